@@ -4,6 +4,7 @@
 
 #include <bench/bench.h>
 
+#include <chainparams.h>
 #include <key.h>
 #include <main.h>
 #include <util.h>
@@ -13,7 +14,10 @@ main(int argc, char** argv)
 {
     ECC_Start();
     SetupEnvironment();
+    ParseParameters(argc, argv);
     fPrintToDebugLog = false; // don't want to write to debug.log file
+    fPrintToConsole = GetBoolArg("-printtoconsole", false);
+    SelectParams(CBaseChainParams::REGTEST); // fixtures rely on regtest activation windows
 
     benchmark::BenchRunner::RunAll();
 
@@ -0,0 +1,140 @@
+// Copyright (c) 2020 The Navcoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <chain.h>
+#include <coins.h>
+#include <consensus/dao.h>
+#include <main.h>
+#include <txdb.h>
+#include <util.h>
+
+#include <assert.h>
+
+#ifndef WIN32
+#include <unistd.h>
+#endif
+
+#include <boost/filesystem.hpp>
+
+static const int nBenchBlocks = 5000000;
+static const int nBenchBatch = 100000;
+static const int nBenchVotesPerBlock = 4;
+
+// Resident set size in bytes, or 0 where it can't be read
+static size_t GetResidentMemory()
+{
+    size_t nResident = 0;
+#ifndef WIN32
+    FILE* file = fopen("/proc/self/statm", "r");
+    if (file) {
+        size_t nSize;
+        if (fscanf(file, "%zu %zu", &nSize, &nResident) != 2)
+            nResident = 0;
+        fclose(file);
+    }
+    nResident *= sysconf(_SC_PAGESIZE);
+#endif
+    return nResident;
+}
+
+// Writes a chain of proof of stake blocks to pblocktree, each of them voting on some proposals
+static void WriteBenchBlockIndex()
+{
+    LOCK(cs_main);
+
+    // The first slot holds the last block of the previous batch
+    std::vector<uint256> vHashes(nBenchBatch + 1);
+    std::vector<CBlockIndex> vIndex(nBenchBatch + 1);
+
+    for (int nHeight = 0; nHeight < nBenchBlocks; nHeight += nBenchBatch)
+    {
+        std::vector<const CBlockIndex*> vWrite;
+
+        for (int i = 1; i <= nBenchBatch; i++)
+        {
+            int nBlock = nHeight + i - 1;
+            vHashes[i] = ArithToUint256(arith_uint256(nBlock + 1));
+
+            CBlockIndex& index = vIndex[i];
+            index.SetNull();
+            index.phashBlock = &vHashes[i];
+            index.pprev = nBlock > 0 ? &vIndex[i - 1] : NULL;
+            index.nHeight = nBlock;
+            index.nStatus = BLOCK_VALID_TREE | BLOCK_OPT_DAO | BLOCK_OPT_SUPPLY;
+            index.nFlags = BLOCK_PROOF_OF_STAKE;
+            index.nStakeModifier = nBlock;
+            index.hashProof = arith_uint256(nBlock);
+            index.nVersion = 0x71000000;
+            index.hashMerkleRoot = vHashes[i];
+            index.nTime = 1500000000 + nBlock * 30;
+            index.nBits = 0x1d00ffff;
+            index.nCFSupply = nBlock;
+
+            std::vector<std::pair<uint256, int>>* pVotes = InsertProposalVotes(vHashes[i]);
+            for (int j = 0; j < nBenchVotesPerBlock; j++)
+                pVotes->push_back(std::make_pair(ArithToUint256(arith_uint256(1000000000 + j)), (int)VoteFlags::VOTE_YES));
+
+            vWrite.push_back(&index);
+        }
+
+        bool fWritten = pblocktree->WriteBatchSync(std::vector<std::pair<int, const CBlockFileInfo*> >(), 0, vWrite);
+        assert(fWritten);
+
+        // Drops the votes kept in memory
+        UnloadBlockIndex();
+
+        vHashes[0] = vHashes[nBenchBatch];
+        vIndex[0] = vIndex[nBenchBatch];
+        vIndex[0].phashBlock = &vHashes[0];
+    }
+}
+
+// Loads a synthetic index of nBenchBlocks blocks from disk, as on startup. It writes
+// the whole index to a temporary directory first, so it only runs with -benchblockindex,
+// and logs the resident memory with -printtoconsole.
+static void LoadBlockIndex5M(benchmark::State& state)
+{
+    if (!GetBoolArg("-benchblockindex", false))
+        return;
+
+    boost::filesystem::path pathTemp = GetTempPath() / strprintf("bench_navcoin_blockindex_%lu", (unsigned long)GetTime());
+    boost::filesystem::create_directories(pathTemp);
+    mapArgs["-datadir"] = pathTemp.string();
+    ClearDatadirCache();
+
+    CStateView dummy;
+    pcoinsTip = new CStateViewCache(&dummy);
+    pblocktree = new CBlockTreeDB(1 << 20, false, true);
+
+    WriteBenchBlockIndex();
+
+    size_t nResidentBefore = GetResidentMemory();
+    size_t nResidentLoaded = 0;
+
+    {
+        LOCK(cs_main);
+
+        while (state.KeepRunning()) {
+            bool fLoaded = LoadBlockIndex();
+            assert(fLoaded && mapBlockIndex.size() == (size_t)nBenchBlocks);
+            nResidentLoaded = GetResidentMemory();
+            UnloadBlockIndex();
+        }
+    }
+
+    LogPrintf("LoadBlockIndex5M: resident memory %u MiB before loading, %u MiB with the index loaded\n",
+              nResidentBefore >> 20, nResidentLoaded >> 20);
+
+    delete pblocktree;
+    pblocktree = NULL;
+    delete pcoinsTip;
+    pcoinsTip = NULL;
+
+    mapArgs.erase("-datadir");
+    ClearDatadirCache();
+    boost::filesystem::remove_all(pathTemp);
+}
+
+BENCHMARK(LoadBlockIndex5M);
@@ -0,0 +1,118 @@
+// Copyright (c) 2020 The Navcoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <blsct/transaction.h>
+#include <blsct/verification.h>
+#include <coins.h>
+#include <consensus/validation.h>
+#include <crypto/common.h>
+#include <primitives/transaction.h>
+
+#include <assert.h>
+
+static bls::PrivateKey DeterministicKey(uint32_t n)
+{
+    uint8_t seed[32] = {0};
+    WriteLE32(seed, n);
+    return bls::PrivateKey::FromSeed(seed, sizeof(seed));
+}
+
+/**
+ * Private to private transactions, each spending its own output of a synthetic
+ * view, all sending to the same sub address.
+ */
+class CBLSCTBenchFixture
+{
+public:
+    CStateView dummy;
+    CStateViewCache view;
+    bls::PrivateKey viewKey;
+    bls::PrivateKey spendKey;
+    std::vector<CTransaction> vTx;
+
+    CBLSCTBenchFixture(size_t nTx) : view(&dummy), viewKey(DeterministicKey(1)), spendKey(DeterministicKey(2))
+    {
+        BulletproofsRangeproof::Init();
+
+        bls::G1Element D = spendKey.GetG1Element();
+        bls::G1Element C = D * viewKey;
+        blsctDoublePublicKey destKey(C, D);
+
+        for (size_t i = 0; i < nTx; i++)
+        {
+            bls::PrivateKey bkPrev = DeterministicKey(100 + 2 * i);
+            bls::PrivateKey bk = DeterministicKey(101 + 2 * i);
+            bls::G1Element nonce;
+            std::string strFailReason;
+            std::vector<bls::G2Element> vBLSSignatures;
+
+            CMutableTransaction prevTx;
+            prevTx.nTime = i;
+            prevTx.vout.resize(1);
+
+            Scalar gammaIns = 0;
+            bool fCreated = CreateBLSCTOutput(bkPrev, nonce, prevTx.vout[0], destKey, 10*COIN, "", gammaIns, strFailReason, false, vBLSSignatures);
+            assert(fCreated);
+
+            view.ModifyCoins(prevTx.GetHash())->FromTx(prevTx, 0);
+
+            CMutableTransaction spendingTx;
+            spendingTx.nVersion |= TX_BLS_CT_FLAG | TX_BLS_INPUT_FLAG;
+            spendingTx.nTime = i;
+            spendingTx.vin.resize(1);
+            spendingTx.vin[0].prevout = COutPoint(prevTx.GetHash(), 0);
+            spendingTx.vout.resize(1);
+
+            Scalar gammaOuts = 0;
+            fCreated = CreateBLSCTOutput(bk, nonce, spendingTx.vout[0], destKey, 10*COIN, "bench", gammaOuts, strFailReason, true, vBLSSignatures);
+            assert(fCreated);
+
+            // Hs(a*R) + b, the spending key of the sub address for the output
+            bls::G1Element t = bls::G1Element::FromByteVector(prevTx.vout[0].outputKey) * viewKey;
+            bls::PrivateKey sk = (Scalar(HashG1Element(t, 0)) + Scalar(spendKey)).GetPrivateKey();
+            SignBLSInput(sk, spendingTx.vin[0], vBLSSignatures);
+
+            spendingTx.vchTxSig = bls::BasicSchemeMPL::Aggregate(vBLSSignatures).Serialize();
+
+            Scalar diff = gammaIns - gammaOuts;
+            spendingTx.vchBalanceSig = bls::BasicSchemeMPL::Sign(diff.GetPrivateKey(), balanceMsg).Serialize();
+
+            vTx.push_back(CTransaction(spendingTx));
+        }
+    }
+};
+
+static void VerifyBLSCTTransaction(benchmark::State& state)
+{
+    CBLSCTBenchFixture fixture(1);
+
+    while (state.KeepRunning()) {
+        std::vector<RangeproofEncodedData> vData;
+        CValidationState validationState;
+        bool fValid = VerifyBLSCT(fixture.vTx[0], fixture.viewKey, vData, fixture.view, validationState);
+        assert(fValid);
+    }
+}
+
+// Combines nTx mixing candidates into a single transaction
+static void Combine(benchmark::State& state, size_t nTx)
+{
+    CBLSCTBenchFixture fixture(nTx);
+
+    while (state.KeepRunning()) {
+        std::set<CTransaction> setTx(fixture.vTx.begin(), fixture.vTx.end());
+        CTransaction outTx;
+        CValidationState validationState;
+        bool fValid = CombineBLSCTTransactions(setTx, outTx, fixture.view, validationState);
+        assert(fValid);
+    }
+}
+
+static void CombineBLSCTTransactions2(benchmark::State& state) { Combine(state, 2); }
+static void CombineBLSCTTransactions8(benchmark::State& state) { Combine(state, 8); }
+
+BENCHMARK(VerifyBLSCTTransaction);
+BENCHMARK(CombineBLSCTTransactions2);
+BENCHMARK(CombineBLSCTTransactions8);
@@ -0,0 +1,129 @@
+// Copyright (c) 2020 The Navcoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <blsct/bulletproofs.h>
+
+#include <assert.h>
+
+#include <boost/thread.hpp>
+
+// Proves 2^logM aggregated values, optionally with the prover threads
+static void Prove(benchmark::State& state, size_t logM, bool fThreads)
+{
+    BulletproofsRangeproof::Init();
+
+    boost::thread_group threadGroup;
+
+    if (fThreads)
+    {
+        for (unsigned int i = 1; i < boost::thread::hardware_concurrency(); i++)
+            threadGroup.create_thread(&ThreadBulletproofsProve);
+    }
+
+    std::vector<Scalar> values(1 << logM);
+
+    for (size_t i = 0; i < values.size(); i++)
+        values[i] = 1000 * (i + 1);
+
+    bls::G1Element nonce = BulletproofsRangeproof::G * Scalar::Rand();
+
+    while (state.KeepRunning()) {
+        BulletproofsRangeproof bprp;
+        bprp.Prove(values, nonce);
+    }
+
+    threadGroup.interrupt_all();
+    threadGroup.join_all();
+}
+
+static void BulletproofsProve1(benchmark::State& state) { Prove(state, 0, false); }
+static void BulletproofsProve2(benchmark::State& state) { Prove(state, 1, false); }
+static void BulletproofsProve4(benchmark::State& state) { Prove(state, 2, false); }
+static void BulletproofsProve8(benchmark::State& state) { Prove(state, 3, false); }
+static void BulletproofsProve16(benchmark::State& state) { Prove(state, 4, false); }
+
+static void BulletproofsProve1Parallel(benchmark::State& state) { Prove(state, 0, true); }
+static void BulletproofsProve2Parallel(benchmark::State& state) { Prove(state, 1, true); }
+static void BulletproofsProve4Parallel(benchmark::State& state) { Prove(state, 2, true); }
+static void BulletproofsProve8Parallel(benchmark::State& state) { Prove(state, 3, true); }
+static void BulletproofsProve16Parallel(benchmark::State& state) { Prove(state, 4, true); }
+
+BENCHMARK(BulletproofsProve1);
+BENCHMARK(BulletproofsProve2);
+BENCHMARK(BulletproofsProve4);
+BENCHMARK(BulletproofsProve8);
+BENCHMARK(BulletproofsProve16);
+BENCHMARK(BulletproofsProve1Parallel);
+BENCHMARK(BulletproofsProve2Parallel);
+BENCHMARK(BulletproofsProve4Parallel);
+BENCHMARK(BulletproofsProve8Parallel);
+BENCHMARK(BulletproofsProve16Parallel);
+
+// Verifies a batch of nProofs single value proofs, as in a block
+static void Verify(benchmark::State& state, size_t nProofs)
+{
+    BulletproofsRangeproof::Init();
+
+    std::vector<std::pair<int, BulletproofsRangeproof>> proofs;
+    std::vector<bls::G1Element> nonces;
+
+    for (size_t i = 0; i < nProofs; i++)
+    {
+        bls::G1Element nonce = BulletproofsRangeproof::G * Scalar(i + 1);
+        std::vector<Scalar> values(1, Scalar(1000 * (i + 1)));
+
+        BulletproofsRangeproof bprp;
+        bprp.Prove(values, nonce);
+
+        proofs.push_back(std::make_pair(i, bprp));
+        nonces.push_back(nonce);
+    }
+
+    while (state.KeepRunning()) {
+        std::vector<RangeproofEncodedData> data;
+        bool fValid = VerifyBulletproof(proofs, data, nonces);
+        assert(fValid);
+    }
+}
+
+static void BulletproofsVerify1(benchmark::State& state) { Verify(state, 1); }
+static void BulletproofsVerify8(benchmark::State& state) { Verify(state, 8); }
+static void BulletproofsVerify64(benchmark::State& state) { Verify(state, 64); }
+
+BENCHMARK(BulletproofsVerify1);
+BENCHMARK(BulletproofsVerify8);
+BENCHMARK(BulletproofsVerify64);
+
+// Field arithmetic of the prover and verifier inner loops
+static void ScalarMul(benchmark::State& state)
+{
+    Scalar::Init();
+
+    Scalar a = Scalar::Rand();
+    Scalar b = Scalar::Rand();
+
+    while (state.KeepRunning()) {
+        for (int i = 0; i < 1000; i++)
+            a = a * b + b;
+    }
+}
+
+static void ScalarVectorInvert(benchmark::State& state)
+{
+    Scalar::Init();
+
+    std::vector<Scalar> values(128);
+
+    for (size_t i = 0; i < values.size(); i++)
+        values[i] = Scalar::Rand();
+
+    while (state.KeepRunning()) {
+        std::vector<Scalar> inverses = VectorInvert(values);
+        assert(inverses[0] * values[0] == 1);
+    }
+}
+
+BENCHMARK(ScalarMul);
+BENCHMARK(ScalarVectorInvert);
@@ -7,6 +7,7 @@
 #include <bench/bench.h>
 #include <bloom.h>
 #include <hash.h>
+#include <primitives/block.h>
 #include <uint256.h>
 #include <utiltime.h>
 #include <crypto/ripemd160.h>
@@ -69,6 +70,37 @@ static void SipHash_32b(benchmark::State& state)
     }
 }
 
+// Proof of work hash of a block header, one per nonce
+static void X13_Header(benchmark::State& state)
+{
+    CBlockHeader header;
+    header.nVersion = 6;
+    header.nTime = 1500000000;
+    header.nBits = 0x1d00ffff;
+    while (state.KeepRunning()) {
+        for (int i = 0; i < 1000; i++) {
+            header.nNonce = i;
+            header.GetPoWHash();
+        }
+    }
+}
+
+// Proof of work hashes of consecutive headers, as received in a headers message
+static void X13_Headers(benchmark::State& state)
+{
+    std::vector<CBlock> headers(1000);
+    for (size_t i = 0; i < headers.size(); i++) {
+        headers[i].nVersion = 6; // Pre-v7 headers are hashed with X13
+        headers[i].nTime = 1500000000;
+        headers[i].nBits = 0x1d00ffff;
+        headers[i].nNonce = i;
+    }
+    std::vector<uint256> vHashes;
+    while (state.KeepRunning()) {
+        GetBlockHeaderHashes(headers, vHashes);
+    }
+}
+
 BENCHMARK(RIPEMD160);
 BENCHMARK(SHA1);
 BENCHMARK(SHA256);
@@ -76,3 +108,5 @@ BENCHMARK(SHA512);
 
 BENCHMARK(SHA256_32b);
 BENCHMARK(SipHash_32b);
+BENCHMARK(X13_Header);
+BENCHMARK(X13_Headers);
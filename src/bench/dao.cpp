@@ -0,0 +1,198 @@
+// Copyright (c) 2020 The Navcoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <chain.h>
+#include <chainparams.h>
+#include <coins.h>
+#include <consensus/dao.h>
+#include <consensus/validation.h>
+#include <main.h>
+#include <versionbits.h>
+
+#include <assert.h>
+
+static const int nBenchProposals = 64;
+
+/**
+ * Synthetic chain with the community fund and consultations active, on which
+ * every block of the last voting cycle votes on nBenchProposals proposals.
+ */
+class CDAOBenchFixture
+{
+public:
+    CStateView dummy;
+    CStateViewCache base;
+    std::vector<uint256> vHashes;
+    std::vector<CBlockIndex*> vIndex;
+    int nCycleLength;
+
+    CDAOBenchFixture() : base(&dummy)
+    {
+        LOCK(cs_main);
+
+        const Consensus::Params& params = Params().GetConsensus();
+        nCycleLength = GetConsensusParameter(Consensus::CONSENSUS_PARAM_VOTING_CYCLE_LENGTH, base);
+
+        // Enough blocks for both deployments to lock in and activate, ending with a whole cycle
+        int nHeight = 3 * params.nMinerConfirmationWindow;
+        nHeight += nCycleLength - (nHeight % nCycleLength);
+
+        vHashes.resize(nHeight + nCycleLength);
+        vIndex.resize(vHashes.size());
+
+        int32_t nVersion = VERSIONBITS_TOP_BITS |
+                (1 << params.vDeployments[Consensus::DEPLOYMENT_COMMUNITYFUND].bit) |
+                (1 << params.vDeployments[Consensus::DEPLOYMENT_CONSULTATIONS].bit);
+
+        for (size_t i = 0; i < vIndex.size(); i++)
+        {
+            vHashes[i] = ArithToUint256(arith_uint256(i + 1));
+
+            CBlockIndex* pindex = new CBlockIndex();
+            pindex->phashBlock = &vHashes[i];
+            pindex->pprev = i > 0 ? vIndex[i - 1] : NULL;
+            pindex->nHeight = i;
+            pindex->nTime = 1500000000 + i * 30;
+            pindex->nVersion = nVersion;
+            pindex->nNonce = 0;
+            pindex->BuildSkip();
+
+            mapBlockIndex[vHashes[i]] = pindex;
+            vIndex[i] = pindex;
+        }
+
+        // Proposals are created in the first block, well before the voting cycle
+        for (int j = 0; j < nBenchProposals; j++)
+        {
+            CProposal proposal;
+            proposal.hash = ArithToUint256(arith_uint256(1000000 + j));
+            proposal.txblockhash = vHashes[1];
+            proposal.nAmount = COIN;
+            proposal.nDeadline = 1000000000;
+            proposal.nVersion = CProposal::BASE_VERSION | CProposal::REDUCED_QUORUM_VERSION | CProposal::ABSTAIN_VOTE_VERSION;
+            base.AddProposal(proposal);
+        }
+
+        for (size_t i = nHeight; i < vIndex.size(); i++)
+        {
+            std::vector<std::pair<uint256, int>>* pVotes = InsertProposalVotes(vHashes[i]);
+
+            for (int j = 0; j < nBenchProposals; j++)
+                pVotes->push_back(std::make_pair(ArithToUint256(arith_uint256(1000000 + j)),
+                                                 (i + j) % 3 ? VoteFlags::VOTE_YES : VoteFlags::VOTE_NO));
+        }
+    }
+
+    int CycleStart() const
+    {
+        return vIndex.size() - nCycleLength;
+    }
+};
+
+static CDAOBenchFixture& GetDAOBenchFixture()
+{
+    static CDAOBenchFixture fixture;
+    return fixture;
+}
+
+// Connects each block of a voting cycle, as when syncing the chain
+static void VoteStepCycle(benchmark::State& state)
+{
+    CDAOBenchFixture& fixture = GetDAOBenchFixture();
+    CValidationState valState;
+
+    LOCK(cs_main);
+
+    while (state.KeepRunning()) {
+        CStateViewCache view(&fixture.base);
+        ResetVoteTally();
+
+        for (size_t i = fixture.CycleStart(); i < fixture.vIndex.size(); i++) {
+            bool fStep = VoteStep(valState, fixture.vIndex[i], false, view);
+            assert(fStep);
+        }
+    }
+}
+
+// Counts the votes of a whole cycle from the block index, as after a reorganization
+static void VoteStepRescan(benchmark::State& state)
+{
+    CDAOBenchFixture& fixture = GetDAOBenchFixture();
+    CValidationState valState;
+
+    LOCK(cs_main);
+
+    while (state.KeepRunning()) {
+        CStateViewCache view(&fixture.base);
+        ResetVoteTally();
+
+        bool fStep = VoteStep(valState, fixture.vIndex.back(), false, view);
+        assert(fStep);
+    }
+}
+
+// Flushes the DAO entries of a child cache to its parent
+static void BatchWriteDAO(benchmark::State& state)
+{
+    CStateView dummy;
+
+    CCoinsMap mapCoins;
+    CProposalMap mapProposals;
+    CPaymentRequestMap mapPaymentRequests;
+    CVoteMap mapVotes;
+    CConsultationMap mapConsultations;
+    CConsultationAnswerMap mapAnswers;
+    CConsensusParameterMap mapConsensus;
+
+    for (int i = 0; i < 1000; i++)
+    {
+        uint256 hash = ArithToUint256(arith_uint256(i + 1));
+
+        CMutableTransaction tx;
+        tx.nTime = i;
+        tx.vout.resize(1);
+        tx.vout[0].nValue = i;
+
+        CCoinsCacheEntry& entry = mapCoins[tx.GetHash()];
+        entry.coins = CCoins(tx, i);
+        entry.flags = CCoinsCacheEntry::DIRTY;
+
+        CProposal& proposal = mapProposals[hash];
+        proposal.hash = hash;
+        proposal.nAmount = i;
+
+        CPaymentRequest& prequest = mapPaymentRequests[hash];
+        prequest.hash = hash;
+        prequest.proposalhash = hash;
+
+        CVoteMapKey voter(hash.begin(), hash.end());
+        mapVotes[voter].Set(i, hash, VoteFlags::VOTE_YES);
+
+        CConsultation& consultation = mapConsultations[hash];
+        consultation.hash = hash;
+
+        CConsultationAnswer& answer = mapAnswers[hash];
+        answer.hash = hash;
+        answer.parent = hash;
+    }
+
+    while (state.KeepRunning()) {
+        CStateViewCache view(&dummy);
+
+        CCoinsMap coins(mapCoins);
+        CProposalMap proposals(mapProposals);
+        CPaymentRequestMap prequests(mapPaymentRequests);
+        CVoteMap votes(mapVotes);
+        CConsultationMap consultations(mapConsultations);
+        CConsultationAnswerMap answers(mapAnswers);
+        CConsensusParameterMap consensus(mapConsensus);
+
+        view.BatchWrite(coins, proposals, prequests, votes, consultations, answers, consensus, uint256(), -1);
+    }
+}
+
+BENCHMARK(VoteStepCycle);
+BENCHMARK(VoteStepRescan);
+BENCHMARK(BatchWriteDAO);
@@ -0,0 +1,106 @@
+// Copyright (c) 2020 The Navcoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <blsct/bulletproofs.h>
+
+// Sizes of the multi-exponentiation run by VerifyBulletproof for a single
+// output (2*64 generators + G, H) and for the maximum of 16 aggregated values
+static const size_t nSmall = 2 * maxN + 2;
+static const size_t nLarge = 2 * maxMN + 2;
+
+static std::vector<MultiexpData> RandomMultiexpData(size_t n)
+{
+    BulletproofsRangeproof::Init();
+
+    std::vector<MultiexpData> data(n);
+
+    for (size_t i = 0; i < n; i++)
+    {
+        data[i].base = BulletproofsRangeproof::G * Scalar::Rand();
+        data[i].exp = Scalar::Rand();
+    }
+
+    return data;
+}
+
+static void MultiExpLegacySmall(benchmark::State& state)
+{
+    std::vector<MultiexpData> data = RandomMultiexpData(nSmall);
+    while (state.KeepRunning()) {
+        MultiExpLegacy(data);
+    }
+}
+
+static void MultiExpMulVecSmall(benchmark::State& state)
+{
+    std::vector<MultiexpData> data = RandomMultiexpData(nSmall);
+    while (state.KeepRunning()) {
+        MultiExpMulVec(data);
+    }
+}
+
+static void MultiExpMulVecLarge(benchmark::State& state)
+{
+    std::vector<MultiexpData> data = RandomMultiexpData(nLarge);
+    while (state.KeepRunning()) {
+        MultiExpMulVec(data);
+    }
+}
+
+static void MultiExpPippengerLarge(benchmark::State& state)
+{
+    std::vector<MultiexpData> data = RandomMultiexpData(nLarge);
+    std::vector<G1> bases(nLarge);
+    std::vector<Fr> exps(nLarge);
+
+    for (size_t i = 0; i < nLarge; i++)
+    {
+        std::vector<unsigned char> base = data[i].base.Serialize();
+        std::vector<unsigned char> exp = data[i].exp.GetVch();
+        bases[i].deserialize(&base[0], base.size());
+        exps[i].deserialize(&exp[0], exp.size());
+    }
+
+    G1 result;
+    while (state.KeepRunning()) {
+        MultiExpPippenger(result, bases.data(), exps.data(), nLarge);
+    }
+}
+
+static void MultiExpGenerators(benchmark::State& state, size_t n)
+{
+    BulletproofsRangeproof::Init();
+
+    std::vector<size_t> indexes(n);
+    std::vector<Fr> exps(n);
+
+    for (size_t i = 0; i < n; i++)
+    {
+        indexes[i] = i;
+        exps[i].setByCSPRNG();
+    }
+
+    G1 result;
+    while (state.KeepRunning()) {
+        BulletproofsRangeproof::generators.MultiExp(result, indexes.data(), exps.data(), n);
+    }
+}
+
+static void MultiExpGeneratorsSmall(benchmark::State& state)
+{
+    MultiExpGenerators(state, nSmall);
+}
+
+static void MultiExpGeneratorsLarge(benchmark::State& state)
+{
+    MultiExpGenerators(state, nLarge);
+}
+
+BENCHMARK(MultiExpLegacySmall);
+BENCHMARK(MultiExpMulVecSmall);
+BENCHMARK(MultiExpGeneratorsSmall);
+BENCHMARK(MultiExpMulVecLarge);
+BENCHMARK(MultiExpPippengerLarge);
+BENCHMARK(MultiExpGeneratorsLarge);
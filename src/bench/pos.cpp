@@ -0,0 +1,64 @@
+// Copyright (c) 2020 The Navcoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <chain.h>
+#include <chainparams.h>
+#include <kernel.h>
+#include <main.h>
+#include <primitives/transaction.h>
+
+// Number of coinstake times checked per iteration, as in a stake kernel search
+static const unsigned int nKernelTimes = 1000;
+static const unsigned int nKernelBits = 0x1b00ffff;
+static const unsigned int nKernelTimeBlockFrom = 1500000000;
+
+static CMutableTransaction KernelPrevTx()
+{
+    CMutableTransaction txPrev;
+    txPrev.nTime = nKernelTimeBlockFrom;
+    txPrev.vout.resize(1);
+    txPrev.vout[0].nValue = 1000 * COIN;
+    return txPrev;
+}
+
+static void CheckStakeKernelHash(benchmark::State& state)
+{
+    CTransaction txPrev(KernelPrevTx());
+    COutPoint prevout(txPrev.GetHash(), 0);
+
+    CBlockIndex indexPrev;
+    indexPrev.nStakeModifier = 0x0123456789abcdefULL;
+
+    CBlockIndex indexFrom;
+    indexFrom.nTime = nKernelTimeBlockFrom;
+
+    unsigned int nTimeTx = nKernelTimeBlockFrom + Params().GetConsensus().nStakeMinAge + nKernelTimes;
+
+    while (state.KeepRunning()) {
+        for (unsigned int n = 0; n < nKernelTimes; n++) {
+            arith_uint256 hashProofOfStake, targetProofOfStake;
+            CheckStakeKernelHash(&indexPrev, nKernelBits, indexFrom, txPrev, prevout, nTimeTx - n, hashProofOfStake, targetProofOfStake);
+        }
+    }
+}
+
+static void CheckStakeKernelPrecomputed(benchmark::State& state)
+{
+    CTransaction txPrev(KernelPrevTx());
+
+    CStakeKernel kernel(0x0123456789abcdefULL, nKernelBits, nKernelTimeBlockFrom, txPrev.nTime,
+                        txPrev.vout[0].nValue, COutPoint(txPrev.GetHash(), 0));
+
+    unsigned int nTimeTx = nKernelTimeBlockFrom + kernel.nStakeMinAge + nKernelTimes;
+
+    while (state.KeepRunning()) {
+        for (unsigned int n = 0; n < nKernelTimes; n++) {
+            kernel.Check(nTimeTx - n);
+        }
+    }
+}
+
+BENCHMARK(CheckStakeKernelHash);
+BENCHMARK(CheckStakeKernelPrecomputed);
@@ -0,0 +1,294 @@
+// Copyright (c) 2020 The Navcoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <blockfilereader.h>
+
+#include <chain.h>
+#include <consensus/consensus.h>
+#include <crypto/common.h>
+#include <main.h>
+#include <util.h>
+
+#include <string.h>
+
+CBlockFileReader blockFileReader;
+CRawBlockCache rawBlockCache;
+
+// Message start and size written before every block
+static const unsigned int BLOCK_HEADER_SIZE = CMessageHeader::MESSAGE_START_SIZE + sizeof(uint32_t);
+
+CBlockFileReader::CBlockFileReader(size_t nMaxFilesIn, size_t nReadAheadIn) :
+    nMaxFiles(std::max(nMaxFilesIn, (size_t)1)), nReadAhead(nReadAheadIn), nUseCounter(0)
+{
+}
+
+CBlockFileReader::~CBlockFileReader()
+{
+    Clear();
+}
+
+void CBlockFileReader::CloseFile(std::map<int, CBlockFile>::iterator it)
+{
+    for (FILE* file: it->second.vFiles)
+        fclose(file);
+    mapFiles.erase(it);
+}
+
+CBlockFileReader::CBlockFile& CBlockFileReader::GetFile(int nFile)
+{
+    std::map<int, CBlockFile>::iterator it = mapFiles.find(nFile);
+
+    if (it == mapFiles.end())
+    {
+        // Closes the least recently used file
+        if (mapFiles.size() >= nMaxFiles)
+        {
+            std::map<int, CBlockFile>::iterator itOldest = mapFiles.begin();
+            for (std::map<int, CBlockFile>::iterator itFile = mapFiles.begin(); itFile != mapFiles.end(); ++itFile)
+                if (itFile->second.nLastUsed < itOldest->second.nLastUsed)
+                    itOldest = itFile;
+            CloseFile(itOldest);
+        }
+
+        it = mapFiles.insert(std::make_pair(nFile, CBlockFile())).first;
+        it->second.nId = ++nUseCounter;
+    }
+
+    it->second.nLastUsed = ++nUseCounter;
+    return it->second;
+}
+
+// Gives back the handle used by a read, and the window it read ahead if the file was not written to meanwhile
+void CBlockFileReader::EndRead(int nFile, uint64_t nId, FILE* file, unsigned int nNextPos, uint64_t nWindowId, unsigned int nStart, const std::shared_ptr<const std::vector<char> >& pWindow)
+{
+    LOCK(cs);
+
+    std::map<int, CBlockFile>::iterator it = mapFiles.find(nFile);
+
+    if (it == mapFiles.end() || it->second.nId != nId)
+    {
+        if (file)
+            fclose(file);
+        return;
+    }
+
+    if (file)
+        it->second.vFiles.push_back(file);
+
+    it->second.nNextPos = nNextPos;
+
+    if (pWindow && it->second.nWindowId == nWindowId)
+    {
+        it->second.pWindow = pWindow;
+        it->second.nStart = nStart;
+    }
+}
+
+// Checks the message start of the header and returns the size of the block which follows it
+static bool ReadBlockHeader(const char* pheader, const CMessageHeader::MessageStartChars& messageStart, const CDiskBlockPos& pos, unsigned int& nSize)
+{
+    if (memcmp(pheader, messageStart, CMessageHeader::MESSAGE_START_SIZE))
+        return error("%s: block magic mismatch at %s", __func__, pos.ToString());
+
+    nSize = ReadLE32((const unsigned char*)pheader + CMessageHeader::MESSAGE_START_SIZE);
+    if (nSize > MAX_BLOCK_SERIALIZED_SIZE)
+        return error("%s: block size %u too large at %s", __func__, nSize, pos.ToString());
+
+    return true;
+}
+
+// Reads at least nReadSize bytes from nHeaderPos, and then whatever is left of the block
+static bool ReadBlockFromFile(FILE* file, unsigned int nHeaderPos, size_t nReadSize, const CMessageHeader::MessageStartChars& messageStart,
+                              const CDiskBlockPos& pos, std::vector<char>& vchRead, unsigned int& nSize)
+{
+    if (fseek(file, nHeaderPos, SEEK_SET))
+        return error("%s: I/O error at %s", __func__, pos.ToString());
+
+    vchRead.resize(std::max(nReadSize, (size_t)BLOCK_HEADER_SIZE));
+    vchRead.resize(fread(vchRead.data(), 1, vchRead.size(), file));
+    if (ferror(file))
+        return error("%s: I/O error at %s", __func__, pos.ToString());
+    if (vchRead.size() < BLOCK_HEADER_SIZE)
+        return error("%s: unexpected end of file at %s", __func__, pos.ToString());
+
+    if (!ReadBlockHeader(vchRead.data(), messageStart, pos, nSize))
+        return false;
+
+    size_t nHave = vchRead.size();
+    if (nHave < BLOCK_HEADER_SIZE + nSize)
+    {
+        vchRead.resize(BLOCK_HEADER_SIZE + nSize);
+        size_t nRead = fread(vchRead.data() + nHave, 1, vchRead.size() - nHave, file);
+        if (ferror(file))
+            return error("%s: I/O error at %s", __func__, pos.ToString());
+        if (nHave + nRead < vchRead.size())
+            return error("%s: unexpected end of file at %s", __func__, pos.ToString());
+    }
+
+    return true;
+}
+
+bool CBlockFileReader::ReadRawBlock(const CDiskBlockPos& pos, const CMessageHeader::MessageStartChars& messageStart, std::vector<char>& vchBlock)
+{
+    vchBlock.clear();
+
+    if (pos.nPos < BLOCK_HEADER_SIZE)
+        return error("%s: invalid position %s", __func__, pos.ToString());
+
+    unsigned int nHeaderPos = pos.nPos - BLOCK_HEADER_SIZE;
+    std::shared_ptr<const std::vector<char> > pWindow;
+    unsigned int nStart;
+    bool fSequential;
+    uint64_t nId, nWindowId;
+    FILE* file = NULL;
+
+    {
+        LOCK(cs);
+
+        CBlockFile& blockFile = GetFile(pos.nFile);
+        pWindow = blockFile.pWindow;
+        nStart = blockFile.nStart;
+        fSequential = nHeaderPos == blockFile.nNextPos;
+        nId = blockFile.nId;
+        nWindowId = blockFile.nWindowId;
+
+        if (!blockFile.vFiles.empty())
+        {
+            file = blockFile.vFiles.back();
+            blockFile.vFiles.pop_back();
+        }
+    }
+
+    unsigned int nSize;
+
+    if (pWindow && nHeaderPos >= nStart && nHeaderPos + BLOCK_HEADER_SIZE <= nStart + pWindow->size())
+    {
+        const char* pheader = &(*pWindow)[nHeaderPos - nStart];
+
+        if (!ReadBlockHeader(pheader, messageStart, pos, nSize))
+        {
+            EndRead(pos.nFile, nId, file, nHeaderPos, nWindowId, 0, nullptr);
+            return false;
+        }
+
+        if (pos.nPos + nSize <= nStart + pWindow->size())
+        {
+            vchBlock.assign(pheader + BLOCK_HEADER_SIZE, pheader + BLOCK_HEADER_SIZE + nSize);
+            EndRead(pos.nFile, nId, file, pos.nPos + nSize, nWindowId, 0, nullptr);
+            return true;
+        }
+
+        // The block goes on past the window, so the next window starts with it
+        fSequential = true;
+    }
+
+    if (!file)
+        file = OpenBlockFile(CDiskBlockPos(pos.nFile, 0), true);
+    if (!file)
+    {
+        EndRead(pos.nFile, nId, NULL, nHeaderPos, nWindowId, 0, nullptr);
+        return error("%s: OpenBlockFile failed for %s", __func__, pos.ToString());
+    }
+
+    std::shared_ptr<std::vector<char> > pRead = std::make_shared<std::vector<char> >();
+
+    if (!ReadBlockFromFile(file, nHeaderPos, fSequential ? nReadAhead : 0, messageStart, pos, *pRead, nSize))
+    {
+        // The handle may be left in an error state
+        fclose(file);
+        EndRead(pos.nFile, nId, NULL, nHeaderPos, nWindowId, 0, nullptr);
+        return false;
+    }
+
+    vchBlock.assign(pRead->begin() + BLOCK_HEADER_SIZE, pRead->begin() + BLOCK_HEADER_SIZE + nSize);
+
+    if (fSequential)
+        EndRead(pos.nFile, nId, file, pos.nPos + nSize, nWindowId, nHeaderPos, pRead);
+    else
+        EndRead(pos.nFile, nId, file, pos.nPos + nSize, nWindowId, 0, nullptr);
+
+    return true;
+}
+
+void CBlockFileReader::Invalidate(const CDiskBlockPos& pos, unsigned int nSize)
+{
+    LOCK(cs);
+
+    std::map<int, CBlockFile>::iterator it = mapFiles.find(pos.nFile);
+    if (it == mapFiles.end())
+        return;
+
+    // Reads in progress may have seen the old contents, so they don't keep their window
+    CBlockFile& blockFile = it->second;
+    blockFile.nWindowId = ++nUseCounter;
+
+    unsigned int nBegin = pos.nPos >= BLOCK_HEADER_SIZE ? pos.nPos - BLOCK_HEADER_SIZE : 0;
+    if (blockFile.pWindow && nBegin < blockFile.nStart + blockFile.pWindow->size() && blockFile.nStart < pos.nPos + nSize)
+        blockFile.pWindow.reset();
+}
+
+void CBlockFileReader::Invalidate(int nFile)
+{
+    LOCK(cs);
+
+    std::map<int, CBlockFile>::iterator it = mapFiles.find(nFile);
+    if (it != mapFiles.end())
+        CloseFile(it);
+}
+
+void CBlockFileReader::Clear()
+{
+    LOCK(cs);
+
+    while (!mapFiles.empty())
+        CloseFile(mapFiles.begin());
+}
+
+std::shared_ptr<const CRawBlock> CRawBlockCache::Get(const uint256& hash)
+{
+    LOCK(cs);
+
+    std::map<uint256, list_type::iterator>::iterator it = mapBlocks.find(hash);
+    if (it == mapBlocks.end())
+        return std::shared_ptr<const CRawBlock>();
+
+    listBlocks.splice(listBlocks.begin(), listBlocks, it->second);
+    return it->second->second;
+}
+
+void CRawBlockCache::Insert(const uint256& hash, const std::shared_ptr<const CRawBlock>& pblock)
+{
+    if (pblock->vchBlock.size() > nMaxSize)
+        return;
+
+    LOCK(cs);
+
+    std::map<uint256, list_type::iterator>::iterator it = mapBlocks.find(hash);
+    if (it != mapBlocks.end())
+    {
+        nSize -= it->second->second->vchBlock.size();
+        listBlocks.erase(it->second);
+        mapBlocks.erase(it);
+    }
+
+    while (!listBlocks.empty() && nSize + pblock->vchBlock.size() > nMaxSize)
+    {
+        nSize -= listBlocks.back().second->vchBlock.size();
+        mapBlocks.erase(listBlocks.back().first);
+        listBlocks.pop_back();
+    }
+
+    listBlocks.push_front(std::make_pair(hash, pblock));
+    mapBlocks[hash] = listBlocks.begin();
+    nSize += pblock->vchBlock.size();
+}
+
+void CRawBlockCache::Clear()
+{
+    LOCK(cs);
+
+    listBlocks.clear();
+    mapBlocks.clear();
+    nSize = 0;
+}
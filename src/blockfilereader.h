@@ -0,0 +1,118 @@
+// Copyright (c) 2020 The Navcoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef NAVCOIN_BLOCKFILEREADER_H
+#define NAVCOIN_BLOCKFILEREADER_H
+
+#include <protocol.h>
+#include <sync.h>
+#include <uint256.h>
+
+#include <list>
+#include <map>
+#include <memory>
+#include <stdint.h>
+#include <stdio.h>
+#include <vector>
+
+struct CDiskBlockPos;
+
+/** Number of blk files kept open by the block file reader */
+static const size_t DEFAULT_BLOCK_READER_FILES = 8;
+/** Bytes read at once from a blk file, so the blocks which follow are served from memory */
+static const size_t DEFAULT_BLOCK_READ_AHEAD = 4 * 1024 * 1024;
+/** Bytes of recently served blocks kept in memory */
+static const size_t DEFAULT_RAW_BLOCK_CACHE_SIZE = 16 * 1024 * 1024;
+
+/**
+ * Reads serialized blocks from the blk files. The most recently used files are kept open
+ * together with a window of their contents. The window is read ahead of a block which
+ * starts where the previous read of the file ended, so sequential reads (rescans, peers
+ * syncing from us) mostly don't touch the disk, while random reads only fetch the block.
+ * The disk is read without holding the lock, each read using its own handle of the file.
+ */
+class CBlockFileReader
+{
+private:
+    struct CBlockFile
+    {
+        //! Handles not used by any read
+        std::vector<FILE*> vFiles;
+        std::shared_ptr<const std::vector<char> > pWindow;
+        unsigned int nStart;
+        //! Where the last block read from this file ended
+        unsigned int nNextPos;
+        //! Changes when the file is dropped, or written to while it is read
+        uint64_t nId;
+        uint64_t nWindowId;
+        uint64_t nLastUsed;
+
+        CBlockFile() : nStart(0), nNextPos(0), nId(0), nWindowId(0), nLastUsed(0) {}
+    };
+
+    CCriticalSection cs;
+    std::map<int, CBlockFile> mapFiles;
+    size_t nMaxFiles;
+    size_t nReadAhead;
+    uint64_t nUseCounter;
+
+    CBlockFile& GetFile(int nFile);
+    void EndRead(int nFile, uint64_t nId, FILE* file, unsigned int nNextPos, uint64_t nWindowId, unsigned int nStart, const std::shared_ptr<const std::vector<char> >& pWindow);
+    void CloseFile(std::map<int, CBlockFile>::iterator it);
+
+public:
+    CBlockFileReader(size_t nMaxFilesIn = DEFAULT_BLOCK_READER_FILES, size_t nReadAheadIn = DEFAULT_BLOCK_READ_AHEAD);
+    ~CBlockFileReader();
+
+    /** Reads the serialized block stored at pos, checking the message start and size written before it */
+    bool ReadRawBlock(const CDiskBlockPos& pos, const CMessageHeader::MessageStartChars& messageStart, std::vector<char>& vchBlock);
+
+    /** Drops what is kept of the block of nSize bytes written at pos, and of the header before it */
+    void Invalidate(const CDiskBlockPos& pos, unsigned int nSize);
+    /** Drops what is kept of a file, which has to be done before it is removed */
+    void Invalidate(int nFile);
+    void Clear();
+};
+
+/** A block as serialized on disk, and whether any of its transactions has witness data */
+struct CRawBlock
+{
+    std::vector<char> vchBlock;
+    bool fWitnessKnown;
+    bool fHasWitness;
+
+    CRawBlock() : fWitnessKnown(false), fHasWitness(false) {}
+
+    /** Whether the bytes are also the serialization without witnesses */
+    bool IsWitnessFree() const { return fWitnessKnown && !fHasWitness; }
+};
+
+/**
+ * Least recently used cache of the blocks served to peers, so the tip blocks several
+ * peers ask for are read from disk once.
+ */
+class CRawBlockCache
+{
+private:
+    typedef std::list<std::pair<uint256, std::shared_ptr<const CRawBlock> > > list_type;
+
+    CCriticalSection cs;
+    list_type listBlocks;
+    std::map<uint256, list_type::iterator> mapBlocks;
+    size_t nMaxSize;
+    size_t nSize;
+
+public:
+    CRawBlockCache(size_t nMaxSizeIn = DEFAULT_RAW_BLOCK_CACHE_SIZE) : nMaxSize(nMaxSizeIn), nSize(0) {}
+
+    std::shared_ptr<const CRawBlock> Get(const uint256& hash);
+    /** Adds the block, replacing what was kept for the same hash */
+    void Insert(const uint256& hash, const std::shared_ptr<const CRawBlock>& pblock);
+    void Clear();
+};
+
+extern CBlockFileReader blockFileReader;
+extern CRawBlockCache rawBlockCache;
+
+#endif // NAVCOIN_BLOCKFILEREADER_H
@@ -3,8 +3,11 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "aggregationsession.h"
+#include <checkqueue.h>
 #include <main.h>
 
+#include <boost/bind.hpp>
+
 CCriticalSection cs_aggregation;
 CCriticalSection cs_sessionKeys;
 
@@ -524,7 +527,7 @@ bool AggregationSession::BuildCandidateTransaction(const CWalletTx *prevcoin, co
     {
         // Balance Sig
         Scalar diff = gammaIns-gammaOuts;
-        bls::PrivateKey balanceSigningKey = bls::PrivateKey::FromBN(diff.bn);
+        bls::PrivateKey balanceSigningKey = diff.GetPrivateKey();
         candidate.vchBalanceSig = bls::BasicSchemeMPL::Sign(balanceSigningKey, balanceMsg).Serialize();
         // Tx Sig
         candidate.vchTxSig = bls::BasicSchemeMPL::Aggregate(vBLSSignatures).Serialize();
@@ -990,6 +993,177 @@ void AggregationSessionThread()
     }
 }
 
+/** A candidate which passed MatchKey() with one of the session keys */
+struct CandidateMatch
+{
+    size_t nCandidate;
+    size_t nKey;
+    bls::G1Element publicKey;
+    uint256 hashedSharedKey;
+    bool fValid;
+    CandidateTransaction tx;
+};
+
+static CCriticalSection cs_candidateStats;
+static CandidateVerificationStats candidateStats = {};
+static int64_t nCandidateTotalLatency = 0;
+
+CandidateVerificationStats GetCandidateVerificationStats()
+{
+    LOCK(cs_candidateStats);
+    CandidateVerificationStats ret = candidateStats;
+    ret.nQueued = candidatesQueue.size();
+    ret.nAvgLatency = ret.nProcessed > 0 ? nCandidateTotalLatency / (int64_t)ret.nProcessed : 0;
+    return ret;
+}
+
+static void UpdateCandidateVerificationStats(const std::vector<EncryptedCandidateTransaction>& vBatch, uint64_t nMatched, uint64_t nAccepted)
+{
+    int64_t nNow = GetTimeMillis();
+    int64_t nLatency = 0;
+
+    LOCK(cs_candidateStats);
+    for (auto& etx: vBatch)
+    {
+        nLatency = std::max(nLatency, nNow - etx.nTime);
+        nCandidateTotalLatency += nNow - etx.nTime;
+    }
+    candidateStats.nProcessed += vBatch.size();
+    candidateStats.nMatched += nMatched;
+    candidateStats.nAccepted += nAccepted;
+    candidateStats.nLastLatency = nLatency;
+    candidateStats.nMaxLatency = std::max(candidateStats.nMaxLatency, nLatency);
+
+    LogPrint("aggregationsession", "AggregationSession::%s: verified %u candidates, %u matched, %u accepted, %dms since reception\n",
+             __func__, vBatch.size(), nMatched, nAccepted, nLatency);
+}
+
+/** Decryption and signature check of one match, run by the candidate verification workers */
+class CCandidateMatchCheck
+{
+private:
+    CandidateMatch *pmatch;
+    const EncryptedCandidateTransaction *petx;
+    const std::pair<uint256, bls::PrivateKey> *pkey;
+
+public:
+    CCandidateMatchCheck(): pmatch(0), petx(0), pkey(0) {}
+    CCandidateMatchCheck(CandidateMatch& matchIn, const EncryptedCandidateTransaction& etxIn, const std::pair<uint256, bls::PrivateKey>& keyIn) :
+        pmatch(&matchIn), petx(&etxIn), pkey(&keyIn) { }
+
+    // Always succeeds, so the failure of one match does not skip the rest of the batch
+    bool operator()()
+    {
+        try
+        {
+            pmatch->fValid = petx->Decrypt(pmatch->publicKey, pkey->second, pkey->first, pmatch->hashedSharedKey, pmatch->tx);
+        }
+        catch(...)
+        {
+            pmatch->fValid = false;
+        }
+
+        return true;
+    }
+
+    void swap(CCandidateMatchCheck &check) {
+        std::swap(pmatch, check.pmatch);
+        std::swap(petx, check.petx);
+        std::swap(pkey, check.pkey);
+    }
+};
+
+static CCheckQueue<CCandidateMatchCheck> candidatecheckqueue(1);
+
+void ThreadCandidateMatchCheck() {
+    RenameThread("navcoin-candch");
+    candidatecheckqueue.Thread();
+}
+
+// Decrypts the candidates of vBatch encrypted to the session keys, returning in vSolved the valid
+// ones in the order they were received
+static void VerifyCandidates(const std::vector<EncryptedCandidateTransaction>& vBatch, std::vector<CandidateTransaction>& vSolved)
+{
+    std::vector<std::pair<uint256, bls::PrivateKey>> vKeys;
+
+    {
+        LOCK(cs_sessionKeys);
+        vKeys = pwalletMain->aggSession->vKeys;
+    }
+
+    // Padding check of every candidate against every key, which lets through only about
+    // one in 256 of the candidates meant for someone else
+    std::vector<CandidateMatch> vMatches;
+
+    for (size_t i = 0; i < vBatch.size(); i++)
+    {
+        try
+        {
+            if (vBatch[i].vPublicKey.size() == 0)
+                continue;
+
+            bls::G1Element publicKey = bls::G1Element::FromByteVector(vBatch[i].vPublicKey);
+
+            for (size_t j = 0; j < vKeys.size(); j++)
+            {
+                CandidateMatch match;
+                if (!vBatch[i].MatchKey(publicKey, vKeys[j].second, vKeys[j].first, match.hashedSharedKey))
+                    continue;
+
+                match.nCandidate = i;
+                match.nKey = j;
+                match.publicKey = publicKey;
+                match.fValid = false;
+                vMatches.push_back(match);
+            }
+        }
+        catch(...)
+        {
+            continue;
+        }
+    }
+
+    // Decryption and signature check of the matches, spread over the workers. This thread
+    // joins them while waiting, so it is done here alone when there are none
+    {
+        CCheckQueueControl<CCandidateMatchCheck> control(&candidatecheckqueue);
+        std::vector<CCandidateMatchCheck> vChecks;
+        vChecks.reserve(vMatches.size());
+
+        for (auto& match: vMatches)
+            vChecks.push_back(CCandidateMatchCheck(match, vBatch[match.nCandidate], vKeys[match.nKey]));
+
+        control.Add(vChecks);
+        control.Wait();
+    }
+
+    // The view of the inputs is not thread safe, so the BLSCT proofs are validated here, under
+    // the same lock as when they were checked while decrypting. As before, a candidate is taken
+    // with the first key it is valid for
+    size_t nLastSolved = vBatch.size();
+
+    LOCK(cs_sessionKeys);
+
+    for (auto& match: vMatches)
+    {
+        if (!match.fValid || match.nCandidate == nLastSolved)
+            continue;
+
+        try
+        {
+            if (!match.tx.Validate(pwalletMain->aggSession->inputs))
+                continue;
+        }
+        catch(...)
+        {
+            continue;
+        }
+
+        vSolved.push_back(match.tx);
+        nLastSolved = match.nCandidate;
+    }
+}
+
 void CandidateVerificationThread()
 {
     LogPrintf("NavcoinCandidateVerificationThread started\n");
@@ -1011,91 +1185,81 @@ void CandidateVerificationThread()
                 MilliSleep(1000);
             } while (true);
 
+            std::vector<EncryptedCandidateTransaction> vBatch;
             EncryptedCandidateTransaction etx;
 
             while(candidatesQueue.pop(etx))
             {
-                bool fSolved = false;
-                CandidateTransaction tx;
+                // Whatever else is already waiting is verified together
+                vBatch.clear();
+                vBatch.push_back(etx);
+                while (vBatch.size() < BLSCT_VER_BATCH_SIZE && candidatesQueue.try_pop(etx))
+                    vBatch.push_back(etx);
 
-                {
-                    LOCK(cs_sessionKeys);
-
-                    for (auto& it: pwalletMain->aggSession->vKeys)
-                    {
-                        try
-                        {
-                            if (etx.Decrypt(it.second, pwalletMain->aggSession->inputs, tx))
-                            {
-                                fSolved = true;
-                                break;
-                            }
-                        }
-                        catch(...)
-                        {
-                            continue;
-                        }
-                    }
-                }
+                std::vector<CandidateTransaction> vSolved;
+                VerifyCandidates(vBatch, vSolved);
 
-                if (!fSolved)
-                {
-                    continue;
-                }
+                uint64_t nAccepted = 0;
 
+                for (auto& tx: vSolved)
                 {
-                    LOCK(cs_aggregation);
+                    {
+                        LOCK(cs_aggregation);
 
-                    bool stop = false;
+                        bool stop = false;
 
-                    for (auto& it: pwalletMain->aggSession->GetTransactionCandidates())
-                    {
-                        bool stop1 = false;
-                        for (auto &in: it.tx.vin)
+                        for (auto& it: pwalletMain->aggSession->GetTransactionCandidates())
                         {
-                            bool stop2 = false;
-                            for (auto &in2: tx.tx.vin)
+                            bool stop1 = false;
+                            for (auto &in: it.tx.vin)
                             {
-                                if (in == in2) // We already have this input
+                                bool stop2 = false;
+                                for (auto &in2: tx.tx.vin)
+                                {
+                                    if (in == in2) // We already have this input
+                                    {
+                                        stop2 = true;
+                                        break;
+                                    }
+                                }
+
+                                if (stop2)
                                 {
-                                    stop2 = true;
+                                    stop1 = true;
                                     break;
                                 }
                             }
-
-                            if (stop2)
+                            if (stop1)
                             {
-                                stop1 = true;
+                                stop = true;
                                 break;
                             }
                         }
-                        if (stop1)
+
+                        if (stop)
                         {
-                            stop = true;
-                            break;
+                            continue;
                         }
-                    }
 
-                    if (stop)
-                    {
-                        continue;
-                    }
+                        if (CWalletTx(NULL, tx.tx).InputsInMempool()) {
+                            stop = true;
+                        } else if (CWalletTx(NULL, tx.tx).InputsInStempool()) {
+                            stop = true;
+                        }
 
-                    if (CWalletTx(NULL, tx.tx).InputsInMempool()) {
-                        stop = true;
-                    } else if (CWalletTx(NULL, tx.tx).InputsInStempool()) {
-                        stop = true;
-                    }
+                        if (stop)
+                        {
+                            continue;
+                        }
 
-                    if (stop)
-                    {
-                        continue;
+                        pwalletMain->aggSession->vTransactionCandidates.push_back(tx);
+                        nAccepted++;
                     }
 
-                    pwalletMain->aggSession->vTransactionCandidates.push_back(tx);
+                    LogPrint("aggregationsession", "AggregationSession::%s: received one candidate\n", __func__);
                 }
 
-                LogPrint("aggregationsession", "AggregationSession::%s: received one candidate\n", __func__);
+                UpdateCandidateVerificationStats(vBatch, vSolved.size(), nAccepted);
             }
 
             MilliSleep(GetRand(verSleep, verSleep + 100));
@@ -115,8 +115,22 @@ private:
     int nVersion;
 };
 
+/** Activity of CandidateVerificationThread */
+struct CandidateVerificationStats
+{
+    size_t nQueued;         // Waiting to be verified
+    uint64_t nProcessed;    // Received and processed
+    uint64_t nMatched;      // Encrypted to one of the session keys
+    uint64_t nAccepted;     // Added to the session
+    int64_t nLastLatency;   // Milliseconds since reception, last processed batch
+    int64_t nMaxLatency;
+    int64_t nAvgLatency;
+};
+
 void AggregationSessionThread();
 void CandidateVerificationThread();
+void ThreadCandidateMatchCheck();
+CandidateVerificationStats GetCandidateVerificationStats();
 
 template <class T>
 class SafeQueue
@@ -150,6 +164,24 @@ public:
         return true;
     }
 
+    bool try_pop(T& val)
+    {
+        std::lock_guard<std::mutex> lock(m);
+        if (q.empty())
+            return false;
+
+        val = q.front();
+        q.pop();
+
+        return true;
+    }
+
+    size_t size() const
+    {
+        std::lock_guard<std::mutex> lock(m);
+        return q.size();
+    }
+
 private:
     std::queue<T> q;
     mutable std::mutex m;
@@ -9,9 +9,13 @@
 #include <boost/algorithm/string.hpp>
 
 #include <blsct/bulletproofs.h>
+#include <checkqueue.h>
 #include <tinyformat.h>
 #include <utiltime.h>
 
+#include <atomic>
+#include <functional>
+
 bool BLSInitResult = bls::BLS::Init();
 
 static std::vector<Scalar> VectorPowers(const Scalar &x, size_t n);
@@ -22,6 +26,7 @@ Scalar BulletproofsRangeproof::one;
 Scalar BulletproofsRangeproof::two;
 
 std::vector<bls::G1Element> BulletproofsRangeproof::Hi, BulletproofsRangeproof::Gi;
+MultiExpFixedBases BulletproofsRangeproof::generators;
 std::vector<Scalar> BulletproofsRangeproof::oneN;
 std::vector<Scalar> BulletproofsRangeproof::twoN;
 Scalar BulletproofsRangeproof::ip12;
@@ -31,6 +36,24 @@ boost::mutex BulletproofsRangeproof::init_mutex;
 bls::G1Element BulletproofsRangeproof::G;
 bls::G1Element BulletproofsRangeproof::H;
 
+static void ToG1(G1& out, const bls::G1Element& p)
+{
+    std::vector<unsigned char> vch = p.Serialize();
+    out.deserialize(&vch[0], vch.size());
+}
+
+static void ToFr(Fr& out, const Scalar& s)
+{
+    out = s.GetFr();
+}
+
+static bls::G1Element FromG1(const G1& p)
+{
+    std::vector<unsigned char> res(48);
+    p.serialize(&res[0], 48);
+    return bls::G1Element::FromByteVector(res);
+}
+
 // Calculate base point
 static bls::G1Element GetBaseG1Element(const bls::G1Element &base, size_t idx)
 {
@@ -62,10 +85,7 @@ bool BulletproofsRangeproof::Init()
     if (fInit)
         return true;
 
-    initPairing(mcl::BLS12_381);
-
-    Fp::setETHserialization(true);
-    Fr::setETHserialization(true);
+    Scalar::Init();
 
     BulletproofsRangeproof::one = 1;
     BulletproofsRangeproof::two = 2;
@@ -82,6 +102,19 @@ bool BulletproofsRangeproof::Init()
         BulletproofsRangeproof::Gi[i] = GetBaseG1Element(BulletproofsRangeproof::H, i * 2 + 2);
     }
 
+    std::vector<G1> bases(2 + 2 * maxMN);
+
+    ToG1(bases[BulletproofsRangeproof::GIndex()], BulletproofsRangeproof::G);
+    ToG1(bases[BulletproofsRangeproof::HIndex()], BulletproofsRangeproof::H);
+
+    for (size_t i = 0; i < maxMN; ++i)
+    {
+        ToG1(bases[BulletproofsRangeproof::GiIndex(i)], BulletproofsRangeproof::Gi[i]);
+        ToG1(bases[BulletproofsRangeproof::HiIndex(i)], BulletproofsRangeproof::Hi[i]);
+    }
+
+    BulletproofsRangeproof::generators.Init(bases);
+
     BulletproofsRangeproof::oneN = VectorDup(BulletproofsRangeproof::one, maxN);
     BulletproofsRangeproof::twoN = VectorPowers(BulletproofsRangeproof::two, maxN);
     BulletproofsRangeproof::ip12 = InnerProduct(BulletproofsRangeproof::oneN, BulletproofsRangeproof::twoN);
@@ -91,8 +124,56 @@ bool BulletproofsRangeproof::Init()
     return true;
 }
 
-// Todo multi-exp optimization
 bls::G1Element MultiExp(std::vector<MultiexpData> multiexp_data)
+{
+    std::vector<G1> x(multiexp_data.size());
+    std::vector<Fr> y(multiexp_data.size());
+    G1 z;
+
+    for (size_t i = 0; i < multiexp_data.size(); i++)
+    {
+        ToG1(x[i], multiexp_data[i].base);
+        ToFr(y[i], multiexp_data[i].exp);
+    }
+
+    MultiExpG1(z, x.data(), y.data(), multiexp_data.size());
+
+    return FromG1(z);
+}
+
+// Computes sum(exps[i] * generators[indexes[i]]) + sum(others[i].exp * others[i].base)
+static G1 MultiExpWithGenerators(const std::vector<size_t>& indexes, const std::vector<Scalar>& exps, const std::vector<MultiexpData>& others)
+{
+    CHECK_AND_ASSERT_THROW_MES(indexes.size() == exps.size(), "Incompatible sizes of indexes and exps");
+
+    std::vector<Fr> y(exps.size());
+
+    for (size_t i = 0; i < exps.size(); i++)
+        ToFr(y[i], exps[i]);
+
+    G1 z;
+    BulletproofsRangeproof::generators.MultiExp(z, indexes.data(), y.data(), indexes.size());
+
+    if (!others.empty())
+    {
+        std::vector<G1> ox(others.size());
+        std::vector<Fr> oy(others.size());
+
+        for (size_t i = 0; i < others.size(); i++)
+        {
+            ToG1(ox[i], others[i].base);
+            ToFr(oy[i], others[i].exp);
+        }
+
+        G1 o;
+        MultiExpG1(o, ox.data(), oy.data(), others.size());
+        G1::add(z, z, o);
+    }
+
+    return z;
+}
+
+bls::G1Element MultiExpMulVec(std::vector<MultiexpData> multiexp_data)
 {
     G1 x[multiexp_data.size()], z;
     Fr y[multiexp_data.size()];
@@ -101,10 +182,9 @@ bls::G1Element MultiExp(std::vector<MultiexpData> multiexp_data)
     for (size_t i = 0; i < multiexp_data.size(); i++)
     {
         std::vector<unsigned char> base = multiexp_data[i].base.Serialize();
-        std::vector<unsigned char> exp = multiexp_data[i].exp.GetVch();
 
         x[i].deserialize(&base[0], base.size());
-        y[i].deserialize(&exp[0], exp.size());
+        y[i] = multiexp_data[i].exp.GetFr();
     }
 
     G1::mulVec(z, x, y, multiexp_data.size());
@@ -125,10 +205,10 @@ bls::G1Element MultiExpLegacy(std::vector<MultiexpData> multiexp_data)
     for (size_t i = 0; i < multiexp_data.size(); i++)
     {
         if (i == 0)
-            result = multiexp_data[i].base * multiexp_data[i].exp.bn;
+            result = multiexp_data[i].base * multiexp_data[i].exp;
         else
         {
-            bls::G1Element temp = bls::G1Element(multiexp_data[i].base * multiexp_data[i].exp.bn);
+            bls::G1Element temp = bls::G1Element(multiexp_data[i].base * multiexp_data[i].exp);
             result = result + temp;
         }
     }
@@ -142,14 +222,20 @@ static bls::G1Element VectorCommitment(const std::vector<Scalar> &a, const std::
     CHECK_AND_ASSERT_THROW_MES(a.size() == b.size(), "Incompatible sizes of a and b");
     CHECK_AND_ASSERT_THROW_MES(a.size() <= maxMN, "Incompatible sizes of a and maxN");
 
-    std::vector<MultiexpData> multiexp_data;
+    std::vector<size_t> indexes;
+    std::vector<Scalar> exps;
+    indexes.reserve(a.size() * 2);
+    exps.reserve(a.size() * 2);
+
     for (size_t i = 0; i < a.size(); ++i)
     {
-        multiexp_data.push_back({BulletproofsRangeproof::Gi[i], a[i]});
-        multiexp_data.push_back({BulletproofsRangeproof::Hi[i], b[i]});
+        indexes.push_back(BulletproofsRangeproof::GiIndex(i));
+        exps.push_back(a[i]);
+        indexes.push_back(BulletproofsRangeproof::HiIndex(i));
+        exps.push_back(b[i]);
     }
 
-    return MultiExp(multiexp_data);
+    return FromG1(MultiExpWithGenerators(indexes, exps, std::vector<MultiexpData>()));
 }
 
 /* Given a Scalar x, construct a vector of powers [x^0, x^1, ..., x^n] */
@@ -232,171 +318,138 @@ static std::vector<Scalar> VectorProduct(const std::vector<Scalar> &a, const std
     return res;
 }
 
-/* Subtract a number from all the elements of a vectors */
-static std::vector<Scalar> VectorSubtract(const std::vector<Scalar>& a, const Scalar& b)
-{
-
-    std::vector<Scalar> ret(a.size());
-
-    for (unsigned int i = 0; i < a.size(); i++)
-    {
-        ret[i] = (a[i] - b);
-    }
-
     return ret;
 }
 
-/* Given two scalar arrays, construct the Hadamard product */
-std::vector<Scalar> Hadamard(const std::vector<Scalar>& a, const std::vector<Scalar>& b)
+/** A slice of a parallel loop, run on the prover threads */
+class CBulletproofsTask
 {
-    if (a.size() != b.size())
-        throw std::runtime_error("Hadamard(): a and b should be of the same size");
+private:
+    const std::function<void(size_t, size_t)>* pf;
+    size_t nBegin;
+    size_t nEnd;
 
-    std::vector<Scalar> ret(a.size());
+public:
+    CBulletproofsTask() : pf(nullptr), nBegin(0), nEnd(0) {}
+    CBulletproofsTask(const std::function<void(size_t, size_t)>* pfIn, size_t nBeginIn, size_t nEndIn) :
+        pf(pfIn), nBegin(nBeginIn), nEnd(nEndIn) {}
 
-    for (unsigned int i = 0; i < a.size(); i++)
+    bool operator()()
     {
-        ret[i] = (a[i] * b[i]);
+        (*pf)(nBegin, nEnd);
+        return true;
     }
 
-    return ret;
-}
-
-/* Add a number to all the elements of a vectors */
-static std::vector<Scalar> VectorAdd(const std::vector<Scalar>& a, const Scalar& b)
-{
-
-    std::vector<Scalar> ret(a.size());
-
-    for (unsigned int i = 0; i < a.size(); i++)
+    void swap(CBulletproofsTask& task)
     {
-        ret[i] = (a[i] + b);
+        std::swap(pf, task.pf);
+        std::swap(nBegin, task.nBegin);
+        std::swap(nEnd, task.nEnd);
     }
+};
 
-    return ret;
-}
+static CCheckQueue<CBulletproofsTask> provequeue(1);
+static boost::mutex provequeue_mutex;
+static std::atomic<int> nProveThreads(0);
 
-static std::vector<Scalar> VectorAdd(const std::vector<Scalar>& a, const std::vector<Scalar>& b)
+void ThreadBulletproofsProve()
 {
-    CHECK_AND_ASSERT_THROW_MES(a.size() == b.size(), "Incompatible sizes of a and b");
+    nProveThreads++;
 
-    std::vector<Scalar> ret(a.size());
-
-    for (unsigned int i = 0; i < a.size(); i++)
+    try
     {
-        ret[i] = (a[i] + b[i]);
+        provequeue.Thread();
     }
-
-    return ret;
-}
-
-/* Multiply all the elements of a vector by a number */
-static std::vector<Scalar> VectorScalar(const std::vector<Scalar>& a, const Scalar& x)
-{
-    std::vector<Scalar> ret(a.size());
-
-    for (unsigned int i = 0; i < a.size(); i++)
+    catch (...)
     {
-        ret[i] = (a[i] * x);
+        nProveThreads--;
+        throw;
     }
-
-    return ret;
 }
 
-/* Compute the slice of a scalar vector */
-static std::vector<Scalar> VectorSlice(const std::vector<Scalar>& a, unsigned int start, unsigned int stop)
+// Runs f over [0, n) split in slices of at least nGrain elements across the
+// prover threads. Falls back to the calling thread when there are no threads
+// or another proof is already using them. f must not throw.
+static void ParallelFor(size_t n, size_t nGrain, const std::function<void(size_t, size_t)>& f)
 {
-    if (start > a.size() || stop > a.size())
-        throw std::runtime_error("VectorSlice(): wrong start or stop point");
+    size_t nSlices = std::min((size_t)nProveThreads + 1, n / std::max(nGrain, (size_t)1));
 
-    std::vector<Scalar> ret(stop-start);
+    boost::unique_lock<boost::mutex> lock(provequeue_mutex, boost::try_to_lock);
 
-    for (unsigned int i = start; i < stop; i++)
+    if (nSlices < 2 || !lock.owns_lock())
     {
-        ret[i-start] = a[i];
+        f(0, n);
+        return;
     }
 
-    return ret;
-}
+    std::vector<CBulletproofsTask> vTasks;
+    vTasks.reserve(nSlices);
 
-static std::vector<bls::G1Element> HadamardFold(const std::vector<bls::G1Element> &vec, const std::vector<Scalar> *scale, const Scalar &a, const Scalar &b)
-{
-    if(!((vec.size() & 1) == 0))
-        throw std::runtime_error("HadamardFold(): vector argument size is not even");
-
-    const size_t sz = vec.size() / 2;
-    std::vector<bls::G1Element> out(sz);
-
-    for (size_t n = 0; n < sz; ++n)
-    {
-        bls::G1Element c0 = vec[n];
-        bls::G1Element c1 = vec[sz + n];
-        Scalar sa, sb;
-        if (scale) sa = a*(*scale)[n]; else sa = a;
-        if (scale) sb = b*(*scale)[sz + n]; else sb = b;
-        bls::G1Element l = c0*sa.bn;
-        bls::G1Element r = c1*sb.bn;
-        out[n] = l + r;
-    }
+    for (size_t i = 0; i < nSlices; i++)
+        vTasks.push_back(CBulletproofsTask(&f, n * i / nSlices, n * (i + 1) / nSlices));
 
-    return out;
+    CCheckQueueControl<CBulletproofsTask> control(&provequeue);
+    control.Add(vTasks);
+    control.Wait();
 }
 
-std::vector<Scalar> VectorInvert(const std::vector<Scalar>& x)
-{
-    std::vector<Scalar> ret(x.size());
-
-    for (size_t i = 0; i < ret.size(); i++)
-    {
-        ret[i] = x[i].Invert();
-    }
-
-    return ret;
-}
+// Minimum number of elements per slice of the parallel kernels
+static const size_t nScalarGrain = 128;
+static const size_t nPointGrain = 8;
 
-bls::G1Element CrossVectorExponent(size_t size, const std::vector<bls::G1Element> &A, size_t Ao, const std::vector<bls::G1Element> &B, size_t Bo, const std::vector<Scalar> &a, size_t ao, const std::vector<Scalar> &b, size_t bo, const std::vector<Scalar> *scale, const bls::G1Element *extra_point, const Scalar *extra_scalar)
+/* Inner product of a[ao..ao+n) and b[bo..bo+n) */
+static Scalar InnerProduct(const std::vector<Scalar> &a, size_t ao, const std::vector<Scalar> &b, size_t bo, size_t n)
 {
-    if (!(size + Ao <= A.size()))
-        throw std::runtime_error("CrossVectorExponent(): Incompatible size for A");
+    CHECK_AND_ASSERT_THROW_MES(ao + n <= a.size() && bo + n <= b.size(), "Incompatible sizes of a and b");
 
-    if (!(size + Bo <= B.size()))
-        throw std::runtime_error("CrossVectorExponent(): Incompatible size for B");
+    Scalar res = 0;
+    boost::mutex res_mutex;
 
-    if (!(size + ao <= a.size()))
-        throw std::runtime_error("CrossVectorExponent(): Incompatible size for a");
+    ParallelFor(n, nScalarGrain, [&](size_t nBegin, size_t nEnd) {
+        Scalar sum = 0;
+        for (size_t i = nBegin; i < nEnd; i++)
+            sum = sum + (a[ao+i] * b[bo+i]);
 
-    if (!(size + bo <= b.size()))
-        throw std::runtime_error("CrossVectorExponent(): Incompatible size for b");
+        boost::lock_guard<boost::mutex> lock(res_mutex);
+        res = res + sum;
+    });
 
-    if (!(size <= maxMN))
-        throw std::runtime_error("CrossVectorExponent(): Size is too large");
+    return res;
+}
 
-    if (!(!scale || size == scale->size() / 2))
-        throw std::runtime_error("CrossVectorExponent(): Incompatible size for scale");
+/** Buffers of a proof, allocated once and reused through all its rounds */
+struct ProverArena
+{
+    std::vector<Scalar> aL, aR, sL, sR, l0, r0, r1, aprime, bprime, scale;
+    std::vector<Fr> exps;
+    std::vector<G1> gprime, hprime, points;
 
-    if (!(!!extra_point == !!extra_scalar))
-        throw std::runtime_error("CrossVectorExponent(): Only one of extra base/exp present");
+    explicit ProverArena(size_t MN) :
+        aL(MN), aR(MN), sL(MN), sR(MN), l0(MN), r0(MN), r1(MN), aprime(MN), bprime(MN),
+        exps(MN + 1), gprime(MN), hprime(MN), points(MN + 1) {}
+};
 
-    std::vector<MultiexpData> multiexp_data;
-    multiexp_data.resize(size*2 + (!!extra_point));
-    for (size_t i = 0; i < size; ++i)
-    {
-        multiexp_data[i*2].exp = a[ao+i];
-        multiexp_data[i*2].base = A[Ao+i];
-        multiexp_data[i*2+1].exp = b[bo+i];
+// Computes the L or R commitment of an inner product round over the points
+// g[go..go+n) and h[ho..ho+n) with exponents a[ao..) and b[bo..) * scale[ho..)
+static bls::G1Element CrossVectorExponent(ProverArena& arena, size_t n, size_t go, size_t ho, size_t ao, size_t bo, bool fScale, const Scalar& extra)
+{
+    ParallelFor(n, nScalarGrain, [&](size_t nBegin, size_t nEnd) {
+        for (size_t i = nBegin; i < nEnd; i++)
+        {
+            arena.points[2*i] = arena.gprime[go+i];
+            ToFr(arena.exps[2*i], arena.aprime[ao+i]);
+            arena.points[2*i+1] = arena.hprime[ho+i];
+            ToFr(arena.exps[2*i+1], fScale ? arena.bprime[bo+i] * arena.scale[ho+i] : arena.bprime[bo+i]);
+        }
+    });
 
-        if (scale)
-            multiexp_data[i*2+1].exp =  multiexp_data[i*2+1].exp * (*scale)[Bo+i];
+    arena.points[2*n] = BulletproofsRangeproof::generators[BulletproofsRangeproof::HIndex()];
+    ToFr(arena.exps[2*n], extra);
 
-        multiexp_data[i*2+1].base = B[Bo+i];
-    }
-    if (extra_point)
-    {
-        multiexp_data.back().exp = *extra_scalar;
-        multiexp_data.back().base = *extra_point;
-    }
+    G1 result;
+    MultiExpG1(result, arena.points.data(), arena.exps.data(), 2*n + 1);
 
-    return MultiExp(multiexp_data);
+    return FromG1(result);
 }
 
 void BulletproofsRangeproof::Prove(std::vector<Scalar> v, bls::G1Element nonce, const std::vector<uint8_t>& message)
@@ -422,6 +475,8 @@ void BulletproofsRangeproof::Prove(std::vector<Scalar> v, bls::G1Element nonce,
     const size_t logMN = logM + BulletproofsRangeproof::logN;
     const size_t MN = M * N;
 
+    ProverArena arena(MN);
+
     // V is a vector with commitments in the form g2^v g^gamma
     this->V.resize(v.size());
 
@@ -438,8 +493,8 @@ void BulletproofsRangeproof::Prove(std::vector<Scalar> v, bls::G1Element nonce,
 
     for (unsigned int j = 0; j < v.size(); j++)
     {
-        bls::G1Element gammaElement = G*gamma[j].bn;
-        bls::G1Element valueElement = H*v[j].bn;
+        bls::G1Element gammaElement = G*gamma[j];
+        bls::G1Element valueElement = H*v[j];
         this->V[j] = gammaElement + valueElement;
         hasher << this->V[j];
     }
@@ -447,7 +502,8 @@ void BulletproofsRangeproof::Prove(std::vector<Scalar> v, bls::G1Element nonce,
     // PAPER LINES 41-42
     // Value to be obfuscated is encoded in binary in aL
     // aR is aL-1
-    std::vector<Scalar> aL(MN), aR(MN);
+    std::vector<Scalar>& aL = arena.aL;
+    std::vector<Scalar>& aR = arena.aR;
 
     for (size_t j = 0; j < M; ++j)
     {
@@ -482,14 +538,14 @@ try_again:
 
     this->A = VectorCommitment(aL, aR);
     {
-    bls::G1Element alphaElement = G*alpha.bn;
+    bls::G1Element alphaElement = G*alpha;
     this->A = this->A + alphaElement;
     }
 
     // PAPER LINES 45-47
     // Commitment to blinding sL and sR (obfuscated with rho)
-    std::vector<Scalar> sL(MN);
-    std::vector<Scalar> sR(MN);
+    std::vector<Scalar>& sL = arena.sL;
+    std::vector<Scalar>& sR = arena.sR;
 
     for (unsigned int i = 0; i < MN; i++)
     {
@@ -502,7 +558,7 @@ try_again:
 
     this->S = VectorCommitment(sL, sR);
     {
-    bls::G1Element rhoElement = G*rho.bn;
+    bls::G1Element rhoElement = G*rho;
     this->S = this->S + rhoElement;
     }
 
@@ -526,41 +582,32 @@ try_again:
 
     // Polynomial construction by coefficients
     // PAPER LINE AFTER 50
-    std::vector<Scalar> l0;
-    std::vector<Scalar> l1;
-    std::vector<Scalar> r0;
-    std::vector<Scalar> r1;
+    std::vector<Scalar>& l0 = arena.l0;
+    std::vector<Scalar>& l1 = sL;
+    std::vector<Scalar>& r0 = arena.r0;
+    std::vector<Scalar>& r1 = arena.r1;
 
-    // l(x) = (aL - z 1^n) + sL X
-    l0 = VectorSubtract(aL, z);
+    std::vector<Scalar> zpow = VectorPowers(z, M+2);
+    std::vector<Scalar> yMN = VectorPowers(y, MN);
 
+    // l(x) = (aL - z 1^n) + sL X
     // l(1) is (aL - z 1^n) + sL, but this is reduced to sL
-    l1 = sL;
-
     // This computes the ugly sum/concatenation from page 19
     // Calculation of r(0) and r(1)
-    std::vector<Scalar> zerosTwos(MN);
-    std::vector<Scalar> zpow(M+2);
-
-    zpow = VectorPowers(z, M+2);
-
-    for (unsigned int j = 0; j < M; ++j)
-    {
-        for (unsigned int i = 0; i < N; ++i)
+    ParallelFor(MN, nScalarGrain, [&](size_t nBegin, size_t nEnd) {
+        for (size_t i = nBegin; i < nEnd; i++)
         {
-            CHECK_AND_ASSERT_THROW_MES(j+2 < zpow.size(), "invalid zpow index");
-            CHECK_AND_ASSERT_THROW_MES(i < twoN.size(), "invalid twoN index");
-            zerosTwos[j*N+i] = zpow[j+2] * BulletproofsRangeproof::twoN[i];
-        }
-    }
+            Scalar zerosTwos = zpow[i/N+2] * BulletproofsRangeproof::twoN[i%N];
 
-    std::vector<Scalar> yMN = VectorPowers(y, MN);
-    r0 = VectorAdd(Hadamard(VectorAdd(aR, z), yMN), zerosTwos);
-    r1 = Hadamard(yMN, sR);
+            l0[i] = aL[i] - z;
+            r0[i] = ((aR[i] + z) * yMN[i]) + zerosTwos;
+            r1[i] = yMN[i] * sR[i];
+        }
+    });
 
     // Polynomial construction before PAPER LINE 51
-    Scalar t1 = InnerProduct(l0, r1) + InnerProduct(l1, r0);
-    Scalar t2 = InnerProduct(l1, r1);
+    Scalar t1 = InnerProduct(l0, 0, r1, 0, MN) + InnerProduct(l1, 0, r0, 0, MN);
+    Scalar t2 = InnerProduct(l1, 0, r1, 0, MN);
 
     // PAPER LINES 52-53
     Scalar tau1 = HashG1Element(nonce, 3);
@@ -570,10 +617,10 @@ try_again:
     tau1 = tau1 + sM2;
 
     {
-    bls::G1Element t1Element = H*t1.bn;
-    bls::G1Element t2Element = H*t2.bn;
-    bls::G1Element tau1Element = G*tau1.bn;
-    bls::G1Element tau2Element = G*tau2.bn;
+    bls::G1Element t1Element = H*t1;
+    bls::G1Element t2Element = H*t2;
+    bls::G1Element tau1Element = G*tau1;
+    bls::G1Element tau2Element = G*tau2;
 
     this->T1 = t1Element + tau1Element;
     this->T2 = t2Element + tau2Element;
@@ -591,15 +638,23 @@ try_again:
         goto try_again;
 
     // PAPER LINES 58-59
-    std::vector<Scalar> l = VectorAdd(l0, VectorScalar(l1, x));
-    std::vector<Scalar> r = VectorAdd(r0, VectorScalar(r1, x));
+    std::vector<Scalar>& l = arena.aprime;
+    std::vector<Scalar>& r = arena.bprime;
+
+    ParallelFor(MN, nScalarGrain, [&](size_t nBegin, size_t nEnd) {
+        for (size_t i = nBegin; i < nEnd; i++)
+        {
+            l[i] = l0[i] + (l1[i] * x);
+            r[i] = r0[i] + (r1[i] * x);
+        }
+    });
 
     // PAPER LINE 60
-    this->t = InnerProduct(l, r);
+    this->t = InnerProduct(l, 0, r, 0, MN);
 
     // TEST
     Scalar test_t;
-    Scalar t0 = InnerProduct(l0, r0);
+    Scalar t0 = InnerProduct(l0, 0, r0, 0, MN);
     test_t = ((t0 + (t1*x)) + (t2*x*x));
     if (!(test_t==this->t))
         throw std::runtime_error("BulletproofsRangeproof::Prove(): L60 Invalid test");
@@ -625,31 +680,23 @@ try_again:
     if (x_ip == 0)
         goto try_again;
 
-    // These are used in the inner product rounds
+    // These are used in the inner product rounds, folding aprime, bprime,
+    // gprime and hprime in place
     unsigned int nprime = MN;
 
-    std::vector<bls::G1Element> gprime(nprime);
-    std::vector<bls::G1Element> hprime(nprime);
-    std::vector<Scalar> aprime(nprime);
-    std::vector<Scalar> bprime(nprime);
+    std::vector<Scalar>& aprime = arena.aprime;
+    std::vector<Scalar>& bprime = arena.bprime;
+    std::vector<G1>& gprime = arena.gprime;
+    std::vector<G1>& hprime = arena.hprime;
 
     Scalar yinv = y.Invert();
 
-    std::vector<Scalar> yinvpow(nprime);
-
-    yinvpow[0] = 1;
-    yinvpow[1] = yinv;
+    arena.scale = VectorPowers(yinv, nprime);
 
     for (unsigned int i = 0; i < nprime; i++)
     {
-        gprime[i] = BulletproofsRangeproof::Gi[i];
-        hprime[i] = BulletproofsRangeproof::Hi[i];
-
-        if(i > 1)
-            yinvpow[i] = yinvpow[i-1] * yinv;
-
-        aprime[i] = l[i];
-        bprime[i] = r[i];
+        gprime[i] = BulletproofsRangeproof::generators[BulletproofsRangeproof::GiIndex(i)];
+        hprime[i] = BulletproofsRangeproof::generators[BulletproofsRangeproof::HiIndex(i)];
     }
 
     this->L.resize(logMN);
@@ -659,7 +706,7 @@ try_again:
 
     std::vector<Scalar> w(logMN);
 
-    std::vector<Scalar>* scale = &yinvpow;
+    bool fScale = true;
 
     Scalar tmp;
 
@@ -669,17 +716,14 @@ try_again:
         nprime /= 2;
 
         // PAPER LINES 21-22
-        Scalar cL = InnerProduct(VectorSlice(aprime, 0, nprime),
-                                 VectorSlice(bprime, nprime, bprime.size()));
-
-        Scalar cR = InnerProduct(VectorSlice(aprime, nprime, aprime.size()),
-                                 VectorSlice(bprime, 0, nprime));
+        Scalar cL = InnerProduct(aprime, 0, bprime, nprime, nprime);
+        Scalar cR = InnerProduct(aprime, nprime, bprime, 0, nprime);
 
         // PAPER LINES 23-24
         tmp = cL * x_ip;
-        this->L[round] = CrossVectorExponent(nprime, gprime, nprime, hprime, 0, aprime, 0, bprime, nprime, scale, &H, &tmp);
+        this->L[round] = CrossVectorExponent(arena, nprime, nprime, 0, 0, nprime, fScale, tmp);
         tmp = cR * x_ip;
-        this->R[round] = CrossVectorExponent(nprime, gprime, 0, hprime, nprime, aprime, nprime, bprime, 0, scale, &H, &tmp);
+        this->R[round] = CrossVectorExponent(arena, nprime, 0, nprime, nprime, 0, fScale, tmp);
 
         // PAPER LINES 25-27
         hasher << this->L[round];
@@ -695,18 +739,46 @@ try_again:
         // PAPER LINES 29-31
         if (nprime > 1)
         {
-            gprime = HadamardFold(gprime, NULL, winv, w[round]);
-            hprime = HadamardFold(hprime, scale, w[round], winv);
+            Fr frw, frwinv;
+            ToFr(frw, w[round]);
+            ToFr(frwinv, winv);
+
+            ParallelFor(nprime, nPointGrain, [&](size_t nBegin, size_t nEnd) {
+                for (size_t i = nBegin; i < nEnd; i++)
+                {
+                    G1 left, right;
+                    G1::mul(left, gprime[i], frwinv);
+                    G1::mul(right, gprime[nprime+i], frw);
+                    G1::add(gprime[i], left, right);
+
+                    if (fScale)
+                    {
+                        Fr sa, sb;
+                        ToFr(sa, w[round] * arena.scale[i]);
+                        ToFr(sb, winv * arena.scale[nprime+i]);
+                        G1::mul(left, hprime[i], sa);
+                        G1::mul(right, hprime[nprime+i], sb);
+                    }
+                    else
+                    {
+                        G1::mul(left, hprime[i], frw);
+                        G1::mul(right, hprime[nprime+i], frwinv);
+                    }
+                    G1::add(hprime[i], left, right);
+                }
+            });
         }
 
         // PAPER LINES 33-34
-        aprime = VectorAdd(VectorScalar(VectorSlice(aprime, 0, nprime), w[round]),
-                           VectorScalar(VectorSlice(aprime, nprime, aprime.size()), winv));
-
-        bprime = VectorAdd(VectorScalar(VectorSlice(bprime, 0, nprime), winv),
-                           VectorScalar(VectorSlice(bprime, nprime, bprime.size()), w[round]));
+        ParallelFor(nprime, nScalarGrain, [&](size_t nBegin, size_t nEnd) {
+            for (size_t i = nBegin; i < nEnd; i++)
+            {
+                aprime[i] = (aprime[i] * w[round]) + (aprime[nprime+i] * winv);
+                bprime[i] = (bprime[i] * winv) + (bprime[nprime+i] * w[round]);
+            }
+        });
 
-        scale = NULL;
+        fScale = false;
 
         round += 1;
     }
@@ -860,8 +932,8 @@ bool VerifyBulletproof(const std::vector<std::pair<int, BulletproofsRangeproof>>
             data.message = std::string(vMsgTrimmed.begin(), vMsgTrimmed.end()) + std::string(vMsg2Trimmed.begin(), vMsg2Trimmed.end());
 
             {
-            bls::G1Element gammaElement = BulletproofsRangeproof::G*gamma.bn;
-            bls::G1Element valueElement = BulletproofsRangeproof::H*amount.bn;
+            bls::G1Element gammaElement = BulletproofsRangeproof::G*gamma;
+            bls::G1Element valueElement = BulletproofsRangeproof::H*amount;
             bool fIsMine = ((gammaElement + valueElement) == pd.V[0]);
 
             if (fIsMine)
@@ -877,6 +949,9 @@ bool VerifyBulletproof(const std::vector<std::pair<int, BulletproofsRangeproof>>
 
     size_t maxMN = 1u << max_length;
 
+    if (maxMN > ::maxMN)
+        return false;
+
     std::vector<Scalar> inverses(to_invert.size());
 
     inverses = VectorInvert(to_invert);
@@ -896,8 +971,7 @@ bool VerifyBulletproof(const std::vector<std::pair<int, BulletproofsRangeproof>>
 
     std::vector<MultiexpData> multiexpdata;
 
-    multiexpdata.reserve(nV + (2 * (10/*logM*/ + BulletproofsRangeproof::logN) + 4) * proofs.size() + 2 * maxMN);
-    multiexpdata.resize(2 * maxMN);
+    multiexpdata.reserve(nV + (2 * (10/*logM*/ + BulletproofsRangeproof::logN) + 4) * proofs.size());
 
     for (auto& p: proofs)
     {
@@ -1036,22 +1110,28 @@ bool VerifyBulletproof(const std::vector<std::pair<int, BulletproofsRangeproof>>
         z3 = z3 + (tmp * weight_z);
     }
 
-    tmp = y0 - z1;
-
-    multiexpdata.push_back({BulletproofsRangeproof::G, tmp});
-
+    // The generator terms go through the precomputed table, the proof points
+    // through the variable base multi-exponentiation
+    std::vector<size_t> indexes;
+    std::vector<Scalar> exps;
+    indexes.reserve(2 + 2 * maxMN);
+    exps.reserve(2 + 2 * maxMN);
 
-    tmp = z3 - y1;
+    indexes.push_back(BulletproofsRangeproof::GIndex());
+    exps.push_back(y0 - z1);
 
-    multiexpdata.push_back({BulletproofsRangeproof::H, tmp});
+    indexes.push_back(BulletproofsRangeproof::HIndex());
+    exps.push_back(z3 - y1);
 
     for (size_t i = 0; i < maxMN; ++i)
     {
-        multiexpdata[i * 2] = {BulletproofsRangeproof::Gi[i], z4[i]};
-        multiexpdata[i * 2 + 1] = {BulletproofsRangeproof::Hi[i], z5[i]};
+        indexes.push_back(BulletproofsRangeproof::GiIndex(i));
+        exps.push_back(z4[i]);
+        indexes.push_back(BulletproofsRangeproof::HiIndex(i));
+        exps.push_back(z5[i]);
     }
 
-    bls::G1Element mexp = MultiExp(multiexpdata);
+    G1 mexp = MultiExpWithGenerators(indexes, exps, multiexpdata);
 
-    return mexp == bls::G1Element::Infinity();
+    return mexp.isZero();
 }
@@ -17,16 +17,12 @@
 #endif
 
 #include <amount.h>
+#include <blsct/multiexp.h>
 #include <blsct/scalar.h>
 #include <bls.hpp>
 #include <streams.h>
 #include <utilstrencodings.h>
 
-#define MCL_DONT_USE_XBYAK
-#define MCL_DONT_USE_OPENSSL
-
-#include <mcl/bls12_381.hpp>
-
 #include <boost/thread/mutex.hpp>
 #include <boost/thread/lock_guard.hpp>
 
@@ -172,6 +168,13 @@ public:
     static Scalar two;
 
     static std::vector<bls::G1Element> Hi, Gi;
+
+    // Precomputed multi-exponentiation table for G, H, Gi and Hi
+    static MultiExpFixedBases generators;
+    static size_t GIndex() { return 0; }
+    static size_t HIndex() { return 1; }
+    static size_t GiIndex(size_t i) { return 2 + 2 * i; }
+    static size_t HiIndex(size_t i) { return 3 + 2 * i; }
     static std::vector<Scalar> oneN;
     static std::vector<Scalar> twoN;
     static Scalar ip12;
@@ -201,6 +204,13 @@ struct RangeproofEncodedData
     bool valid = false;
 };
 
+bls::G1Element MultiExp(std::vector<MultiexpData> multiexp_data);
+bls::G1Element MultiExpMulVec(std::vector<MultiexpData> multiexp_data);
+bls::G1Element MultiExpLegacy(std::vector<MultiexpData> multiexp_data);
+
+/** Worker loop of the threads running the parallel kernels of BulletproofsRangeproof::Prove */
+void ThreadBulletproofsProve();
+
 bool VerifyBulletproof(const std::vector<std::pair<int, BulletproofsRangeproof>>& proofs, std::vector<RangeproofEncodedData>& data, const std::vector<bls::G1Element>& nonces, const bool &fOnlyRecover = false);
 
 #endif // NAVCOIN_BLSCT_BULLETPROOFS_H
@@ -240,7 +240,7 @@ public:
         Scalar l, r;
         l = bls::PrivateKey::FromBytes(&k.front());
         r = bls::PrivateKey::FromBytes(&(rhs.k).front());
-        return bn_cmp(l.bn, r.bn);
+        return !(l == r);
     }
 
     bool operator==(const blsctKey& rhs) const {
@@ -0,0 +1,235 @@
+// Copyright (c) 2020 The Navcoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <blsct/multiexp.h>
+
+#include <algorithm>
+#include <stdexcept>
+
+using namespace mcl::bn;
+
+static const size_t unitBits = sizeof(mcl::fp::Unit) * 8;
+
+// Copies the plain (non Montgomery) representation of the exponents into a
+// flat array, nUnits limbs per exponent.
+static void GetExponentLimbs(const Fr* exps, size_t n, std::vector<mcl::fp::Unit>& limbs, size_t& nUnits)
+{
+    nUnits = (Fr::getBitSize() + unitBits - 1) / unitBits;
+    limbs.assign(n * nUnits, 0);
+
+    for (size_t i = 0; i < n; i++)
+    {
+        mcl::fp::Block b;
+        exps[i].getBlock(b);
+
+        for (size_t j = 0; j < std::min(b.n, nUnits); j++)
+            limbs[i * nUnits + j] = b.p[j];
+    }
+}
+
+// Returns the width bits of the exponent starting at bit
+static inline size_t GetWindow(const mcl::fp::Unit* p, size_t nUnits, size_t bit, size_t width)
+{
+    const size_t idx = bit / unitBits;
+    const size_t shift = bit % unitBits;
+
+    if (idx >= nUnits)
+        return 0;
+
+    uint64_t v = (uint64_t)p[idx] >> shift;
+
+    if (shift + width > unitBits && idx + 1 < nUnits)
+        v |= (uint64_t)p[idx + 1] << (unitBits - shift);
+
+    return v & ((1ULL << width) - 1);
+}
+
+// Computes sum(j * buckets[j-1]) with running sums
+static void SumBuckets(G1& result, const std::vector<G1>& buckets)
+{
+    G1 running, sum;
+    running.clear();
+    sum.clear();
+
+    for (size_t j = buckets.size(); j-- > 0;)
+    {
+        G1::add(running, running, buckets[j]);
+        G1::add(sum, sum, running);
+    }
+
+    result = sum;
+}
+
+size_t MultiExpWindowSize(size_t n)
+{
+    size_t nLog = 0;
+
+    while ((size_t(1) << (nLog + 1)) <= n)
+        nLog++;
+
+    if (nLog < 4)
+        return 2;
+
+    return std::min(nLog - 2, (size_t)16);
+}
+
+void NormalizeG1Vec(std::vector<G1>& points)
+{
+    if (G1::mode_ != mcl::ec::Jacobi)
+    {
+        for (G1& p: points)
+            p.normalize();
+        return;
+    }
+
+    // Montgomery's trick: one inversion for the product of all the z coordinates
+    std::vector<Fp> acc(points.size());
+    Fp prod = 1;
+
+    for (size_t i = 0; i < points.size(); i++)
+    {
+        if (points[i].isZero() || points[i].z.isOne())
+            continue;
+        acc[i] = prod;
+        Fp::mul(prod, prod, points[i].z);
+    }
+
+    Fp inv;
+    Fp::inv(inv, prod);
+
+    for (size_t i = points.size(); i-- > 0;)
+    {
+        G1& p = points[i];
+
+        if (p.isZero() || p.z.isOne())
+            continue;
+
+        Fp zinv, zinv2;
+        Fp::mul(zinv, inv, acc[i]);
+        Fp::mul(inv, inv, p.z);
+
+        // x = X/Z^2, y = Y/Z^3
+        Fp::sqr(zinv2, zinv);
+        Fp::mul(p.x, p.x, zinv2);
+        Fp::mul(zinv2, zinv2, zinv);
+        Fp::mul(p.y, p.y, zinv2);
+        p.z = 1;
+    }
+}
+
+void MultiExpPippenger(G1& result, const G1* bases, const Fr* exps, size_t n)
+{
+    result.clear();
+
+    if (n == 0)
+        return;
+
+    if (n == 1)
+    {
+        G1::mul(result, bases[0], exps[0]);
+        return;
+    }
+
+    const size_t c = MultiExpWindowSize(n);
+    const size_t nWindows = (Fr::getBitSize() + c - 1) / c;
+
+    std::vector<mcl::fp::Unit> limbs;
+    size_t nUnits;
+
+    GetExponentLimbs(exps, n, limbs, nUnits);
+
+    std::vector<G1> buckets((size_t(1) << c) - 1);
+
+    for (size_t w = nWindows; w-- > 0;)
+    {
+        for (size_t i = 0; i < c; i++)
+            G1::dbl(result, result);
+
+        for (G1& bucket: buckets)
+            bucket.clear();
+
+        for (size_t i = 0; i < n; i++)
+        {
+            size_t d = GetWindow(&limbs[i * nUnits], nUnits, w * c, c);
+
+            if (d)
+                G1::add(buckets[d - 1], buckets[d - 1], bases[i]);
+        }
+
+        G1 sum;
+        SumBuckets(sum, buckets);
+        G1::add(result, result, sum);
+    }
+}
+
+void MultiExpG1(G1& result, const G1* bases, const Fr* exps, size_t n)
+{
+    if (n < MULTIEXP_PIPPENGER_MIN_SIZE)
+    {
+        result.clear();
+        if (n > 0)
+            G1::mulVec(result, const_cast<G1*>(bases), exps, n);
+        return;
+    }
+
+    MultiExpPippenger(result, bases, exps, n);
+}
+
+void MultiExpFixedBases::Init(const std::vector<G1>& bases)
+{
+    nWindows = (Fr::getBitSize() + WINDOW - 1) / WINDOW;
+    table.resize(bases.size() * nWindows);
+
+    for (size_t i = 0; i < bases.size(); i++)
+    {
+        G1 p = bases[i];
+
+        for (size_t k = 0; k < nWindows; k++)
+        {
+            table[i * nWindows + k] = p;
+
+            for (size_t j = 0; j < WINDOW; j++)
+                G1::dbl(p, p);
+        }
+    }
+
+    // Normalized points make every bucket addition a cheaper mixed addition
+    NormalizeG1Vec(table);
+}
+
+void MultiExpFixedBases::MultiExp(G1& result, const size_t* indexes, const Fr* exps, size_t n) const
+{
+    result.clear();
+
+    if (n == 0)
+        return;
+
+    std::vector<mcl::fp::Unit> limbs;
+    size_t nUnits;
+
+    GetExponentLimbs(exps, n, limbs, nUnits);
+
+    std::vector<G1> buckets((size_t(1) << WINDOW) - 1);
+
+    for (G1& bucket: buckets)
+        bucket.clear();
+
+    for (size_t i = 0; i < n; i++)
+    {
+        if (indexes[i] >= size())
+            throw std::runtime_error("MultiExpFixedBases::MultiExp(): index out of range");
+
+        const G1* windows = &table[indexes[i] * nWindows];
+
+        for (size_t k = 0; k < nWindows; k++)
+        {
+            size_t d = GetWindow(&limbs[i * nUnits], nUnits, k * WINDOW, WINDOW);
+
+            if (d)
+                G1::add(buckets[d - 1], buckets[d - 1], windows[k]);
+        }
+    }
+
+    SumBuckets(result, buckets);
+}
@@ -0,0 +1,61 @@
+// Copyright (c) 2020 The Navcoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+// Multi-exponentiation over the mcl G1 group using Pippenger's bucket method
+// and precomputed tables for fixed generators.
+
+#ifndef NAVCOIN_BLSCT_MULTIEXP_H
+#define NAVCOIN_BLSCT_MULTIEXP_H
+
+#define MCL_DONT_USE_XBYAK
+#define MCL_DONT_USE_OPENSSL
+
+#include <mcl/bls12_381.hpp>
+
+#include <stddef.h>
+#include <vector>
+
+/** Window size in bits used by Pippenger's method for a multi-exponentiation of n terms */
+size_t MultiExpWindowSize(size_t n);
+
+/** Normalizes a vector of points sharing a single field inversion */
+void NormalizeG1Vec(std::vector<mcl::bn::G1>& points);
+
+/** Computes result = sum(exps[i] * bases[i]) using Pippenger's bucket method */
+void MultiExpPippenger(mcl::bn::G1& result, const mcl::bn::G1* bases, const mcl::bn::Fr* exps, size_t n);
+
+/**
+ * Computes result = sum(exps[i] * bases[i]), using Pippenger's method for large inputs
+ * and mcl's GLV accelerated mulVec below MULTIEXP_PIPPENGER_MIN_SIZE terms.
+ */
+void MultiExpG1(mcl::bn::G1& result, const mcl::bn::G1* bases, const mcl::bn::Fr* exps, size_t n);
+
+static const size_t MULTIEXP_PIPPENGER_MIN_SIZE = 256;
+
+/**
+ * Precomputed table for a fixed set of bases. For every base P it keeps the
+ * normalized points 2^(WINDOW*k)*P for every window k, so a multi-exponentiation
+ * over the fixed bases is a single pass over the buckets without doublings.
+ */
+class MultiExpFixedBases
+{
+public:
+    static const size_t WINDOW = 8;
+
+    MultiExpFixedBases() : nWindows(0) {}
+
+    void Init(const std::vector<mcl::bn::G1>& bases);
+
+    size_t size() const { return nWindows ? table.size() / nWindows : 0; }
+    const mcl::bn::G1& operator[](size_t index) const { return table[index * nWindows]; }
+
+    /** Computes result = sum(exps[i] * bases[indexes[i]]) */
+    void MultiExp(mcl::bn::G1& result, const size_t* indexes, const mcl::bn::Fr* exps, size_t n) const;
+
+private:
+    size_t nWindows;
+    std::vector<mcl::bn::G1> table;
+};
+
+#endif // NAVCOIN_BLSCT_MULTIEXP_H
@@ -65,7 +65,8 @@ UniValue viewaggregationsession(const UniValue& params, bool fHelp)
     if (fHelp || params.size() > 1)
         throw std::runtime_error(
                 "viewaggregationsession <show_candidates>\n"
-                "Shows the active mix session if any\n"
+                "Shows the active mix session if any, with the activity of the verification of\n"
+                "the candidates received (latencies in milliseconds since reception)\n"
                 );
 
     UniValue ret(UniValue::VOBJ);
@@ -101,6 +102,17 @@ UniValue viewaggregationsession(const UniValue& params, bool fHelp)
         ret.pushKV("txCandidatesCount", (uint64_t)pwalletMain->aggSession->GetTransactionCandidates().size());
     }
 
+    CandidateVerificationStats stats = GetCandidateVerificationStats();
+    UniValue verification(UniValue::VOBJ);
+    verification.pushKV("queued", (uint64_t)stats.nQueued);
+    verification.pushKV("processed", stats.nProcessed);
+    verification.pushKV("matched", stats.nMatched);
+    verification.pushKV("accepted", stats.nAccepted);
+    verification.pushKV("lastLatency", stats.nLastLatency);
+    verification.pushKV("avgLatency", stats.nAvgLatency);
+    verification.pushKV("maxLatency", stats.nMaxLatency);
+    ret.pushKV("verification", verification);
+
     return ret;
 }
 
@@ -3,289 +3,281 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "scalar.h"
+#include <random.h>
+#include <support/cleanse.h>
 #include <utilstrencodings.h>
 
-#include <iostream>
-
-void fp_inv_exgcd_bn(bn_t c, const bn_t u_, const bn_t p) {
-    bn_t v, g1, g2, q, r, u;
-
-    bn_null(v);
-    bn_null(g1);
-    bn_null(g2);
-    bn_null(q);
-    bn_null(r);
-
-    RLC_TRY {
-        bn_new(v);
-        bn_new(g1);
-        bn_new(g2);
-        bn_new(q);
-        bn_new(r);
-        bn_new(u);
-
-        /* u = a, v = p, g1 = 1, g2 = 0. */
-        bn_copy(v, p);
-        bn_copy(u, u_);
-        bn_set_dig(g1, 1);
-        bn_zero(g2);
-
-        /* While (u != 1. */
-        while (bn_cmp_dig(u, 1) != RLC_EQ) {
-            /* q = [v/u], r = v mod u. */
-            bn_div_rem(q, r, v, u);
-            /* v = u, u = r. */
-            bn_copy(v, u);
-            bn_copy(u, r);
-            /* r = g2 - q * g1. */
-            bn_mul(r, q, g1);
-            bn_sub(r, g2, r);
-            /* g2 = g1, g1 = r. */
-            bn_copy(g2, g1);
-            bn_copy(g1, r);
-        }
+#include <mutex>
+
+using mcl::bn::Fr;
+
+static const size_t SCALAR_SIZE = 32;
+
+std::atomic<bool> Scalar::fInitialized(false);
+
+// Called lazily, so every binary reading BLSCT data has the curve set up, not only the node
+bool Scalar::Init()
+{
+    static std::once_flag initFlag;
+
+    std::call_once(initFlag, []() {
+        mcl::bn::initPairing(mcl::BLS12_381);
+        mcl::bn::Fp::setETHserialization(true);
+        Fr::setETHserialization(true);
+        fInitialized.store(true, std::memory_order_release);
+    });
+
+    return true;
+}
+
+// Canonical value as a little endian integer
+static void GetLittleEndian(const Fr& fr, uint8_t out[SCALAR_SIZE])
+{
+    memset(out, 0, SCALAR_SIZE);
+    fr.getLittleEndian(out, SCALAR_SIZE);
+}
+
+static void SetLittleEndian(Fr& fr, const uint8_t* in, size_t size)
+{
+    bool fOk;
+    fr.setLittleEndianMod(&fOk, in, size);
+    CHECK_AND_ASSERT_THROW_MES(fOk, "Scalar: value too large");
+}
 
-        if (bn_sign(g1) == RLC_NEG) {
-            bn_add(g1, g1, p);
+static size_t GetBitLength(const uint8_t in[SCALAR_SIZE])
+{
+    for (size_t i = SCALAR_SIZE; i > 0; i--)
+    {
+        if (in[i-1])
+        {
+            size_t n = 8 * i;
+            for (uint8_t c = in[i-1]; !(c & 0x80); c <<= 1)
+                n--;
+            return n;
         }
-        bn_copy(c, g1);
     }
-    RLC_CATCH_ANY {
-        RLC_THROW(ERR_CAUGHT);
-    }
-    RLC_FINALLY {
-        bn_free(v);
-        bn_free(g1);
-        bn_free(g2);
-        bn_free(q);
-        bn_free(r);
-    };
+    return 0;
 }
 
 Scalar::Scalar()
 {
-    bn_new(bn);
-    bn_zero(bn);
+    EnsureInit();
+    fr.clear();
 }
 
 Scalar::Scalar(const std::vector<uint8_t> &v)
 {
-    bn_new(bn);
-    bn_zero(bn);
+    EnsureInit();
+    fr.clear();
     SetVch(v);
 }
 
 Scalar Scalar::operator+(const Scalar &b) const
 {
     Scalar ret;
-    bn_add(ret.bn, this->bn, b.bn);
-    bn_t ord;
-    bn_new(ord);
-    g1_get_ord(ord);
-    bn_mod(ret.bn, ret.bn, ord);
+    Fr::add(ret.fr, this->fr, b.fr);
     return ret;
 }
 
 Scalar Scalar::operator-(const Scalar &b) const
 {
     Scalar ret;
-    bn_sub(ret.bn, this->bn, b.bn);
-    bn_t ord;
-    bn_new(ord);
-    g1_get_ord(ord);
-    bn_mod(ret.bn, ret.bn, ord);
+    Fr::sub(ret.fr, this->fr, b.fr);
     return ret;
 }
 
 Scalar Scalar::operator*(const Scalar &b) const
 {
     Scalar ret;
-    bn_mul(ret.bn, this->bn, b.bn);
-    bn_t ord;
-    bn_new(ord);
-    g1_get_ord(ord);
-    bn_mod(ret.bn, ret.bn, ord);
+    Fr::mul(ret.fr, this->fr, b.fr);
     return ret;
 }
 
 Scalar Scalar::operator<<(const int &b) const
 {
+    uint8_t in[SCALAR_SIZE], out[2 * SCALAR_SIZE] = {0};
+    GetLittleEndian(this->fr, in);
+
+    CHECK_AND_ASSERT_THROW_MES(b >= 0 && b <= 8 * (int)SCALAR_SIZE, "Scalar: shift out of range");
+
+    for (size_t i = 0; i < SCALAR_SIZE; i++)
+    {
+        size_t pos = i * 8 + b;
+        out[pos / 8] |= in[i] << (pos % 8);
+        if (pos % 8 && pos / 8 + 1 < sizeof(out))
+            out[pos / 8 + 1] |= in[i] >> (8 - pos % 8);
+    }
+
     Scalar ret;
-    bn_lsh(ret.bn, this->bn, b);
+    SetLittleEndian(ret.fr, out, sizeof(out));
     return ret;
 }
 
 Scalar Scalar::operator>>(const int &b) const
 {
+    uint8_t in[SCALAR_SIZE], out[SCALAR_SIZE] = {0};
+    GetLittleEndian(this->fr, in);
+
+    for (size_t i = 0; i < SCALAR_SIZE && b >= 0; i++)
+    {
+        size_t pos = i * 8 + b;
+        if (pos / 8 >= SCALAR_SIZE)
+            break;
+        out[i] = in[pos / 8] >> (pos % 8);
+        if (pos % 8 && pos / 8 + 1 < SCALAR_SIZE)
+            out[i] |= in[pos / 8 + 1] << (8 - pos % 8);
+    }
+
     Scalar ret;
-    bn_rsh(ret.bn, this->bn, b);
+    SetLittleEndian(ret.fr, out, sizeof(out));
     return ret;
 }
 
 Scalar Scalar::operator|(const Scalar &b) const
 {
-    Scalar ret;
-    size_t size = std::max(bn_bits(this->bn), bn_bits(b.bn));
+    uint8_t l[SCALAR_SIZE], r[SCALAR_SIZE];
+    GetLittleEndian(this->fr, l);
+    GetLittleEndian(b.fr, r);
 
-    for (size_t i = 0; i < size; i++)
-    {
-        bool l = bn_get_bit(this->bn, i);
-        bool r = bn_get_bit(b.bn, i);
-        bn_set_bit(ret.bn, i, l|r);
-    }
+    for (size_t i = 0; i < SCALAR_SIZE; i++)
+        l[i] |= r[i];
 
+    Scalar ret;
+    SetLittleEndian(ret.fr, l, sizeof(l));
     return ret;
 }
 
 Scalar Scalar::operator^(const Scalar &b) const
 {
-    Scalar ret;
-
-    size_t size = std::max(bn_bits(this->bn), bn_bits(b.bn));
+    uint8_t l[SCALAR_SIZE], r[SCALAR_SIZE];
+    GetLittleEndian(this->fr, l);
+    GetLittleEndian(b.fr, r);
 
-    for (size_t i = 0; i < size; i++)
-    {
-        bool l = bn_get_bit(this->bn, i);
-        bool r = bn_get_bit(b.bn, i);
-        bn_set_bit(ret.bn, i, l^r);
-    }
+    for (size_t i = 0; i < SCALAR_SIZE; i++)
+        l[i] ^= r[i];
 
+    Scalar ret;
+    SetLittleEndian(ret.fr, l, sizeof(l));
     return ret;
 }
 
 Scalar Scalar::operator&(const Scalar &b) const
 {
-    Scalar ret;
-    size_t size = std::max(bn_bits(this->bn), bn_bits(b.bn));
+    uint8_t l[SCALAR_SIZE], r[SCALAR_SIZE];
+    GetLittleEndian(this->fr, l);
+    GetLittleEndian(b.fr, r);
 
-    for (size_t i = 0; i < size; i++)
-    {
-        bool l = bn_get_bit(this->bn, i);
-        bool r = bn_get_bit(b.bn, i);
-        bn_set_bit(ret.bn, i, l&r);
-    }
+    for (size_t i = 0; i < SCALAR_SIZE; i++)
+        l[i] &= r[i];
 
+    Scalar ret;
+    SetLittleEndian(ret.fr, l, sizeof(l));
     return ret;
 }
 
+// Flips the bits up to the most significant one set
 Scalar Scalar::operator~() const
 {
-    Scalar ret;
-    size_t size = bn_bits(this->bn);
+    uint8_t v[SCALAR_SIZE];
+    GetLittleEndian(this->fr, v);
+
+    size_t size = GetBitLength(v);
 
     for (size_t i = 0; i < size; i++)
-    {
-        bool a = bn_get_bit(this->bn, i);
-        bn_set_bit(ret.bn, i, !a);
-    }
+        v[i / 8] ^= 1 << (i % 8);
 
+    Scalar ret;
+    SetLittleEndian(ret.fr, v, sizeof(v));
     return ret;
 }
 
 void Scalar::operator=(const uint64_t& n)
 {
-    bn_new(this->bn);
-    bn_zero(this->bn);
-    for (size_t i = 0; i < 64; i++)
-    {
-        bn_set_bit(this->bn, i, (n>>i)&1);
-    }
+    EnsureInit();
+    uint8_t v[8];
+    for (size_t i = 0; i < 8; i++)
+        v[i] = (n >> (8 * i)) & 0xFF;
+    SetLittleEndian(this->fr, v, sizeof(v));
 }
 
 Scalar::Scalar(const uint64_t& n)
 {
-    bn_new(this->bn);
-    bn_zero(this->bn);
-    for (size_t i = 0; i < 64; i++)
-    {
-        bn_set_bit(this->bn, i, (n>>i)&1);
-    }
+    *this = n;
 }
 
-Scalar::Scalar(const Scalar& n)
+Scalar::Scalar(const Scalar& n) : fr(n.fr)
 {
-    bn_new(this->bn);
-    bn_zero(this->bn);
-    bn_copy(this->bn, n.bn);
-    bn_t ord;
-    bn_new(ord);
-    g1_get_ord(ord);
-    bn_mod(this->bn, this->bn, ord);
 }
 
 Scalar::Scalar(const bls::PrivateKey& n)
 {
-    bn_new(this->bn);
-    bn_zero(this->bn);
+    EnsureInit();
     uint8_t buf[bls::PrivateKey::PRIVATE_KEY_SIZE];
     n.Serialize(buf);
-    bn_read_bin(this->bn, (unsigned char*)&buf, 32);
-    bn_t ord;
-    bn_new(ord);
-    g1_get_ord(ord);
-    bn_mod(this->bn, this->bn, ord);
+    bool fOk;
+    this->fr.setBigEndianMod(&fOk, buf, sizeof(buf));
+    memory_cleanse(buf, sizeof(buf));
+    CHECK_AND_ASSERT_THROW_MES(fOk, "Scalar: invalid private key");
 }
 
 bool Scalar::operator==(const int &b) const
 {
     Scalar temp;
     temp = b;
-    return bn_cmp(this->bn, temp.bn) == RLC_EQ;
+    return this->fr == temp.fr;
 }
 
 bool Scalar::operator==(const Scalar &b) const
 {
-    return bn_cmp(this->bn, b.bn) == RLC_EQ;
+    return this->fr == b.fr;
 }
 
 std::vector<uint8_t> Scalar::GetVch() const
 {
-    std::vector<uint8_t> ret(bls::PrivateKey::PRIVATE_KEY_SIZE);
-    bn_write_bin(ret.data(), bls::PrivateKey::PRIVATE_KEY_SIZE, this->bn);
-    return ret;
+    uint8_t v[SCALAR_SIZE];
+    GetLittleEndian(this->fr, v);
+    return std::vector<uint8_t>(std::reverse_iterator<uint8_t*>(v + SCALAR_SIZE), std::reverse_iterator<uint8_t*>(v));
 }
 
 Scalar Scalar::Invert() const
 {
-    bn_t ord;
-    bn_new(ord);
-    g1_get_ord(ord);
-    Scalar inv;
-    Scalar toinverse;
-    toinverse = *this;
-    fp_inv_exgcd_bn(inv.bn, toinverse.bn, ord);
-
-    bn_mod(inv.bn, inv.bn, ord);
-
-    CHECK_AND_ASSERT_THROW_MES((*this * inv) == 1, "Invert failed");
+    CHECK_AND_ASSERT_THROW_MES(!this->fr.isZero(), "Invert failed");
 
+    Scalar inv;
+    Fr::inv(inv.fr, this->fr);
     return inv;
 }
 
 int64_t Scalar::GetInt64() const
 {
-    int64_t ret = 0;
-    for (int64_t i = 0; i < 64; i++)
-    {
-        ret |= (int64_t)bn_get_bit(this->bn, i) << i;
-    }
-    return ret;
+    uint8_t v[SCALAR_SIZE];
+    GetLittleEndian(this->fr, v);
+
+    uint64_t ret = 0;
+    for (size_t i = 0; i < 8; i++)
+        ret |= (uint64_t)v[i] << (8 * i);
+    return (int64_t)ret;
 }
 
 bool Scalar::GetBit(size_t n) const
 {
-    return bn_get_bit(this->bn, n);
+    if (n >= 8 * SCALAR_SIZE)
+        return false;
+
+    uint8_t v[SCALAR_SIZE];
+    GetLittleEndian(this->fr, v);
+    return (v[n / 8] >> (n % 8)) & 1;
 }
 
+// Reduces 512 random bits, so the bias is negligible
 Scalar Scalar::Rand()
 {
-    bn_t ord;
-    bn_new(ord);
-    g1_get_ord(ord);
-    bn_t ret;
-    bn_rand_mod(ret, ord);
+    uint8_t buf[2 * SCALAR_SIZE];
+    GetStrongRandBytes(buf, sizeof(buf));
+
     Scalar r;
-    r = ret;
+    SetLittleEndian(r.fr, buf, sizeof(buf));
+    memory_cleanse(buf, sizeof(buf));
     return r;
 }
 
@@ -299,45 +291,117 @@ uint256 Scalar::Hash(const int& n) const
 
 Scalar::Scalar(const bn_t& n)
 {
-    bn_new(this->bn);
-    bn_zero(this->bn);
-    bn_copy(this->bn, n);
-    bn_t ord;
-    bn_new(ord);
-    g1_get_ord(ord);
-    bn_mod(this->bn, this->bn, ord);
+    EnsureInit();
+    uint8_t buf[2 * SCALAR_SIZE] = {0};
+    CHECK_AND_ASSERT_THROW_MES(bn_size_bin(n) <= (int)sizeof(buf), "Scalar: value too large");
+    bn_write_bin(buf, sizeof(buf), n);
+    bool fOk;
+    this->fr.setBigEndianMod(&fOk, buf, sizeof(buf));
+    if (bn_sign(n) == RLC_NEG)
+        Fr::neg(this->fr, this->fr);
 }
 
 Scalar::Scalar(const uint256 &b)
 {
-    bn_new(this->bn);
-    bn_zero(this->bn);
-    bn_read_bin(this->bn, (unsigned char*)&b, 32);
-    bn_t ord;
-    bn_new(ord);
-    g1_get_ord(ord);
-    bn_mod(this->bn, this->bn, ord);
+    EnsureInit();
+    bool fOk;
+    this->fr.setBigEndianMod(&fOk, b.begin(), 32);
 }
 
+// Values from the network which are not reduced are read modulo the group order
 void Scalar::SetVch(const std::vector<uint8_t> &b)
 {
-    bn_read_bin(this->bn, &b.front(), b.size());
+    if (b.empty())
+    {
+        this->fr.clear();
+        return;
+    }
+
+    bool fOk;
+    this->fr.setBigEndianMod(&fOk, &b.front(), b.size());
+    CHECK_AND_ASSERT_THROW_MES(fOk, "Scalar: value too large");
 }
 
 Scalar Scalar::Negate() const
 {
     Scalar ret;
-    bn_neg(ret.bn, this->bn);
-    bn_t ord;
-    bn_new(ord);
-    g1_get_ord(ord);
-    bn_mod(ret.bn, ret.bn, ord);
+    Fr::neg(ret.fr, this->fr);
     return ret;
 }
 
 void Scalar::SetPow2(const int& n)
 {
-    bn_set_2b(this->bn, n);
+    this->fr = 1;
+    for (int i = 0; i < n; i++)
+        Fr::add(this->fr, this->fr, this->fr);
+}
+
+void Scalar::GetBN(bn_t b) const
+{
+    std::vector<uint8_t> v = GetVch();
+    bn_read_bin(b, v.data(), v.size());
+}
+
+bls::PrivateKey Scalar::GetPrivateKey() const
+{
+    bn_t b;
+    bn_new(b);
+    GetBN(b);
+    bls::PrivateKey ret = bls::PrivateKey::FromBN(b);
+    bn_free(b);
+    return ret;
+}
+
+std::vector<Scalar> VectorInvert(const std::vector<Scalar>& x)
+{
+    std::vector<Scalar> ret(x.size());
+
+    if (x.empty())
+        return ret;
+
+    // Montgomery's trick: ret[i] holds the product of x[0..i-1] until the single inversion
+    Fr acc = 1;
+    for (size_t i = 0; i < x.size(); i++)
+    {
+        CHECK_AND_ASSERT_THROW_MES(!x[i].fr.isZero(), "Invert failed");
+        ret[i].fr = acc;
+        Fr::mul(acc, acc, x[i].fr);
+    }
+
+    Fr::inv(acc, acc);
+
+    for (size_t i = x.size(); i > 0; i--)
+    {
+        Fr::mul(ret[i-1].fr, ret[i-1].fr, acc);
+        Fr::mul(acc, acc, x[i-1].fr);
+    }
+
+    return ret;
+}
+
+bls::G1Element operator*(const bls::G1Element& a, const Scalar& b)
+{
+    bn_t bn;
+    bn_new(bn);
+    b.GetBN(bn);
+    bls::G1Element ret = a * bn;
+    bn_free(bn);
+    return ret;
+}
+
+bls::G1Element operator*(const Scalar& a, const bls::G1Element& b)
+{
+    return b * a;
+}
+
+bls::G2Element operator*(const bls::G2Element& a, const Scalar& b)
+{
+    bn_t bn;
+    bn_new(bn);
+    b.GetBN(bn);
+    bls::G2Element ret = a * bn;
+    bn_free(bn);
+    return ret;
 }
 
 uint256 HashG1Element(bls::G1Element g1, uint64_t n)
@@ -33,12 +33,28 @@
 #include "relic_core.h"
 #include "relic_test.h"
 
+#define MCL_DONT_USE_XBYAK
+#define MCL_DONT_USE_OPENSSL
+
+#include <mcl/bls12_381.hpp>
+
+#include <atomic>
 #include <stddef.h>
 #include <string>
 #include <vector>
 
 #define CHECK_AND_ASSERT_THROW_MES(expr, message) do {if(!(expr)) throw std::runtime_error(message);} while(0)
 
+/**
+ * Element of the scalar field of BLS12-381, kept in Montgomery form in a fixed size mcl Fr
+ * so arithmetic needs no allocation and multi-exponentiations read it without conversion.
+ * Relic big numbers are only produced at the boundary with the bls library.
+ *
+ * Values are always reduced modulo the group order, as the relic big number was when
+ * copied, so the bytes hashed into bulletproof transcripts are the same on every node.
+ * The arithmetic uses the generic mcl field operations, which are not constant time:
+ * inversions are only done on public transcript challenges.
+ */
 class Scalar {
 public:
     Scalar();
@@ -48,8 +64,13 @@ public:
     Scalar(const bn_t &b);
     Scalar(const Scalar& n);
     Scalar(const uint256& n);
+    explicit Scalar(const mcl::bn::Fr& n) : fr(n) {}
+
+    /** Sets the curve parameters of mcl, which any arithmetic needs. The constructors call it. */
+    static bool Init();
 
     void operator=(const uint64_t& n);
+    Scalar& operator=(const Scalar& n) { fr = n.fr; return *this; }
 
     Scalar operator+(const Scalar &b) const;
     Scalar operator-(const Scalar &b) const;
@@ -77,6 +98,12 @@ public:
 
     uint256 Hash(const int& n) const;
 
+    const mcl::bn::Fr& GetFr() const { return fr; }
+
+    /** Writes the value to b, which must have been initialized with bn_new */
+    void GetBN(bn_t b) const;
+    bls::PrivateKey GetPrivateKey() const;
+
     static Scalar Rand();
 
     unsigned int GetSerializeSize(int nType=0, int nVersion=PROTOCOL_VERSION) const
@@ -98,9 +125,21 @@ public:
         SetVch(vch);
     }
 
-    bn_t bn;
+    mcl::bn::Fr fr;
+
+private:
+    static std::atomic<bool> fInitialized;
+
+    static void EnsureInit() { if (!fInitialized.load(std::memory_order_acquire)) Init(); }
 };
 
+/** Inverts every element of x with a single field inversion */
+std::vector<Scalar> VectorInvert(const std::vector<Scalar>& x);
+
+bls::G1Element operator*(const bls::G1Element& a, const Scalar& b);
+bls::G1Element operator*(const Scalar& a, const bls::G1Element& b);
+bls::G2Element operator*(const bls::G2Element& a, const Scalar& b);
+
 uint256 HashG1Element(bls::G1Element g1, uint64_t n);
 
 #endif // NAVCOIN_BLSCT_SCALAR_H
@@ -4,6 +4,9 @@
 
 #include "transaction.h"
 
+#include <crypto/aes.h>
+#include <support/cleanse.h>
+
 bool CreateBLSCTOutput(bls::PrivateKey blindingKey, bls::G1Element& nonce, CTxOut& newTxOut, const blsctDoublePublicKey& destKey, const CAmount& nAmount, std::string sMemo,
                        Scalar& gammaAcc, std::string &strFailReason, const bool& fBLSSign, std::vector<bls::G2Element>& vBLSSignatures, bool fVerify)
 {
@@ -116,7 +119,7 @@ bool GenTxOutputKeys(bls::PrivateKey blindingKey, const blsctDoublePublicKey& de
             return false;
         }
         bls::G1Element rV = blindingKey*V;
-        bls::G1Element P = bls::PrivateKey::FromBN(Scalar(HashG1Element(rV,0)).bn).GetG1Element();
+        bls::G1Element P = Scalar(HashG1Element(rV,0)).GetPrivateKey().GetG1Element();
         P = S + P;
 
         spendingKey = P.Serialize();
@@ -145,7 +148,7 @@ bool CandidateTransaction::Validate(const CStateViewCache* inputs) {
     for (unsigned int i = 0; i < tx.vout.size(); i++)
     {
         Scalar s = minAmount;
-        bls::G1Element l = (BulletproofsRangeproof::H*s.bn).Inverse();
+        bls::G1Element l = (BulletproofsRangeproof::H*s).Inverse();
         bls::G1Element r = tx.vout[i].GetBulletproof().V[0];
         l = l + r;
         if (!(l == minAmountProofs.V[i]))
@@ -166,7 +169,7 @@ bool CandidateTransaction::Validate(const CStateViewCache* inputs) {
 
     try
     {
-        if(!VerifyBLSCT(tx, bls::PrivateKey::FromBN(Scalar::Rand().bn), blsctData, *inputs, state, false, fee))
+        if(!VerifyBLSCT(tx, Scalar::Rand().GetPrivateKey(), blsctData, *inputs, state, false, fee))
         {
             return error("CandidateTransaction::%s: Failed validation of transaction candidate %s", __func__, state.GetRejectReason());
         }
@@ -219,19 +222,60 @@ bool EncryptedCandidateTransaction::Decrypt(const bls::PrivateKey &key, const CS
         return false;
 
     bls::G1Element publicKey = bls::G1Element::FromByteVector(vPublicKey);
+    uint256 keyHash = SerializeHash(key.GetG1Element().Serialize());
+    uint256 hashedSharedKey;
+
+    if (!MatchKey(publicKey, key, keyHash, hashedSharedKey))
+        return false;
+
+    CandidateTransaction candidate;
+
+    if (!Decrypt(publicKey, key, keyHash, hashedSharedKey, candidate))
+        return false;
 
-    if (vData.size() == 0)
+    if (!candidate.Validate(inputs))
+        return false;
+
+    tx = candidate;
+
+    return true;
+}
+
+bool EncryptedCandidateTransaction::MatchKey(const bls::G1Element &publicKey, const bls::PrivateKey &key, const uint256 &keyHash, uint256 &hashedSharedKey) const
+{
+    if (vData.size() == 0 || vData.size() % AES_BLOCKSIZE != 0)
         return false;
 
     bls::G1Element sharedKey = key * publicKey;
-    uint256 hashedSharedKey = SerializeHash(sharedKey.Serialize());
+    hashedSharedKey = SerializeHash(sharedKey.Serialize());
+
+    // Last block of the CBC chain, the IV being the hash of the recipient public key as in DecryptSecret()
+    const unsigned char* prev = vData.size() > AES_BLOCKSIZE ? &vData[vData.size() - 2 * AES_BLOCKSIZE] : keyHash.begin();
+    unsigned char block[AES_BLOCKSIZE];
+
+    AES256Decrypt(hashedSharedKey.begin()).Decrypt(block, &vData[vData.size() - AES_BLOCKSIZE]);
+    for (int i = 0; i < AES_BLOCKSIZE; i++)
+        block[i] ^= prev[i];
+
+    // A wrong key leaves well-formed padding only about once every 256 tries
+    unsigned char nPadding = block[AES_BLOCKSIZE - 1];
+    bool fMatch = nPadding > 0 && nPadding <= AES_BLOCKSIZE;
+    for (int i = AES_BLOCKSIZE - nPadding; fMatch && i < AES_BLOCKSIZE; i++)
+        fMatch = block[i] == nPadding;
+
+    memory_cleanse(block, sizeof(block));
 
+    return fMatch;
+}
+
+bool EncryptedCandidateTransaction::Decrypt(const bls::G1Element &publicKey, const bls::PrivateKey &key, const uint256 &keyHash, const uint256 &hashedSharedKey, CandidateTransaction& tx) const
+{
     CKeyingMaterial vEncryptionKey;
     vEncryptionKey.resize(bls::PrivateKey::PRIVATE_KEY_SIZE);
     memcpy(vEncryptionKey.data(), hashedSharedKey.begin(), vEncryptionKey.size());
 
     CKeyingMaterial vchSecret;
-    if(!DecryptSecret(vEncryptionKey, vData, SerializeHash(key.GetG1Element().Serialize()), vchSecret))
+    if(!DecryptSecret(vEncryptionKey, vData, keyHash, vchSecret))
         return false;
 
     DecryptedCandidateTransaction dct;
@@ -248,9 +292,6 @@ bool EncryptedCandidateTransaction::Decrypt(const bls::PrivateKey &key, const CS
     if (!bls::AugSchemeMPL::Verify(publicKey, key.GetG1Element().Serialize(), sig))
         return false;
 
-    if (!dct.tx.Validate(inputs))
-        return false;
-
     tx = dct.tx;
 
     return true;
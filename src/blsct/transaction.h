@@ -29,6 +29,7 @@
 
 #define BLSCT_THREAD_SLEEP_AGG 5000
 #define BLSCT_THREAD_SLEEP_VER 16000
+#define BLSCT_VER_BATCH_SIZE 256
 
 #define BLSCT_TX_INPUT_FEE 200000
 #define BLSCT_TX_OUTPUT_FEE 200000
@@ -77,6 +78,14 @@ public:
 
     bool Decrypt(const bls::PrivateKey &key, const CStateViewCache* inputs, CandidateTransaction& tx) const;
 
+    //! Cheap check of whether this is encrypted to key, whose public key hashes to keyHash, by
+    //! decrypting only the padding of the last block. Sets the key shared with the sender.
+    bool MatchKey(const bls::G1Element &publicKey, const bls::PrivateKey &key, const uint256 &keyHash, uint256 &hashedSharedKey) const;
+
+    //! Decrypts with a shared key found by MatchKey() and verifies the signature of the sender,
+    //! but does not validate the candidate
+    bool Decrypt(const bls::G1Element &publicKey, const bls::PrivateKey &key, const uint256 &keyHash, const uint256 &hashedSharedKey, CandidateTransaction& tx) const;
+
     friend inline  bool operator==(const EncryptedCandidateTransaction& a, const EncryptedCandidateTransaction& b) { return a.vData == b.vData && a.vPublicKey == b.vPublicKey; }
     friend inline  bool operator<(const EncryptedCandidateTransaction& a, const EncryptedCandidateTransaction& b) { return a.vData < b.vData; }
 
@@ -5,12 +5,8 @@
 #include "verification.h"
 #include "utiltime.h"
 
-bool VerifyBLSCT(const CTransaction &tx, bls::PrivateKey viewKey, std::vector<RangeproofEncodedData> &vData, const CStateViewCache& view, CValidationState& state, bool fOnlyRecover, CAmount nMixFee)
+bool PrepareBLSCTVerification(const CTransaction &tx, bls::PrivateKey viewKey, std::vector<RangeproofEncodedData> &vData, const CStateViewCache& view, CValidationState& state, BLSCTVerificationData& data, bool fOnlyRecover, CAmount nMixFee, bool fDeferRecovery)
 {
-    auto nStart = GetTimeMicros();
-    std::vector<std::pair<int, BulletproofsRangeproof>> proofs;
-    std::vector<bls::G1Element> nonces;
-
     bls::G1Element balKey;
     bool fElementZero = true;
 
@@ -18,6 +14,9 @@ bool VerifyBLSCT(const CTransaction &tx, bls::PrivateKey viewKey, std::vector<Ra
     bool fCheckBLSSignature = tx.IsBLSInput();
     bool fCheckBalance = fCheckBLSSignature || fCheckRange;
 
+    data = BLSCTVerificationData();
+    data.txHash = tx.GetHash();
+
     if (fOnlyRecover)
     {
         fCheckBLSSignature = false;
@@ -30,9 +29,6 @@ bool VerifyBLSCT(const CTransaction &tx, bls::PrivateKey viewKey, std::vector<Ra
     if (!(fCheckRange || fCheckBalance || fCheckBLSSignature))
         return true;
 
-    std::vector<bls::G1Element> txSigningKeys;
-    std::vector<std::vector<uint8_t>> vMessages;
-
     CAmount valIn = 0;
     CAmount valOut = 0;
 
@@ -43,8 +39,8 @@ bool VerifyBLSCT(const CTransaction &tx, bls::PrivateKey viewKey, std::vector<Ra
         if (nMixFee < 0)
             sMixFee = sMixFee.Negate();
 
-        Scalar s = Scalar(sMixFee).bn;
-        bls::G1Element t = BulletproofsRangeproof::H*s.bn;
+        Scalar s = Scalar(sMixFee);
+        bls::G1Element t = BulletproofsRangeproof::H*s;
         balKey = fElementZero ? t : balKey + t;
         valIn += nMixFee;
         fElementZero = false;
@@ -65,8 +61,8 @@ bool VerifyBLSCT(const CTransaction &tx, bls::PrivateKey viewKey, std::vector<Ra
                 }
                 else
                 {
-                    Scalar s = Scalar(prevOut.nValue).bn;
-                    bls::G1Element t = BulletproofsRangeproof::H*s.bn;
+                    Scalar s = Scalar(prevOut.nValue);
+                    bls::G1Element t = BulletproofsRangeproof::H*s;
                     balKey = fElementZero ? t : balKey + t;
                     valIn += prevOut.nValue;
                     fElementZero = false;
@@ -77,7 +73,7 @@ bool VerifyBLSCT(const CTransaction &tx, bls::PrivateKey viewKey, std::vector<Ra
             {
                 try
                 {
-                    txSigningKeys.push_back(bls::G1Element::FromBytes(prevOut.spendingKey.data()));
+                    data.txSigningKeys.push_back(bls::G1Element::FromBytes(prevOut.spendingKey.data()));
                 }
                 catch(std::exception& e)
                 {
@@ -87,7 +83,7 @@ bool VerifyBLSCT(const CTransaction &tx, bls::PrivateKey viewKey, std::vector<Ra
                 CHashWriter hasher(0,0);
                 hasher << tx.vin[j];
                 uint256 hash = hasher.GetHash();
-                vMessages.push_back(std::vector<unsigned char>(hash.begin(), hash.end()));
+                data.vMessages.push_back(std::vector<unsigned char>(hash.begin(), hash.end()));
             }
         }
     }
@@ -102,13 +98,13 @@ bool VerifyBLSCT(const CTransaction &tx, bls::PrivateKey viewKey, std::vector<Ra
             }
             if (fCheckRange)
             {
-                proofs.push_back(std::make_pair(j, tx.vout[j].GetBulletproof()));
+                data.proofs.push_back(std::make_pair(j, tx.vout[j].GetBulletproof()));
                 // Shared key v*R - Used as nonce for bulletproof
                 try
                 {
                     bls::G1Element t = bls::G1Element::FromBytes(tx.vout[j].outputKey.data());
                     t = t * viewKey;
-                    nonces.push_back(t);
+                    data.nonces.push_back(t);
                 }
                 catch(std::exception& e)
                 {
@@ -134,12 +130,12 @@ bool VerifyBLSCT(const CTransaction &tx, bls::PrivateKey viewKey, std::vector<Ra
             if (fElementZero)
             {
                 Scalar s = Scalar(tx.vout[j].nValue);
-                balKey = BulletproofsRangeproof::H*s.bn;
+                balKey = BulletproofsRangeproof::H*s;
             }
             else
             {
                 Scalar s = Scalar(tx.vout[j].nValue);
-                bls::G1Element t = BulletproofsRangeproof::H*s.bn;
+                bls::G1Element t = BulletproofsRangeproof::H*s;
                 t = t.Inverse();
                 balKey = balKey + t;
             }
@@ -155,35 +151,76 @@ bool VerifyBLSCT(const CTransaction &tx, bls::PrivateKey viewKey, std::vector<Ra
             }
             try
             {
-                txSigningKeys.push_back(bls::G1Element::FromBytes(tx.vout[j].ephemeralKey.data()));
+                data.txSigningKeys.push_back(bls::G1Element::FromBytes(tx.vout[j].ephemeralKey.data()));
             }
             catch(std::exception& e)
             {
                 return state.DoS(100, false, REJECT_INVALID, strprintf("caught-ephemeralkey-exception"));
             }
             uint256 hash = tx.vout[j].GetHash();
-            vMessages.push_back(std::vector<unsigned char>(hash.begin(), hash.end()));
+            data.vMessages.push_back(std::vector<unsigned char>(hash.begin(), hash.end()));
         }
     }
 
-    if (fCheckRange && proofs.size() > 0)
+    // Recovering the amounts is cheap compared to the range proof verification,
+    // so it is done here and the proofs themselves are left for VerifyBLSCTData.
+    // With fDeferRecovery it is left for RecoverBLSCTData, which writes to vData.
+    if (fCheckRange && data.proofs.size() > 0)
     {
-        if (!VerifyBulletproof(proofs, vData, nonces, fOnlyRecover))
+        if (fDeferRecovery)
+        {
+            vData.clear();
+            data.pvData = &vData;
+        }
+        else if (!VerifyBulletproof(data.proofs, vData, data.nonces, true))
         {
             return state.DoS(100, false, REJECT_INVALID, "invalid-rangeproof");
         }
     }
 
-    if (fCheckBalance)
+    data.fCheckRange = fCheckRange && !fOnlyRecover && data.proofs.size() > 0;
+    data.fCheckBalance = fCheckBalance;
+    data.fCheckBLSSignature = fCheckBLSSignature;
+    data.balKey = balKey;
+    data.vchBalanceSig = tx.vchBalanceSig;
+    data.vchTxSig = tx.vchTxSig;
+
+    return true;
+}
+
+bool RecoverBLSCTData(const BLSCTVerificationData& data, CValidationState& state)
+{
+    if (!data.pvData)
+        return true;
+
+    if (!VerifyBulletproof(data.proofs, *data.pvData, data.nonces, true))
+        return state.DoS(100, false, REJECT_INVALID, "invalid-rangeproof");
+
+    return true;
+}
+
+bool VerifyBLSCTData(const BLSCTVerificationData& data, CValidationState& state)
+{
+    if (data.fCheckRange)
     {
-        if (tx.vchBalanceSig.size() == 0)
+        std::vector<RangeproofEncodedData> vDummyData;
+
+        if (!VerifyBulletproof(data.proofs, vDummyData, std::vector<bls::G1Element>()))
+        {
+            return state.DoS(100, false, REJECT_INVALID, "invalid-rangeproof");
+        }
+    }
+
+    if (data.fCheckBalance)
+    {
+        if (data.vchBalanceSig.size() == 0)
             return state.DoS(100, false, REJECT_INVALID, strprintf("could-not-read-balanceproof"));
 
         try
         {
-            bls::G2Element sig = bls::G2Element::FromBytes(tx.vchBalanceSig.data());
+            bls::G2Element sig = bls::G2Element::FromBytes(data.vchBalanceSig.data());
 
-            if (!bls::BasicSchemeMPL::Verify(balKey, balanceMsg, sig))
+            if (!bls::BasicSchemeMPL::Verify(data.balKey, balanceMsg, sig))
                 return state.DoS(100, false, REJECT_INVALID, strprintf("invalid-balanceproof"));
         }
         catch(std::exception& e)
@@ -192,16 +229,16 @@ bool VerifyBLSCT(const CTransaction &tx, bls::PrivateKey viewKey, std::vector<Ra
         }
     }
 
-    if (fCheckBLSSignature)
+    if (data.fCheckBLSSignature)
     {
-        if (tx.vchTxSig.size() == 0)
+        if (data.vchTxSig.size() == 0)
             return state.DoS(100, false, REJECT_INVALID, strprintf("could-not-read-blstxsig"));
 
         try
         {
-            bls::G2Element txsig = bls::G2Element::FromBytes(tx.vchTxSig.data());
+            bls::G2Element txsig = bls::G2Element::FromBytes(data.vchTxSig.data());
 
-            if (!bls::AugSchemeMPL::AggregateVerify(txSigningKeys, vMessages, txsig))
+            if (!bls::AugSchemeMPL::AggregateVerify(data.txSigningKeys, data.vMessages, txsig))
                 return state.DoS(100, false, REJECT_INVALID, "invalid-bls-signature");
         }
         catch(std::exception& e)
@@ -210,10 +247,184 @@ bool VerifyBLSCT(const CTransaction &tx, bls::PrivateKey viewKey, std::vector<Ra
         }
     }
 
-    //std::cout << strprintf("%s: took %.2f ms\n", __func__, (GetTimeMicros()-nStart)/1000);
     return true;
 }
 
+// Verifies the range proofs of vBatch[nBegin, nEnd) in a single bulletproof
+// multi-exponentiation and their signatures in one pairing check per scheme.
+// Every transaction is weighted with a random scalar so invalid signatures
+// of different transactions can not cancel each other out.
+static bool VerifyBLSCTCombined(const std::vector<BLSCTVerificationData>& vBatch, size_t nBegin, size_t nEnd)
+{
+    std::vector<std::pair<int, BulletproofsRangeproof>> proofs;
+
+    bls::G1Element balKeys;
+    bls::G2Element balSigs;
+    bool fBalance = false;
+
+    std::vector<bls::G1Element> txSigningKeys;
+    std::vector<std::vector<uint8_t>> vMessages;
+    bls::G2Element txSigs;
+    bool fTxSig = false;
+
+    for (size_t i = nBegin; i < nEnd; i++)
+    {
+        const BLSCTVerificationData& data = vBatch[i];
+
+        if (data.fCheckRange)
+            proofs.insert(proofs.end(), data.proofs.begin(), data.proofs.end());
+
+        if (!(data.fCheckBalance || data.fCheckBLSSignature))
+            continue;
+
+        Scalar weight = Scalar::Rand();
+
+        if (data.fCheckBalance)
+        {
+            if (data.vchBalanceSig.size() == 0)
+                return false;
+
+            bls::G1Element key = data.balKey * weight;
+            bls::G2Element sig = bls::G2Element::FromBytes(data.vchBalanceSig.data()) * weight;
+
+            balKeys = fBalance ? balKeys + key : key;
+            balSigs = fBalance ? balSigs + sig : sig;
+            fBalance = true;
+        }
+
+        if (data.fCheckBLSSignature)
+        {
+            if (data.vchTxSig.size() == 0 || data.txSigningKeys.size() != data.vMessages.size())
+                return false;
+
+            for (size_t j = 0; j < data.txSigningKeys.size(); j++)
+            {
+                // Augmented scheme: the message is prefixed with the unweighted public key
+                std::vector<uint8_t> augMessage = data.txSigningKeys[j].Serialize();
+                augMessage.insert(augMessage.end(), data.vMessages[j].begin(), data.vMessages[j].end());
+
+                txSigningKeys.push_back(data.txSigningKeys[j] * weight);
+                vMessages.push_back(augMessage);
+            }
+
+            bls::G2Element sig = bls::G2Element::FromBytes(data.vchTxSig.data()) * weight;
+
+            txSigs = fTxSig ? txSigs + sig : sig;
+            fTxSig = true;
+        }
+    }
+
+    if (proofs.size() > 0)
+    {
+        std::vector<RangeproofEncodedData> vDummyData;
+
+        if (!VerifyBulletproof(proofs, vDummyData, std::vector<bls::G1Element>()))
+            return false;
+    }
+
+    if (fBalance && !bls::BasicSchemeMPL::Verify(balKeys, balanceMsg, balSigs))
+        return false;
+
+    if (fTxSig && !bls::CoreMPL::AggregateVerify(txSigningKeys, vMessages, txSigs,
+                                                 bls::AugSchemeMPL::CIPHERSUITE_ID, bls::AugSchemeMPL::CIPHERSUITE_ID_LEN))
+        return false;
+
+    return true;
+}
+
+// Bisects a failing range of the batch until the offending transaction is found.
+static bool VerifyBLSCTBatchRange(const std::vector<BLSCTVerificationData>& vBatch, size_t nBegin, size_t nEnd, CValidationState& state, uint256& hashFailed)
+{
+    if (nEnd - nBegin == 1)
+    {
+        bool fValid = false;
+
+        try
+        {
+            fValid = VerifyBLSCTData(vBatch[nBegin], state);
+        }
+        catch(...)
+        {
+            fValid = state.DoS(100, false, REJECT_INVALID, "caught-blsct-exception");
+        }
+
+        if (!fValid)
+            hashFailed = vBatch[nBegin].txHash;
+
+        return fValid;
+    }
+
+    bool fValid = false;
+
+    try
+    {
+        fValid = VerifyBLSCTCombined(vBatch, nBegin, nEnd);
+    }
+    catch(...)
+    {
+        fValid = false;
+    }
+
+    if (fValid)
+        return true;
+
+    size_t nMiddle = nBegin + (nEnd - nBegin) / 2;
+
+    if (!VerifyBLSCTBatchRange(vBatch, nBegin, nMiddle, state, hashFailed))
+        return false;
+
+    if (!VerifyBLSCTBatchRange(vBatch, nMiddle, nEnd, state, hashFailed))
+        return false;
+
+    // The whole range failed but both halves verify: this can only happen if the random
+    // weights collided, which is negligible. Be conservative and reject.
+    hashFailed = vBatch[nBegin].txHash;
+    return state.DoS(100, false, REJECT_INVALID, "invalid-blsct-batch");
+}
+
+bool VerifyBLSCTBatch(const std::vector<BLSCTVerificationData>& vBatch, size_t nBegin, size_t nEnd, CValidationState& state, uint256& hashFailed)
+{
+    if (nBegin >= nEnd || nEnd > vBatch.size())
+        return true;
+
+    for (size_t i = nBegin; i < nEnd; i++)
+    {
+        bool fValid = false;
+
+        try
+        {
+            fValid = RecoverBLSCTData(vBatch[i], state);
+        }
+        catch(...)
+        {
+            fValid = state.DoS(100, false, REJECT_INVALID, "caught-blsct-exception");
+        }
+
+        if (!fValid)
+        {
+            hashFailed = vBatch[i].txHash;
+            return false;
+        }
+    }
+
+    return VerifyBLSCTBatchRange(vBatch, nBegin, nEnd, state, hashFailed);
+}
+
+bool VerifyBLSCTBatch(const std::vector<BLSCTVerificationData>& vBatch, CValidationState& state, uint256& hashFailed)
+{
+    return VerifyBLSCTBatch(vBatch, 0, vBatch.size(), state, hashFailed);
+}
+
+bool VerifyBLSCT(const CTransaction &tx, bls::PrivateKey viewKey, std::vector<RangeproofEncodedData> &vData, const CStateViewCache& view, CValidationState& state, bool fOnlyRecover, CAmount nMixFee)
+{
+    BLSCTVerificationData data;
+
+    if (!PrepareBLSCTVerification(tx, viewKey, vData, view, state, data, fOnlyRecover, nMixFee))
+        return false;
+
+    return VerifyBLSCTData(data, state);
+}
+
 
 bool VerifyBLSCTBalanceOutputs(const CTransaction &tx, bls::PrivateKey viewKey, std::vector<RangeproofEncodedData> &vData, const CStateViewCache& view, CValidationState& state, bool fOnlyRecover, CAmount nMixFee)
 {
@@ -236,8 +447,8 @@ bool VerifyBLSCTBalanceOutputs(const CTransaction &tx, bls::PrivateKey viewKey,
         if (nMixFee < 0)
             sMixFee = sMixFee.Negate();
 
-        Scalar s = Scalar(sMixFee).bn;
-        bls::G1Element t = BulletproofsRangeproof::H*s.bn;
+        Scalar s = Scalar(sMixFee);
+        bls::G1Element t = BulletproofsRangeproof::H*s;
         balKey = fElementZero ? t : balKey + t;
         valIn += nMixFee;
         fElementZero = false;
@@ -313,14 +524,32 @@ bool VerifyBLSCTBalanceOutputs(const CTransaction &tx, bls::PrivateKey viewKey,
 }
 
 
-bool CombineBLSCTTransactions(std::set<CTransaction> &vTx, CTransaction& outTx, const CStateViewCache& inputs, CValidationState& state, CAmount nMixFee)
+bool GetBLSCTCombineData(const CTransaction &tx, BLSCTCombineData& data)
+{
+    try
+    {
+        data.fBalanceSig = tx.vchBalanceSig.size() > 0;
+        if (data.fBalanceSig)
+            data.balanceSig = bls::G2Element::FromByteVector(tx.vchBalanceSig);
+
+        data.fTxSig = tx.vchTxSig.size() > 0;
+        if (data.fTxSig)
+            data.txSig = bls::G2Element::FromByteVector(tx.vchTxSig);
+    }
+    catch(...)
+    {
+        return false;
+    }
+
+    return true;
+}
+
+// Joins the inputs and outputs of vTx in a single transaction, with their fees in one output
+static bool CombineBLSCTInputsAndOutputs(const std::vector<const CTransaction*> &vTx, CMutableTransaction& mutOutTx, CValidationState& state)
 {
     std::set<CTxIn> setInputs;
     std::set<CTxOut> setOutputs;
 
-    std::vector<bls::G2Element> balanceSigs;
-    std::vector<bls::G2Element> txSigs;
-
     if (vTx.size() == 0)
         return state.DoS(100, false, REJECT_INVALID, strprintf("empty-vector-combine-blsct"));
 
@@ -329,21 +558,16 @@ bool CombineBLSCTTransactions(std::set<CTransaction> &vTx, CTransaction& outTx,
 
     for (auto& tx: vTx)
     {
-        if (!tx.IsBLSInput())
+        if (!tx->IsBLSInput())
             return state.DoS(100, false, REJECT_INVALID, strprintf("cant-combine-non-blsct"));
 
-        for (auto& in: tx.vin)
+        for (auto& in: tx->vin)
         {
-            for (auto &cin: setInputs)
-            {
-                if (cin == in)
-                    return state.DoS(100, false, REJECT_INVALID, strprintf("duplicate-input"));
-            }
-
-            setInputs.insert(in);
+            if (!setInputs.insert(in).second)
+                return state.DoS(100, false, REJECT_INVALID, strprintf("duplicate-input"));
         }
 
-        for (auto& out: tx.vout)
+        for (auto& out: tx->vout)
         {
             if (out.HasRangeProof())
             {
@@ -356,14 +580,46 @@ bool CombineBLSCTTransactions(std::set<CTransaction> &vTx, CTransaction& outTx,
                 continue;
             }
 
-            for (auto &cout: setOutputs)
-            {
-                if (cout == out)
-                    return state.DoS(100, false, REJECT_INVALID, strprintf("duplicate-output"));
-            }
-
-            setOutputs.insert(out);
+            if (!setOutputs.insert(out).second)
+                return state.DoS(100, false, REJECT_INVALID, strprintf("duplicate-output"));
         }
+    }
+
+    mutOutTx.nVersion = TX_BLS_INPUT_FLAG;
+    if (fAnyCTOutput)
+        mutOutTx.nVersion |= TX_BLS_CT_FLAG;
+    mutOutTx.nTime = GetTime();
+    mutOutTx.vin.clear();
+    mutOutTx.vout.clear();
+
+    for (auto& in: setInputs)
+    {
+        mutOutTx.vin.push_back(in);
+    }
+
+    for (auto& out: setOutputs)
+    {
+        mutOutTx.vout.push_back(out);
+    }
+
+    std::random_shuffle(mutOutTx.vin.begin(), mutOutTx.vin.end(), GetRandInt);
+    std::random_shuffle(mutOutTx.vout.begin(), mutOutTx.vout.end(), GetRandInt);
+
+    mutOutTx.vout.push_back(CTxOut(nFee, CScript(OP_RETURN)));
+
+    return true;
+}
+
+bool CombineBLSCTTransactions(std::set<CTransaction> &vTx, CTransaction& outTx, const CStateViewCache& inputs, CValidationState& state, CAmount nMixFee)
+{
+    std::vector<const CTransaction*> vTxPtr;
+
+    std::vector<bls::G2Element> balanceSigs;
+    std::vector<bls::G2Element> txSigs;
+
+    for (auto& tx: vTx)
+    {
+        vTxPtr.push_back(&tx);
 
         if (tx.vchBalanceSig.size() > 0)
         {
@@ -393,27 +649,10 @@ bool CombineBLSCTTransactions(std::set<CTransaction> &vTx, CTransaction& outTx,
     }
 
     CMutableTransaction mutOutTx;
-    mutOutTx.nVersion = TX_BLS_INPUT_FLAG;
-    if (fAnyCTOutput)
-        mutOutTx.nVersion |= TX_BLS_CT_FLAG;
-    mutOutTx.nTime = GetTime();
-    mutOutTx.vin.clear();
-    mutOutTx.vout.clear();
 
-    for (auto& in: setInputs)
-    {
-        mutOutTx.vin.push_back(in);
-    }
+    if (!CombineBLSCTInputsAndOutputs(vTxPtr, mutOutTx, state))
+        return false;
 
-    for (auto& out: setOutputs)
-    {
-        mutOutTx.vout.push_back(out);
-    }
-
-    std::random_shuffle(mutOutTx.vin.begin(), mutOutTx.vin.end(), GetRandInt);
-    std::random_shuffle(mutOutTx.vout.begin(), mutOutTx.vout.end(), GetRandInt);
-
-    mutOutTx.vout.push_back(CTxOut(nFee, CScript(OP_RETURN)));
     mutOutTx.SetBalanceSignature(bls::AugSchemeMPL::Aggregate(balanceSigs));
     mutOutTx.SetTxSignature(bls::AugSchemeMPL::Aggregate(txSigs));
 
@@ -426,10 +665,30 @@ bool CombineBLSCTTransactions(std::set<CTransaction> &vTx, CTransaction& outTx,
 
     try
     {
-        return VerifyBLSCT(outTx, bls::PrivateKey::FromBN(Scalar::Rand().bn), blsctData, inputs, state, false, nMixFee);
+        return VerifyBLSCT(outTx, Scalar::Rand().GetPrivateKey(), blsctData, inputs, state, false, nMixFee);
     }
     catch(...)
     {
         return state.DoS(100, false, REJECT_INVALID, strprintf("%s: catched exception", __func__));
     }
 }
+
+bool CombineVerifiedBLSCTTransactions(const std::vector<CTransaction> &vTx, const bls::G2Element& balanceSig, const bls::G2Element& txSig, CTransaction& outTx, CValidationState& state)
+{
+    std::vector<const CTransaction*> vTxPtr;
+
+    for (auto& tx: vTx)
+        vTxPtr.push_back(&tx);
+
+    CMutableTransaction mutOutTx;
+
+    if (!CombineBLSCTInputsAndOutputs(vTxPtr, mutOutTx, state))
+        return false;
+
+    mutOutTx.SetBalanceSignature(balanceSig);
+    mutOutTx.SetTxSignature(txSig);
+
+    outTx = mutOutTx;
+
+    return true;
+}
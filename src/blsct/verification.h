@@ -21,7 +21,54 @@
 #include <schemes.hpp>
 #include <utiltime.h>
 
+/** Expensive checks of a BLSCT transaction, gathered so they can be verified together with other transactions. */
+struct BLSCTVerificationData
+{
+    uint256 txHash;
+
+    bool fCheckRange = false;
+    bool fCheckBalance = false;
+    bool fCheckBLSSignature = false;
+
+    std::vector<std::pair<int, BulletproofsRangeproof>> proofs;
+    std::vector<bls::G1Element> nonces;
+
+    // When set, the recovery of the range proof data was deferred and is written here
+    std::vector<RangeproofEncodedData>* pvData = nullptr;
+
+    bls::G1Element balKey;
+    std::vector<uint8_t> vchBalanceSig;
+
+    std::vector<bls::G1Element> txSigningKeys;
+    std::vector<std::vector<uint8_t>> vMessages;
+    std::vector<uint8_t> vchTxSig;
+};
+
+bool PrepareBLSCTVerification(const CTransaction &tx, bls::PrivateKey viewKey, std::vector<RangeproofEncodedData> &vData, const CStateViewCache& view, CValidationState& state, BLSCTVerificationData& data, bool fOnlyRecover = false, CAmount nMixFee = 0, bool fDeferRecovery = false);
+bool RecoverBLSCTData(const BLSCTVerificationData& data, CValidationState& state);
+bool VerifyBLSCTData(const BLSCTVerificationData& data, CValidationState& state);
+bool VerifyBLSCTBatch(const std::vector<BLSCTVerificationData>& vBatch, size_t nBegin, size_t nEnd, CValidationState& state, uint256& hashFailed);
+bool VerifyBLSCTBatch(const std::vector<BLSCTVerificationData>& vBatch, CValidationState& state, uint256& hashFailed);
 bool VerifyBLSCT(const CTransaction &tx, bls::PrivateKey viewKey, std::vector<RangeproofEncodedData> &vData, const CStateViewCache& view, CValidationState& state, bool fOnlyRecover = false, CAmount nMixFee = 0);
 bool VerifyBLSCTBalanceOutputs(const CTransaction &tx, bls::PrivateKey viewKey, std::vector<RangeproofEncodedData> &vData, const CStateViewCache& view, CValidationState& state, bool fOnlyRecover = false, CAmount nMixFee = 0);
+
+/** Signatures of a BLSCT transaction, parsed once so it can be combined with others */
+struct BLSCTCombineData
+{
+    bool fBalanceSig = false;
+    bls::G2Element balanceSig;
+
+    bool fTxSig = false;
+    bls::G2Element txSig;
+};
+
+bool GetBLSCTCombineData(const CTransaction &tx, BLSCTCombineData& data);
 bool CombineBLSCTTransactions(std::set<CTransaction> &vTx, CTransaction& outTx, const CStateViewCache& inputs, CValidationState& state, CAmount nMixFee = 0);
+
+/**
+ * Combines transactions which were verified on their own, without mixing fee, given the sums of
+ * their balance and transaction signatures. As the range proofs, balances and signatures add up,
+ * the result is not verified again.
+ */
+bool CombineVerifiedBLSCTTransactions(const std::vector<CTransaction> &vTx, const bls::G2Element& balanceSig, const bls::G2Element& txSig, CTransaction& outTx, CValidationState& state);
 #endif // BLSCT_VERIFICATION_H
@@ -0,0 +1,113 @@
+// Copyright (c) 2020 The Navcoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <blsct/verificationcache.h>
+
+#include <crypto/common.h>
+#include <crypto/sha256.h>
+#include <memusage.h>
+#include <random.h>
+#include <shardedcache.h>
+#include <util.h>
+
+namespace {
+
+class CBLSCTDataUsage
+{
+public:
+    size_t operator()(const std::vector<RangeproofEncodedData>& vData) const {
+        size_t nUsage = memusage::DynamicUsage(vData);
+
+        for (auto& it: vData)
+            nUsage += memusage::MallocUsage(it.message.capacity());
+
+        return nUsage;
+    }
+};
+
+/**
+ * Cache of valid BLSCT transactions, to avoid verifying the range proofs, balance
+ * and signatures of a transaction twice (once when accepted into memory pool, and
+ * again when accepted into the block chain). The output data recovered with the
+ * view key is kept along, as it is needed again when the block is connected.
+ */
+class CBLSCTVerificationCache
+{
+private:
+    //! Entries are SHA256(nonce || tx hash || mixing fee || view key)
+    uint256 nonce;
+    CShardedCache<std::vector<RangeproofEncodedData>, CBLSCTDataUsage> cache;
+
+public:
+    CBLSCTVerificationCache()
+    {
+        GetRandBytes(nonce.begin(), 32);
+    }
+
+    void
+    ComputeEntry(uint256& entry, const uint256 &hash, CAmount nMixFee, const std::vector<unsigned char>& vchViewKey)
+    {
+        unsigned char fee[8];
+        WriteLE64(fee, nMixFee);
+
+        CSHA256 hasher;
+        hasher.Write(nonce.begin(), 32).Write(hash.begin(), 32).Write(fee, sizeof(fee));
+        if (!vchViewKey.empty())
+            hasher.Write(&vchViewKey[0], vchViewKey.size());
+        hasher.Finalize(entry.begin());
+    }
+
+    bool
+    Get(const uint256& entry, std::vector<RangeproofEncodedData>& vData, bool fErase)
+    {
+        return cache.Get(entry, vData, fErase);
+    }
+
+    size_t MaxUsage()
+    {
+        return GetArg("-maxblsctcachesize", DEFAULT_MAX_BLSCT_CACHE_SIZE) * ((size_t) 1 << 20);
+    }
+
+    void Set(const uint256& entry, const std::vector<RangeproofEncodedData>& vData)
+    {
+        cache.Set(entry, vData, MaxUsage());
+    }
+
+    void GetStats(BLSCTVerificationCacheStats& stats)
+    {
+        cache.GetStats(stats, MaxUsage());
+    }
+};
+
+CBLSCTVerificationCache& GetCache()
+{
+    static CBLSCTVerificationCache blsctCache;
+    return blsctCache;
+}
+
+}
+
+uint256 GetBLSCTCacheEntry(const uint256& txHash, CAmount nMixFee, const std::vector<unsigned char>& vchViewKey)
+{
+    uint256 entry;
+    GetCache().ComputeEntry(entry, txHash, nMixFee, vchViewKey);
+    return entry;
+}
+
+bool GetCachedBLSCTVerification(const uint256& entry, std::vector<RangeproofEncodedData>& vData, bool fErase)
+{
+    return GetCache().Get(entry, vData, fErase);
+}
+
+void SetCachedBLSCTVerification(const uint256& entry, const std::vector<RangeproofEncodedData>& vData)
+{
+    GetCache().Set(entry, vData);
+}
+
+BLSCTVerificationCacheStats GetBLSCTVerificationCacheStats()
+{
+    BLSCTVerificationCacheStats stats;
+    GetCache().GetStats(stats);
+    return stats;
+}
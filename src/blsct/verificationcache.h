@@ -0,0 +1,40 @@
+// Copyright (c) 2020 The Navcoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BLSCT_VERIFICATIONCACHE_H
+#define BLSCT_VERIFICATIONCACHE_H
+
+#include <amount.h>
+#include <blsct/bulletproofs.h>
+#include <shardedcache.h>
+#include <uint256.h>
+
+#include <stdint.h>
+#include <vector>
+
+// DoS prevention: limit cache size to less than 32MB
+static const unsigned int DEFAULT_MAX_BLSCT_CACHE_SIZE = 32;
+
+typedef CacheStats BLSCTVerificationCacheStats;
+
+/**
+ * Computes the salted cache entry of a BLSCT transaction checked with the given
+ * mixing fee allowance. vchViewKey should be empty when no wallet view key is
+ * available, as no output data can be recovered then.
+ */
+uint256 GetBLSCTCacheEntry(const uint256& txHash, CAmount nMixFee, const std::vector<unsigned char>& vchViewKey);
+
+/**
+ * Looks up a transaction previously found valid, returning the output data
+ * recovered when it was checked. When fErase is set the entry is removed on a hit,
+ * as it is not expected to be checked again.
+ */
+bool GetCachedBLSCTVerification(const uint256& entry, std::vector<RangeproofEncodedData>& vData, bool fErase);
+
+/** Remembers a transaction whose range proofs, balance and signatures are valid */
+void SetCachedBLSCTVerification(const uint256& entry, const std::vector<RangeproofEncodedData>& vData);
+
+BLSCTVerificationCacheStats GetBLSCTVerificationCacheStats();
+
+#endif // BLSCT_VERIFICATIONCACHE_H
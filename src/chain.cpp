@@ -5,6 +5,11 @@
 
 #include <chain.h>
 
+#include <memusage.h>
+
+#include <mutex>
+#include <unordered_set>
+
 using namespace std;
 
 /**
@@ -143,3 +148,34 @@ int64_t GetBlockProofEquivalentTime(const CBlockIndex& to, const CBlockIndex& fr
     }
     return sign * r.GetLow64();
 }
+
+const std::string* InternString(const std::string& str)
+{
+    static std::mutex mutex;
+    static std::unordered_set<std::string> setStrings;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    return &*setStrings.insert(str).first;
+}
+
+CBlockIndex* CBlockIndexArena::Allocate()
+{
+    if (nUsed == CHUNK_SIZE) {
+        vChunks.push_back(new CBlockIndex[CHUNK_SIZE]);
+        nUsed = 0;
+    }
+    return &vChunks.back()[nUsed++];
+}
+
+void CBlockIndexArena::Clear()
+{
+    for (CBlockIndex* pchunk : vChunks)
+        delete[] pchunk;
+    vChunks.clear();
+    nUsed = CHUNK_SIZE;
+}
+
+size_t CBlockIndexArena::DynamicMemoryUsage() const
+{
+    return memusage::DynamicUsage(vChunks) + vChunks.size() * memusage::MallocUsage(CHUNK_SIZE * sizeof(CBlockIndex));
+}
@@ -15,6 +15,7 @@
 #include <util.h>
 #include <utilmoneystr.h>
 
+#include <string>
 #include <vector>
 
 #define BLOCK_PROOF_OF_STAKE    0x01 // is proof-of-stake block
@@ -167,6 +168,9 @@ enum BlockStatus: uint32_t {
     BLOCK_OPT_SUPPLY         =   512, //! supply data structures
 };
 
+/** Returns a shared copy of str, which is never freed. Thread safe. */
+const std::string* InternString(const std::string& str);
+
 /** The block chain is a tree shaped structure starting with the
  * genesis block at the root, with each block potentially having multiple
  * candidates to be the next block. A blockindex may have multiple pprev pointing
@@ -175,6 +179,8 @@ enum BlockStatus: uint32_t {
 class CBlockIndex
 {
 public:
+    // Members are grouped by size so that entries pack without padding
+
     //! pointer to the hash of the block, if any. Memory is owned by this CBlockIndex
     const uint256* phashBlock;
 
@@ -187,6 +193,23 @@ public:
     //! pointer to the index of some further predecessor of this block
     CBlockIndex* pskip;
 
+    //! (memory only) strDZeel of the coinstake, interned as most blocks share it. See GetDZeel()
+    const std::string* pstrDZeel;
+
+    int64_t nMint;
+    int64_t nCFSupply;
+    int64_t nCFLocked;
+
+    CAmount nPrivateMoneySupply;
+    CAmount nPublicMoneySupply;
+
+    uint64_t nStakeModifier; // hash modifier for proof-of-stake
+
+    //! (memory only) Total amount of work (expected number of hashes) in the chain up to and including this block
+    arith_uint256 nChainWork;
+
+    arith_uint256 hashProof;
+
     //! height of the entry in the chain. The genesis block has height 0
     int nHeight;
 
@@ -199,9 +222,6 @@ public:
     //! Byte offset within rev?????.dat where this block's undo data is stored
     unsigned int nUndoPos;
 
-    //! (memory only) Total amount of work (expected number of hashes) in the chain up to and including this block
-    arith_uint256 nChainWork;
-
     //! Number of transactions in this block.
     //! Note: in a potential headers-first mode, this number cannot be relied upon
     unsigned int nTx;
@@ -214,30 +234,20 @@ public:
     //! Verification status of this block. See enum BlockStatus
     unsigned int nStatus;
 
+    unsigned int nFlags;  // ppcoin: block index flags
+
+    //! (memory only) Sequential id assigned to distinguish order in which blocks are received.
+    uint32_t nSequenceId;
+
     //! block header
     int nVersion;
-    uint256 hashMerkleRoot;
     unsigned int nTime;
     unsigned int nBits;
     unsigned int nNonce;
+    uint256 hashMerkleRoot;
 
-    int64_t nMint;
-    int64_t nCFSupply;
-    int64_t nCFLocked;
-
-    std::string strDZeel;
-
-    unsigned int nFlags;  // ppcoin: block index flags
-
-    uint64_t nStakeModifier; // hash modifier for proof-of-stake
-
-    arith_uint256 hashProof;
-
-    //! (memory only) Sequential id assigned to distinguish order in which blocks are received.
-    uint32_t nSequenceId;
-
-    CAmount nPrivateMoneySupply;
-    CAmount nPublicMoneySupply;
+    //! (memory only) The DAO votes of this block have not been read from its entry on disk yet
+    bool fDAOVotesOnDisk;
 
     void SetNull()
     {
@@ -245,6 +255,7 @@ public:
         pprev = NULL;
         pnext = NULL;
         pskip = NULL;
+        pstrDZeel = NULL;
         nHeight = 0;
         nFile = 0;
         nDataPos = 0;
@@ -261,6 +272,8 @@ public:
         nFlags = 0;
         nStakeModifier = 0;
         hashProof = arith_uint256();
+        nSequenceId = 0;
+        fDAOVotesOnDisk = false;
         nVersion       = 0;
         hashMerkleRoot = uint256();
         nTime          = 0;
@@ -347,6 +360,17 @@ public:
         return *phashBlock;
     }
 
+    const std::string& GetDZeel() const
+    {
+        static const std::string strEmpty;
+        return pstrDZeel ? *pstrDZeel : strEmpty;
+    }
+
+    void SetDZeel(const std::string& strDZeel)
+    {
+        pstrDZeel = strDZeel.empty() ? NULL : InternString(strDZeel);
+    }
+
     int64_t GetBlockTime() const
     {
         return (int64_t)nTime;
@@ -476,6 +500,35 @@ public:
     const CBlockIndex* GetAncestor(int height) const;
 };
 
+/**
+ * Allocates block index entries in contiguous chunks, saving the allocator
+ * overhead of millions of small objects and keeping entries close in memory.
+ * Entries are only released all at once by Clear().
+ */
+class CBlockIndexArena
+{
+private:
+    std::vector<CBlockIndex*> vChunks;
+    //! Entries handed out from the last chunk
+    size_t nUsed;
+
+public:
+    static const size_t CHUNK_SIZE = 4096;
+
+    CBlockIndexArena() : nUsed(CHUNK_SIZE) {}
+    CBlockIndexArena(const CBlockIndexArena&) = delete;
+    CBlockIndexArena& operator=(const CBlockIndexArena&) = delete;
+    ~CBlockIndexArena() { Clear(); }
+
+    //! Returns a null entry which stays valid until Clear()
+    CBlockIndex* Allocate();
+
+    //! Releases all the entries
+    void Clear();
+
+    size_t DynamicMemoryUsage() const;
+};
+
 arith_uint256 GetBlockProof(const CBlockIndex& block);
 /** Return the time it would take to redo the work difference between from and to, assuming the current hashrate corresponds to the difficulty at tip, in seconds. */
 int64_t GetBlockProofEquivalentTime(const CBlockIndex& to, const CBlockIndex& from, const CBlockIndex& tip, const Consensus::Params&);
@@ -484,7 +537,8 @@ int64_t GetBlockProofEquivalentTime(const CBlockIndex& to, const CBlockIndex& fr
 class CDiskBlockIndex : public CBlockIndex
 {
 private:
-    uint256 blockHash;
+    //! Hash of the header, stored along so it does not have to be computed again on load
+    mutable uint256 blockHash;
 public:
     uint256 hashPrev;
     uint256 hashNext;
@@ -513,6 +567,7 @@ public:
     explicit CDiskBlockIndex(const CBlockIndex* pindex) : CBlockIndex(*pindex) {
         hashPrev = (pprev ? pprev->GetBlockHash() : uint256());
         hashNext = (pnext ? pnext->GetBlockHash() : uint256());
+        blockHash = (phashBlock ? *phashBlock : uint256());
     }
 
     ADD_SERIALIZE_METHODS;
@@ -605,7 +660,17 @@ public:
         }
     }
 
+    //! The stored header hash, computed only if the record does not carry one
     uint256 GetBlockHash() const
+    {
+        if (blockHash.IsNull())
+            blockHash = ComputeBlockHash();
+
+        return blockHash;
+    }
+
+    //! Hashes the header again, which is the X13 hash for pre-v7 headers
+    uint256 ComputeBlockHash() const
     {
         CBlockHeader block;
         block.nVersion        = nVersion;
@@ -615,8 +680,6 @@ public:
         block.nBits           = nBits;
         block.nNonce          = nNonce;
 
-        const_cast<CDiskBlockIndex*>(this)->blockHash = block.GetHash();
-
         return block.GetHash();
     }
 
@@ -66,6 +66,12 @@ bool CStateView::GetAllPaymentRequests(CPaymentRequestMap& map) { return false;
 bool CStateView::GetAllVotes(CVoteMap& map) { return false; }
 bool CStateView::GetAllConsultations(CConsultationMap& map) { return false; }
 bool CStateView::GetAllConsultationAnswers(CConsultationAnswerMap& map) { return false; }
+bool CStateView::GetPaymentRequestsForProposal(const uint256 &pid, std::set<uint256>& setHashes) { return false; }
+bool CStateView::GetProposalsByState(const flags &state, std::set<uint256>& setHashes) { return false; }
+bool CStateView::GetPaymentRequestsByState(const flags &state, std::set<uint256>& setHashes) { return false; }
+bool CStateView::GetConsultationsByState(const flags &state, std::set<uint256>& setHashes) { return false; }
+bool CStateView::GetVotersAtHeight(const int &nHeight, std::set<CVoteMapKey>& setVoters) { return false; }
+const CDAOStateCommitment* CStateView::GetDAOStateCommitment(CDAOStateChanges& changes) { return NULL; }
 uint256 CStateView::GetBestBlock() const { return uint256(); }
 bool CStateView::BatchWrite(CCoinsMap &mapCoins, CProposalMap &mapProposals,
                             CPaymentRequestMap &mapPaymentRequests, CVoteMap &mapVotes,
@@ -96,6 +102,12 @@ bool CStateViewBacked::GetAllPaymentRequests(CPaymentRequestMap& map) { return b
 bool CStateViewBacked::GetAllVotes(CVoteMap& map) { return base->GetAllVotes(map); }
 bool CStateViewBacked::GetAllConsultations(CConsultationMap& map) { return base->GetAllConsultations(map); }
 bool CStateViewBacked::GetAllConsultationAnswers(CConsultationAnswerMap& map) { return base->GetAllConsultationAnswers(map); }
+bool CStateViewBacked::GetPaymentRequestsForProposal(const uint256 &pid, std::set<uint256>& setHashes) { return base->GetPaymentRequestsForProposal(pid, setHashes); }
+bool CStateViewBacked::GetProposalsByState(const flags &state, std::set<uint256>& setHashes) { return base->GetProposalsByState(state, setHashes); }
+bool CStateViewBacked::GetPaymentRequestsByState(const flags &state, std::set<uint256>& setHashes) { return base->GetPaymentRequestsByState(state, setHashes); }
+bool CStateViewBacked::GetConsultationsByState(const flags &state, std::set<uint256>& setHashes) { return base->GetConsultationsByState(state, setHashes); }
+bool CStateViewBacked::GetVotersAtHeight(const int &nHeight, std::set<CVoteMapKey>& setVoters) { return base->GetVotersAtHeight(nHeight, setVoters); }
+const CDAOStateCommitment* CStateViewBacked::GetDAOStateCommitment(CDAOStateChanges& changes) { return base->GetDAOStateCommitment(changes); }
 uint256 CStateViewBacked::GetBestBlock() const { return base->GetBestBlock(); }
 void CStateViewBacked::SetBackend(CStateView &viewIn) { base = &viewIn; }
 bool CStateViewBacked::BatchWrite(CCoinsMap &mapCoins, CProposalMap &mapProposals,
@@ -324,6 +336,93 @@ bool CStateViewCache::GetAllProposals(CProposalMap& mapProposal) {
     return true;
 }
 
+// The entries of the cache replace those of the base, whatever the base index says about them
+template <typename Map, typename Predicate>
+static void MergeIndexedHashes(const Map& cache, const std::set<typename Map::key_type>& setBase, Predicate matches,
+                               std::set<typename Map::key_type>& setHashes)
+{
+    setHashes.clear();
+
+    for (typename std::set<typename Map::key_type>::const_iterator it = setBase.begin(); it != setBase.end(); ++it)
+        if (!cache.count(*it))
+            setHashes.insert(*it);
+
+    for (typename Map::const_iterator it = cache.begin(); it != cache.end(); ++it)
+        if (!it->second.IsNull() && matches(it->second))
+            setHashes.insert(it->first);
+}
+
+bool CStateViewCache::GetPaymentRequestsForProposal(const uint256 &pid, std::set<uint256>& setHashes) {
+    std::set<uint256> setBase;
+
+    if (!base->GetPaymentRequestsForProposal(pid, setBase))
+        return false;
+
+    MergeIndexedHashes(cachePaymentRequests, setBase, [&pid](const CPaymentRequest& prequest) {
+        return prequest.proposalhash == pid;
+    }, setHashes);
+
+    return true;
+}
+
+// The state of an entry depends on the block index, so the entries of the cache are
+// all returned as candidates and the callers check their state.
+bool CStateViewCache::GetProposalsByState(const flags &state, std::set<uint256>& setHashes) {
+    std::set<uint256> setBase;
+
+    if (!base->GetProposalsByState(state, setBase))
+        return false;
+
+    MergeIndexedHashes(cacheProposals, setBase, [](const CProposal&) { return true; }, setHashes);
+
+    return true;
+}
+
+bool CStateViewCache::GetPaymentRequestsByState(const flags &state, std::set<uint256>& setHashes) {
+    std::set<uint256> setBase;
+
+    if (!base->GetPaymentRequestsByState(state, setBase))
+        return false;
+
+    MergeIndexedHashes(cachePaymentRequests, setBase, [](const CPaymentRequest&) { return true; }, setHashes);
+
+    return true;
+}
+
+bool CStateViewCache::GetConsultationsByState(const flags &state, std::set<uint256>& setHashes) {
+    std::set<uint256> setBase;
+
+    if (!base->GetConsultationsByState(state, setBase))
+        return false;
+
+    MergeIndexedHashes(cacheConsultations, setBase, [](const CConsultation&) { return true; }, setHashes);
+
+    return true;
+}
+
+bool CStateViewCache::GetVotersAtHeight(const int &nHeight, std::set<CVoteMapKey>& setVoters) {
+    std::set<CVoteMapKey> setBase;
+
+    if (!base->GetVotersAtHeight(nHeight, setBase))
+        return false;
+
+    MergeIndexedHashes(cacheVotes, setBase, [&nHeight](const CVoteList& votes) {
+        return votes.HasHeight(nHeight);
+    }, setVoters);
+
+    return true;
+}
+
+const CDAOStateCommitment* CStateViewCache::GetDAOStateCommitment(CDAOStateChanges& changes) {
+    AddDAOStateChanges(DAO_ENTRY_PROPOSAL, cacheProposals, changes);
+    AddDAOStateChanges(DAO_ENTRY_PAYMENT_REQUEST, cachePaymentRequests, changes);
+    AddDAOStateChanges(DAO_ENTRY_CONSULTATION, cacheConsultations, changes);
+    AddDAOStateChanges(DAO_ENTRY_ANSWER, cacheAnswers, changes);
+    AddDAOStateChanges(DAO_ENTRY_VOTE, cacheVotes, changes);
+
+    return base->GetDAOStateCommitment(changes);
+}
+
 int CStateViewCache::GetExcludeVotes() const {
     if (nCacheExcludeVotes == -1) nCacheExcludeVotes = base->GetExcludeVotes();
     return nCacheExcludeVotes;
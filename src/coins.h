@@ -14,10 +14,13 @@
 #include <uint256.h>
 
 #include "consensus/dao.h"
+#include "consensus/daocommitment.h"
 
 #include <assert.h>
 #include <stdint.h>
 
+#include <set>
+
 #include <boost/unordered_map.hpp>
 
 class CConsultation;
@@ -376,12 +379,26 @@ public:
     virtual bool HaveConsultationAnswer(const uint256 &cid) const;
     virtual bool GetAllConsultationAnswers(CConsultationAnswerMap& map);
 
+    //! Hashes of the payment requests of a proposal, read from an index of the database
+    virtual bool GetPaymentRequestsForProposal(const uint256 &pid, std::set<uint256>& setHashes);
+    //! Hashes of the entries whose last state is state, read from an index of the database.
+    //! Entries modified in a cache are returned whatever their state, callers check it.
+    virtual bool GetProposalsByState(const flags &state, std::set<uint256>& setHashes);
+    virtual bool GetPaymentRequestsByState(const flags &state, std::set<uint256>& setHashes);
+    virtual bool GetConsultationsByState(const flags &state, std::set<uint256>& setHashes);
+    //! Voters whose vote list has an entry at nHeight, read from an index of the database
+    virtual bool GetVotersAtHeight(const int &nHeight, std::set<CVoteMapKey>& setVoters);
+
     virtual bool GetConsensusParameter(const int &pid, CConsensusParameter& cparameter) const;
     virtual bool HaveConsensusParameter(const int &pid) const;
 
     virtual int GetExcludeVotes() const;
     virtual bool SetExcludeVotes(int count);
 
+    //! Merkle commitment to the DAO state of the backing database, with the
+    //! entries of the caches above it added to changes. NULL if not kept.
+    virtual const CDAOStateCommitment* GetDAOStateCommitment(CDAOStateChanges& changes);
+
     //! Retrieve the block hash whose state this CStateView currently represents
     virtual uint256 GetBestBlock() const;
 
@@ -426,12 +443,19 @@ public:
     bool HaveConsultation(const uint256 &cid) const;
     bool HaveConsultationAnswer(const uint256 &cid) const;
     bool GetAllConsultationAnswers(CConsultationAnswerMap& map);
+    bool GetPaymentRequestsForProposal(const uint256 &pid, std::set<uint256>& setHashes);
+    bool GetProposalsByState(const flags &state, std::set<uint256>& setHashes);
+    bool GetPaymentRequestsByState(const flags &state, std::set<uint256>& setHashes);
+    bool GetConsultationsByState(const flags &state, std::set<uint256>& setHashes);
+    bool GetVotersAtHeight(const int &nHeight, std::set<CVoteMapKey>& setVoters);
     bool GetConsensusParameter(const int &pid, CConsensusParameter& cparameter) const;
     bool HaveConsensusParameter(const int &pid) const;
 
     int GetExcludeVotes() const;
     bool SetExcludeVotes(int count);
 
+    const CDAOStateCommitment* GetDAOStateCommitment(CDAOStateChanges& changes);
+
     uint256 GetBestBlock() const;
     void SetBackend(CStateView &viewIn);
     bool BatchWrite(CCoinsMap &mapCoins, CProposalMap &mapProposals,
@@ -612,6 +636,12 @@ public:
     bool GetAllConsultations(CConsultationMap& map);
     bool GetAllConsultationAnswers(CConsultationAnswerMap& map);
     bool GetAnswersForConsultation(CConsultationAnswerMap& map, const uint256& parent);
+    bool GetPaymentRequestsForProposal(const uint256 &pid, std::set<uint256>& setHashes);
+    bool GetProposalsByState(const flags &state, std::set<uint256>& setHashes);
+    bool GetPaymentRequestsByState(const flags &state, std::set<uint256>& setHashes);
+    bool GetConsultationsByState(const flags &state, std::set<uint256>& setHashes);
+    bool GetVotersAtHeight(const int &nHeight, std::set<CVoteMapKey>& setVoters);
+    const CDAOStateCommitment* GetDAOStateCommitment(CDAOStateChanges& changes);
     uint256 GetBestBlock() const;
     void SetBestBlock(const uint256 &hashBlock);
     bool BatchWrite(CCoinsMap &mapCoins, CProposalMap &mapProposals,
@@ -322,208 +322,275 @@ std::string RemoveFormatConsensusParameter(Consensus::ConsensusParamsPos pos, st
     return ret;
 }
 
-std::map<uint256, std::pair<std::pair<int, int>, int>> mapCacheProposalsToUpdate;
-std::map<uint256, std::pair<std::pair<int, int>, int>> mapCachePaymentRequestToUpdate;
-std::map<uint256, int> mapCacheSupportToUpdate;
-std::map<std::pair<uint256, int64_t>, int> mapCacheConsultationToUpdate;
-int nCacheExclude = 0;
-uint256 lastConsensusStateHash;
-
-bool VoteStep(const CValidationState& state, CBlockIndex *pindexNew, const bool fUndo, CStateViewCache& view)
+void CVoteTally::Add(const CVoteTally& votes)
 {
-    AssertLockHeld(cs_main);
+    for (auto& it: votes.mapProposals)
+    {
+        auto& entry = mapProposals[it.first];
+        entry.first.first += it.second.first.first;
+        entry.first.second += it.second.first.second;
+        entry.second += it.second.second;
+    }
 
-    const CBlockIndex* pindexDelete;
-    if (fUndo)
+    for (auto& it: votes.mapPaymentRequests)
     {
-        pindexDelete = pindexNew;
-        pindexNew = pindexNew->pprev;
-        assert(pindexNew);
+        auto& entry = mapPaymentRequests[it.first];
+        entry.first.first += it.second.first.first;
+        entry.first.second += it.second.first.second;
+        entry.second += it.second.second;
     }
 
-    int64_t nTimeStart = GetTimeMicros();
-    auto nCycleLength = GetConsensusParameter(Consensus::CONSENSUS_PARAM_VOTING_CYCLE_LENGTH, view);
-    int nBlocks = (pindexNew->nHeight % nCycleLength) + 1;
-    const CBlockIndex* pindexblock = pindexNew;
+    for (auto& it: votes.mapSupport)
+        mapSupport[it.first] += it.second;
 
-    bool fCFund = IsCommunityFundEnabled(pindexNew->pprev, Params().GetConsensus());
-    bool fDAOConsultations = IsDAOEnabled(pindexNew->pprev, Params().GetConsensus());
+    for (auto& it: votes.mapConsultations)
+        mapConsultations[it.first] += it.second;
 
-    if (!fCFund && !fDAOConsultations)
-        return true;
+    nExclude += votes.nExclude;
+}
 
-    bool fScanningWholeCycle = false;
+// Votes of the current cycle up to the tip, as counted by VoteStep
+CVoteTally voteTally;
+uint256 lastConsensusStateHash;
 
-    std::map<uint256, bool> mapSeen;
-    std::map<uint256, bool> mapSeenSupport;
+// Consensus parameters only change in VoteStep and when a block is disconnected, so the
+// hash read before the step of a block is still valid for its child when that step
+// changed none of them
+uint256 hashConsensusStateBlock;
+bool fConsensusStateChanged = true;
 
-    uint256 consensusStateHash = GetConsensusStateHash(view);
+void ResetVoteTally()
+{
+    voteTally.SetNull();
+    hashConsensusStateBlock = uint256();
+    fConsensusStateChanged = true;
+}
 
-    if (fUndo || lastConsensusStateHash != consensusStateHash || nBlocks == 1 ||
-            (mapCacheProposalsToUpdate.empty() && mapCachePaymentRequestToUpdate.empty() && mapCacheSupportToUpdate.empty() && mapCacheConsultationToUpdate.empty())) {
-        mapCacheProposalsToUpdate.clear();
-        mapCachePaymentRequestToUpdate.clear();
-        mapCacheSupportToUpdate.clear();
-        mapCacheConsultationToUpdate.clear();
-        nCacheExclude = 0;
-        fScanningWholeCycle = true;
-    } else {
-        nBlocks = 1;
-    }
+// Counts the votes of a single block
+static void CountBlockVotes(const CBlockIndex* pindexblock, const bool fCFund, const bool fDAOConsultations, CStateViewCache& view, CVoteTally& votes)
+{
+    std::map<uint256, bool> mapSeen;
+    std::map<uint256, bool> mapSeenSupport;
 
-    int64_t nTimeStart2 = GetTimeMicros();
+    CConsultationAnswer answer;
 
-    LogPrint("dao", "%s: Scanning %d block(s) starting at %d (fUndo=%d fScanningWholeCycle=%d consensusChanged=%d). We are in block %d inside of the cycle.\n",
-             __func__, nBlocks, pindexblock->nHeight, fUndo, fScanningWholeCycle, lastConsensusStateHash != consensusStateHash,
-             (pindexNew->nHeight % nCycleLength) + 1);
+    votes.SetNull();
+    votes.hashBlock = pindexblock->GetBlockHash();
 
-    lastConsensusStateHash = consensusStateHash;
+    if (pindexblock->nNonce & 1 && !pindexblock->IsColdStakeV2())
+    {
+        votes.nExclude++;
+        return;
+    }
 
-    while(nBlocks > 0 && pindexblock != NULL)
+    if (fCFund)
     {
-        CProposal proposal;
-        CPaymentRequest prequest;
-        CConsultation consultation;
-        CConsultationAnswer answer;
+        auto pVotes = GetProposalVotes(pindexblock->GetBlockHash());
+        if (pVotes != nullptr)
+        {
+            for(unsigned int i = 0; i < pVotes->size(); i++)
+            {
+                if(mapSeen.count((*pVotes)[i].first) == 0)
+                {
+                    LogPrint("daoextra", "%s: Found vote %d for proposal %s at block height %d\n", __func__,
+                             (*pVotes)[i].second, (*pVotes)[i].first.ToString(),
+                             pindexblock->nHeight);
 
-        mapSeen.clear();
-        mapSeenSupport.clear();
+                    if(votes.mapProposals.count((*pVotes)[i].first) == 0)
+                        votes.mapProposals[(*pVotes)[i].first] = make_pair(make_pair(0, 0), 0);
 
-        if (pindexblock->nNonce & 1 && !pindexblock->IsColdStakeV2())
-        {
-            nCacheExclude++;
+                    if((*pVotes)[i].second == VoteFlags::VOTE_YES)
+                        votes.mapProposals[(*pVotes)[i].first].first.first += 1;
+                    else if((*pVotes)[i].second == VoteFlags::VOTE_ABSTAIN)
+                        votes.mapProposals[(*pVotes)[i].first].second += 1;
+                    else if((*pVotes)[i].second == VoteFlags::VOTE_NO)
+                        votes.mapProposals[(*pVotes)[i].first].first.second += 1;
+
+                    mapSeen[(*pVotes)[i].first]=true;
+                }
+            }
         }
-        else
+
+        auto prVotes = GetPaymentRequestVotes(pindexblock->GetBlockHash());
+        if (prVotes != nullptr)
         {
-            if (fCFund)
+            for(unsigned int i = 0; i < prVotes->size(); i++)
             {
-                auto pVotes = GetProposalVotes(pindexblock->GetBlockHash());
-                if (pVotes != nullptr)
+                if(mapSeen.count((*prVotes)[i].first) == 0)
                 {
-                    for(unsigned int i = 0; i < pVotes->size(); i++)
-                    {
-                        if(mapSeen.count((*pVotes)[i].first) == 0)
-                        {
-                            LogPrint("daoextra", "%s: Found vote %d for proposal %s at block height %d\n", __func__,
-                                     (*pVotes)[i].second, (*pVotes)[i].first.ToString(),
-                                     pindexblock->nHeight);
+                    LogPrint("daoextra", "%s: Found vote %d for payment request %s at block height %d\n", __func__,
+                             (*prVotes)[i].second, (*prVotes)[i].first.ToString(),
+                             pindexblock->nHeight);
 
-                            if(mapCacheProposalsToUpdate.count((*pVotes)[i].first) == 0)
-                                mapCacheProposalsToUpdate[(*pVotes)[i].first] = make_pair(make_pair(0, 0), 0);
+                    if(votes.mapPaymentRequests.count((*prVotes)[i].first) == 0)
+                        votes.mapPaymentRequests[(*prVotes)[i].first] = make_pair(make_pair(0, 0), 0);
 
-                            if((*pVotes)[i].second == VoteFlags::VOTE_YES)
-                                mapCacheProposalsToUpdate[(*pVotes)[i].first].first.first += 1;
-                            else if((*pVotes)[i].second == VoteFlags::VOTE_ABSTAIN)
-                                mapCacheProposalsToUpdate[(*pVotes)[i].first].second += 1;
-                            else if((*pVotes)[i].second == VoteFlags::VOTE_NO)
-                                mapCacheProposalsToUpdate[(*pVotes)[i].first].first.second += 1;
+                    if((*prVotes)[i].second == VoteFlags::VOTE_YES)
+                        votes.mapPaymentRequests[(*prVotes)[i].first].first.first += 1;
+                    else if((*prVotes)[i].second == VoteFlags::VOTE_ABSTAIN)
+                        votes.mapPaymentRequests[(*prVotes)[i].first].second += 1;
+                    else if((*prVotes)[i].second == VoteFlags::VOTE_NO)
+                        votes.mapPaymentRequests[(*prVotes)[i].first].first.second += 1;
 
-                            mapSeen[(*pVotes)[i].first]=true;
-                        }
-                    }
+                    mapSeen[(*prVotes)[i].first]=true;
                 }
+            }
+        }
+    }
 
-                auto prVotes = GetPaymentRequestVotes(pindexblock->GetBlockHash());
-                if (prVotes != nullptr)
-                {
-                    for(unsigned int i = 0; i < prVotes->size(); i++)
-                    {
-                        if(mapSeen.count((*prVotes)[i].first) == 0)
-                        {
-                            LogPrint("daoextra", "%s: Found vote %d for payment request %s at block height %d\n", __func__,
-                                     (*prVotes)[i].second, (*prVotes)[i].first.ToString(),
-                                     pindexblock->nHeight);
+    if (fDAOConsultations)
+    {
+        auto supp = GetSupport(pindexblock->GetBlockHash());
 
-                            if(mapCachePaymentRequestToUpdate.count((*prVotes)[i].first) == 0)
-                                mapCachePaymentRequestToUpdate[(*prVotes)[i].first] = make_pair(make_pair(0, 0), 0);
+        if (supp != nullptr)
+        {
+            for (auto& it: *supp)
+            {
+                if (!it.second)
+                    continue;
 
-                            if((*prVotes)[i].second == VoteFlags::VOTE_YES)
-                                mapCachePaymentRequestToUpdate[(*prVotes)[i].first].first.first += 1;
-                            else if((*prVotes)[i].second == VoteFlags::VOTE_ABSTAIN)
-                                mapCachePaymentRequestToUpdate[(*prVotes)[i].first].second += 1;
-                            else if((*prVotes)[i].second == VoteFlags::VOTE_NO)
-                                mapCachePaymentRequestToUpdate[(*prVotes)[i].first].first.second += 1;
+                if (!mapSeenSupport.count(it.first))
+                {
+                    LogPrint("daoextra", "%s: Found support vote for %s at block height %d\n", __func__,
+                             it.first.ToString(),
+                             pindexblock->nHeight);
 
-                            mapSeen[(*prVotes)[i].first]=true;
-                        }
-                    }
+                    if(votes.mapSupport.count(it.first) == 0)
+                        votes.mapSupport[it.first] = 0;
+
+                    votes.mapSupport[it.first] += 1;
+                    mapSeenSupport[it.first]=true;
                 }
             }
+        }
+
+        auto cVotes = GetConsultationVotes(pindexblock->GetBlockHash());
 
-            if (fDAOConsultations)
+        if (cVotes != nullptr)
+        {
+            for (auto&it: *cVotes)
             {
-                auto supp = GetSupport(pindexblock->GetBlockHash());
+                if (mapSeen.count(it.first))
+                    continue;
 
-                if (supp != nullptr)
+                if (view.HaveConsultation(it.first) || view.HaveConsultationAnswer(it.first))
                 {
-                    for (auto& it: *supp)
+
+                    if (it.second == VoteFlags::VOTE_ABSTAIN && view.GetConsultationAnswer(it.first, answer))
                     {
-                        if (!it.second)
-                            continue;
+                        if(votes.mapConsultations.count(std::make_pair(answer.parent,it.second)) == 0)
+                            votes.mapConsultations[std::make_pair(answer.parent,it.second)] = 0;
 
-                        if (!mapSeenSupport.count(it.first))
-                        {
-                            LogPrint("daoextra", "%s: Found support vote for %s at block height %d\n", __func__,
-                                     it.first.ToString(),
-                                     pindexblock->nHeight);
+                        votes.mapConsultations[std::make_pair(answer.parent,it.second)] += 1;
 
-                            if(mapCacheSupportToUpdate.count(it.first) == 0)
-                                mapCacheSupportToUpdate[it.first] = 0;
+                        mapSeen[it.first]=true;
 
-                            mapCacheSupportToUpdate[it.first] += 1;
-                            mapSeenSupport[it.first]=true;
-                        }
+                        LogPrint("daoextra", "%s: Found consultation answer vote %d for %s at block height %d\n", __func__,
+                                 it.second, answer.parent.ToString(), pindexblock->nHeight);
+                    }
+                    else
+                    {
+                        if(votes.mapConsultations.count(std::make_pair(it.first,it.second)) == 0)
+                            votes.mapConsultations[std::make_pair(it.first,it.second)] = 0;
+
+                        votes.mapConsultations[std::make_pair(it.first,it.second)] += 1;
+
+                        mapSeen[it.first]=true;
+
+                        LogPrint("daoextra", "%s: Found consultation vote %d for %s at block height %d\n", __func__,
+                                 it.second, it.first.ToString(), pindexblock->nHeight);
                     }
                 }
+            }
+        }
+    }
+}
 
-                auto cVotes = GetConsultationVotes(pindexblock->GetBlockHash());
+bool VoteStep(const CValidationState& state, CBlockIndex *pindexNew, const bool fUndo, CStateViewCache& view)
+{
+    AssertLockHeld(cs_main);
 
-                if (cVotes != nullptr)
-                {
-                    for (auto&it: *cVotes)
-                    {
-                        if (mapSeen.count(it.first))
-                            continue;
+    const CBlockIndex* pindexDelete;
+    if (fUndo)
+    {
+        pindexDelete = pindexNew;
+        pindexNew = pindexNew->pprev;
+        assert(pindexNew);
+    }
 
-                        if (view.HaveConsultation(it.first) || view.HaveConsultationAnswer(it.first))
-                        {
+    int64_t nTimeStart = GetTimeMicros();
+    auto nCycleLength = GetConsensusParameter(Consensus::CONSENSUS_PARAM_VOTING_CYCLE_LENGTH, view);
+    int nBlocks = (pindexNew->nHeight % nCycleLength) + 1;
+    const CBlockIndex* pindexblock = pindexNew;
 
-                            if (it.second == VoteFlags::VOTE_ABSTAIN && view.GetConsultationAnswer(it.first, answer))
-                            {
-                                if(mapCacheConsultationToUpdate.count(std::make_pair(answer.parent,it.second)) == 0)
-                                    mapCacheConsultationToUpdate[std::make_pair(answer.parent,it.second)] = 0;
+    bool fCFund = IsCommunityFundEnabled(pindexNew->pprev, Params().GetConsensus());
+    bool fDAOConsultations = IsDAOEnabled(pindexNew->pprev, Params().GetConsensus());
 
-                                mapCacheConsultationToUpdate[std::make_pair(answer.parent,it.second)] += 1;
+    if (!fCFund && !fDAOConsultations)
+        return true;
 
-                                mapSeen[it.first]=true;
+    std::map<uint256, bool> mapSeen;
+    std::map<uint256, bool> mapSeenSupport;
 
-                                LogPrint("daoextra", "%s: Found consultation answer vote %d for %s at block height %d (total %d)\n", __func__,
-                                         it.second, answer.parent.ToString(), pindexblock->nHeight, mapCacheConsultationToUpdate[std::make_pair(answer.parent,it.second)]);
-                            }
-                            else
-                            {
-                                if(mapCacheConsultationToUpdate.count(std::make_pair(it.first,it.second)) == 0)
-                                    mapCacheConsultationToUpdate[std::make_pair(it.first,it.second)] = 0;
+    uint256 consensusStateHash;
 
-                                mapCacheConsultationToUpdate[std::make_pair(it.first,it.second)] += 1;
+    if (!fUndo && !fConsensusStateChanged && pindexNew->pprev && hashConsensusStateBlock == pindexNew->pprev->GetBlockHash())
+        consensusStateHash = lastConsensusStateHash;
+    else
+        consensusStateHash = GetConsensusStateHash(view);
 
-                                mapSeen[it.first]=true;
+    // Set again once the step is done, so a failed step reads the parameters next time
+    hashConsensusStateBlock = uint256();
 
-                                LogPrint("daoextra", "%s: Found consultation vote %d for %s at block height %d (total %d)\n", __func__,
-                                         it.second, it.first.ToString(), pindexblock->nHeight, mapCacheConsultationToUpdate[std::make_pair(it.first,it.second)]);
-                            }
-                        }
-                    }
-                }
-            }
+    CVoteTally& tally = voteTally;
+
+    bool fConsensusChanged = tally.consensusStateHash != consensusStateHash;
+
+    // Only a block connected on top of the tally adds its votes to it. Undoing a block, a new
+    // cycle, a change of the consensus parameters or a tally counted for another tip (as after
+    // a restart) count the whole cycle again, with the current view
+    bool fScanningWholeCycle = fUndo || fConsensusChanged || nBlocks == 1 || tally.IsEmpty() ||
+            !pindexNew->pprev || tally.hashBlock != pindexNew->pprev->GetBlockHash();
+
+    int64_t nTimeStart2 = GetTimeMicros();
+
+    LogPrint("dao", "%s: Scanning %d block(s) starting at %d (fUndo=%d fScanningWholeCycle=%d consensusChanged=%d). We are in block %d inside of the cycle.\n",
+             __func__, fScanningWholeCycle ? nBlocks : 1, pindexblock->nHeight, fUndo, fScanningWholeCycle, fConsensusChanged,
+             (pindexNew->nHeight % nCycleLength) + 1);
+
+    if (fScanningWholeCycle)
+    {
+        tally.SetNull();
+
+        while(nBlocks > 0 && pindexblock != NULL)
+        {
+            CVoteTally votes;
+            CountBlockVotes(pindexblock, fCFund, fDAOConsultations, view, votes);
+
+            tally.Add(votes);
+
+            pindexblock = pindexblock->pprev;
+            nBlocks--;
         }
+    }
+    else
+    {
+        CVoteTally votes;
+        CountBlockVotes(pindexNew, fCFund, fDAOConsultations, view, votes);
 
-        pindexblock = pindexblock->pprev;
-        nBlocks--;
+        tally.Add(votes);
     }
 
-    mapSeen.clear();
-    mapSeenSupport.clear();
+    tally.hashBlock = pindexNew->GetBlockHash();
+    tally.consensusStateHash = consensusStateHash;
+
+    lastConsensusStateHash = consensusStateHash;
+
+    const std::map<uint256, std::pair<std::pair<int, int>, int>>& mapCacheProposalsToUpdate = tally.mapProposals;
+    const std::map<uint256, std::pair<std::pair<int, int>, int>>& mapCachePaymentRequestToUpdate = tally.mapPaymentRequests;
+    const std::map<uint256, int>& mapCacheSupportToUpdate = tally.mapSupport;
+    const std::map<std::pair<uint256, int64_t>, int>& mapCacheConsultationToUpdate = tally.mapConsultations;
+    int nCacheExclude = tally.nExclude;
 
     int64_t nTimeEnd2 = GetTimeMicros();
     LogPrint("bench", "   - CFund count votes from headers: %.2fms\n", (nTimeEnd2 - nTimeStart2) * 0.001);
@@ -1635,6 +1702,9 @@ bool VoteStep(const CValidationState& state, CBlockIndex *pindexNew, const bool
         mcparameter->Set(pindexNew->nHeight, it.second);
     }
 
+    hashConsensusStateBlock = pindexNew->GetBlockHash();
+    fConsensusStateChanged = !mapConsensusToChange.empty();
+
     int64_t nTimeEnd8 = GetTimeMicros();
     LogPrint("bench", "   - CFund update consensus parameter status: %.2fms\n", (nTimeEnd8 - nTimeStart8) * 0.001);
 
@@ -1909,6 +1979,30 @@ bool IsValidConsultationAnswer(CTransaction tx, CStateViewCache& coins, uint64_t
 
 }
 
+// Consultations which are not finished, read through the index of their states. As the
+// states of entries in the caches are not indexed, callers still check IsFinished().
+static bool GetUnfinishedConsultations(CStateViewCache& coins, CConsultationMap& consultationMap)
+{
+    consultationMap.clear();
+
+    for (flags state: {DAOFlags::NIL, DAOFlags::SUPPORTED, DAOFlags::REFLECTION, DAOFlags::ACCEPTED})
+    {
+        std::set<uint256> setHashes;
+
+        if (!coins.GetConsultationsByState(state, setHashes))
+            return false;
+
+        for (auto& hash: setHashes)
+        {
+            CConsultation consultation;
+            if (coins.GetConsultation(hash, consultation))
+                consultationMap.insert(std::make_pair(hash, consultation));
+        }
+    }
+
+    return true;
+}
+
 bool IsValidConsultation(CTransaction tx, CStateViewCache& coins, uint64_t nMaskVersion, CBlockIndex* pindex)
 {
     if(tx.strDZeel.length() > 1024)
@@ -1967,7 +2061,7 @@ bool IsValidConsultation(CTransaction tx, CStateViewCache& coins, uint64_t nMask
 
             CConsultationMap consultationMap;
 
-            if (coins.GetAllConsultations(consultationMap))
+            if (GetUnfinishedConsultations(coins, consultationMap))
             {
                 for (auto& it: consultationMap)
                 {
@@ -2102,7 +2196,7 @@ bool IsValidConsensusParameterProposal(Consensus::ConsensusParamsPos pos, std::s
 
         CConsultationMap consultationMap;
 
-        if (coins.GetAllConsultations(consultationMap))
+        if (GetUnfinishedConsultations(coins, consultationMap))
         {
             for (auto& it: consultationMap)
             {
@@ -3081,15 +3175,15 @@ CAmount CProposal::GetAvailable(CStateViewCache& coins, bool fIncludeRequests) c
     AssertLockHeld(cs_main);
 
     CAmount initial = nAmount;
-    CPaymentRequestMap mapPaymentRequests;
+    std::set<uint256> setPaymentRequests;
 
-    if(coins.GetAllPaymentRequests(mapPaymentRequests))
+    if(coins.GetPaymentRequestsForProposal(hash, setPaymentRequests))
     {
-        for (CPaymentRequestMap::iterator it_ = mapPaymentRequests.begin(); it_ != mapPaymentRequests.end(); it_++)
+        for (auto& it_: setPaymentRequests)
         {
             CPaymentRequest prequest;
 
-            if (!coins.GetPaymentRequest(it_->first, prequest))
+            if (!coins.GetPaymentRequest(it_, prequest))
                 continue;
 
             if (prequest.proposalhash != hash)
@@ -3116,15 +3210,15 @@ std::string CProposal::ToString(CStateViewCache& coins, uint32_t currentTime) co
                      "nVotesAbs=%u, nVotesNo=%u, nVotingCycle=%u, fState=%s, strDZeel=%s, blockhash=%s)",
                      hash.ToString(), nVersion, (float)nAmount/COIN, (float)GetAvailable(coins)/COIN, (float)nFee/COIN, ownerAddress, paymentAddress, nDeadline,
                      nVotesYes, nVotesAbs, nVotesNo, nVotingCycle, GetState(currentTime, coins), strDZeel, blockhash.ToString().substr(0,10));
-    CPaymentRequestMap mapPaymentRequests;
+    std::set<uint256> setPaymentRequests;
 
-    if(coins.GetAllPaymentRequests(mapPaymentRequests))
+    if(coins.GetPaymentRequestsForProposal(hash, setPaymentRequests))
     {
-        for (CPaymentRequestMap::iterator it_ = mapPaymentRequests.begin(); it_ != mapPaymentRequests.end(); it_++)
+        for (auto& it_: setPaymentRequests)
         {
             CPaymentRequest prequest;
 
-            if (!coins.GetPaymentRequest(it_->first, prequest))
+            if (!coins.GetPaymentRequest(it_, prequest))
                 continue;
 
             if (prequest.proposalhash != hash)
@@ -3139,15 +3233,15 @@ std::string CProposal::ToString(CStateViewCache& coins, uint32_t currentTime) co
 bool CProposal::HasPendingPaymentRequests(CStateViewCache& coins) const {
     AssertLockHeld(cs_main);
 
-    CPaymentRequestMap mapPaymentRequests;
+    std::set<uint256> setPaymentRequests;
 
-    if(coins.GetAllPaymentRequests(mapPaymentRequests))
+    if(coins.GetPaymentRequestsForProposal(hash, setPaymentRequests))
     {
-        for (CPaymentRequestMap::iterator it_ = mapPaymentRequests.begin(); it_ != mapPaymentRequests.end(); it_++)
+        for (auto& it_: setPaymentRequests)
         {
             CPaymentRequest prequest;
 
-            if (!coins.GetPaymentRequest(it_->first, prequest))
+            if (!coins.GetPaymentRequest(it_, prequest))
                 continue;
 
             if (prequest.proposalhash != hash)
@@ -3294,19 +3388,19 @@ void CProposal::ToJson(UniValue& ret, CStateViewCache& coins) const {
     ret.pushKV("state", (uint64_t)fState);
     if(blockhash != uint256())
         ret.pushKV("stateChangedOnBlock", blockhash.ToString());
-    CPaymentRequestMap mapPaymentRequests;
+    std::set<uint256> setPaymentRequests;
 
-    if(coins.GetAllPaymentRequests(mapPaymentRequests))
+    if(coins.GetPaymentRequestsForProposal(hash, setPaymentRequests))
     {
         UniValue preq(UniValue::VOBJ);
         UniValue arr(UniValue::VARR);
         CPaymentRequest prequest;
 
-        for (CPaymentRequestMap::iterator it_ = mapPaymentRequests.begin(); it_ != mapPaymentRequests.end(); it_++)
+        for (auto& it_: setPaymentRequests)
         {
             CPaymentRequest prequest;
 
-            if (!coins.GetPaymentRequest(it_->first, prequest))
+            if (!coins.GetPaymentRequest(it_, prequest))
                 continue;
 
             if (prequest.proposalhash != hash)
@@ -3376,12 +3470,6 @@ uint256 GetConsensusStateHash(CStateViewCache& view)
 
 uint256 GetDAOStateHash(CStateViewCache& view, const CAmount& nCFLocked, const CAmount& nCFSupply)
 {
-    CPaymentRequestMap mapPaymentRequests;
-    CProposalMap mapProposals;
-    CConsultationMap mapConsultations;
-    CConsultationAnswerMap mapAnswers;
-    CVoteMap mapVotes;
-
     int64_t nTimeStart = GetTimeMicros();
 
     CHashWriter writer(0,0);
@@ -3389,58 +3477,43 @@ uint256 GetDAOStateHash(CStateViewCache& view, const CAmount& nCFLocked, const C
     writer << nCFSupply;
     writer << nCFLocked;
 
-    if (view.GetAllProposals(mapProposals) && view.GetAllPaymentRequests(mapPaymentRequests) &&
-            view.GetAllConsultations(mapConsultations) && view.GetAllVotes(mapVotes) &&
-            view.GetAllConsultationAnswers(mapAnswers))
-    {
-
-        for (auto &it: mapProposals)
-        {
-            if (!it.second.IsNull())
-            {
-                writer << it.second;
-            }
-        }
-
-        for (auto &it: mapPaymentRequests)
-        {
-            if (!it.second.IsNull())
-            {
-                writer << it.second;
-            }
-        }
+    CDAOStateChanges changes;
+    const CDAOStateCommitment* pcommitment = view.GetDAOStateCommitment(changes);
 
-        for (auto &it: mapConsultations)
-        {
-            if (!it.second.IsNull())
-            {
-                writer << it.second;
-            }
-        }
+    if (pcommitment)
+    {
+        writer << pcommitment->GetRoot(changes);
+    }
+    else
+    {
+        // Views without a database below them are committed to from scratch
+        CPaymentRequestMap mapPaymentRequests;
+        CProposalMap mapProposals;
+        CConsultationMap mapConsultations;
+        CConsultationAnswerMap mapAnswers;
+        CVoteMap mapVotes;
 
-        for (auto &it: mapVotes)
-        {
-            if (!it.second.IsNull())
-            {
-                writer << it.first;
-                writer << it.second.GetList();
-            }
-        }
+        if (!view.GetAllProposals(mapProposals) || !view.GetAllPaymentRequests(mapPaymentRequests) ||
+                !view.GetAllConsultations(mapConsultations) || !view.GetAllVotes(mapVotes) ||
+                !view.GetAllConsultationAnswers(mapAnswers))
+            return writer.GetHash();
 
-        for (auto &it: mapAnswers)
-        {
-            if (!it.second.IsNull())
-            {
-                writer << it.second;
-            }
-        }
+        CDAOStateChanges entries;
+        AddDAOStateChanges(DAO_ENTRY_PROPOSAL, mapProposals, entries);
+        AddDAOStateChanges(DAO_ENTRY_PAYMENT_REQUEST, mapPaymentRequests, entries);
+        AddDAOStateChanges(DAO_ENTRY_CONSULTATION, mapConsultations, entries);
+        AddDAOStateChanges(DAO_ENTRY_ANSWER, mapAnswers, entries);
+        AddDAOStateChanges(DAO_ENTRY_VOTE, mapVotes, entries);
 
-        for (unsigned int i = 0; i < Consensus::MAX_CONSENSUS_PARAMS; i++)
-        {
-            Consensus::ConsensusParamsPos id = (Consensus::ConsensusParamsPos)i;
-            writer << GetConsensusParameter(id, view);
-        }
+        CDAOStateCommitment commitment;
+        commitment.Update(entries);
+        writer << commitment.GetRoot();
+    }
 
+    for (unsigned int i = 0; i < Consensus::MAX_CONSENSUS_PARAMS; i++)
+    {
+        Consensus::ConsensusParamsPos id = (Consensus::ConsensusParamsPos)i;
+        writer << GetConsensusParameter(id, view);
     }
 
     uint256 ret = writer.GetHash();
@@ -159,6 +159,10 @@ public:
         std::swap(to.list, list);
     }
 
+    bool HasHeight(const int& height) const {
+        return list.count(height) > 0;
+    }
+
     int GetLastVoteHeight() {
         if (list.empty())
             return 0;
@@ -249,6 +253,43 @@ private:
     std::map<int, uint64_t> list;
 };
 
+/** Votes counted for the DAO objects in a range of blocks of a voting cycle, ending at hashBlock */
+class CVoteTally
+{
+public:
+    std::map<uint256, std::pair<std::pair<int, int>, int>> mapProposals;
+    std::map<uint256, std::pair<std::pair<int, int>, int>> mapPaymentRequests;
+    std::map<uint256, int> mapSupport;
+    std::map<std::pair<uint256, int64_t>, int> mapConsultations;
+    int nExclude;
+    uint256 hashBlock;
+    uint256 consensusStateHash;
+
+    CVoteTally() { SetNull(); }
+
+    void SetNull()
+    {
+        mapProposals.clear();
+        mapPaymentRequests.clear();
+        mapSupport.clear();
+        mapConsultations.clear();
+        nExclude = 0;
+        hashBlock = uint256();
+        consensusStateHash = uint256();
+    }
+
+    bool IsEmpty() const
+    {
+        return mapProposals.empty() && mapPaymentRequests.empty() && mapSupport.empty() && mapConsultations.empty();
+    }
+
+    //! Adds the votes of another tally
+    void Add(const CVoteTally& votes);
+};
+
+//! Drops the running tally of VoteStep, so the next step counts the whole cycle
+void ResetVoteTally();
+
 bool IsBeginningCycle(const CBlockIndex* pindex, const CStateViewCache& coins);
 bool IsEndCycle(const CBlockIndex* pindex, CChainParams params);
 bool VoteStep(const CValidationState& state, CBlockIndex *pindexNew, const bool fUndo, CStateViewCache& coins);
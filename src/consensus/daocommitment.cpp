@@ -0,0 +1,186 @@
+// Copyright (c) 2020 The Navcoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <consensus/daocommitment.h>
+
+#include <consensus/dao.h>
+
+#include <set>
+
+template <typename T>
+static uint256 GetLeaf(const T& entry)
+{
+    if (entry.IsNull())
+        return uint256();
+    return SerializeHash(entry);
+}
+
+uint256 GetDAOStateLeaf(const CProposal& proposal) { return GetLeaf(proposal); }
+uint256 GetDAOStateLeaf(const CPaymentRequest& prequest) { return GetLeaf(prequest); }
+uint256 GetDAOStateLeaf(const CConsultation& consultation) { return GetLeaf(consultation); }
+uint256 GetDAOStateLeaf(const CConsultationAnswer& answer) { return GetLeaf(answer); }
+uint256 GetDAOStateLeaf(const CVoteList& votes) { return GetLeaf(votes); }
+
+CDAOStateCommitment::CDAOStateCommitment()
+{
+    Clear();
+}
+
+uint256 CDAOStateCommitment::GetBucketHash(const bucket_type& bucket)
+{
+    if (bucket.empty())
+        return uint256();
+
+    CHashWriter writer(0,0);
+    for (bucket_type::const_iterator it = bucket.begin(); it != bucket.end(); ++it)
+        writer << it->first << it->second;
+    return writer.GetHash();
+}
+
+uint256 CDAOStateCommitment::GetParentHash(const uint256& left, const uint256& right)
+{
+    return Hash(left.begin(), left.end(), right.begin(), right.end());
+}
+
+void CDAOStateCommitment::Clear()
+{
+    vBuckets.assign(BUCKETS, bucket_type());
+    vNodes.assign(2 * BUCKETS - 1, uint256());
+
+    for (unsigned int i = BUCKETS - 1; i > 0; i--)
+        vNodes[i - 1] = GetParentHash(vNodes[2 * i - 1], vNodes[2 * i]);
+}
+
+void CDAOStateCommitment::GetChangedBuckets(const CDAOStateChanges& changes, std::map<unsigned int, bucket_type>& mapChanged) const
+{
+    for (CDAOStateChanges::const_iterator it = changes.begin(); it != changes.end(); ++it)
+    {
+        unsigned int nBucket = GetBucket(it->first);
+        std::map<unsigned int, bucket_type>::iterator itBucket = mapChanged.find(nBucket);
+        if (itBucket == mapChanged.end())
+            itBucket = mapChanged.insert(std::make_pair(nBucket, vBuckets[nBucket])).first;
+
+        if (it->second.IsNull())
+            itBucket->second.erase(it->first);
+        else
+            itBucket->second[it->first] = it->second;
+    }
+}
+
+void CDAOStateCommitment::GetChangedNodes(const std::map<unsigned int, bucket_type>& mapChanged, std::map<unsigned int, uint256>& mapNodes) const
+{
+    std::set<unsigned int> setLevel;
+
+    for (std::map<unsigned int, bucket_type>::const_iterator it = mapChanged.begin(); it != mapChanged.end(); ++it)
+    {
+        unsigned int nNode = BUCKETS - 1 + it->first;
+        mapNodes[nNode] = GetBucketHash(it->second);
+        setLevel.insert(nNode);
+    }
+
+    // Walks up one level at a time, every parent rehashed once
+    while (!setLevel.empty() && *setLevel.begin() > 0)
+    {
+        std::set<unsigned int> setParents;
+        for (std::set<unsigned int>::const_iterator it = setLevel.begin(); it != setLevel.end(); ++it)
+            setParents.insert((*it - 1) / 2);
+
+        for (std::set<unsigned int>::const_iterator it = setParents.begin(); it != setParents.end(); ++it)
+        {
+            unsigned int nLeft = 2 * *it + 1, nRight = 2 * *it + 2;
+            std::map<unsigned int, uint256>::const_iterator itLeft = mapNodes.find(nLeft);
+            std::map<unsigned int, uint256>::const_iterator itRight = mapNodes.find(nRight);
+            mapNodes[*it] = GetParentHash(itLeft != mapNodes.end() ? itLeft->second : vNodes[nLeft],
+                                          itRight != mapNodes.end() ? itRight->second : vNodes[nRight]);
+        }
+
+        setLevel.swap(setParents);
+    }
+}
+
+void CDAOStateCommitment::Update(const CDAOStateChanges& changes)
+{
+    std::map<unsigned int, bucket_type> mapChanged;
+    std::map<unsigned int, uint256> mapNodes;
+
+    GetChangedBuckets(changes, mapChanged);
+    GetChangedNodes(mapChanged, mapNodes);
+
+    for (std::map<unsigned int, bucket_type>::iterator it = mapChanged.begin(); it != mapChanged.end(); ++it)
+        vBuckets[it->first].swap(it->second);
+
+    for (std::map<unsigned int, uint256>::const_iterator it = mapNodes.begin(); it != mapNodes.end(); ++it)
+        vNodes[it->first] = it->second;
+}
+
+uint256 CDAOStateCommitment::GetRoot(const CDAOStateChanges& changes) const
+{
+    if (changes.empty())
+        return GetRoot();
+
+    std::map<unsigned int, bucket_type> mapChanged;
+    std::map<unsigned int, uint256> mapNodes;
+
+    GetChangedBuckets(changes, mapChanged);
+    GetChangedNodes(mapChanged, mapNodes);
+
+    return mapNodes[0];
+}
+
+void CDAOStateCommitment::GetProof(const uint256& id, const CDAOStateChanges& changes,
+                                   std::vector<std::pair<uint256, uint256> >& vEntries, std::vector<uint256>& vBranch) const
+{
+    std::map<unsigned int, bucket_type> mapChanged;
+    std::map<unsigned int, uint256> mapNodes;
+
+    GetChangedBuckets(changes, mapChanged);
+    GetChangedNodes(mapChanged, mapNodes);
+
+    unsigned int nBucket = GetBucket(id);
+    std::map<unsigned int, bucket_type>::const_iterator itBucket = mapChanged.find(nBucket);
+    const bucket_type& bucket = itBucket != mapChanged.end() ? itBucket->second : vBuckets[nBucket];
+
+    vEntries.assign(bucket.begin(), bucket.end());
+    vBranch.clear();
+
+    for (unsigned int nNode = BUCKETS - 1 + nBucket; nNode > 0; nNode = (nNode - 1) / 2)
+    {
+        unsigned int nSibling = (nNode % 2) ? nNode + 1 : nNode - 1;
+        std::map<unsigned int, uint256>::const_iterator it = mapNodes.find(nSibling);
+        vBranch.push_back(it != mapNodes.end() ? it->second : vNodes[nSibling]);
+    }
+}
+
+uint256 CDAOStateCommitment::GetProofRoot(const uint256& id, const std::vector<std::pair<uint256, uint256> >& vEntries,
+                                          const std::vector<uint256>& vBranch)
+{
+    if (vBranch.size() != BUCKET_BITS)
+        return uint256();
+
+    unsigned int nBucket = GetBucket(id);
+    bucket_type bucket;
+
+    for (std::vector<std::pair<uint256, uint256> >::const_iterator it = vEntries.begin(); it != vEntries.end(); ++it)
+        if (GetBucket(it->first) != nBucket || it->second.IsNull() || !bucket.insert(*it).second)
+            return uint256();
+
+    uint256 hash = GetBucketHash(bucket);
+    unsigned int nNode = BUCKETS - 1 + nBucket;
+
+    for (std::vector<uint256>::const_iterator it = vBranch.begin(); it != vBranch.end(); ++it)
+    {
+        hash = (nNode % 2) ? GetParentHash(hash, *it) : GetParentHash(*it, hash);
+        nNode = (nNode - 1) / 2;
+    }
+
+    return hash;
+}
+
+size_t CDAOStateCommitment::GetEntries() const
+{
+    size_t nEntries = 0;
+    for (std::vector<bucket_type>::const_iterator it = vBuckets.begin(); it != vBuckets.end(); ++it)
+        nEntries += it->size();
+    return nEntries;
+}
@@ -0,0 +1,111 @@
+// Copyright (c) 2020 The Navcoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef NAVCOIN_CONSENSUS_DAOCOMMITMENT_H
+#define NAVCOIN_CONSENSUS_DAOCOMMITMENT_H
+
+#include <hash.h>
+#include <uint256.h>
+
+#include <map>
+#include <utility>
+#include <vector>
+
+class CConsultation;
+class CConsultationAnswer;
+class CPaymentRequest;
+class CProposal;
+class CVoteList;
+
+/** Kinds of entries committed to, hashed together with their key into the entry id */
+enum DAOStateEntryType
+{
+    DAO_ENTRY_PROPOSAL = 'p',
+    DAO_ENTRY_PAYMENT_REQUEST = 'r',
+    DAO_ENTRY_CONSULTATION = 'c',
+    DAO_ENTRY_ANSWER = 'a',
+    DAO_ENTRY_VOTE = 'v',
+};
+
+/** New leaf hashes by entry id, a null leaf meaning the entry was removed */
+typedef std::map<uint256, uint256> CDAOStateChanges;
+
+template <typename K>
+uint256 GetDAOStateEntryId(DAOStateEntryType type, const K& key)
+{
+    CHashWriter writer(0,0);
+    writer << (unsigned char)type;
+    writer << key;
+    return writer.GetHash();
+}
+
+uint256 GetDAOStateLeaf(const CProposal& proposal);
+uint256 GetDAOStateLeaf(const CPaymentRequest& prequest);
+uint256 GetDAOStateLeaf(const CConsultation& consultation);
+uint256 GetDAOStateLeaf(const CConsultationAnswer& answer);
+uint256 GetDAOStateLeaf(const CVoteList& votes);
+
+/**
+ * Adds the entries of a map of the state view to changes. Entries already present
+ * are kept, so the changes of a cache have to be added before those of its base.
+ */
+template <typename Map>
+void AddDAOStateChanges(DAOStateEntryType type, const Map& map, CDAOStateChanges& changes)
+{
+    for (typename Map::const_iterator it = map.begin(); it != map.end(); ++it)
+        if (it->second.fDirty)
+            changes.insert(std::make_pair(GetDAOStateEntryId(type, it->first), GetDAOStateLeaf(it->second)));
+}
+
+/**
+ * Merkle commitment to the DAO state. Entries are spread by id over a fixed number
+ * of buckets, which are the leaves of a binary hash tree, so updating an entry
+ * rehashes one bucket and the path from it to the root.
+ */
+class CDAOStateCommitment
+{
+public:
+    static const unsigned int BUCKET_BITS = 12;
+    static const unsigned int BUCKETS = 1 << BUCKET_BITS;
+
+private:
+    typedef std::map<uint256, uint256> bucket_type;
+
+    std::vector<bucket_type> vBuckets;
+    //! Tree nodes with the root first, the children of node i at 2i+1 and 2i+2 and the buckets last
+    std::vector<uint256> vNodes;
+
+    static unsigned int GetBucket(const uint256& id) { return id.GetCheapHash() & (BUCKETS - 1); }
+    static uint256 GetBucketHash(const bucket_type& bucket);
+    static uint256 GetParentHash(const uint256& left, const uint256& right);
+
+    //! Buckets with the changes applied, only for the buckets they touch
+    void GetChangedBuckets(const CDAOStateChanges& changes, std::map<unsigned int, bucket_type>& mapChanged) const;
+    //! Nodes which differ once the changed buckets replace the stored ones
+    void GetChangedNodes(const std::map<unsigned int, bucket_type>& mapChanged, std::map<unsigned int, uint256>& mapNodes) const;
+
+public:
+    CDAOStateCommitment();
+
+    void Update(const CDAOStateChanges& changes);
+    void Clear();
+
+    uint256 GetRoot() const { return vNodes[0]; }
+    /** Root once changes not written yet (those of the caches above the database) are applied */
+    uint256 GetRoot(const CDAOStateChanges& changes) const;
+
+    /**
+     * Returns the entries of the bucket of id and the hashes of the siblings of the
+     * bucket up to the root, after applying changes.
+     */
+    void GetProof(const uint256& id, const CDAOStateChanges& changes,
+                  std::vector<std::pair<uint256, uint256> >& vEntries, std::vector<uint256>& vBranch) const;
+    /** Root a proof leads to, or a null hash if the entries don't belong to the bucket of id */
+    static uint256 GetProofRoot(const uint256& id, const std::vector<std::pair<uint256, uint256> >& vEntries,
+                                const std::vector<uint256>& vBranch);
+
+    size_t GetEntries() const;
+};
+
+#endif // NAVCOIN_CONSENSUS_DAOCOMMITMENT_H
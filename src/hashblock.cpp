@@ -0,0 +1,494 @@
+// Copyright (c) 2020 The Navcoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <hashblock.h>
+
+#include <crypto/common.h>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define ENABLE_X13_X86 1
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+
+namespace {
+
+/** A stage of the X13 chain, hashing 64 bytes into 64 bytes */
+typedef void (*X13Stage)(const unsigned char* in, unsigned char* out);
+
+#define X13_SPH_STAGE(name, ctx_type, init, update, close) \
+    void name(const unsigned char* in, unsigned char* out) \
+    { \
+        ctx_type ctx; \
+        init(&ctx); \
+        update(&ctx, in, 64); \
+        close(&ctx, out); \
+    }
+
+X13_SPH_STAGE(BMW, sph_bmw512_context, sph_bmw512_init, sph_bmw512, sph_bmw512_close)
+X13_SPH_STAGE(Groestl, sph_groestl512_context, sph_groestl512_init, sph_groestl512, sph_groestl512_close)
+X13_SPH_STAGE(Skein, sph_skein512_context, sph_skein512_init, sph_skein512, sph_skein512_close)
+X13_SPH_STAGE(JH, sph_jh512_context, sph_jh512_init, sph_jh512, sph_jh512_close)
+X13_SPH_STAGE(Keccak, sph_keccak512_context, sph_keccak512_init, sph_keccak512, sph_keccak512_close)
+X13_SPH_STAGE(Luffa, sph_luffa512_context, sph_luffa512_init, sph_luffa512, sph_luffa512_close)
+X13_SPH_STAGE(CubeHash, sph_cubehash512_context, sph_cubehash512_init, sph_cubehash512, sph_cubehash512_close)
+X13_SPH_STAGE(SHAvite, sph_shavite512_context, sph_shavite512_init, sph_shavite512, sph_shavite512_close)
+X13_SPH_STAGE(SIMD, sph_simd512_context, sph_simd512_init, sph_simd512, sph_simd512_close)
+X13_SPH_STAGE(Echo, sph_echo512_context, sph_echo512_init, sph_echo512, sph_echo512_close)
+X13_SPH_STAGE(Hamsi, sph_hamsi512_context, sph_hamsi512_init, sph_hamsi512, sph_hamsi512_close)
+X13_SPH_STAGE(Fugue, sph_fugue512_context, sph_fugue512_init, sph_fugue512, sph_fugue512_close)
+
+#undef X13_SPH_STAGE
+
+void Blake80(const unsigned char* in, unsigned char* out)
+{
+    sph_blake512_context ctx;
+    sph_blake512_init(&ctx);
+    sph_blake512(&ctx, in, 80);
+    sph_blake512_close(&ctx, out);
+}
+
+#if ENABLE_X13_X86
+
+/*
+ * ECHO-512 of a 64 byte message. The 128 bit words of the ECHO state are AES
+ * states, so BigSubWords maps to two AESENC per word.
+ */
+__attribute__((target("aes,sse2")))
+void EchoAESNI(const unsigned char* in, unsigned char* out)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i mask1b = _mm_set1_epi8(0x1b);
+    __m128i W[16];
+    __m128i M[4];
+
+    // Chaining value, then the message padded with its length and bit counter
+    for (int i = 0; i < 8; i++)
+        W[i] = _mm_set_epi64x(0, 512);
+    for (int i = 0; i < 4; i++)
+        W[8 + i] = M[i] = _mm_loadu_si128((const __m128i*)(in + 16 * i));
+    W[12] = _mm_set_epi64x(0, 0x80);
+    W[13] = zero;
+    W[14] = _mm_set_epi16(0x0200, 0, 0, 0, 0, 0, 0, 0);
+    W[15] = _mm_set_epi64x(0, 512);
+
+    // The counter of a single block message never carries out of its low word
+    uint32_t k = 512;
+
+    for (int r = 0; r < 10; r++)
+    {
+        for (int i = 0; i < 16; i++)
+            W[i] = _mm_aesenc_si128(_mm_aesenc_si128(W[i], _mm_set_epi32(0, 0, 0, k++)), zero);
+
+        __m128i t = W[1];
+        W[1] = W[5]; W[5] = W[9]; W[9] = W[13]; W[13] = t;
+        t = W[2]; W[2] = W[10]; W[10] = t;
+        t = W[6]; W[6] = W[14]; W[14] = t;
+        t = W[15]; W[15] = W[11]; W[11] = W[7]; W[7] = W[3]; W[3] = t;
+
+        for (int i = 0; i < 16; i += 4)
+        {
+            __m128i a = W[i], b = W[i + 1], c = W[i + 2], d = W[i + 3];
+            __m128i ab = _mm_xor_si128(a, b);
+            __m128i bc = _mm_xor_si128(b, c);
+            __m128i cd = _mm_xor_si128(c, d);
+            __m128i abx = _mm_xor_si128(_mm_add_epi8(ab, ab), _mm_and_si128(_mm_cmplt_epi8(ab, zero), mask1b));
+            __m128i bcx = _mm_xor_si128(_mm_add_epi8(bc, bc), _mm_and_si128(_mm_cmplt_epi8(bc, zero), mask1b));
+            __m128i cdx = _mm_xor_si128(_mm_add_epi8(cd, cd), _mm_and_si128(_mm_cmplt_epi8(cd, zero), mask1b));
+            W[i] = _mm_xor_si128(_mm_xor_si128(abx, bc), d);
+            W[i + 1] = _mm_xor_si128(_mm_xor_si128(bcx, a), cd);
+            W[i + 2] = _mm_xor_si128(_mm_xor_si128(cdx, ab), d);
+            W[i + 3] = _mm_xor_si128(_mm_xor_si128(_mm_xor_si128(abx, bcx), _mm_xor_si128(cdx, ab)), c);
+        }
+    }
+
+    for (int i = 0; i < 4; i++)
+    {
+        __m128i h = _mm_xor_si128(_mm_xor_si128(_mm_set_epi64x(0, 512), M[i]), _mm_xor_si128(W[i], W[i + 8]));
+        _mm_storeu_si128((__m128i*)(out + 16 * i), h);
+    }
+}
+
+/** Byte shuffles applying ShiftBytes to the rows of P and Q, undoing the ShiftRows of AESENCLAST */
+struct CGroestlShuffles
+{
+    alignas(16) unsigned char p[8][16];
+    alignas(16) unsigned char q[8][16];
+
+    CGroestlShuffles()
+    {
+        static const int shiftP[8] = {0, 1, 2, 3, 4, 5, 6, 11};
+        static const int shiftQ[8] = {1, 3, 5, 11, 0, 2, 4, 6};
+
+        for (int i = 0; i < 8; i++)
+        {
+            for (int j = 0; j < 16; j++)
+            {
+                // AESENCLAST moves byte r + 4 * ((c + r) % 4) to r + 4 * c
+                int src = (j % 4) + 4 * ((j / 4 + j % 4) % 4);
+                p[i][src] = (j + shiftP[i]) % 16;
+                q[i][src] = (j + shiftQ[i]) % 16;
+            }
+        }
+    }
+};
+
+const CGroestlShuffles groestlShuffles;
+
+#define GROESTL_XTIME(x) _mm_xor_si128(_mm_add_epi8(x, x), _mm_and_si128(_mm_cmplt_epi8(x, zero), mask1b))
+
+// Row i of MixBytes with the circulant matrix (2, 2, 3, 4, 5, 3, 5, 7)
+#define GROESTL_MIX_ROW(i) \
+    _mm_xor_si128(_mm_xor_si128(_mm_xor_si128(_mm_xor_si128(x[(i + 2) & 7], x[(i + 4) & 7]), \
+                                              _mm_xor_si128(x[(i + 5) & 7], x[(i + 6) & 7])), \
+                                _mm_xor_si128(_mm_xor_si128(x[(i + 7) & 7], x2[i]), \
+                                              _mm_xor_si128(x2[(i + 1) & 7], x2[(i + 2) & 7]))), \
+                  _mm_xor_si128(_mm_xor_si128(_mm_xor_si128(x2[(i + 5) & 7], x2[(i + 7) & 7]), \
+                                              _mm_xor_si128(x4[(i + 3) & 7], x4[(i + 4) & 7])), \
+                                _mm_xor_si128(x4[(i + 6) & 7], x4[(i + 7) & 7])))
+
+/*
+ * Permutation P or Q of Groestl-512 over a state kept as eight rows of sixteen
+ * bytes, with SubBytes done by AESENCLAST.
+ */
+template<bool fQ>
+__attribute__((target("aes,ssse3")))
+inline void GroestlPermAESNI(__m128i x[8])
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i ones = _mm_set1_epi8((char)0xff);
+    const __m128i mask1b = _mm_set1_epi8(0x1b);
+    const __m128i columns = _mm_set_epi8((char)0xf0, (char)0xe0, (char)0xd0, (char)0xc0, (char)0xb0, (char)0xa0, (char)0x90, (char)0x80,
+                                         0x70, 0x60, 0x50, 0x40, 0x30, 0x20, 0x10, 0x00);
+    const unsigned char (*shuffles)[16] = fQ ? groestlShuffles.q : groestlShuffles.p;
+    __m128i x2[8], x4[8];
+
+    for (int r = 0; r < 14; r++)
+    {
+        if (fQ)
+        {
+            for (int i = 0; i < 7; i++)
+                x[i] = _mm_xor_si128(x[i], ones);
+            x[7] = _mm_xor_si128(x[7], _mm_xor_si128(_mm_xor_si128(columns, ones), _mm_set1_epi8(r)));
+        }
+        else
+        {
+            x[0] = _mm_xor_si128(x[0], _mm_xor_si128(columns, _mm_set1_epi8(r)));
+        }
+
+        for (int i = 0; i < 8; i++)
+        {
+            x[i] = _mm_aesenclast_si128(_mm_shuffle_epi8(x[i], _mm_load_si128((const __m128i*)shuffles[i])), zero);
+            x2[i] = GROESTL_XTIME(x[i]);
+            x4[i] = GROESTL_XTIME(x2[i]);
+        }
+
+        __m128i y0 = GROESTL_MIX_ROW(0), y1 = GROESTL_MIX_ROW(1), y2 = GROESTL_MIX_ROW(2), y3 = GROESTL_MIX_ROW(3);
+        __m128i y4 = GROESTL_MIX_ROW(4), y5 = GROESTL_MIX_ROW(5), y6 = GROESTL_MIX_ROW(6), y7 = GROESTL_MIX_ROW(7);
+        x[0] = y0; x[1] = y1; x[2] = y2; x[3] = y3; x[4] = y4; x[5] = y5; x[6] = y6; x[7] = y7;
+    }
+}
+
+#undef GROESTL_MIX_ROW
+#undef GROESTL_XTIME
+
+/** Groestl-512 of a 64 byte message */
+__attribute__((target("aes,ssse3")))
+void GroestlAESNI(const unsigned char* in, unsigned char* out)
+{
+    // The state is stored by columns, the rows are gathered in registers
+    unsigned char block[128] = {0};
+    memcpy(block, in, 64);
+    block[64] = 0x80;
+    block[127] = 1;
+
+    unsigned char rows[8][16];
+    for (int i = 0; i < 8; i++)
+        for (int j = 0; j < 16; j++)
+            rows[i][j] = block[8 * j + i];
+
+    __m128i h[8], p[8], q[8];
+    for (int i = 0; i < 8; i++)
+    {
+        q[i] = _mm_loadu_si128((const __m128i*)rows[i]);
+        h[i] = _mm_setzero_si128();
+    }
+    // The initial value encodes the output size as the last 64 bit word
+    h[6] = _mm_insert_epi16(h[6], 0x0200, 7);
+    for (int i = 0; i < 8; i++)
+        p[i] = _mm_xor_si128(h[i], q[i]);
+
+    GroestlPermAESNI<false>(p);
+    GroestlPermAESNI<true>(q);
+
+    for (int i = 0; i < 8; i++)
+        p[i] = h[i] = _mm_xor_si128(_mm_xor_si128(p[i], q[i]), h[i]);
+
+    GroestlPermAESNI<false>(p);
+
+    for (int i = 0; i < 8; i++)
+        _mm_storeu_si128((__m128i*)rows[i], _mm_xor_si128(p[i], h[i]));
+
+    for (int j = 8; j < 16; j++)
+        for (int i = 0; i < 8; i++)
+            out[8 * (j - 8) + i] = rows[i][j];
+}
+
+const uint32_t cubehashIV[32] = {
+    0x2AEA2A61, 0x50F494D4, 0x2D538B8B, 0x4167D83E, 0x3FEE2313, 0xC701CF8C, 0xCC39968E, 0x50AC5695,
+    0x4D42C787, 0xA647A8B3, 0x97CF0BEF, 0x825B4537, 0xEEF864D2, 0xF22090C4, 0xD0E5CD33, 0xA23911AE,
+    0xFCD398D9, 0x148FE485, 0x1B017BEF, 0xB6444532, 0x6A536159, 0x2FF5781C, 0x91FA7934, 0x0DBADEA9,
+    0xD65C8A2B, 0xA5A70E75, 0xB1C62456, 0xBC796576, 0x1921C8F7, 0xE7989AF1, 0x7795D246, 0xD43E3B44
+};
+
+#define CUBEHASH_ROTL(x, n) _mm_or_si128(_mm_slli_epi32(x, n), _mm_srli_epi32(x, 32 - (n)))
+
+/** Two CubeHash rounds over a state held in eight registers of four words */
+inline void CubeHashRoundsSSE2(__m128i x[8], int nRounds)
+{
+    __m128i x0 = x[0], x1 = x[1], x2 = x[2], x3 = x[3], x4 = x[4], x5 = x[5], x6 = x[6], x7 = x[7];
+
+    for (int r = 0; r < nRounds; r += 2)
+    {
+        // Even round; the swap of the words 0-7 with 8-15 is a renaming
+        x4 = _mm_add_epi32(x0, x4); x5 = _mm_add_epi32(x1, x5); x6 = _mm_add_epi32(x2, x6); x7 = _mm_add_epi32(x3, x7);
+        x0 = CUBEHASH_ROTL(x0, 7); x1 = CUBEHASH_ROTL(x1, 7); x2 = CUBEHASH_ROTL(x2, 7); x3 = CUBEHASH_ROTL(x3, 7);
+        x2 = _mm_xor_si128(x2, x4); x3 = _mm_xor_si128(x3, x5); x0 = _mm_xor_si128(x0, x6); x1 = _mm_xor_si128(x1, x7);
+        x4 = _mm_shuffle_epi32(x4, 0x4e); x5 = _mm_shuffle_epi32(x5, 0x4e); x6 = _mm_shuffle_epi32(x6, 0x4e); x7 = _mm_shuffle_epi32(x7, 0x4e);
+        x4 = _mm_add_epi32(x2, x4); x5 = _mm_add_epi32(x3, x5); x6 = _mm_add_epi32(x0, x6); x7 = _mm_add_epi32(x1, x7);
+        x2 = CUBEHASH_ROTL(x2, 11); x3 = CUBEHASH_ROTL(x3, 11); x0 = CUBEHASH_ROTL(x0, 11); x1 = CUBEHASH_ROTL(x1, 11);
+        x3 = _mm_xor_si128(x3, x4); x2 = _mm_xor_si128(x2, x5); x1 = _mm_xor_si128(x1, x6); x0 = _mm_xor_si128(x0, x7);
+        x4 = _mm_shuffle_epi32(x4, 0xb1); x5 = _mm_shuffle_epi32(x5, 0xb1); x6 = _mm_shuffle_epi32(x6, 0xb1); x7 = _mm_shuffle_epi32(x7, 0xb1);
+
+        // Odd round, starting from words 0-15 held in x3, x2, x1, x0
+        x4 = _mm_add_epi32(x3, x4); x5 = _mm_add_epi32(x2, x5); x6 = _mm_add_epi32(x1, x6); x7 = _mm_add_epi32(x0, x7);
+        x3 = CUBEHASH_ROTL(x3, 7); x2 = CUBEHASH_ROTL(x2, 7); x1 = CUBEHASH_ROTL(x1, 7); x0 = CUBEHASH_ROTL(x0, 7);
+        x1 = _mm_xor_si128(x1, x4); x0 = _mm_xor_si128(x0, x5); x3 = _mm_xor_si128(x3, x6); x2 = _mm_xor_si128(x2, x7);
+        x4 = _mm_shuffle_epi32(x4, 0x4e); x5 = _mm_shuffle_epi32(x5, 0x4e); x6 = _mm_shuffle_epi32(x6, 0x4e); x7 = _mm_shuffle_epi32(x7, 0x4e);
+        x4 = _mm_add_epi32(x1, x4); x5 = _mm_add_epi32(x0, x5); x6 = _mm_add_epi32(x3, x6); x7 = _mm_add_epi32(x2, x7);
+        x1 = CUBEHASH_ROTL(x1, 11); x0 = CUBEHASH_ROTL(x0, 11); x3 = CUBEHASH_ROTL(x3, 11); x2 = CUBEHASH_ROTL(x2, 11);
+        x0 = _mm_xor_si128(x0, x4); x1 = _mm_xor_si128(x1, x5); x2 = _mm_xor_si128(x2, x6); x3 = _mm_xor_si128(x3, x7);
+        x4 = _mm_shuffle_epi32(x4, 0xb1); x5 = _mm_shuffle_epi32(x5, 0xb1); x6 = _mm_shuffle_epi32(x6, 0xb1); x7 = _mm_shuffle_epi32(x7, 0xb1);
+    }
+
+    x[0] = x0; x[1] = x1; x[2] = x2; x[3] = x3; x[4] = x4; x[5] = x5; x[6] = x6; x[7] = x7;
+}
+
+#undef CUBEHASH_ROTL
+
+/** CubeHash16/32-512 of a 64 byte message */
+void CubeHashSSE2(const unsigned char* in, unsigned char* out)
+{
+    __m128i x[8];
+    for (int i = 0; i < 8; i++)
+        x[i] = _mm_loadu_si128((const __m128i*)(cubehashIV + 4 * i));
+
+    for (int b = 0; b < 2; b++)
+    {
+        x[0] = _mm_xor_si128(x[0], _mm_loadu_si128((const __m128i*)(in + 32 * b)));
+        x[1] = _mm_xor_si128(x[1], _mm_loadu_si128((const __m128i*)(in + 32 * b + 16)));
+        CubeHashRoundsSSE2(x, 16);
+    }
+
+    x[0] = _mm_xor_si128(x[0], _mm_set_epi32(0, 0, 0, 0x80));
+    CubeHashRoundsSSE2(x, 16);
+
+    x[7] = _mm_xor_si128(x[7], _mm_set_epi32(1, 0, 0, 0));
+    CubeHashRoundsSSE2(x, 160);
+
+    for (int i = 0; i < 4; i++)
+        _mm_storeu_si128((__m128i*)(out + 16 * i), x[i]);
+}
+
+const uint64_t blakeIV[8] = {
+    0x6A09E667F3BCC908ULL, 0xBB67AE8584CAA73BULL, 0x3C6EF372FE94F82BULL, 0xA54FF53A5F1D36F1ULL,
+    0x510E527FADE682D1ULL, 0x9B05688C2B3E6C1FULL, 0x1F83D9ABFB41BD6BULL, 0x5BE0CD19137E2179ULL
+};
+
+const uint64_t blakeCB[16] = {
+    0x243F6A8885A308D3ULL, 0x13198A2E03707344ULL, 0xA4093822299F31D0ULL, 0x082EFA98EC4E6C89ULL,
+    0x452821E638D01377ULL, 0xBE5466CF34E90C6CULL, 0xC0AC29B7C97C50DDULL, 0x3F84D5B5B5470917ULL,
+    0x9216D5D98979FB1BULL, 0xD1310BA698DFB5ACULL, 0x2FFD72DBD01ADFB7ULL, 0xB8E1AFED6A267E96ULL,
+    0xBA7C9045F12C7F99ULL, 0x24A19947B3916CF7ULL, 0x0801F2E2858EFC16ULL, 0x636920D871574E69ULL
+};
+
+const unsigned char blakeSigma[10][16] = {
+    {  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15 },
+    { 14, 10,  4,  8,  9, 15, 13,  6,  1, 12,  0,  2, 11,  7,  5,  3 },
+    { 11,  8, 12,  0,  5,  2, 15, 13, 10, 14,  3,  6,  7,  1,  9,  4 },
+    {  7,  9,  3,  1, 13, 12, 11, 14,  2,  6,  5, 10,  4,  0, 15,  8 },
+    {  9,  0,  5,  7,  2,  4, 10, 15, 14,  1, 11, 12,  6,  8,  3, 13 },
+    {  2, 12,  6, 10,  0, 11,  8,  3,  4, 13,  7,  5, 15, 14,  1,  9 },
+    { 12,  5,  1, 15, 14, 13,  4, 10,  0,  7,  6,  3,  9,  2,  8, 11 },
+    { 13, 11,  7, 14, 12,  1,  3,  9,  5,  0, 15,  4,  8,  6,  2, 10 },
+    {  6, 15, 14,  9, 11,  3,  0,  8, 12,  2, 13,  7,  1,  4, 10,  5 },
+    { 10,  2,  8,  4,  7,  6,  1,  5, 15, 11,  9, 14,  3, 12, 13,  0 }
+};
+
+/** BLAKE-512 of four 80 byte headers, one per 64 bit lane */
+__attribute__((target("avx2")))
+void Blake80AVX2(const unsigned char* in, unsigned char* out)
+{
+    const __m256i rot16 = _mm256_setr_epi8(2, 3, 4, 5, 6, 7, 0, 1, 10, 11, 12, 13, 14, 15, 8, 9,
+                                           2, 3, 4, 5, 6, 7, 0, 1, 10, 11, 12, 13, 14, 15, 8, 9);
+    __m256i m[16], v[16];
+
+    // Message words are big endian; the padding is the same for every 80 byte message
+    for (int w = 0; w < 10; w++)
+        m[w] = _mm256_set_epi64x(ReadBE64(in + 240 + 8 * w), ReadBE64(in + 160 + 8 * w),
+                                 ReadBE64(in + 80 + 8 * w), ReadBE64(in + 8 * w));
+    m[10] = _mm256_set1_epi64x(0x8000000000000000ULL);
+    m[11] = m[12] = m[14] = _mm256_setzero_si256();
+    m[13] = _mm256_set1_epi64x(1);
+    m[15] = _mm256_set1_epi64x(640);
+
+    for (int i = 0; i < 8; i++)
+        v[i] = _mm256_set1_epi64x(blakeIV[i]);
+    for (int i = 0; i < 4; i++)
+        v[8 + i] = _mm256_set1_epi64x(blakeCB[i]);
+    v[12] = _mm256_set1_epi64x(640 ^ blakeCB[4]);
+    v[13] = _mm256_set1_epi64x(640 ^ blakeCB[5]);
+    v[14] = _mm256_set1_epi64x(blakeCB[6]);
+    v[15] = _mm256_set1_epi64x(blakeCB[7]);
+
+#define BLAKE_G(a, b, c, d, e) do { \
+        const unsigned char* s = blakeSigma[r % 10]; \
+        v[a] = _mm256_add_epi64(_mm256_add_epi64(v[a], v[b]), _mm256_xor_si256(m[s[e]], _mm256_set1_epi64x(blakeCB[s[e + 1]]))); \
+        v[d] = _mm256_shuffle_epi32(_mm256_xor_si256(v[d], v[a]), 0xb1); \
+        v[c] = _mm256_add_epi64(v[c], v[d]); \
+        v[b] = _mm256_xor_si256(v[b], v[c]); \
+        v[b] = _mm256_or_si256(_mm256_srli_epi64(v[b], 25), _mm256_slli_epi64(v[b], 39)); \
+        v[a] = _mm256_add_epi64(_mm256_add_epi64(v[a], v[b]), _mm256_xor_si256(m[s[e + 1]], _mm256_set1_epi64x(blakeCB[s[e]]))); \
+        v[d] = _mm256_shuffle_epi8(_mm256_xor_si256(v[d], v[a]), rot16); \
+        v[c] = _mm256_add_epi64(v[c], v[d]); \
+        v[b] = _mm256_xor_si256(v[b], v[c]); \
+        v[b] = _mm256_or_si256(_mm256_srli_epi64(v[b], 11), _mm256_slli_epi64(v[b], 53)); \
+    } while (0)
+
+    for (int r = 0; r < 16; r++)
+    {
+        BLAKE_G(0, 4, 8, 12, 0);
+        BLAKE_G(1, 5, 9, 13, 2);
+        BLAKE_G(2, 6, 10, 14, 4);
+        BLAKE_G(3, 7, 11, 15, 6);
+        BLAKE_G(0, 5, 10, 15, 8);
+        BLAKE_G(1, 6, 11, 12, 10);
+        BLAKE_G(2, 7, 8, 13, 12);
+        BLAKE_G(3, 4, 9, 14, 14);
+    }
+
+#undef BLAKE_G
+
+    for (int i = 0; i < 8; i++)
+    {
+        uint64_t h[4];
+        _mm256_storeu_si256((__m256i*)h, _mm256_xor_si256(_mm256_set1_epi64x(blakeIV[i]), _mm256_xor_si256(v[i], v[i + 8])));
+        for (int lane = 0; lane < 4; lane++)
+            WriteBE64(out + 64 * lane + 8 * i, h[lane]);
+    }
+}
+
+#endif // ENABLE_X13_X86
+
+/** The X13 implementation picked for this CPU */
+struct CX13Engine
+{
+    X13Stage stages[12];
+    bool fBlake4Way;
+    std::string strName;
+
+    CX13Engine() : fBlake4Way(false), strName("standard")
+    {
+        X13Stage standard[12] = {BMW, Groestl, Skein, JH, Keccak, Luffa, CubeHash, SHAvite, SIMD, Echo, Hamsi, Fugue};
+        memcpy(stages, standard, sizeof(stages));
+
+#if ENABLE_X13_X86
+        uint32_t eax, ebx, ecx, edx;
+        bool fSSSE3 = false, fAES = false, fAVX2 = false;
+
+        if (__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+        {
+            fSSSE3 = (ecx >> 9) & 1;
+            fAES = (ecx >> 25) & 1;
+
+            // AVX2 needs the OS to save the YMM registers
+            bool fOSXSAVE = (ecx >> 27) & 1;
+            if (fOSXSAVE && __get_cpuid_max(0, nullptr) >= 7)
+            {
+                uint32_t xcr0_lo, xcr0_hi;
+                __asm__ ("xgetbv" : "=a"(xcr0_lo), "=d"(xcr0_hi) : "c"(0));
+                __cpuid_count(7, 0, eax, ebx, ecx, edx);
+                fAVX2 = ((xcr0_lo & 6) == 6) && ((ebx >> 5) & 1);
+            }
+        }
+
+        stages[6] = CubeHashSSE2;
+        strName = "sse2";
+
+        if (fAES && fSSSE3)
+        {
+            stages[1] = GroestlAESNI;
+            stages[9] = EchoAESNI;
+            strName += ",aes";
+        }
+
+        if (fAVX2)
+        {
+            fBlake4Way = true;
+            strName += ",avx2(4-way)";
+        }
+#endif
+    }
+
+    void Tail(unsigned char* hash, uint256& out) const
+    {
+        unsigned char buf[64];
+
+        for (int i = 0; i < 12; i++)
+        {
+            stages[i](hash, buf);
+            memcpy(hash, buf, 64);
+        }
+
+        memcpy(out.begin(), hash, 32);
+    }
+};
+
+const CX13Engine& GetX13Engine()
+{
+    static const CX13Engine engine;
+    return engine;
+}
+
+}
+
+void Hash9Headers(const unsigned char* pheaders, size_t nCount, uint256* phashes)
+{
+    const CX13Engine& engine = GetX13Engine();
+    unsigned char hash[4][64];
+    size_t i = 0;
+
+#if ENABLE_X13_X86
+    if (engine.fBlake4Way)
+    {
+        for (; i + 4 <= nCount; i += 4)
+        {
+            Blake80AVX2(pheaders + 80 * i, hash[0]);
+            for (int lane = 0; lane < 4; lane++)
+                engine.Tail(hash[lane], phashes[i + lane]);
+        }
+    }
+#endif
+
+    for (; i < nCount; i++)
+    {
+        Blake80(pheaders + 80 * i, hash[0]);
+        engine.Tail(hash[0], phashes[i]);
+    }
+}
+
+std::string Hash9Implementation()
+{
+    return GetX13Engine().strName;
+}
@@ -20,9 +20,7 @@
 #include <limits.h>
 
 
-#ifndef QT_NO_DEBUG
 #include <string>
-#endif
 
 #ifdef GLOBALDEFINED
 #define GLOBAL
@@ -155,6 +153,16 @@ inline uint256 Hash9(const T1 pbegin, const T1 pend)
     return hash[12].trim256();
 }
 
+/**
+ * Computes Hash9 of nCount consecutive 80 byte block headers into phashes. The
+ * first stage hashes four headers at once and the heavier stages use AES-NI or
+ * SSE2 kernels where the CPU supports them; results match Hash9.
+ */
+void Hash9Headers(const unsigned char* pheaders, size_t nCount, uint256* phashes);
+
+/** Describes the kernels used by Hash9Headers on this CPU */
+std::string Hash9Implementation();
+
 
 
 #endif // HASHBLOCK_H
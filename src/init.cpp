@@ -18,8 +18,11 @@
 #include <compat/sanity.h>
 #include <consensus/validation.h>
 #include <blsct/aggregationsession.h>
+#include <blsct/bulletproofs.h>
+#include <blsct/verificationcache.h>
 #include <blsct/rpc.h>
 #include <httpserver.h>
+#include <hashblock.h>
 #include <httprpc.h>
 #include <kernel.h>
 #include <key.h>
@@ -46,6 +49,7 @@
 #ifdef ENABLE_WALLET
 #include <wallet/wallet.h>
 #endif
+#include <atomic>
 #include <stdint.h>
 #include <stdio.h>
 
@@ -75,6 +79,8 @@
 using namespace std;
 
 bool fFeeEstimatesInitialized = false;
+//! Set once the mempool was loaded from disk, so a dump can't replace it with an empty pool
+static std::atomic<bool> fDumpMempoolLater(false);
 volatile bool fRestartRequested = false; // true: restart false: shutdown
 static const bool DEFAULT_PROXYRANDOMIZE = true;
 static const bool DEFAULT_REST_ENABLE = false;
@@ -265,6 +271,11 @@ void PrepareShutdown()
     torController.Stop();
     UnregisterNodeSignals(GetNodeSignals());
 
+    if (fDumpMempoolLater && GetBoolArg("-persistmempool", DEFAULT_PERSIST_MEMPOOL)) {
+        DumpMempool();
+        fDumpMempoolLater = false;
+    }
+
     if (fFeeEstimatesInitialized)
     {
         boost::filesystem::path est_path = GetDataDir() / FEE_ESTIMATES_FILENAME;
@@ -412,6 +423,7 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-mempoolexpiry=<n>", strprintf(_("Do not keep transactions in the mempool longer than <n> hours (default: %u)"), DEFAULT_MEMPOOL_EXPIRY));
     strUsage += HelpMessageOpt("-minersleep=<n>", strprintf(_("Sets the default sleep for the staking thread (default: %u)"), 500));
     strUsage += HelpMessageOpt("-mininputvalue=<n>", strprintf(_("Sets the minimum value for an output to be considered as a coinstake kernel candidate")));
+    strUsage += HelpMessageOpt("-persistmempool", strprintf(_("Whether to save the mempool on shutdown and load on restart (default: %u)"), DEFAULT_PERSIST_MEMPOOL));
     strUsage += HelpMessageOpt("-par=<n>", strprintf(_("Set the number of script verification threads (%u to %d, 0 = auto, <0 = leave that many cores free, default: %d)"),
                                                      -GetNumCores(), MAX_SCRIPTCHECK_THREADS, DEFAULT_SCRIPTCHECK_THREADS));
 #ifndef WIN32
@@ -424,6 +436,8 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-reindex", _("Rebuild chain state and block index from the blk*.dat files on disk"));
 #ifdef ENABLE_WALLET
     strUsage += HelpMessageOpt("-staking=<bool>", _("Enables or disables the staking thread."));
+    strUsage += HelpMessageOpt("-stakerthreads=<n>", strprintf(_("Set the number of threads searching stake kernels (%u to %d, 0 = auto, <0 = leave that many cores free, default: %d)"),
+                                                     -GetNumCores(), MAX_STAKER_THREADS, DEFAULT_STAKER_THREADS));
 #endif
 #ifndef WIN32
     strUsage += HelpMessageOpt("-sysperms", _("Create new files with system default permissions, instead of umask 077 (only effective with disabled wallet functionality)"));
@@ -506,6 +520,7 @@ std::string HelpMessage(HelpMessageMode mode)
     if (showDebug)
     {
         strUsage += HelpMessageOpt("-checkblockindex", strprintf("Do a full consistency check for mapBlockIndex, setBlockIndexCandidates, chainActive and mapBlocksUnlinked occasionally. Also sets -checkmempool (default: %u)", Params(CBaseChainParams::MAIN).DefaultConsistencyChecks()));
+        strUsage += HelpMessageOpt("-checkblockhashes", strprintf("Hash the headers of the block index again when loading it, instead of trusting the stored hashes (default: %u)", DEFAULT_CHECKBLOCKHASHES));
         strUsage += HelpMessageOpt("-checkmempool=<n>", strprintf("Run checks every <n> transactions (default: %u)", Params(CBaseChainParams::MAIN).DefaultConsistencyChecks()));
         strUsage += HelpMessageOpt("-checkpoints", strprintf("Disable expensive verification for known chain history (default: %u)", DEFAULT_CHECKPOINTS_ENABLED));
         strUsage += HelpMessageOpt("-disablesafemode", strprintf("Disable safemode, override a real safe mode event (default: %u)", DEFAULT_DISABLE_SAFEMODE));
@@ -535,6 +550,7 @@ std::string HelpMessage(HelpMessageMode mode)
         strUsage += HelpMessageOpt("-limitfreerelay=<n>", strprintf("Continuously rate-limit free transactions to <n>*1000 bytes per minute (default: %u)", DEFAULT_LIMITFREERELAY));
         strUsage += HelpMessageOpt("-relaypriority", strprintf("Require high priority for relaying free or low-fee transactions (default: %u)", DEFAULT_RELAYPRIORITY));
         strUsage += HelpMessageOpt("-maxsigcachesize=<n>", strprintf("Limit size of signature cache to <n> MiB (default: %u)", DEFAULT_MAX_SIG_CACHE_SIZE));
+        strUsage += HelpMessageOpt("-maxblsctcachesize=<n>", strprintf("Limit size of the verified BLSCT transaction cache to <n> MiB (default: %u)", DEFAULT_MAX_BLSCT_CACHE_SIZE));
         strUsage += HelpMessageOpt("-maxtipage=<n>", strprintf("Maximum tip age in seconds to consider node in initial block download (default: %u)", DEFAULT_MAX_TIP_AGE));
     }
     strUsage += HelpMessageOpt("-minrelaytxfee=<amt>", strprintf(_("Fees (in %s/kB) smaller than this are considered zero fee for relaying, mining and transaction creation"),
@@ -777,6 +793,18 @@ void ThreadImport(std::vector<boost::filesystem::path> vImportFiles)
         LogPrintf("Stopping after block import\n");
         StartShutdown();
     }
+
+    if (GetBoolArg("-persistmempool", DEFAULT_PERSIST_MEMPOOL)) {
+        LoadMempool();
+        fDumpMempoolLater = !fRequestShutdown;
+    }
+}
+
+// Keeps a recent copy of the mempool on disk in case the node doesn't shut down cleanly
+static void PeriodicDumpMempool()
+{
+    if (fDumpMempoolLater)
+        DumpMempool();
 }
 
 /** Sanity checks
@@ -873,6 +901,9 @@ void InitParameterInteraction()
     if (GetBoolArg("-zapwallettxes", false)) {
         if (SoftSetBoolArg("-rescan", true))
             LogPrintf("%s: parameter interaction: -zapwallettxes=<mode> -> setting -rescan=1\n", __func__);
+        // the zapped transactions would come back from the mempool dump
+        if (SoftSetBoolArg("-persistmempool", false))
+            LogPrintf("%s: parameter interaction: -zapwallettxes=<mode> -> setting -persistmempool=0\n", __func__);
     }
 
     // -importmnemonic implies a rescan
@@ -1296,12 +1327,17 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler, const std
     LogPrintf("Using data directory %s\n", strDataDir);
     LogPrintf("Using config file %s\n", GetConfigFile().string());
     LogPrintf("Using at most %i connections (%i file descriptors available)\n", nMaxConnections, nFD);
+    LogPrintf("Using X13 implementation %s\n", Hash9Implementation());
     std::ostringstream strErrors;
 
-    LogPrintf("Using %u threads for script verification\n", nScriptCheckThreads);
+    LogPrintf("Using %u threads for script and BLSCT verification and range proof generation\n", nScriptCheckThreads);
     if (nScriptCheckThreads) {
         for (int i=0; i<nScriptCheckThreads-1; i++)
+        {
             threadGroup.create_thread(&ThreadScriptCheck);
+            threadGroup.create_thread(&ThreadBLSCTCheck);
+            threadGroup.create_thread(&ThreadBulletproofsProve);
+        }
     }
 
     // Start the lightweight task scheduler thread
@@ -1626,6 +1662,12 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler, const std
                     break;
                 }
 
+                // The states of the DAO entries are indexed once the block index is loaded
+                if (!pcoinsdbview->UpgradeDAOIndexes()) {
+                    strLoadError = _("Error indexing the DAO entries of the chainstate database");
+                    break;
+                }
+
                 // Check for changed -txindex state
                 if (fTxIndex != GetBoolArg("-txindex", DEFAULT_TXINDEX)) {
                     strLoadError = _("You need to rebuild the database using -reindex-chainstate to change -txindex");
@@ -1882,6 +1924,9 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler, const std
 
     StartNode(threadGroup, scheduler);
 
+    if (GetBoolArg("-persistmempool", DEFAULT_PERSIST_MEMPOOL))
+        scheduler.scheduleEvery(&PeriodicDumpMempool, MEMPOOL_DUMP_INTERVAL);
+
     // ********************************************************* Step 12: finished
 
     SetRPCWarmupFinished();
@@ -1891,11 +1936,25 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler, const std
     SetStaking(GetBoolArg("-staking", true));
     uiInterface.InitMessage(_("Booting staking thread"));
     threadGroup.create_thread(boost::bind(&NavcoinStaker, boost::cref(chainparams)));
+
+    // -stakerthreads=0 means autodetect, the staker thread itself searches too
+    int nStakerThreads = GetArg("-stakerthreads", DEFAULT_STAKER_THREADS);
+    if (nStakerThreads <= 0)
+        nStakerThreads += GetNumCores();
+    if (nStakerThreads > MAX_STAKER_THREADS)
+        nStakerThreads = MAX_STAKER_THREADS;
+    if (GetBoolArg("-staking", true) && nStakerThreads > 1) {
+        LogPrintf("Using %u threads for stake kernel search\n", nStakerThreads);
+        for (int i=0; i<nStakerThreads-1; i++)
+            threadGroup.create_thread(&ThreadStakeKernelSearch);
+    }
     if (pwalletMain && GetBoolArg("-blsctmix", DEFAULT_MIX))
     {
         uiInterface.InitMessage(_("Booting blsCT threads"));
         threadGroup.create_thread(boost::bind(&AggregationSessionThread));
         threadGroup.create_thread(boost::bind(&CandidateVerificationThread));
+        for (int i=0; i<nScriptCheckThreads-1; i++)
+            threadGroup.create_thread(&ThreadCandidateMatchCheck);
     }
 #endif
 
@@ -9,3 +9,277 @@
 #include <timedata.h>
 #include <txdb.h>
 #include <main.h>
+
+#include <checkqueue.h>
+#include <crypto/common.h>
+#include <hash.h>
+#include <util.h>
+#include <utiltime.h>
+
+#include <atomic>
+
+#include <boost/thread.hpp>
+
+void WriteStakeKernelPreimage(unsigned char* preimage, uint64_t nStakeModifier, unsigned int nTimeBlockFrom, unsigned int nTimeTxPrev, const COutPoint& prevout)
+{
+    WriteLE64(preimage, nStakeModifier);
+    WriteLE32(preimage + 8, nTimeBlockFrom);
+    WriteLE32(preimage + 12, nTimeTxPrev);
+    memcpy(preimage + 16, prevout.hash.begin(), 32);
+    WriteLE32(preimage + 48, prevout.n);
+}
+
+uint256 GetStakeKernelHash(const unsigned char* preimage, unsigned int nTimeTx)
+{
+    unsigned char time[4];
+    WriteLE32(time, nTimeTx);
+
+    uint256 hash;
+    CHash256().Write(preimage, STAKE_KERNEL_PREIMAGE_SIZE).Write(time, sizeof(time)).Finalize(hash.begin());
+    return hash;
+}
+
+CStakeKernel::CStakeKernel(uint64_t nStakeModifier, unsigned int nBits, unsigned int nTimeBlockFromIn, unsigned int nTimeTxPrevIn,
+                           CAmount nValue, const COutPoint& prevoutIn) :
+    prevout(prevoutIn), nTimeBlockFrom(nTimeBlockFromIn), nTimeTxPrev(nTimeTxPrevIn),
+    nStakeMinAge(Params().GetConsensus().nStakeMinAge)
+{
+    // Weighted target, as in CheckStakeKernelHash()
+    arith_uint256 targetProofOfStake;
+    targetProofOfStake.SetCompact(nBits);
+    base_uint<512> target512(targetProofOfStake.GetHex());
+    target512 *= arith_uint512(nValue);
+    fAnyHash = target512.bits() > 256;
+    bnTarget = UintToArith256(ArithToUint512(arith_uint512(target512)).trim256());
+
+    WriteStakeKernelPreimage(preimage, nStakeModifier, nTimeBlockFrom, nTimeTxPrev, prevout);
+}
+
+bool CStakeKernel::Check(unsigned int nTimeTx) const
+{
+    // Transaction timestamp violation
+    if (nTimeTx < nTimeTxPrev)
+        return false;
+
+    // Min age requirement
+    if (nTimeBlockFrom + nStakeMinAge > nTimeTx)
+        return false;
+
+    if (fAnyHash)
+        return true;
+
+    return UintToArith256(GetStakeKernelHash(preimage, nTimeTx)) <= bnTarget;
+}
+
+/** Parts of a stake kernel which do not depend on the chain tip */
+struct CStakeInput
+{
+    uint256 hashBlock;
+    int64_t nTimeBlockFrom;
+    unsigned int nTimeTxPrev;
+    CAmount nValue;
+};
+
+static std::map<COutPoint, CStakeInput> mapStakeInputs;
+
+void PrepareStakeKernels(const CBlockIndex* pindexPrev, unsigned int nBits, const std::vector<COutPoint>& vPrevouts, const CStateViewCache& view, std::vector<CStakeKernel>& vKernels)
+{
+    LOCK(cs_main);
+
+    vKernels.clear();
+    vKernels.reserve(vPrevouts.size());
+
+    std::map<COutPoint, CStakeInput> mapInputs;
+
+    for (const COutPoint& prevout: vPrevouts)
+    {
+        CStakeInput input;
+        auto it = mapStakeInputs.find(prevout);
+
+        // A cached input is reused as long as its block is still in the active chain
+        if (it != mapStakeInputs.end() && mapBlockIndex.count(it->second.hashBlock) &&
+                chainActive.Contains(mapBlockIndex[it->second.hashBlock]))
+        {
+            input = it->second;
+        }
+        else
+        {
+            CTransaction txPrev;
+            if (!GetTransaction(prevout.hash, txPrev, Params().GetConsensus(), input.hashBlock, view, true))
+            {
+                LogPrintf("%s: Could not find previous transaction %s\n", __func__, prevout.hash.ToString());
+                continue;
+            }
+
+            if (mapBlockIndex.count(input.hashBlock) == 0)
+            {
+                LogPrintf("%s: Could not find block of previous transaction %s\n", __func__, input.hashBlock.ToString());
+                continue;
+            }
+
+            if (prevout.n >= txPrev.vout.size())
+                continue;
+
+            input.nTimeBlockFrom = mapBlockIndex[input.hashBlock]->GetBlockTime();
+            input.nTimeTxPrev = txPrev.nTime;
+            input.nValue = txPrev.vout[prevout.n].nValue;
+        }
+
+        mapInputs[prevout] = input;
+
+        vKernels.push_back(CStakeKernel(pindexPrev->nStakeModifier, nBits, (unsigned int)input.nTimeBlockFrom, input.nTimeTxPrev, input.nValue, prevout));
+    }
+
+    // Forget the outputs which are not staking anymore
+    mapStakeInputs.swap(mapInputs);
+}
+
+/** Outcome of a kernel search, shared by its tasks */
+struct CStakeKernelSearch
+{
+    std::atomic<bool> fFound;
+    std::atomic<uint64_t> nChecked;
+    boost::mutex mutex;
+    int nKernel;
+    unsigned int nTime;
+
+    CStakeKernelSearch() : fFound(false), nChecked(0), nKernel(-1), nTime(0) {}
+};
+
+/** A slice of the kernels of a search, run on the staker threads */
+class CStakeKernelTask
+{
+private:
+    const std::vector<CStakeKernel>* pvKernels;
+    size_t nBegin;
+    size_t nEnd;
+    unsigned int nTime;
+    unsigned int nSearchInterval;
+    CStakeKernelSearch* pSearch;
+
+public:
+    CStakeKernelTask() : pvKernels(nullptr), nBegin(0), nEnd(0), nTime(0), nSearchInterval(0), pSearch(nullptr) {}
+    CStakeKernelTask(const std::vector<CStakeKernel>* pvKernelsIn, size_t nBeginIn, size_t nEndIn, unsigned int nTimeIn,
+                     unsigned int nSearchIntervalIn, CStakeKernelSearch* pSearchIn) :
+        pvKernels(pvKernelsIn), nBegin(nBeginIn), nEnd(nEndIn), nTime(nTimeIn), nSearchInterval(nSearchIntervalIn), pSearch(pSearchIn) {}
+
+    // Returns false once a kernel is found, so the queue skips the remaining slices
+    bool operator()()
+    {
+        uint64_t nChecked = 0;
+
+        for (size_t i = nBegin; i < nEnd && !pSearch->fFound; i++)
+        {
+            for (unsigned int n = 0; n < nSearchInterval; n++)
+            {
+                nChecked++;
+
+                if ((*pvKernels)[i].Check(nTime - n))
+                {
+                    boost::lock_guard<boost::mutex> lock(pSearch->mutex);
+                    // Prefer the first kernel, as a serial search would
+                    if (pSearch->nKernel < 0 || (int)i < pSearch->nKernel)
+                    {
+                        pSearch->nKernel = i;
+                        pSearch->nTime = nTime - n;
+                    }
+                    pSearch->fFound = true;
+                    break;
+                }
+            }
+        }
+
+        pSearch->nChecked += nChecked;
+
+        return !pSearch->fFound;
+    }
+
+    void swap(CStakeKernelTask& task)
+    {
+        std::swap(pvKernels, task.pvKernels);
+        std::swap(nBegin, task.nBegin);
+        std::swap(nEnd, task.nEnd);
+        std::swap(nTime, task.nTime);
+        std::swap(nSearchInterval, task.nSearchInterval);
+        std::swap(pSearch, task.pSearch);
+    }
+};
+
+// Number of kernels checked by each task
+static const size_t nKernelGrain = 256;
+
+static CCheckQueue<CStakeKernelTask> kernelqueue(1);
+static boost::mutex kernelqueue_mutex;
+static std::atomic<int> nKernelThreads(0);
+static std::atomic<uint64_t> nKernelsPerSecond(0);
+
+void ThreadStakeKernelSearch()
+{
+    SetThreadPriority(THREAD_PRIORITY_LOWEST);
+    RenameThread("navcoin-kernel");
+
+    nKernelThreads++;
+
+    try
+    {
+        kernelqueue.Thread();
+    }
+    catch (...)
+    {
+        nKernelThreads--;
+        throw;
+    }
+}
+
+int SearchStakeKernels(const std::vector<CStakeKernel>& vKernels, unsigned int nTime, unsigned int nSearchInterval, unsigned int& nTimeRet)
+{
+    int64_t nTimeStart = GetTimeMicros();
+
+    CStakeKernelSearch search;
+
+    size_t nTasks = (vKernels.size() + nKernelGrain - 1) / nKernelGrain;
+    std::vector<CStakeKernelTask> vTasks;
+    vTasks.reserve(nTasks);
+
+    // Slices are taken from the back of the queue, so they are added in reverse
+    for (size_t i = nTasks; i-- > 0;)
+        vTasks.push_back(CStakeKernelTask(&vKernels, i * nKernelGrain, std::min((i + 1) * nKernelGrain, vKernels.size()),
+                                          nTime, nSearchInterval, &search));
+
+    boost::unique_lock<boost::mutex> lock(kernelqueue_mutex, boost::try_to_lock);
+
+    if (nKernelThreads > 0 && nTasks > 1 && lock.owns_lock())
+    {
+        CCheckQueueControl<CStakeKernelTask> control(&kernelqueue);
+        control.Add(vTasks);
+        control.Wait();
+    }
+    else
+    {
+        for (auto it = vTasks.rbegin(); it != vTasks.rend(); ++it)
+        {
+            if (!(*it)())
+                break;
+        }
+    }
+
+    int64_t nElapsed = GetTimeMicros() - nTimeStart;
+    uint64_t nChecked = search.nChecked;
+
+    if (nElapsed > 0)
+        nKernelsPerSecond = nChecked * 1000000 / nElapsed;
+
+    LogPrint("coinstake", "%s: Checked %d kernel hashes of %d outputs in %.2fms\n", __func__,
+             nChecked, vKernels.size(), nElapsed * 0.001);
+
+    if (!search.fFound)
+        return -1;
+
+    nTimeRet = search.nTime;
+    return search.nKernel;
+}
+
+uint64_t GetStakeKernelsPerSecond()
+{
+    return nKernelsPerSecond;
+}
@@ -0,0 +1,81 @@
+// Copyright (c) 2020 The Navcoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef NAVCOIN_KERNEL_H
+#define NAVCOIN_KERNEL_H
+
+#include <amount.h>
+#include <arith_uint256.h>
+#include <primitives/transaction.h>
+#include <uint256.h>
+
+#include <stdint.h>
+#include <vector>
+
+class CBlockIndex;
+class CStateViewCache;
+
+/** -stakerthreads default (0 = one per core) */
+static const int DEFAULT_STAKER_THREADS = 0;
+/** Maximum number of threads searching stake kernels */
+static const int MAX_STAKER_THREADS = 16;
+
+/** Size of the stake kernel hash preimage up to the coinstake time */
+static const size_t STAKE_KERNEL_PREIMAGE_SIZE = 52;
+
+/**
+ * Writes nStakeModifier, nTimeBlockFrom, nTimeTxPrev, prevout.hash and prevout.n
+ * as they are serialized for the stake kernel hash.
+ */
+void WriteStakeKernelPreimage(unsigned char* preimage, uint64_t nStakeModifier, unsigned int nTimeBlockFrom, unsigned int nTimeTxPrev, const COutPoint& prevout);
+
+/** Stake kernel hash of a preimage and the coinstake time nTimeTx */
+uint256 GetStakeKernelHash(const unsigned char* preimage, unsigned int nTimeTx);
+
+/**
+ * Stake kernel of an output for a coinstake on top of a given block, with the
+ * kernel hash preimage serialized up to the coinstake time.
+ */
+class CStakeKernel
+{
+public:
+    COutPoint prevout;
+    unsigned int nTimeBlockFrom;
+    unsigned int nTimeTxPrev;
+    unsigned int nStakeMinAge;
+    //! Target weighted by the output value, fAnyHash when it does not fit in 256 bits
+    arith_uint256 bnTarget;
+    bool fAnyHash;
+    //! nStakeModifier, nTimeBlockFrom, nTimeTxPrev, prevout.hash and prevout.n
+    unsigned char preimage[STAKE_KERNEL_PREIMAGE_SIZE];
+
+    CStakeKernel() : nTimeBlockFrom(0), nTimeTxPrev(0), nStakeMinAge(0), fAnyHash(false) {}
+    CStakeKernel(uint64_t nStakeModifier, unsigned int nBits, unsigned int nTimeBlockFromIn, unsigned int nTimeTxPrevIn,
+                 CAmount nValue, const COutPoint& prevoutIn);
+
+    //! Same result as CheckKernel() for a coinstake with time nTimeTx
+    bool Check(unsigned int nTimeTx) const;
+};
+
+/**
+ * Precomputes the kernels of the outputs in vPrevouts for a coinstake on top of
+ * pindexPrev with target nBits. Outputs which can't be found are skipped. The
+ * block and transaction of each output are cached between calls.
+ */
+void PrepareStakeKernels(const CBlockIndex* pindexPrev, unsigned int nBits, const std::vector<COutPoint>& vPrevouts, const CStateViewCache& view, std::vector<CStakeKernel>& vKernels);
+
+/**
+ * Checks the kernels at the times nTime, nTime - 1, ... nTime - nSearchInterval + 1
+ * across the staker threads. Returns the index of a kernel meeting its target and
+ * sets nTimeRet to its time, or returns -1 if there is none.
+ */
+int SearchStakeKernels(const std::vector<CStakeKernel>& vKernels, unsigned int nTime, unsigned int nSearchInterval, unsigned int& nTimeRet);
+
+/** Run instances of this in threads to help searching stake kernels */
+void ThreadStakeKernelSearch();
+
+/** Kernel hashes checked per second during the last search */
+uint64_t GetStakeKernelsPerSecond();
+
+#endif // NAVCOIN_KERNEL_H
@@ -73,7 +73,7 @@ bool CBasicKeyStore::GetBLSCTHashId(const std::vector<unsigned char>& outputKey,
         bls::PrivateKey k = privateBlsViewKey.GetKey();
         t = t * k;
         Scalar hash_T = Scalar(HashG1Element(t, 0));
-        bls::G1Element dh = bls::PrivateKey::FromBN(hash_T.bn).GetG1Element();
+        bls::G1Element dh = hash_T.GetPrivateKey().GetG1Element();
         dh = dh.Inverse();
         t = bls::G1Element::FromByteVector(spendingKey);
         bls::G1Element D_prime = t + dh;
@@ -109,7 +109,7 @@ bool CBasicKeyStore::GetBLSCTSubAddressPublicKeys(const std::pair<uint64_t, uint
         // D = B + M
         // C = a*D
         Scalar m = string.GetHash();
-        bls::G1Element M = bls::PrivateKey::FromBN(m.bn).GetG1Element();
+        bls::G1Element M = m.GetPrivateKey().GetG1Element();
         bls::G1Element t;
         if (!publicBlsKey.GetSpendKey(t))
         {
@@ -117,7 +117,7 @@ bool CBasicKeyStore::GetBLSCTSubAddressPublicKeys(const std::pair<uint64_t, uint
         }
         bls::G1Element D = M + t;
         Scalar s = privateBlsViewKey.GetKey();
-        bls::G1Element C = s.bn*D;
+        bls::G1Element C = s*D;
         pk = blsctDoublePublicKey(C, D);
     }
     catch(...)
@@ -148,8 +148,8 @@ bool CBasicKeyStore::GetBLSCTSubAddressSpendingKeyForOutput(const std::pair<uint
         // Hs(a*R) + b + Hs("SubAddress\0" || a || acc || index)
         Scalar s = privateBlsViewKey.GetScalar();
         bls::G1Element t = bls::G1Element::FromByteVector(outputKey);
-        t = t*s.bn;
-        k = blsctKey(bls::PrivateKey::FromBN((Scalar(HashG1Element(t, 0)) + privateBlsSpendKey.GetScalar() + Scalar(string.GetHash())).bn));
+        t = t*s;
+        k = blsctKey((Scalar(HashG1Element(t, 0)) + privateBlsSpendKey.GetScalar() + Scalar(string.GetHash())).GetPrivateKey());
     }
     catch(...)
     {
@@ -10,6 +10,8 @@
 #include <arith_uint256.h>
 #include <base58.h>
 #include <blockencodings.h>
+#include <blockfilereader.h>
+#include <blsct/verificationcache.h>
 #include <chainparams.h>
 #include <checkpoints.h>
 #include <checkqueue.h>
@@ -19,6 +21,7 @@
 #include <core_io.h>
 #include <hash.h>
 #include <init.h>
+#include <kernel.h>
 #include <merkleblock.h>
 #include <net.h>
 #include <policy/fees.h>
@@ -67,6 +70,8 @@ using namespace std;
 CCriticalSection cs_main;
 
 BlockMap mapBlockIndex;
+/** Storage of the entries of mapBlockIndex */
+static CBlockIndexArena blockIndexArena;
 std::map<uint256,std::vector<std::pair<uint256, int>>> vProposalVotes;
 std::map<uint256,std::vector<std::pair<uint256, int>>> vPaymentRequestVotes;
 std::map<uint256,std::map<uint256, bool>> mapSupport;
@@ -749,6 +754,7 @@ void RegisterNodeSignals(CNodeSignals& nodeSignals)
     nodeSignals.SendMessages.connect(&SendMessages);
     nodeSignals.InitializeNode.connect(&InitializeNode);
     nodeSignals.FinalizeNode.connect(&FinalizeNode);
+    nodeSignals.ExpireDandelionEmbargoes.connect(&CheckDandelionEmbargoes);
 }
 
 void UnregisterNodeSignals(CNodeSignals& nodeSignals)
@@ -758,6 +764,7 @@ void UnregisterNodeSignals(CNodeSignals& nodeSignals)
     nodeSignals.SendMessages.disconnect(&SendMessages);
     nodeSignals.InitializeNode.disconnect(&InitializeNode);
     nodeSignals.FinalizeNode.disconnect(&FinalizeNode);
+    nodeSignals.ExpireDandelionEmbargoes.disconnect(&CheckDandelionEmbargoes);
 }
 
 CBlockIndex* FindForkInGlobalIndex(const CChain& chain, const CBlockLocator& locator)
@@ -1274,7 +1281,7 @@ bool RemoveBLSCTConflicting(CTxMemPool& pool, const CTxIn& txin)
 }
 
 bool AcceptToMemoryPoolWorker(CTxMemPool& pool, CCriticalSection *mpcs, CCriticalSection *spcs, CValidationState& state, const CTransaction& tx, bool fLimitFree,
-                              bool* pfMissingInputs, bool fOverrideMempoolLimit, const CAmount& nAbsurdFee,
+                              bool* pfMissingInputs, int64_t nAcceptTime, bool fOverrideMempoolLimit, const CAmount& nAbsurdFee,
                               std::vector<uint256>& vHashTxnToUncache)
 {
     const uint256 hash = tx.GetHash();
@@ -1620,7 +1627,7 @@ bool AcceptToMemoryPoolWorker(CTxMemPool& pool, CCriticalSection *mpcs, CCritica
             }
         }
 
-        CTxMemPoolEntry entry(tx, nFees, GetTime(), dPriority, chainActive.Height(), pool.HasNoInputsOf(tx), inChainInputValue, fSpendsCoinbase, nSigOpsCost, lp);
+        CTxMemPoolEntry entry(tx, nFees, nAcceptTime, dPriority, chainActive.Height(), pool.HasNoInputsOf(tx), inChainInputValue, fSpendsCoinbase, nSigOpsCost, lp);
         unsigned int nSize = entry.GetTxSize();
 
         // Check that the transaction doesn't have an excessive number of
@@ -1894,11 +1901,11 @@ bool AcceptToMemoryPoolWorker(CTxMemPool& pool, CCriticalSection *mpcs, CCritica
     return true;
 }
 
-bool AcceptToMemoryPool(CTxMemPool& pool, CCriticalSection *mpcs, CCriticalSection *spcs, CValidationState &state, const CTransaction &tx, bool fLimitFree,
-                        bool* pfMissingInputs, bool fOverrideMempoolLimit, const CAmount nAbsurdFee)
+bool AcceptToMemoryPoolWithTime(CTxMemPool& pool, CCriticalSection *mpcs, CCriticalSection *spcs, CValidationState &state, const CTransaction &tx, bool fLimitFree,
+                                bool* pfMissingInputs, int64_t nAcceptTime, bool fOverrideMempoolLimit, const CAmount nAbsurdFee)
 {
     std::vector<uint256> vHashTxToUncache;
-    bool res = AcceptToMemoryPoolWorker(pool, mpcs, spcs, state, tx, fLimitFree, pfMissingInputs, fOverrideMempoolLimit, nAbsurdFee, vHashTxToUncache);
+    bool res = AcceptToMemoryPoolWorker(pool, mpcs, spcs, state, tx, fLimitFree, pfMissingInputs, nAcceptTime, fOverrideMempoolLimit, nAbsurdFee, vHashTxToUncache);
     if (res)
         LogPrintf("%s: Successfully added txn %s to %s.\n", __func__, tx.ToString(), (&pool == &mempool) ? "mempool" : "stempool");
     else
@@ -1910,6 +1917,258 @@ bool AcceptToMemoryPool(CTxMemPool& pool, CCriticalSection *mpcs, CCriticalSecti
     return res;
 }
 
+bool AcceptToMemoryPool(CTxMemPool& pool, CCriticalSection *mpcs, CCriticalSection *spcs, CValidationState &state, const CTransaction &tx, bool fLimitFree,
+                        bool* pfMissingInputs, bool fOverrideMempoolLimit, const CAmount nAbsurdFee)
+{
+    return AcceptToMemoryPoolWithTime(pool, mpcs, spcs, state, tx, fLimitFree, pfMissingInputs, GetTime(), fOverrideMempoolLimit, nAbsurdFee);
+}
+
+static const uint64_t MEMPOOL_DUMP_VERSION = 1;
+
+static CCriticalSection cs_mempoolDump;
+
+/**
+ * Verifies the range proofs and signatures of the BLSCT transactions of a dump in one
+ * batch, before they are accepted one by one, and caches the results so
+ * AcceptToMemoryPool doesn't verify them again. The transactions are in dependency
+ * order, so their outputs are added to the view as they are prepared.
+ */
+static void VerifyMempoolDumpBLSCT(const std::vector<CTransaction>& vtx)
+{
+    std::vector<BLSCTVerificationData> vBatch;
+    std::vector<std::vector<RangeproofEncodedData>> vData;
+    std::vector<uint256> vCacheEntries;
+
+    // The recovered data is written through pointers to the elements of vData
+    vBatch.reserve(vtx.size());
+    vData.reserve(vtx.size());
+
+    blsctKey v;
+    bool fHaveViewKey = pwalletMain && pwalletMain->GetBLSCTViewKey(v);
+
+    if (!fHaveViewKey)
+        v = blsctKey(Scalar::Rand().GetPrivateKey());
+
+    {
+        LOCK(cs_main);
+        CStateViewCache view(pcoinsTip);
+
+        for (const CTransaction& tx: vtx)
+        {
+            if (!view.HaveInputs(tx))
+                continue;
+
+            if (tx.IsBLSCT())
+            {
+                CValidationState state;
+                bool fPrepared = false;
+
+                vData.push_back(std::vector<RangeproofEncodedData>());
+                vBatch.push_back(BLSCTVerificationData());
+
+                try
+                {
+                    fPrepared = PrepareBLSCTVerification(tx, v.GetKey(), vData.back(), view, state, vBatch.back(), false, 0, true);
+                }
+                catch(...)
+                {
+                }
+
+                if (fPrepared)
+                {
+                    vCacheEntries.push_back(GetBLSCTCacheEntry(tx.GetHash(), 0, fHaveViewKey ? v.GetKey().Serialize() : std::vector<unsigned char>()));
+                }
+                else
+                {
+                    vBatch.pop_back();
+                    vData.pop_back();
+                }
+            }
+
+            UpdateCoins(tx, view, MEMPOOL_HEIGHT);
+        }
+    }
+
+    if (vBatch.empty())
+        return;
+
+    int64_t nStart = GetTimeMicros();
+    CValidationState state;
+    uint256 hashFailed;
+
+    // A failure leaves every transaction to be verified on its own when it is accepted
+    if (!VerifyBLSCTBatch(vBatch, state, hashFailed))
+    {
+        LogPrintf("%s: BLSCT transaction %s of the dump is invalid (%s)\n", __func__, hashFailed.ToString(), FormatStateMessage(state));
+        return;
+    }
+
+    for (unsigned int i = 0; i < vBatch.size(); i++)
+        SetCachedBLSCTVerification(vCacheEntries[i], vData[i]);
+
+    LogPrint("bench", "    - Verify %u BLSCT transactions of the mempool dump: %.2fms\n", vBatch.size(), 0.001 * (GetTimeMicros() - nStart));
+}
+
+bool LoadMempool()
+{
+    int64_t nExpiryTimeout = GetArg("-mempoolexpiry", DEFAULT_MEMPOOL_EXPIRY) * 60 * 60;
+    FILE* filestr = fopen((GetDataDir() / "mempool.dat").string().c_str(), "rb");
+    CAutoFile file(filestr, SER_DISK, CLIENT_VERSION);
+    if (file.IsNull()) {
+        LogPrintf("Failed to open mempool file from disk. Continuing anyway.\n");
+        return false;
+    }
+
+    std::map<uint256, std::pair<double, CAmount> > mapDeltas;
+    std::vector<CTransaction> vtx;
+    std::vector<int64_t> vTime;
+    std::vector<bool> vStem;
+    int64_t nExpired = 0;
+
+    try {
+        uint64_t nVersion;
+        file >> nVersion;
+        if (nVersion != MEMPOOL_DUMP_VERSION)
+            return error("%s: unknown mempool dump version %d", __func__, nVersion);
+
+        file >> mapDeltas;
+
+        uint64_t nEntries;
+        file >> nEntries;
+
+        int64_t nNow = GetTime();
+
+        while (nEntries--) {
+            CTransaction tx;
+            int64_t nTime;
+            bool fStem;
+            file >> tx;
+            file >> nTime;
+            file >> fStem;
+
+            // Dropped the same way Expire would have once they were accepted
+            if (nTime + nExpiryTimeout <= nNow) {
+                ++nExpired;
+                continue;
+            }
+
+            vtx.push_back(tx);
+            vTime.push_back(nTime);
+            vStem.push_back(fStem);
+        }
+    } catch (const std::exception& e) {
+        LogPrintf("Failed to deserialize mempool data on disk: %s. Continuing anyway.\n", e.what());
+        return false;
+    }
+
+    // Prioritised before they are accepted, so the deltas count towards the fee checks
+    for (auto& it: mapDeltas) {
+        mempool.PrioritiseTransaction(it.first, it.first.ToString(), it.second.first, it.second.second);
+        // Changes to mempool should also be made to Dandelion stempool
+        stempool.PrioritiseTransaction(it.first, it.first.ToString(), it.second.first, it.second.second);
+    }
+
+    VerifyMempoolDumpBLSCT(vtx);
+
+    int64_t nAccepted = 0, nFailed = 0;
+
+    for (unsigned int i = 0; i < vtx.size(); i++) {
+        const CTransaction& tx = vtx[i];
+        CValidationState state;
+        bool fAccepted;
+
+        LOCK(cs_main);
+
+        if (vStem[i]) {
+            // The stem route is gone, the embargo fluffs the transaction if no peer does
+            fAccepted = AcceptToMemoryPoolWithTime(stempool, &mempool.cs, &stempool.cs, state, tx, true, nullptr, vTime[i]);
+            if (fAccepted) {
+                int64_t nCurrTime = GetTimeMicros();
+                InsertDandelionEmbargo(tx.GetHash(), 1000000*DANDELION_EMBARGO_MINIMUM+PoissonNextSend(nCurrTime, DANDELION_EMBARGO_AVG_ADD));
+            }
+        } else {
+            fAccepted = AcceptToMemoryPoolWithTime(mempool, &mempool.cs, &stempool.cs, state, tx, true, nullptr, vTime[i]);
+            if (fAccepted) {
+                // Changes to mempool should also be made to Dandelion stempool
+                CValidationState dummyState;
+                AcceptToMemoryPoolWithTime(stempool, &mempool.cs, &stempool.cs, dummyState, tx, true, nullptr, vTime[i]);
+            }
+        }
+
+        if (fAccepted)
+            ++nAccepted;
+        else
+            ++nFailed;
+
+        if (ShutdownRequested())
+            return false;
+    }
+
+    LogPrintf("Imported mempool transactions from disk: %i successes, %i failed, %i expired\n", nAccepted, nFailed, nExpired);
+    return true;
+}
+
+bool DumpMempool()
+{
+    int64_t nStart = GetTimeMicros();
+
+    std::map<uint256, std::pair<double, CAmount> > mapDeltas;
+    std::vector<TxMempoolInfo> vInfo;
+    std::vector<TxMempoolInfo> vStemInfo;
+
+    {
+        LOCK2(mempool.cs, stempool.cs);
+        mapDeltas = mempool.mapDeltas;
+        vInfo = mempool.infoAll();
+        for (const TxMempoolInfo& info: stempool.infoAll())
+            if (!mempool.exists(info.tx->GetHash()))
+                vStemInfo.push_back(info);
+    }
+
+    LOCK(cs_mempoolDump);
+
+    int64_t nMid = GetTimeMicros();
+
+    try {
+        FILE* filestr = fopen((GetDataDir() / "mempool.dat.new").string().c_str(), "wb");
+        if (!filestr)
+            return false;
+
+        CAutoFile file(filestr, SER_DISK, CLIENT_VERSION);
+
+        uint64_t nVersion = MEMPOOL_DUMP_VERSION;
+        file << nVersion;
+
+        file << mapDeltas;
+
+        uint64_t nEntries = vInfo.size() + vStemInfo.size();
+        file << nEntries;
+
+        for (const TxMempoolInfo& info: vInfo) {
+            file << *(info.tx);
+            file << info.nTime;
+            file << false;
+        }
+
+        for (const TxMempoolInfo& info: vStemInfo) {
+            file << *(info.tx);
+            file << info.nTime;
+            file << true;
+        }
+
+        FileCommit(file.Get());
+        file.fclose();
+        RenameOver(GetDataDir() / "mempool.dat.new", GetDataDir() / "mempool.dat");
+        int64_t nLast = GetTimeMicros();
+        LogPrintf("Dumped mempool: %gs to copy, %gs to dump\n", (nMid-nStart)*0.000001, (nLast-nMid)*0.000001);
+    } catch (const std::exception& e) {
+        LogPrintf("Failed to dump mempool: %s. Continuing anyway.\n", e.what());
+        return false;
+    }
+
+    return true;
+}
+
 bool GetTimestampIndex(const unsigned int &high, const unsigned int &low, const bool fActiveOnly, std::vector<std::pair<uint256, unsigned int> > &hashes)
 {
     if (!fTimestampIndex)
@@ -2073,22 +2332,30 @@ bool WriteBlockToDisk(const CBlock& block, CDiskBlockPos& pos, const CMessageHea
         return error("WriteBlockToDisk: ftell failed");
     pos.nPos = (unsigned int)fileOutPos;
     fileout << block;
+    fileout.fclose();
+
+    // What the reader read ahead where this block was written is stale
+    blockFileReader.Invalidate(pos, nSize);
 
     return true;
 }
 
+bool ReadRawBlockFromDisk(std::vector<char>& vchBlock, const CDiskBlockPos& pos)
+{
+    return blockFileReader.ReadRawBlock(pos, Params().MessageStart(), vchBlock);
+}
+
 bool ReadBlockFromDisk(CBlock& block, const CDiskBlockPos& pos, const Consensus::Params& consensusParams)
 {
     block.SetNull();
 
-    // Open history file to read
-    CAutoFile filein(OpenBlockFile(pos, true), SER_DISK, CLIENT_VERSION);
-    if (filein.IsNull())
-        return error("ReadBlockFromDisk: OpenBlockFile failed for %s", pos.ToString());
+    std::vector<char> vchBlock;
+    if (!ReadRawBlockFromDisk(vchBlock, pos))
+        return error("ReadBlockFromDisk: could not read block at %s", pos.ToString());
 
-    // Read block
     try {
-        filein >> block;
+        CDataStream ssBlock(vchBlock, SER_DISK, CLIENT_VERSION);
+        ssBlock >> block;
     }
     catch (const std::exception& e) {
         return error("%s: Deserialize or I/O error - %s at %s", __func__, e.what(), pos.ToString());
@@ -2319,6 +2586,10 @@ void UpdateCoins(const CTransaction& tx, CStateViewCache& inputs, int nHeight)
     UpdateCoins(tx, inputs, txundo, nHeight);
 }
 
+bool CBLSCTCheck::operator()() {
+    return VerifyBLSCTBatch(*pvBatch, nBegin, nEnd, *pstate, *phashFailed);
+}
+
 bool CScriptCheck::operator()() {
     const CScript &scriptSig = ptxTo->vin[nIn].scriptSig;
     const CScriptWitness *witness = (nIn < ptxTo->wit.vtxinwit.size()) ? &ptxTo->wit.vtxinwit[nIn].scriptWitness : nullptr;
@@ -2337,7 +2608,7 @@ int GetSpendHeight(const CStateViewCache& inputs)
 }
 
 namespace Consensus {
-bool CheckTxInputs(const CTransaction& tx, CValidationState& state, const CStateViewCache& inputs, int nSpendHeight, std::vector<RangeproofEncodedData>& blsctData, CAmount allowedInPrivate = 0)
+bool CheckTxInputs(const CTransaction& tx, CValidationState& state, const CStateViewCache& inputs, int nSpendHeight, std::vector<RangeproofEncodedData>& blsctData, CAmount allowedInPrivate = 0, std::vector<BLSCTVerificationData> *pvBLSCTChecks = nullptr, bool cacheStore = false)
 {
     // This doesn't trigger the DoS code on purpose; if it did, it would make it easier
     // for an attacker to attempt to split the network.
@@ -2408,12 +2679,35 @@ bool CheckTxInputs(const CTransaction& tx, CValidationState& state, const CState
         try
         {
             blsctKey v;
+            bool fHaveViewKey = pwalletMain && pwalletMain->GetBLSCTViewKey(v);
 
-            if (!(pwalletMain && pwalletMain->GetBLSCTViewKey(v)))
-                v = blsctKey(bls::PrivateKey::FromBN(Scalar::Rand().bn));
+            if (!fHaveViewKey)
+                v = blsctKey(Scalar::Rand().GetPrivateKey());
 
-            if (!tx.IsCoinStake() && !VerifyBLSCT(tx, v.GetKey(), blsctData, inputs, state, false, allowedInPrivate))
-                return false;
+            if (!tx.IsCoinStake())
+            {
+                // Transactions verified when they were accepted to the mempool are not verified again
+                uint256 cacheEntry = GetBLSCTCacheEntry(tx.GetHash(), allowedInPrivate, fHaveViewKey ? v.GetKey().Serialize() : std::vector<unsigned char>());
+
+                if (!GetCachedBLSCTVerification(cacheEntry, blsctData, !cacheStore))
+                {
+                    if (pvBLSCTChecks)
+                    {
+                        // Range proofs and signatures are verified later in batches, on the BLSCT check threads
+                        pvBLSCTChecks->push_back(BLSCTVerificationData());
+                        if (!PrepareBLSCTVerification(tx, v.GetKey(), blsctData, inputs, state, pvBLSCTChecks->back(), false, allowedInPrivate, true))
+                            return false;
+                    }
+                    else
+                    {
+                        if (!VerifyBLSCT(tx, v.GetKey(), blsctData, inputs, state, false, allowedInPrivate))
+                            return false;
+
+                        if (cacheStore)
+                            SetCachedBLSCTVerification(cacheEntry, blsctData);
+                    }
+                }
+            }
         }
         catch(...)
         {
@@ -2427,11 +2721,11 @@ bool CheckTxInputs(const CTransaction& tx, CValidationState& state, const CState
 }
 }// namespace Consensus
 
-bool CheckInputs(const CTransaction& tx, CValidationState &state, const CStateViewCache &inputs, bool fScriptChecks, unsigned int flags, bool cacheStore, std::vector<RangeproofEncodedData>& blsctData, PrecomputedTransactionData& txdata, std::vector<CScriptCheck> *pvChecks, CAmount allowedInPrivate)
+bool CheckInputs(const CTransaction& tx, CValidationState &state, const CStateViewCache &inputs, bool fScriptChecks, unsigned int flags, bool cacheStore, std::vector<RangeproofEncodedData>& blsctData, PrecomputedTransactionData& txdata, std::vector<CScriptCheck> *pvChecks, CAmount allowedInPrivate, std::vector<BLSCTVerificationData> *pvBLSCTChecks)
 {
     if (!tx.IsCoinBase())
     {
-        if (!Consensus::CheckTxInputs(tx, state, inputs, GetSpendHeight(inputs), blsctData, allowedInPrivate))
+        if (!Consensus::CheckTxInputs(tx, state, inputs, GetSpendHeight(inputs), blsctData, allowedInPrivate, pvBLSCTChecks, cacheStore))
             return false;
 
         if (pvChecks)
@@ -3038,18 +3332,17 @@ bool DisconnectBlock(const CBlock& block, CValidationState& state, const CBlockI
 
     if (fStake && fVoteCacheState && fCFund && !(pindex->nNonce & 1 && !fStakerIsColdStakingv2))
     {
-        CVoteMap baseMap;
+        // Only the voters with votes recorded by this block have anything to clear
+        std::set<CVoteMapKey> setVoters;
 
-        if (!view.GetAllVotes(baseMap))
+        if (!view.GetVotersAtHeight(pindex->nHeight, setVoters))
             return AbortNode(state, "Failed to get voters list");
 
-        LogPrint("daoextra", "%s: Clearing votes at height %d\n", __func__, pindex->nHeight);
+        LogPrint("daoextra", "%s: Clearing votes of %u voters at height %d\n", __func__, setVoters.size(), pindex->nHeight);
 
-        for (auto&it: baseMap)
+        for (auto&it: setVoters)
         {
-            CVoteList pVoteList;
-            view.GetCachedVoter(it.first, pVoteList);
-            CVoteModifier mVote = view.ModifyVote(it.first, pindex->nHeight);
+            CVoteModifier mVote = view.ModifyVote(it, pindex->nHeight);
             mVote->Clear(pindex->nHeight);
             mVote->fDirty = true;
         }
@@ -3120,6 +3413,71 @@ void ThreadScriptCheck() {
     scriptcheckqueue.Thread();
 }
 
+static CCheckQueue<CBLSCTCheck> blsctcheckqueue(1);
+
+void ThreadBLSCTCheck() {
+    RenameThread("navcoin-blsctch");
+    blsctcheckqueue.Thread();
+}
+
+CBLSCTBlockChecks::CBLSCTBlockChecks() {}
+
+CBLSCTBlockChecks::~CBLSCTBlockChecks() {}
+
+void CBLSCTBlockChecks::Start(const std::vector<BLSCTVerificationData>& vChecks)
+{
+    size_t nBatches = std::min(vChecks.size(), (size_t)std::max(nScriptCheckThreads, 1));
+    vStates.assign(nBatches, CValidationState());
+    vFailed.assign(nBatches, uint256());
+    vBatches.clear();
+
+    for (size_t j = 0; j < nBatches; j++)
+        vBatches.push_back(CBLSCTCheck(vChecks, vChecks.size() * j / nBatches, vChecks.size() * (j + 1) / nBatches, &vStates[j], &vFailed[j]));
+
+    // Only take the queue when there is something for its workers to verify
+    if (nScriptCheckThreads && !vBatches.empty())
+    {
+        pcontrol.reset(new CCheckQueueControl<CBLSCTCheck>(&blsctcheckqueue));
+        pcontrol->Add(vBatches);
+    }
+}
+
+bool CBLSCTBlockChecks::Wait(CValidationState& state, uint256& hashFailed)
+{
+    bool fValid = true;
+
+    if (pcontrol)
+    {
+        fValid = pcontrol->Wait();
+        pcontrol.reset();
+    }
+    else
+    {
+        for (CBLSCTCheck& check: vBatches)
+        {
+            fValid = check();
+            if (!fValid)
+                break;
+        }
+    }
+
+    if (fValid)
+        return true;
+
+    for (size_t j = 0; j < vStates.size(); j++)
+    {
+        if (!vStates[j].IsValid())
+        {
+            state = vStates[j];
+            hashFailed = vFailed[j];
+            return false;
+        }
+    }
+
+    hashFailed.SetNull();
+    return state.DoS(100, false, REJECT_INVALID, "invalid-blsct");
+}
+
 // Protected by cs_main
 VersionBitsCache versionbitscache;
 
@@ -3641,6 +3999,8 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
     std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> > spentIndex;
 
     CCheckQueueControl<CScriptCheck> control(fScriptChecks && nScriptCheckThreads ? &scriptcheckqueue : nullptr);
+    std::vector<BLSCTVerificationData> vBLSCTChecks;
+    CBLSCTBlockChecks blsctchecks;
     std::vector<PrecomputedTransactionData> txdata;
     txdata.reserve(block.vtx.size()); // Required so that pointers to individual PrecomputedTransactionData don't get invalidated
 
@@ -4124,7 +4484,7 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
             if (tx.IsCoinStake())
             {
                 nStakeReward = tx.GetValueOut() - view.GetValueIn(tx);
-                pindex->strDZeel = tx.strDZeel;
+                pindex->SetDZeel(tx.strDZeel);
 
                 if(IsCommunityFundAccumulationEnabled(pindex->pprev, Params().GetConsensus(), false))
                 {
@@ -4163,7 +4523,7 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
             std::vector<CScriptCheck> vChecks;
             std::vector<RangeproofEncodedData> dummyData;
             bool fCacheResults = fJustCheck; /* Don't cache results if we're actually connecting blocks (still consult the cache, though) */
-            if (!CheckInputs(tx, state, view, fScriptChecks, flags, fCacheResults, tx.IsCTOutput()?blsctData[i]:dummyData, txdata[i], nScriptCheckThreads ? &vChecks : nullptr))
+            if (!CheckInputs(tx, state, view, fScriptChecks, flags, fCacheResults, tx.IsCTOutput()?blsctData[i]:dummyData, txdata[i], nScriptCheckThreads ? &vChecks : nullptr, 0, &vBLSCTChecks))
                 return error("ConnectBlock(): CheckInputs on %s failed with %s",
                              tx.GetHash().ToString(), FormatStateMessage(state));
             control.Add(vChecks);
@@ -4636,7 +4996,7 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
                 if (pwalletMain)
                     pwalletMain->GetBLSCTViewKey(v);
                 else
-                    v = blsctKey(bls::PrivateKey::FromBN(Scalar::Rand().bn));
+                    v = blsctKey(Scalar::Rand().GetPrivateKey());
 
                 CTransaction tx = block.vtx[1];
 
@@ -4659,9 +5019,18 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
     if (pindex->nPrivateMoneySupply < 0)
         return state.DoS(100, error("ConnectBlock() : private money supply goes in negative"));
 
+    // The private transactions are verified on the BLSCT check queue while the
+    // master thread joins the script checks
+    blsctchecks.Start(vBLSCTChecks);
+
     if (!control.Wait()) {
         return state.DoS(100, false);
     }
+
+    uint256 hashBLSCTFailed;
+    if (!blsctchecks.Wait(state, hashBLSCTFailed))
+        return error("ConnectBlock(): BLSCT verification of %s failed with %s",
+                     hashBLSCTFailed.ToString(), FormatStateMessage(state));
     int64_t nTime44 = GetTimeMicros(); nTimeVerify += nTime44 - nTime2;
     LogPrint("bench", "    - Verify %u txins: %.2fms (%.3fms/txin) [%.2fs]\n", nInputs - 1, 0.001 * (nTime44 - nTime2), nInputs <= 1 ? 0 : 0.001 * (nTime44 - nTime2) / (nInputs-1), nTimeVerify * 0.000001);
 
@@ -4933,8 +5302,9 @@ void static UpdateTip(CBlockIndex *pindexNew, uint256 statehash, const CChainPar
         for (int i = 0; i < 1000 && pindex != nullptr; i++)
         {
             int32_t nExpectedVersion = CLIENT_VERSION;
-            if (atoi(pindex->strDZeel.substr(pindex->strDZeel.find(";") + 1).c_str()) > nExpectedVersion
-                    && pindex->strDZeel.find(';') != std::string::npos)
+            const std::string& strDZeel = pindex->GetDZeel();
+            if (atoi(strDZeel.substr(strDZeel.find(";") + 1).c_str()) > nExpectedVersion
+                    && strDZeel.find(';') != std::string::npos)
                 ++nUpgraded;
             pindex = pindex->pprev;
         }
@@ -5453,17 +5823,17 @@ bool ResetBlockFailureFlags(CBlockIndex *pindex) {
     return true;
 }
 
-CBlockIndex* AddToBlockIndex(const CBlockHeader& block)
+CBlockIndex* AddToBlockIndex(const CBlockHeader& block, const uint256* phash = nullptr)
 {
     // Check for duplicate
-    uint256 hash = block.GetHash();
+    uint256 hash = phash ? *phash : block.GetHash();
     BlockMap::iterator it = mapBlockIndex.find(hash);
     if (it != mapBlockIndex.end())
         return it->second;
 
     // Construct new block index object
-    CBlockIndex* pindexNew = new CBlockIndex(block);
-    assert(pindexNew);
+    CBlockIndex* pindexNew = blockIndexArena.Allocate();
+    *pindexNew = CBlockIndex(block);
     // We assign the sequence id to blocks only when the full data is available,
     // to avoid miners withholding blocks but broadcasting headers, to get a
     // competitive advantage.
@@ -5630,12 +6000,12 @@ bool FindUndoPos(CValidationState &state, int nFile, CDiskBlockPos &pos, unsigne
     return true;
 }
 
-bool CheckBlockHeader(const CBlockHeader& block, CValidationState& state, const Consensus::Params& consensusParams, bool fCheckPOW)
+bool CheckBlockHeader(const CBlockHeader& block, CValidationState& state, const Consensus::Params& consensusParams, bool fCheckPOW, const uint256* phash)
 {
     // Check proof of work matches claimed amount
     CBlockIndex pblock = CBlockIndex(block);
     if (pblock.IsProofOfWork())
-        if (!CheckProofOfWork(block.GetHash(), block.nBits, consensusParams))
+        if (!CheckProofOfWork(phash ? *phash : block.GetHash(), block.nBits, consensusParams))
             return state.DoS(50, false, REJECT_INVALID, "high-hash", false, "proof of work failed");
 
     return true;
@@ -6158,11 +6528,11 @@ bool ContextualCheckBlock(const CBlock& block, CValidationState& state, CBlockIn
     return true;
 }
 
-static bool AcceptBlockHeader(const CBlockHeader& block, CValidationState& state, const CChainParams& chainparams, CBlockIndex** ppindex=NULL)
+static bool AcceptBlockHeader(const CBlockHeader& block, CValidationState& state, const CChainParams& chainparams, CBlockIndex** ppindex=NULL, const uint256* phash=NULL)
 {
     AssertLockHeld(cs_main);
     // Check for duplicate
-    uint256 hash = block.GetHash();
+    uint256 hash = phash ? *phash : block.GetHash();
     BlockMap::iterator miSelf = mapBlockIndex.find(hash);
     CBlockIndex *pindex = nullptr;
     if (hash != chainparams.GetConsensus().hashGenesisBlock) {
@@ -6177,7 +6547,7 @@ static bool AcceptBlockHeader(const CBlockHeader& block, CValidationState& state
             return true;
         }
 
-        if (!CheckBlockHeader(block, state, chainparams.GetConsensus(), false))
+        if (!CheckBlockHeader(block, state, chainparams.GetConsensus(), false, &hash))
             return error("%s: Consensus::CheckBlockHeader: %s, %s", __func__, hash.ToString(), FormatStateMessage(state));
 
         // Get prev block index
@@ -6199,7 +6569,7 @@ static bool AcceptBlockHeader(const CBlockHeader& block, CValidationState& state
     }
 
     if (pindex == nullptr)
-        pindex = AddToBlockIndex(block);
+        pindex = AddToBlockIndex(block, &hash);
 
     if (ppindex)
         *ppindex = pindex;
@@ -6397,6 +6767,7 @@ void UnlinkPrunedFiles(std::set<int>& setFilesToPrune)
 {
     for (set<int>::iterator it = setFilesToPrune.begin(); it != setFilesToPrune.end(); ++it) {
         CDiskBlockPos pos(*it, 0);
+        blockFileReader.Invalidate(*it);
         boost::filesystem::remove(GetBlockPosFilename(pos, "blk"));
         boost::filesystem::remove(GetBlockPosFilename(pos, "rev"));
         LogPrintf("Prune: %s deleted blk/rev (%05u)\n", __func__, *it);
@@ -6509,9 +6880,7 @@ CBlockIndex * InsertBlockIndex(uint256 hash)
         return (*mi).second;
 
     // Create new
-    CBlockIndex* pindexNew = new CBlockIndex();
-    if (!pindexNew)
-        throw runtime_error("LoadBlockIndex(): new CBlockIndex failed");
+    CBlockIndex* pindexNew = blockIndexArena.Allocate();
     mi = mapBlockIndex.insert(make_pair(hash, pindexNew)).first;
     pindexNew->phashBlock = &((*mi).first);
 
@@ -6520,37 +6889,49 @@ CBlockIndex * InsertBlockIndex(uint256 hash)
 
 bool static LoadBlockIndexDB()
 {
+    int64_t nTimeStart = GetTimeMicros();
+
     uiInterface.InitMessage(_("Loading block guts..."));
     const CChainParams& chainparams = Params();
-    if (!pblocktree->LoadBlockIndexGuts(InsertBlockIndex, InsertProposalVotes, InsertPaymentRequestVotes, InsertSupport, InsertConsultationVotes))
+    if (!pblocktree->LoadBlockIndexGuts(InsertBlockIndex))
         return false;
+    LogPrintf("%s: %u block index entries using %.1fMiB\n", __func__, mapBlockIndex.size(),
+              blockIndexArena.DynamicMemoryUsage() * (1.0 / (1 << 20)));
 
     boost::this_thread::interruption_point();
 
+    int64_t nTimeGuts = GetTimeMicros();
+
     uiInterface.InitMessage(_("Loading block index..."));
 
     int nMapBlockInc = 0;
 
-    // Calculate nChainWork
-    vector<pair<int, CBlockIndex*> > vSortedByHeight;
-    vSortedByHeight.reserve(mapBlockIndex.size());
+    // Order the entries by height. Heights are dense, so they are counted in buckets instead of sorted
+    int nMaxHeight = 0;
+    for(const PAIRTYPE(uint256, CBlockIndex*)& item: mapBlockIndex)
+        nMaxHeight = std::max(nMaxHeight, item.second->nHeight);
+    vector<size_t> vHeightOffset(nMaxHeight + 2, 0);
+    for(const PAIRTYPE(uint256, CBlockIndex*)& item: mapBlockIndex)
+        vHeightOffset[item.second->nHeight + 1]++;
+    for (int nHeight = 0; nHeight <= nMaxHeight; nHeight++)
+        vHeightOffset[nHeight + 1] += vHeightOffset[nHeight];
+    vector<CBlockIndex*> vSortedByHeight(mapBlockIndex.size());
     for(const PAIRTYPE(uint256, CBlockIndex*)& item: mapBlockIndex)
     {
         if (++nMapBlockInc % PROGRESS_INTERVAL == 0) {
             // Update the progress
             uiInterface.ShowProgress(_("Loading block index..."),  (int)((float) nMapBlockInc / (float) mapBlockIndex.size() * 50));
         }
-        CBlockIndex* pindex = item.second;
-        vSortedByHeight.push_back(make_pair(pindex->nHeight, pindex));
+        vSortedByHeight[vHeightOffset[item.second->nHeight]++] = item.second;
     }
-    sort(vSortedByHeight.begin(), vSortedByHeight.end());
-    for(const PAIRTYPE(int, CBlockIndex*)& item: vSortedByHeight)
+
+    // Calculate nChainWork, and link the skip list, parents first
+    for(CBlockIndex* pindex: vSortedByHeight)
     {
         if (++nMapBlockInc % PROGRESS_INTERVAL == 0) {
             // Update the progress
             uiInterface.ShowProgress(_("Loading block index..."),  (int)((float) nMapBlockInc / (float) vSortedByHeight.size() * 50));
         }
-        CBlockIndex* pindex = item.second;
         pindex->nChainWork = (pindex->pprev ? pindex->pprev->nChainWork : 0) + GetBlockProof(*pindex);
         // We can link the chain of blocks for which we've received transactions at some point.
         // Pruned nodes may have deleted the block.
@@ -6576,6 +6957,8 @@ bool static LoadBlockIndexDB()
             pindexBestHeader = pindex;
     }
 
+    int64_t nTimeChain = GetTimeMicros();
+
     // Load block file info
     pblocktree->ReadLastBlockFile(nLastBlockFile);
     vinfoBlockFile.resize(nLastBlockFile + 1);
@@ -6637,6 +7020,11 @@ bool static LoadBlockIndexDB()
     pblocktree->ReadFlag("spentindex", fSpentIndex);
     LogPrintf("%s: spent index %s\n", __func__, fSpentIndex ? "enabled" : "disabled");
 
+    int64_t nTimeEnd = GetTimeMicros();
+    LogPrintf("%s: loaded in %.2fs: guts %.2fs, chain work %.2fs, block files %.2fs\n", __func__,
+              (nTimeEnd - nTimeStart) * 0.000001, (nTimeGuts - nTimeStart) * 0.000001,
+              (nTimeChain - nTimeGuts) * 0.000001, (nTimeEnd - nTimeChain) * 0.000001);
+
     // Load pointer to end of best chain
     BlockMap::iterator it = mapBlockIndex.find(pcoinsTip->GetBestBlock());
     if (it == mapBlockIndex.end())
@@ -7020,10 +7408,12 @@ void UnloadBlockIndex()
         warningcache[b].clear();
     }
 
-    for(BlockMap::value_type& entry: mapBlockIndex) {
-        delete entry.second;
-    }
     mapBlockIndex.clear();
+    blockIndexArena.Clear();
+    vProposalVotes.clear();
+    vPaymentRequestVotes.clear();
+    mapSupport.clear();
+    mapConsultationVotes.clear();
     fHavePruned = false;
 }
 
@@ -7535,6 +7925,56 @@ bool static AlreadyHave(const CInv& inv) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
     return true;
 }
 
+/**
+ * Gets a block to relay to a peer as serialized on disk, from the recently served blocks or from
+ * disk. It is also deserialized into block when fNeedBlock, or when the bytes can't be relayed as
+ * they are because the peer doesn't take witnesses.
+ */
+static std::shared_ptr<const CRawBlock> GetBlockToServe(const CBlockIndex* pindex, bool fWitness, bool fNeedBlock, CBlock& block)
+{
+    const uint256 hash = pindex->GetBlockHash();
+    std::shared_ptr<const CRawBlock> pcached = rawBlockCache.Get(hash);
+    std::shared_ptr<CRawBlock> pread;
+    const CRawBlock* praw = pcached.get();
+
+    if (!pcached)
+    {
+        pread = std::make_shared<CRawBlock>();
+        if (!ReadRawBlockFromDisk(pread->vchBlock, pindex->GetBlockPos()))
+            return std::shared_ptr<const CRawBlock>();
+        praw = pread.get();
+    }
+
+    if (fNeedBlock || !(fWitness || praw->IsWitnessFree()))
+    {
+        try {
+            CDataStream ssBlock(praw->vchBlock, SER_DISK, CLIENT_VERSION);
+            ssBlock >> block;
+        }
+        catch (const std::exception& e) {
+            error("%s: Deserialize error - %s at %s", __func__, e.what(), pindex->GetBlockPos().ToString());
+            return std::shared_ptr<const CRawBlock>();
+        }
+
+        if (!praw->fWitnessKnown)
+        {
+            if (!pread)
+                pread = std::make_shared<CRawBlock>(*pcached);
+            pread->fWitnessKnown = true;
+            for (const CTransaction& tx: block.vtx)
+                pread->fHasWitness |= !tx.wit.IsNull();
+        }
+    }
+
+    if (pread)
+    {
+        rawBlockCache.Insert(hash, pread);
+        return pread;
+    }
+
+    return pcached;
+}
+
 void static ProcessGetData(CNode* pfrom, const Consensus::Params& consensusParams)
 {
     std::deque<CInv>::iterator it = pfrom->vRecvGetData.begin();
@@ -7589,14 +8029,22 @@ void static ProcessGetData(CNode* pfrom, const Consensus::Params& consensusParam
                 // it's available before trying to send.
                 if (send && (mi->second->nStatus & BLOCK_HAVE_DATA))
                 {
-                    // Send block from disk
+                    // Send block from disk, or from the recently served blocks. The bytes are relayed as
+                    // stored when the peer takes witnesses or the block has none.
                     CBlock block;
-                    if (!ReadBlockFromDisk(block, (*mi).second, consensusParams))
+                    std::shared_ptr<const CRawBlock> prawblock = GetBlockToServe((*mi).second, inv.type == MSG_WITNESS_BLOCK, inv.type == MSG_FILTERED_BLOCK, block);
+                    if (!prawblock)
                         assert(!"cannot load block from disk");
-                    if (inv.type == MSG_BLOCK)
-                        pfrom->PushMessageWithFlag(SERIALIZE_TRANSACTION_NO_WITNESS, NetMsgType::BLOCK, block);
-                    else if (inv.type == MSG_WITNESS_BLOCK)
-                        pfrom->PushMessage(NetMsgType::BLOCK, block);
+                    bool fRaw = inv.type == MSG_WITNESS_BLOCK || prawblock->IsWitnessFree();
+                    const std::vector<char>& vchBlock = prawblock->vchBlock;
+                    CFlatData rawBlock((void*)vchBlock.data(), (void*)(vchBlock.data() + vchBlock.size()));
+                    if (inv.type == MSG_BLOCK || inv.type == MSG_WITNESS_BLOCK)
+                    {
+                        if (fRaw)
+                            pfrom->PushMessage(NetMsgType::BLOCK, rawBlock);
+                        else
+                            pfrom->PushMessageWithFlag(SERIALIZE_TRANSACTION_NO_WITNESS, NetMsgType::BLOCK, block);
+                    }
                     else if (inv.type == MSG_FILTERED_BLOCK)
                     {
                         LOCK(pfrom->cs_filter);
@@ -7627,6 +8075,9 @@ void static ProcessGetData(CNode* pfrom, const Consensus::Params& consensusParam
 //                            CBlockHeaderAndShortTxIDs cmpctblock(block);
 //                            pfrom->PushMessageWithFlag(SERIALIZE_TRANSACTION_NO_WITNESS, NetMsgType::CMPCTBLOCK, cmpctblock);
 //                        } else
+                        if (fRaw)
+                            pfrom->PushMessage(NetMsgType::BLOCK, rawBlock);
+                        else
                             pfrom->PushMessageWithFlag(SERIALIZE_TRANSACTION_NO_WITNESS, NetMsgType::BLOCK, block);
                     }
 
@@ -7832,11 +8283,6 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
         }
     }
 
-    {
-        LOCK(cs_main);
-        CheckDandelionEmbargoes();
-    }
-
     if (strCommand == NetMsgType::VERSION)
     {
         // Each connection can only send one version message
@@ -8891,6 +9337,10 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
             //ReadCompactSize(vRecv); // ignore tx count; assume it is 0.
         }
 
+        // Hash the whole batch up front, outside of cs_main
+        std::vector<uint256> vHashes;
+        GetBlockHeaderHashes(headers, vHashes);
+
         {
         LOCK(cs_main);
 
@@ -8913,14 +9363,14 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
             nodestate->nUnconnectingHeaders++;
             pfrom->PushMessage(NetMsgType::GETHEADERS, chainActive.GetLocator(pindexBestHeader), uint256());
             LogPrint("net", "received header %s: missing prev block %s, sending getheaders (%d) to end (peer=%d, nUnconnectingHeaders=%d)\n",
-                    headers[0].GetHash().ToString(),
+                    vHashes[0].ToString(),
                     headers[0].hashPrevBlock.ToString(),
                     pindexBestHeader->nHeight,
                     pfrom->id, nodestate->nUnconnectingHeaders);
             // Set hashLastUnknownBlock for this peer, so that if we
             // eventually get the headers - even from a different peer -
             // we can use this peer to download.
-            UpdateBlockAvailability(pfrom->GetId(), headers.back().GetHash());
+            UpdateBlockAvailability(pfrom->GetId(), vHashes.back());
 
             if (nodestate->nUnconnectingHeaders % MAX_UNCONNECTING_HEADERS == 0) {
                 Misbehaving(pfrom->GetId(), 20);
@@ -8940,7 +9390,8 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
 
         std::vector<uint256> vHeaderHashes;
 
-        for(const CBlock& header: headers) {
+        for(unsigned int n = 0; n < headers.size(); n++) {
+            const CBlock& header = headers[n];
             CValidationState state;
             if (pindexLast != NULL && header.hashPrevBlock != pindexLast->GetBlockHash()) {
                 Misbehaving(pfrom->GetId(), 20);
@@ -8949,7 +9400,7 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
                 break;
             }
             CBlockHeader pblockheader = CBlockHeader(header);
-            if (!AcceptBlockHeader(pblockheader, state, chainparams, &pindexLast)) {
+            if (!AcceptBlockHeader(pblockheader, state, chainparams, &pindexLast, &vHashes[n])) {
                 int nDoS;
                 if (state.IsInvalid(nDoS)) {
                     if (nDoS > 0)
@@ -8959,7 +9410,7 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
                     break;
                 }
             }
-            vHeaderHashes.push_back(pblockheader.GetHash());
+            vHeaderHashes.push_back(vHashes[n]);
             if (pindexLast) {
                 nLast = pindexLast->nHeight;
                 if (bFirst){
@@ -10065,10 +10516,8 @@ public:
     CMainCleanup() {}
     ~CMainCleanup() {
         // block headers
-        BlockMap::iterator it1 = mapBlockIndex.begin();
-        for (; it1 != mapBlockIndex.end(); it1++)
-            delete (*it1).second;
         mapBlockIndex.clear();
+        blockIndexArena.Clear();
 
         // orphan transactions
         mapOrphanTransactions.clear();
@@ -10391,10 +10840,10 @@ static bool CheckStakeKernelHashV2(CBlockIndex* pindexPrev, unsigned int nBits,
     int nStakeModifierHeight = pindexPrev->nHeight;
     int64_t nStakeModifierTime = pindexPrev->nTime;
 
-    // Calculate hash
-    CDataStream ss(SER_GETHASH, 0);
-    ss << nStakeModifier << nTimeBlockFrom << txPrev.nTime << prevout.hash << prevout.n << nTimeTx;
-    hashProofOfStake = UintToArith256(Hash(ss.begin(), ss.end()));
+    // Calculate hash, the staker precomputes the same preimage
+    unsigned char preimage[STAKE_KERNEL_PREIMAGE_SIZE];
+    WriteStakeKernelPreimage(preimage, nStakeModifier, nTimeBlockFrom, txPrev.nTime, prevout);
+    hashProofOfStake = UintToArith256(GetStakeKernelHash(preimage, nTimeTx));
 
     if (fPrintProofOfStake)
     {
@@ -10681,68 +11130,86 @@ void StempoolAddEncryptedCandidateTransaction(const EncryptedCandidateTransactio
     stempool.AddEncryptedCandidateTransaction(ec);
 }
 
+// Run by the scheduler when embargoes expire, only taking cs_main when there is something to fluff
 static void CheckDandelionEmbargoes()
 {
-    int64_t nCurrTime = GetTimeMicros();
-    for (auto iter=mDandelionAggregationSessionEmbargo.begin(); iter!=mDandelionAggregationSessionEmbargo.end();) {
-        if (iter->second < nCurrTime) {
+    std::vector<std::pair<DandelionEmbargoType, uint256> > vExpired;
+    PopExpiredDandelionEmbargoes(GetTimeMicros(), vExpired);
+
+    if (vExpired.empty())
+        return;
+
+    LOCK(cs_main);
+
+    for (auto& it: vExpired) {
+        const uint256& hash = it.second;
+
+        if (it.first == DANDELION_EMBARGO_AGGREGATION_SESSION) {
             AggregationSession ms(pcoinsTip);
-            if (stempool.GetAggregationSession(iter->first, ms))
+            if (stempool.GetAggregationSession(hash, ms))
             {
                 mempool.AddAggregationSession(ms);
-                RelayAggregationSession(iter->first);
+                RelayAggregationSession(hash);
             }
-            iter = mDandelionAggregationSessionEmbargo.erase(iter);
-        } else {
-            iter++;
-        }
-    }
-
-    for (auto iter=mDandelionEncryptedCandidateEmbargo.begin(); iter!=mDandelionEncryptedCandidateEmbargo.end();) {
-        if (iter->second < nCurrTime) {
+        } else if (it.first == DANDELION_EMBARGO_ENCRYPTED_CANDIDATE) {
             EncryptedCandidateTransaction ec;
-            if (stempool.GetEncryptedCandidateTransaction(iter->first, ec))
+            if (stempool.GetEncryptedCandidateTransaction(hash, ec))
             {
                 mempool.AddEncryptedCandidateTransaction(ec);
-                RelayEncryptedCandidate(iter->first);
+                RelayEncryptedCandidate(hash);
             }
-            iter = mDandelionEncryptedCandidateEmbargo.erase(iter);
+        } else if (mempool.exists(hash)) {
+            LogPrint("dandelion", "Embargoed dandeliontx %s found in mempool; removing from embargo map\n", hash.ToString());
         } else {
-            iter++;
-        }
-    }
-
-    for (auto iter=mDandelionEmbargo.begin(); iter!=mDandelionEmbargo.end();) {
-        if (mempool.exists(iter->first)) {
-            LogPrint("dandelion", "Embargoed dandeliontx %s found in mempool; removing from embargo map\n", iter->first.ToString());
-            iter = mDandelionEmbargo.erase(iter);
-        } else if (iter->second < nCurrTime) {
-            LogPrint("dandelion", "dandeliontx %s embargo expired\n", iter->first.ToString());
+            LogPrint("dandelion", "dandeliontx %s embargo expired\n", hash.ToString());
             CValidationState state;
-            shared_ptr<const CTransaction> ptx = stempool.get(iter->first);
-            // If txn was not found in Stempool, then something went wrong,
-            // Keep it embargoed for now.
+            shared_ptr<const CTransaction> ptx = stempool.get(hash);
+            // If txn was not found in Stempool, then something went wrong
             if (!ptx) {
                 LogPrintf(
                             "ERROR: dandeliontx %s embargo expired, but not found in stempool.\n",
-                            iter->first.ToString());
-                iter = mDandelionEmbargo.erase(iter);
+                            hash.ToString());
                 continue;
             }
             bool fMissingInputs = false;
             AcceptToMemoryPool(mempool, &mempool.cs, &stempool.cs, state, *ptx, false, &fMissingInputs, false, 0);
             LogPrint("mempool", "AcceptToMemoryPool: accepted %s (poolsz %u txn, %u kB)\n",
-                     iter->first.ToString(), mempool.size(), mempool.DynamicMemoryUsage() / 1000);
+                     hash.ToString(), mempool.size(), mempool.DynamicMemoryUsage() / 1000);
             RelayTransaction(*ptx);
-            iter = mDandelionEmbargo.erase(iter);
-        } else {
-            iter++;
         }
     }
 }
 
+/**
+ * Votes of the blocks loaded from the block tree stay in their entry on disk,
+ * and are only read from there the first time the block is looked up.
+ */
+static void LoadDAOVotes(const uint256& hash)
+{
+    BlockMap::iterator it = mapBlockIndex.find(hash);
+    if (it == mapBlockIndex.end() || !it->second->fDAOVotesOnDisk)
+        return;
+
+    it->second->fDAOVotesOnDisk = false;
+
+    CDiskBlockIndex diskindex;
+    if (!pblocktree || !pblocktree->ReadBlockIndex(hash, diskindex))
+        return;
+
+    if (!diskindex.vProposalVotes.empty())
+        vProposalVotes[hash] = diskindex.vProposalVotes;
+    if (!diskindex.vPaymentRequestVotes.empty())
+        vPaymentRequestVotes[hash] = diskindex.vPaymentRequestVotes;
+    if (!diskindex.mapSupport.empty())
+        mapSupport[hash] = diskindex.mapSupport;
+    if (!diskindex.mapConsultationVotes.empty())
+        mapConsultationVotes[hash] = diskindex.mapConsultationVotes;
+}
+
 std::vector<std::pair<uint256, int>>* GetProposalVotes(const uint256& hash)
 {
+    LoadDAOVotes(hash);
+
     if (vProposalVotes.count(hash) == 0)
         return nullptr;
 
@@ -10751,6 +11218,8 @@ std::vector<std::pair<uint256, int>>* GetProposalVotes(const uint256& hash)
 
 std::vector<std::pair<uint256, int>>* GetPaymentRequestVotes(const uint256& hash)
 {
+    LoadDAOVotes(hash);
+
     if (vPaymentRequestVotes.count(hash) == 0)
         return nullptr;
 
@@ -10759,6 +11228,8 @@ std::vector<std::pair<uint256, int>>* GetPaymentRequestVotes(const uint256& hash
 
 std::map<uint256, bool>* GetSupport(const uint256& hash)
 {
+    LoadDAOVotes(hash);
+
     if (mapSupport.count(hash) == 0)
         return nullptr;
 
@@ -10767,6 +11238,8 @@ std::map<uint256, bool>* GetSupport(const uint256& hash)
 
 std::map<uint256, uint64_t>* GetConsultationVotes(const uint256& hash)
 {
+    LoadDAOVotes(hash);
+
     if (mapConsultationVotes.count(hash) == 0)
         return nullptr;
 
@@ -10775,20 +11248,24 @@ std::map<uint256, uint64_t>* GetConsultationVotes(const uint256& hash)
 
 std::vector<std::pair<uint256, int>>* InsertProposalVotes(const uint256& hash)
 {
+    LoadDAOVotes(hash);
     return &vProposalVotes[hash];
 }
 
 std::vector<std::pair<uint256, int>>* InsertPaymentRequestVotes(const uint256& hash)
 {
+    LoadDAOVotes(hash);
     return &vPaymentRequestVotes[hash];
 }
 
 std::map<uint256, bool>* InsertSupport(const uint256& hash)
 {
+    LoadDAOVotes(hash);
     return &mapSupport[hash];
 }
 
 std::map<uint256, uint64_t>* InsertConsultationVotes(const uint256& hash)
 {
+    LoadDAOVotes(hash);
     return &mapConsultationVotes[hash];
 }
@@ -31,6 +31,7 @@
 #include <algorithm>
 #include <exception>
 #include <map>
+#include <memory>
 #include <set>
 #include <stdint.h>
 #include <string>
@@ -62,6 +63,9 @@ class CValidationState;
 struct CNodeStateStats;
 struct LockPoints;
 
+template <typename T>
+class CCheckQueueControl;
+
 /** Default for DEFAULT_WHITELISTRELAY. */
 static const bool DEFAULT_WHITELISTRELAY = true;
 /** Default for DEFAULT_WHITELISTFORCERELAY. */
@@ -90,6 +94,10 @@ static const unsigned int DEFAULT_DESCENDANT_LIMIT = 25;
 static const unsigned int DEFAULT_DESCENDANT_SIZE_LIMIT = 101;
 /** Default for -mempoolexpiry, expiration time for mempool transactions in hours */
 static const unsigned int DEFAULT_MEMPOOL_EXPIRY = 72;
+/** Default for -persistmempool */
+static const bool DEFAULT_PERSIST_MEMPOOL = true;
+/** Seconds between dumps of the mempool to disk, besides the one on shutdown */
+static const int MEMPOOL_DUMP_INTERVAL = 15 * 60;
 /** The maximum size of a blk?????.dat file (since 0.8) */
 static const unsigned int MAX_BLOCKFILE_SIZE = 0x8000000; // 128 MiB
 /** The pre-allocation chunk size for blk?????.dat files (since 0.8) */
@@ -300,6 +308,8 @@ bool ProcessMessages(CNode* pfrom);
 bool SendMessages(CNode* pto);
 /** Run an instance of the script checking thread */
 void ThreadScriptCheck();
+/** Run an instance of the BLSCT checking thread */
+void ThreadBLSCTCheck();
 /** Check whether we are doing an initial block download (synchronizing from disk or network) */
 bool IsInitialBlockDownload();
 /** Format a string that describes several potential problems detected by the core.
@@ -357,6 +367,16 @@ bool RemoveBLSCTConflicting(CTxMemPool& pool, const CTxIn& txin, CCriticalSectio
 bool AcceptToMemoryPool(CTxMemPool& pool, CCriticalSection *mpcs, CCriticalSection *spcs, CValidationState &state, const CTransaction &tx, bool fLimitFree,
                         bool* pfMissingInputs, bool fOverrideMempoolLimit=false, const CAmount nAbsurdFee=0);
 
+/** (try to) add transaction to memory pool with a specified acceptance time **/
+bool AcceptToMemoryPoolWithTime(CTxMemPool& pool, CCriticalSection *mpcs, CCriticalSection *spcs, CValidationState &state, const CTransaction &tx, bool fLimitFree,
+                                bool* pfMissingInputs, int64_t nAcceptTime, bool fOverrideMempoolLimit=false, const CAmount nAbsurdFee=0);
+
+/** Dump the mempool and the stempool to disk. */
+bool DumpMempool();
+
+/** Load the mempool and the stempool from disk. */
+bool LoadMempool();
+
 /** Convert CValidationState to a human-readable message for logging */
 std::string FormatStateMessage(const CValidationState &state);
 
@@ -398,10 +418,12 @@ int64_t GetTransactionSigOpCost(const CTransaction& tx, const CStateViewCache& i
 /**
  * Check whether all inputs of this transaction are valid (no double spends, scripts & sigs, amounts)
  * This does not modify the UTXO set. If pvChecks is not NULL, script checks are pushed onto it
- * instead of being performed inline.
+ * instead of being performed inline. Likewise, if pvBLSCTChecks is not NULL, the range proof and
+ * BLS signature checks of private transactions are pushed onto it to be verified in a batch.
  */
 bool CheckInputs(const CTransaction& tx, CValidationState &state, const CStateViewCache &view, bool fScriptChecks,
-                 unsigned int flags, bool cacheStore, std::vector<RangeproofEncodedData>& blsctData, PrecomputedTransactionData& txdata, std::vector<CScriptCheck> *pvChecks = NULL, CAmount allowedInPrivate = 0);
+                 unsigned int flags, bool cacheStore, std::vector<RangeproofEncodedData>& blsctData, PrecomputedTransactionData& txdata, std::vector<CScriptCheck> *pvChecks = NULL, CAmount allowedInPrivate = 0,
+                 std::vector<BLSCTVerificationData> *pvBLSCTChecks = NULL);
 
 /** Apply the effects of this transaction on the UTXO set represented by view */
 void UpdateCoins(const CTransaction& tx, CStateViewCache& inputs, int nHeight);
@@ -486,6 +508,59 @@ public:
     ScriptError GetScriptError() const { return error; }
 };
 
+/**
+ * Closure representing the BLSCT range proof and signature verification of a
+ * range of the private transactions of a block, which is verified as one batch.
+ * Note that this stores references to the batch and to the result slots.
+ */
+class CBLSCTCheck
+{
+private:
+    const std::vector<BLSCTVerificationData> *pvBatch;
+    size_t nBegin;
+    size_t nEnd;
+    CValidationState *pstate;
+    uint256 *phashFailed;
+
+public:
+    CBLSCTCheck(): pvBatch(0), nBegin(0), nEnd(0), pstate(0), phashFailed(0) {}
+    CBLSCTCheck(const std::vector<BLSCTVerificationData>& vBatchIn, size_t nBeginIn, size_t nEndIn, CValidationState* pstateIn, uint256* phashFailedIn) :
+        pvBatch(&vBatchIn), nBegin(nBeginIn), nEnd(nEndIn), pstate(pstateIn), phashFailed(phashFailedIn) { }
+
+    bool operator()();
+
+    void swap(CBLSCTCheck &check) {
+        std::swap(pvBatch, check.pvBatch);
+        std::swap(nBegin, check.nBegin);
+        std::swap(nEnd, check.nEnd);
+        std::swap(pstate, check.pstate);
+        std::swap(phashFailed, check.phashFailed);
+    }
+};
+
+/**
+ * BLSCT verifications of a block, split in one CBLSCTCheck per script check
+ * thread. Start() queues them on the BLSCT check queue when there are worker
+ * threads, so they are verified while the caller does its other checks, and
+ * Wait() returns the state of the first batch which failed. vChecks must
+ * outlive the verification.
+ */
+class CBLSCTBlockChecks
+{
+private:
+    std::vector<CValidationState> vStates;
+    std::vector<uint256> vFailed;
+    std::vector<CBLSCTCheck> vBatches;
+    std::unique_ptr<CCheckQueueControl<CBLSCTCheck>> pcontrol;
+
+public:
+    CBLSCTBlockChecks();
+    ~CBLSCTBlockChecks();
+
+    void Start(const std::vector<BLSCTVerificationData>& vChecks);
+    bool Wait(CValidationState& state, uint256& hashFailed);
+};
+
 bool GetTimestampIndex(const unsigned int &high, const unsigned int &low, const bool fActiveOnly, std::vector<std::pair<uint256, unsigned int> > &hashes);
 bool GetSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value);
 bool HashOnchainActive(const uint256 &hash);
@@ -500,13 +575,15 @@ bool GetAddressUnspent(uint160 addressHash, int type,
 
 /** Functions for disk access for blocks */
 bool WriteBlockToDisk(const CBlock& block, CDiskBlockPos& pos, const CMessageHeader::MessageStartChars& messageStart);
+/** Reads the serialized block at pos, as it is stored on disk */
+bool ReadRawBlockFromDisk(std::vector<char>& vchBlock, const CDiskBlockPos& pos);
 bool ReadBlockFromDisk(CBlock& block, const CDiskBlockPos& pos, const Consensus::Params& consensusParams);
 bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex, const Consensus::Params& consensusParams);
 
 /** Functions for validating blocks and updating the block tree */
 
 /** Context-independent validity checks */
-bool CheckBlockHeader(const CBlockHeader& block, CValidationState& state, const Consensus::Params& consensusParams, bool fCheckPOW = true);
+bool CheckBlockHeader(const CBlockHeader& block, CValidationState& state, const Consensus::Params& consensusParams, bool fCheckPOW = true, const uint256* phash = nullptr);
 bool CheckBlock(const CBlock& block, CValidationState& state, const Consensus::Params& consensusParams, bool fCheckPOW = true, bool fCheckMerkleRoot = true, bool fCheckSig = true, bool fScriptChecks = true);
 
 /** Context-dependent validity checks.
@@ -693,6 +770,7 @@ void StempoolAddAggregationSession(const AggregationSession& ms);
 void MempoolAddEncryptedCandidateTransaction(const EncryptedCandidateTransaction& ms);
 void StempoolAddEncryptedCandidateTransaction(const EncryptedCandidateTransaction& ms);
 
+/** Votes of a block, read from its block index entry on first use. Requires cs_main. */
 std::vector<std::pair<uint256, int>>* GetProposalVotes(const uint256& hash);
 std::vector<std::pair<uint256, int>>* GetPaymentRequestVotes(const uint256& hash);
 std::map<uint256, bool>* GetSupport(const uint256& hash);
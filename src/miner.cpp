@@ -360,15 +360,15 @@ CBlockTemplate* BlockAssembler::CreateNewBlock(const CScript& scriptPubKeyIn, bo
         }
 
         UniValue strDZeel(UniValue::VARR);
-        CPaymentRequestMap mapPaymentRequests;
+        std::set<uint256> setPaymentRequests;
 
-        if(view.GetAllPaymentRequests(mapPaymentRequests))
+        if(view.GetPaymentRequestsByState(DAOFlags::ACCEPTED, setPaymentRequests))
         {
-            for (CPaymentRequestMap::iterator it_ = mapPaymentRequests.begin(); it_ != mapPaymentRequests.end(); it_++)
+            for (auto& it_: setPaymentRequests)
             {
                 CPaymentRequest prequest;
 
-                if (!view.GetPaymentRequest(it_->first, prequest))
+                if (!view.GetPaymentRequest(it_, prequest))
                     continue;
                 CBlockIndex* pblockindex = prequest.GetLastStateBlockIndexForState(DAOFlags::ACCEPTED);
                 if(pblockindex == nullptr)
@@ -626,11 +626,14 @@ void BlockAssembler::SortForBlock(const CTxMemPool::setEntries& package, CTxMemP
 void BlockAssembler::addCombinedBLSCT(const CStateViewCache& inputs)
 {
     std::set<CTransaction> setToCombine;
+    std::vector<uint256> vLeftOut;
     std::vector<RangeproofEncodedData> blsctData;
     CValidationState state;
 
     CAmount nMovedToPublic = 0;
 
+    LOCK(stempool.cs);
+
     for (auto &it: stempool.mapTx)
     {
         CTransaction tx = it.GetTx();
@@ -644,14 +647,16 @@ void BlockAssembler::addCombinedBLSCT(const CStateViewCache& inputs)
             {
                 nMovedToPublic += inputs.GetValueIn(tx) - tx.GetValueOut();
                 setToCombine.insert(tx);
+                continue;
             }
             else
                 LogPrintf("%s: Missing inputs or invalid blsct of %s (%s)\n", __func__, it.GetTx().GetHash().ToString(), FormatStateMessage(state));
         }
         catch(...)
         {
-            continue;
         }
+
+        vLeftOut.push_back(tx.GetHash());
     }
 
     CBlockIndex* pindexPrev = chainActive.Tip();
@@ -674,7 +679,7 @@ void BlockAssembler::addCombinedBLSCT(const CStateViewCache& inputs)
 
     CTransaction combinedTx;
 
-    if (!CombineBLSCTTransactions(setToCombine, combinedTx, inputs, state))
+    if (!CombinePoolBLSCTTransactions(stempool, setToCombine, vLeftOut, inputs, combinedTx, state))
     {
         LogPrintf("%s: Could not combine BLSCT transactions: %s\n", __func__, FormatStateMessage(state));
         return;
@@ -685,6 +690,39 @@ void BlockAssembler::addCombinedBLSCT(const CStateViewCache& inputs)
 
 }
 
+bool CombinePoolBLSCTTransactions(const CTxMemPool& pool, std::set<CTransaction>& setToCombine, const std::vector<uint256>& vLeftOut,
+                                  const CStateViewCache& inputs, CTransaction& combinedTx, CValidationState& state)
+{
+    // The transactions were verified when they were accepted to the pool, which keeps the sums
+    // of their signatures. Taking out those left out of the block is all the work needed, unless
+    // some of them are missing from the sums and the combination has to be verified.
+    bls::G2Element balanceSig, txSig;
+    BLSCTCombineData data;
+
+    pool.GetBLSCTSignatureSums(balanceSig, txSig);
+
+    for (auto& hash: vLeftOut)
+    {
+        if (!pool.GetBLSCTCombineData(hash, data))
+            continue;
+
+        if (data.fBalanceSig)
+            balanceSig = balanceSig + data.balanceSig.Negate();
+        if (data.fTxSig)
+            txSig = txSig + data.txSig.Negate();
+    }
+
+    for (auto& tx: setToCombine)
+    {
+        if (!pool.GetBLSCTCombineData(tx.GetHash(), data))
+            return CombineBLSCTTransactions(setToCombine, combinedTx, inputs, state);
+    }
+
+    std::vector<CTransaction> vToCombine(setToCombine.begin(), setToCombine.end());
+
+    return CombineVerifiedBLSCTTransactions(vToCombine, balanceSig, txSig, combinedTx, state);
+}
+
 // This transaction selection algorithm orders the mempool based
 // on feerate of a transaction including all unconfirmed ancestors.
 // Since we don't remove transactions from the mempool as we select them
@@ -916,6 +954,46 @@ void IncrementExtraNonce(CBlock* pblock, const CBlockIndex* pindexPrev, unsigned
 
 extern unsigned int nMinerSleep;
 
+/** Masked time up to which the staker last searched for a kernel, shared by HasStakeKernel() and SignBlock() */
+static int64_t& LastCoinStakeSearchTime()
+{
+    static int64_t nLastCoinStakeSearchTime = GetAdjustedTime(); // startup timestamp
+    return nLastCoinStakeSearchTime;
+}
+
+static void SetLastCoinStakeSearchTime(int64_t nSearchTime)
+{
+    nLastCoinStakeSearchInterval = nSearchTime - LastCoinStakeSearchTime();
+    LastCoinStakeSearchTime() = nSearchTime;
+}
+
+/**
+ * Searches the kernels of the wallet outputs in the current masked time slot,
+ * once per slot as SignBlock() does. A slot with a kernel is left for
+ * SignBlock() to record.
+ */
+static bool HasStakeKernel(CWallet& wallet)
+{
+    int64_t nSearchTime = GetAdjustedTime() & ~STAKE_TIMESTAMP_MASK;
+
+    if (nSearchTime <= LastCoinStakeSearchTime())
+        return false;
+
+    const CBlockIndex* pindexPrev;
+    unsigned int nBits;
+    {
+        LOCK(cs_main);
+        pindexPrev = chainActive.Tip();
+        nBits = GetNextTargetRequired(pindexPrev, true);
+    }
+
+    if (wallet.FindStakeKernel(pindexPrev, nBits, nSearchTime))
+        return true;
+
+    SetLastCoinStakeSearchTime(nSearchTime);
+    return false;
+}
+
 void NavcoinStaker(const CChainParams& chainparams)
 {
 
@@ -984,6 +1062,13 @@ void NavcoinStaker(const CChainParams& chainparams)
             nLastTime = GetTimeMillis();
             nLastSteadyTime = GetSteadyTime();
 
+            // Only assemble a block template once one of our outputs has a kernel
+            if (!HasStakeKernel(*pwalletMain))
+            {
+                MilliSleep(nMinerSleep);
+                continue;
+            }
+
             //
             // Create new block
             //
@@ -1044,8 +1129,6 @@ bool SignBlock(CBlock *pblock, CWallet& wallet, int64_t nFees, std::string sLog)
 
   CStateViewCache view(pcoinsTip);
 
-  static int64_t nLastCoinStakeSearchTime = GetAdjustedTime(); // startup timestamp
-
   CKey key;
   CMutableTransaction txCoinStake;
   CTransaction txNew;
@@ -1056,10 +1139,10 @@ bool SignBlock(CBlock *pblock, CWallet& wallet, int64_t nFees, std::string sLog)
 
   int64_t nSearchTime = txCoinStake.nTime; // search to current time
 
-  if (nSearchTime > nLastCoinStakeSearchTime)
+  if (nSearchTime > LastCoinStakeSearchTime())
   {
 
-      int64_t nSearchInterval = nBestHeight+1 > 0 ? 1 : nSearchTime - nLastCoinStakeSearchTime;
+      int64_t nSearchInterval = nBestHeight+1 > 0 ? 1 : nSearchTime - LastCoinStakeSearchTime();
       CScript kernelScriptPubKey;
       if (wallet.CreateCoinStake(wallet, pblock->nBits, nSearchInterval, nFees, txCoinStake, key, kernelScriptPubKey))
       {
@@ -1437,8 +1520,7 @@ bool SignBlock(CBlock *pblock, CWallet& wallet, int64_t nFees, std::string sLog)
               return key.Sign(pblock->GetHash(), pblock->vchBlockSig);
           }
       }
-      nLastCoinStakeSearchInterval = nSearchTime - nLastCoinStakeSearchTime;
-      nLastCoinStakeSearchTime = nSearchTime;
+      SetLastCoinStakeSearchTime(nSearchTime);
   }
 
   return false;
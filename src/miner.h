@@ -219,6 +219,13 @@ private:
     void UpdatePackagesForAdded(const CTxMemPool::setEntries& alreadyAdded, indexed_modified_transaction_set &mapModifiedTx);
 };
 
+/**
+ * Combines the BLSCT transactions of setToCombine, all entries of pool, into one. The sums of
+ * signatures the pool keeps are reused, minus those of the entries in vLeftOut.
+ */
+bool CombinePoolBLSCTTransactions(const CTxMemPool& pool, std::set<CTransaction>& setToCombine, const std::vector<uint256>& vLeftOut,
+                                  const CStateViewCache& inputs, CTransaction& combinedTx, CValidationState& state);
+
 /** Modify the extranonce in a block */
 void IncrementExtraNonce(CBlock* pblock, const CBlockIndex* pindexPrev, unsigned int& nExtraNonce);
 int64_t UpdateTime(CBlockHeader* pblock, const Consensus::Params& consensusParams, const CBlockIndex* pindexPrev);
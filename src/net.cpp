@@ -38,6 +38,8 @@
 #include <boost/thread.hpp>
 
 #include <math.h>
+#include <set>
+#include <tuple>
 
 // Dump addresses to peers.dat and banlist.dat every 15 minutes (900s)
 #define DUMP_ADDRESSES_INTERVAL 900
@@ -111,10 +113,14 @@ CCriticalSection cs_nLastNodeId;
 static CSemaphore *semOutbound = nullptr;
 boost::condition_variable messageHandlerCondition;
 
-// Public Dandelion field
-std::map<uint256, int64_t> mDandelionEmbargo;
-std::map<uint256, int64_t> mDandelionAggregationSessionEmbargo;
-std::map<uint256, int64_t> mDandelionEncryptedCandidateEmbargo;
+// Dandelion embargoes, by hash and ordered by deadline, guarded by cs_mapDandelionEmbargo
+static std::map<uint256, int64_t> mDandelionEmbargo;
+static std::map<uint256, int64_t> mDandelionAggregationSessionEmbargo;
+static std::map<uint256, int64_t> mDandelionEncryptedCandidateEmbargo;
+static std::set<std::tuple<int64_t, DandelionEmbargoType, uint256> > setDandelionEmbargoDeadlines;
+static CScheduler* pDandelionScheduler = nullptr;
+// Earliest deadline the scheduler wakes up for, 0 when none is pending
+static int64_t nDandelionEmbargoWakeup = 0;
 // Dandelion fields
 std::vector<CNode*> vDandelionInbound;
 std::vector<CNode*> vDandelionOutbound;
@@ -1559,91 +1565,127 @@ bool LocalDandelionDestinationPushInventory(const CInv& inv) {
     }
 }
 
+static std::map<uint256, int64_t>& GetDandelionEmbargoMap(DandelionEmbargoType type)
+{
+    switch (type) {
+    case DANDELION_EMBARGO_AGGREGATION_SESSION:
+        return mDandelionAggregationSessionEmbargo;
+    case DANDELION_EMBARGO_ENCRYPTED_CANDIDATE:
+        return mDandelionEncryptedCandidateEmbargo;
+    default:
+        return mDandelionEmbargo;
+    }
+}
+
+static void ExpireDandelionEmbargoes(int64_t wakeup)
+{
+    {
+        LOCK(cs_mapDandelionEmbargo);
+        if (nDandelionEmbargoWakeup == wakeup)
+            nDandelionEmbargoWakeup = 0;
+    }
+    GetNodeSignals().ExpireDandelionEmbargoes();
+}
+
+// Wakes the scheduler when the embargo expires, so nothing is checked before.
+// Later deadlines are scheduled as the earlier ones expire.
+static void ScheduleDandelionEmbargo(int64_t embargo)
+{
+    AssertLockHeld(cs_mapDandelionEmbargo);
+    if (!pDandelionScheduler || (nDandelionEmbargoWakeup != 0 && nDandelionEmbargoWakeup <= embargo))
+        return;
+    nDandelionEmbargoWakeup = embargo;
+    pDandelionScheduler->schedule(boost::bind(&ExpireDandelionEmbargoes, embargo), boost::chrono::system_clock::time_point(boost::chrono::microseconds(embargo + 1)));
+}
+
+static bool InsertDandelionEmbargo(DandelionEmbargoType type, const uint256& hash, const int64_t& embargo)
+{
+    LOCK(cs_mapDandelionEmbargo);
+    if (!GetDandelionEmbargoMap(type).insert(std::make_pair(hash, embargo)).second)
+        return false;
+    setDandelionEmbargoDeadlines.insert(std::make_tuple(embargo, type, hash));
+    ScheduleDandelionEmbargo(embargo);
+    return true;
+}
+
+static bool IsDandelionEmbargoed(DandelionEmbargoType type, const uint256& hash)
+{
+    LOCK(cs_mapDandelionEmbargo);
+    return GetDandelionEmbargoMap(type).count(hash) > 0;
+}
+
+static bool RemoveDandelionEmbargo(DandelionEmbargoType type, const uint256& hash)
+{
+    LOCK(cs_mapDandelionEmbargo);
+    std::map<uint256, int64_t>& mapEmbargo = GetDandelionEmbargoMap(type);
+    std::map<uint256, int64_t>::iterator it = mapEmbargo.find(hash);
+    if (it == mapEmbargo.end())
+        return false;
+    setDandelionEmbargoDeadlines.erase(std::make_tuple(it->second, type, hash));
+    mapEmbargo.erase(it);
+    return true;
+}
+
 bool InsertDandelionEmbargo(const uint256& hash, const int64_t& embargo) {
-    auto pair = mDandelionEmbargo.insert(std::make_pair(hash, embargo));
-    return pair.second;
+    return InsertDandelionEmbargo(DANDELION_EMBARGO_TX, hash, embargo);
 }
 
 bool IsTxDandelionEmbargoed(const uint256& hash) {
-    auto pair = mDandelionEmbargo.find(hash);
-    if (pair != mDandelionEmbargo.end()) {
-        return true;
-    } else {
-        return false;
-    }
+    return IsDandelionEmbargoed(DANDELION_EMBARGO_TX, hash);
 }
 
 bool RemoveDandelionEmbargo(const uint256& hash) {
-    bool removed = false;
-    for (auto iter=mDandelionEmbargo.begin(); iter!=mDandelionEmbargo.end();) {
-        if (iter->first==hash) {
-            iter = mDandelionEmbargo.erase(iter);
-            removed = true;
-        } else {
-            iter++;
-        }
-    }
-    return removed;
+    return RemoveDandelionEmbargo(DANDELION_EMBARGO_TX, hash);
 }
 
 bool InsertDandelionAggregationSessionEmbargo(const uint256& hash, const int64_t& embargo) {
-    LOCK(cs_mapDandelionEmbargo);
-    auto pair = mDandelionAggregationSessionEmbargo.insert(std::make_pair(hash, embargo));
-    return pair.second;
+    return InsertDandelionEmbargo(DANDELION_EMBARGO_AGGREGATION_SESSION, hash, embargo);
 }
 
 bool IsDandelionAggregationSessionEmbargoed(const uint256& hash) {
-    LOCK(cs_mapDandelionEmbargo);
-    auto pair = mDandelionAggregationSessionEmbargo.find(hash);
-    if (pair != mDandelionAggregationSessionEmbargo.end()) {
-        return true;
-    } else {
-        return false;
-    }
+    return IsDandelionEmbargoed(DANDELION_EMBARGO_AGGREGATION_SESSION, hash);
 }
 
 bool RemoveDandelionAggregationSessionEmbargo(const uint256& hash) {
-    LOCK(cs_mapDandelionEmbargo);
-    bool removed = false;
-    for (auto iter=mDandelionAggregationSessionEmbargo.begin(); iter!=mDandelionAggregationSessionEmbargo.end();) {
-        if (iter->first==hash) {
-            iter = mDandelionAggregationSessionEmbargo.erase(iter);
-            removed = true;
-        } else {
-            iter++;
-        }
-    }
-    return removed;
+    return RemoveDandelionEmbargo(DANDELION_EMBARGO_AGGREGATION_SESSION, hash);
 }
 
 bool InsertDandelionEncryptedCandidateEmbargo(const uint256 &ec, const int64_t& embargo) {
-    LOCK(cs_mapDandelionEmbargo);
-    auto pair = mDandelionEncryptedCandidateEmbargo.insert(std::make_pair(ec, embargo));
-    return pair.second;
+    return InsertDandelionEmbargo(DANDELION_EMBARGO_ENCRYPTED_CANDIDATE, ec, embargo);
 }
 
 bool IsDandelionEncryptedCandidateEmbargoed(const uint256 &ec) {
-    LOCK(cs_mapDandelionEmbargo);
-    auto pair = mDandelionEncryptedCandidateEmbargo.find(ec);
-    if (pair != mDandelionEncryptedCandidateEmbargo.end()) {
-        return true;
-    } else {
-        return false;
-    }
+    return IsDandelionEmbargoed(DANDELION_EMBARGO_ENCRYPTED_CANDIDATE, ec);
 }
 
 bool RemoveDandelionEncryptedCandidateEmbargo(const uint256 &ec) {
+    return RemoveDandelionEmbargo(DANDELION_EMBARGO_ENCRYPTED_CANDIDATE, ec);
+}
+
+void PopExpiredDandelionEmbargoes(int64_t nTime, std::vector<std::pair<DandelionEmbargoType, uint256> >& vExpired)
+{
     LOCK(cs_mapDandelionEmbargo);
-    bool removed = false;
-    for (auto iter=mDandelionEncryptedCandidateEmbargo.begin(); iter!=mDandelionEncryptedCandidateEmbargo.end();) {
-        if (iter->first==ec) {
-            iter = mDandelionEncryptedCandidateEmbargo.erase(iter);
-            removed = true;
-        } else {
-            iter++;
-        }
+    while (!setDandelionEmbargoDeadlines.empty() && std::get<0>(*setDandelionEmbargoDeadlines.begin()) <= nTime)
+    {
+        DandelionEmbargoType type = std::get<1>(*setDandelionEmbargoDeadlines.begin());
+        const uint256 hash = std::get<2>(*setDandelionEmbargoDeadlines.begin());
+        GetDandelionEmbargoMap(type).erase(hash);
+        setDandelionEmbargoDeadlines.erase(setDandelionEmbargoDeadlines.begin());
+        vExpired.push_back(std::make_pair(type, hash));
     }
-    return removed;
+
+    // Wake up again for the next embargo left
+    if (!setDandelionEmbargoDeadlines.empty())
+        ScheduleDandelionEmbargo(std::get<0>(*setDandelionEmbargoDeadlines.begin()));
+}
+
+void SetDandelionEmbargoScheduler(CScheduler* pscheduler)
+{
+    LOCK(cs_mapDandelionEmbargo);
+    pDandelionScheduler = pscheduler;
+    nDandelionEmbargoWakeup = 0;
+    if (!setDandelionEmbargoDeadlines.empty())
+        ScheduleDandelionEmbargo(std::get<0>(*setDandelionEmbargoDeadlines.begin()));
 }
 
 CNode* SelectFromDandelionDestinations()
@@ -2480,12 +2522,16 @@ void StartNode(boost::thread_group& threadGroup, CScheduler& scheduler)
 
     // Dump network addresses
     scheduler.scheduleEvery(&DumpData, DUMP_ADDRESSES_INTERVAL);
+
+    // Expire the Dandelion embargoes, including the ones set before the scheduler was known
+    SetDandelionEmbargoScheduler(&scheduler);
 }
 
 bool StopNode()
 {
     LogPrintf("StopNode()\n");
     MapPort(false);
+    SetDandelionEmbargoScheduler(nullptr);
     if (semOutbound)
         for (int i=0; i<MAX_OUTBOUND_CONNECTIONS; i++)
             semOutbound->post();
@@ -131,6 +131,8 @@ struct CNodeSignals
     boost::signals2::signal<bool (CNode*), CombinerAll> SendMessages;
     boost::signals2::signal<void (NodeId, const CNode*)> InitializeNode;
     boost::signals2::signal<void (NodeId)> FinalizeNode;
+    //! Fired by the scheduler when a Dandelion embargo expires
+    boost::signals2::signal<void ()> ExpireDandelionEmbargoes;
 };
 
 
@@ -185,10 +187,13 @@ extern CCriticalSection cs_vAddedNodes;
 extern NodeId nLastNodeId;
 extern CCriticalSection cs_nLastNodeId;
 
-// Public Dandelion field
-extern std::map<uint256, int64_t> mDandelionEmbargo;
-extern std::map<uint256, int64_t> mDandelionAggregationSessionEmbargo;
-extern std::map<uint256, int64_t> mDandelionEncryptedCandidateEmbargo;
+enum DandelionEmbargoType
+{
+    DANDELION_EMBARGO_TX,
+    DANDELION_EMBARGO_AGGREGATION_SESSION,
+    DANDELION_EMBARGO_ENCRYPTED_CANDIDATE,
+};
+
 // Dandelion methods
 bool IsDandelionInbound(const CNode* const pnode);
 bool IsDandelionOutbound(const CNode* const pnode);
@@ -205,6 +210,10 @@ bool RemoveDandelionAggregationSessionEmbargo(const uint256& hash);
 bool InsertDandelionEncryptedCandidateEmbargo(const uint256 &ec, const int64_t& embargo);
 bool IsDandelionEncryptedCandidateEmbargoed(const uint256 &ec);
 bool RemoveDandelionEncryptedCandidateEmbargo(const uint256 &ec);
+/** Removes the embargoes expired by nTime, in the order they expired */
+void PopExpiredDandelionEmbargoes(int64_t nTime, std::vector<std::pair<DandelionEmbargoType, uint256> >& vExpired);
+/** Wakes pscheduler as the embargoes expire, including the ones already set; nullptr stops it */
+void SetDandelionEmbargoScheduler(CScheduler* pscheduler);
 // Dandelion fields
 extern std::vector<CNode*> vDandelionInbound;
 extern std::vector<CNode*> vDandelionOutbound;
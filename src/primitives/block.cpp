@@ -21,7 +21,42 @@ uint256 CBlockHeader::GetHash() const
 
 uint256 CBlockHeader::GetPoWHash() const
 {
- return Hash9(BEGIN(nVersion), END(nNonce));
+    static_assert(sizeof(nVersion) + sizeof(hashPrevBlock) + sizeof(hashMerkleRoot) + sizeof(nTime) + sizeof(nBits) + sizeof(nNonce) == 80,
+                  "the X13 engine hashes 80 byte headers");
+    uint256 hash;
+    Hash9Headers((const unsigned char*)BEGIN(nVersion), 1, &hash);
+    return hash;
+}
+
+void GetBlockHeaderHashes(const std::vector<CBlock>& headers, std::vector<uint256>& vHashes)
+{
+    vHashes.resize(headers.size());
+
+    std::vector<unsigned char> vPoWHeaders;
+    std::vector<size_t> vPoWIndex;
+
+    for (size_t i = 0; i < headers.size(); i++)
+    {
+        if (headers[i].nVersion > 6)
+        {
+            vHashes[i] = headers[i].GetHash();
+        }
+        else
+        {
+            const unsigned char* p = (const unsigned char*)BEGIN(headers[i].nVersion);
+            vPoWHeaders.insert(vPoWHeaders.end(), p, p + 80);
+            vPoWIndex.push_back(i);
+        }
+    }
+
+    if (vPoWIndex.empty())
+        return;
+
+    std::vector<uint256> vPoWHashes(vPoWIndex.size());
+    Hash9Headers(vPoWHeaders.data(), vPoWIndex.size(), vPoWHashes.data());
+
+    for (size_t i = 0; i < vPoWIndex.size(); i++)
+        vHashes[vPoWIndex[i]] = vPoWHashes[i];
 }
 
 std::string CBlock::ToString() const
@@ -217,4 +217,10 @@ struct CBlockLocator
 /** Compute the consensus-critical block weight (see BIP 141). */
 int64_t GetBlockWeight(const CBlock& tx);
 
+/**
+ * Computes GetHash() of each header into vHashes. The X13 hashes of pre-v7
+ * headers are computed several at a time.
+ */
+void GetBlockHeaderHashes(const std::vector<CBlock>& headers, std::vector<uint256>& vHashes);
+
 #endif // NAVCOIN_PRIMITIVES_BLOCK_H
@@ -5,6 +5,7 @@
 
 #include "amount.h"
 #include "base58.h"
+#include "blsct/verificationcache.h"
 #include "chain.h"
 #include "chainparams.h"
 #include "checkpoints.h"
@@ -17,6 +18,7 @@
 #include "rpc/server.h"
 #include "script/script.h"
 #include "script/script_error.h"
+#include "script/sigcache.h"
 #include "script/sign.h"
 #include "script/standard.h"
 #include "streams.h"
@@ -1097,15 +1099,44 @@ UniValue listconsultations(const UniValue& params, bool fHelp)
         }
     }
 
-    CConsultationMap mapConsultations;
+    std::set<uint256> setConsultations;
     CStateViewCache view(pcoinsTip);
+    bool fFound = true;
 
-    if(view.GetAllConsultations(mapConsultations))
+    // The filters only look at the state, so only the consultations in the states asked for are read
+    if (showAll)
     {
-        for (CConsultationMap::iterator it = mapConsultations.begin(); it != mapConsultations.end(); it++)
+        CConsultationMap mapConsultations;
+        fFound = view.GetAllConsultations(mapConsultations);
+        for (auto& it: mapConsultations)
+            setConsultations.insert(it.first);
+    }
+    else
+    {
+        std::set<flags> setStates;
+        if (showNotEnoughAnswers || showLookingForSupport)
+            setStates.insert(DAOFlags::NIL);
+        if (showReflection)
+            setStates.insert(DAOFlags::REFLECTION);
+        if (showVoting)
+            setStates.insert(DAOFlags::ACCEPTED);
+        if (showFinished)
+            setStates.insert(DAOFlags::EXPIRED);
+
+        for (auto& state: setStates)
+        {
+            std::set<uint256> setHashes;
+            fFound = fFound && view.GetConsultationsByState(state, setHashes);
+            setConsultations.insert(setHashes.begin(), setHashes.end());
+        }
+    }
+
+    if(fFound)
+    {
+        for (auto& hash: setConsultations)
         {
             CConsultation consultation;
-            if (!view.GetConsultation(it->first, consultation))
+            if (!view.GetConsultation(hash, consultation))
                 continue;
 
             if (!mapBlockIndex.count(consultation.txblockhash))
@@ -1748,6 +1779,85 @@ UniValue getmempoolinfo(const UniValue& params, bool fHelp)
 }
 
 
+static UniValue cacheStatsToJSON(const CacheStats& stats)
+{
+    UniValue ret(UniValue::VOBJ);
+    ret.pushKV("size", (int64_t) stats.nEntries);
+    ret.pushKV("usage", (int64_t) stats.nUsage);
+    ret.pushKV("maxusage", (int64_t) stats.nMaxUsage);
+    ret.pushKV("hits", (int64_t) stats.nHits);
+    ret.pushKV("misses", (int64_t) stats.nMisses);
+    ret.pushKV("hitrate", stats.nHits + stats.nMisses > 0 ? (double) stats.nHits / (stats.nHits + stats.nMisses) : 0.0);
+    ret.pushKV("contended", (int64_t) stats.nContended);
+
+    UniValue shards(UniValue::VARR);
+    for (const CacheShardStats& shardStats: stats.vShards)
+    {
+        UniValue shard(UniValue::VOBJ);
+        shard.pushKV("size", (int64_t) shardStats.nEntries);
+        shard.pushKV("usage", (int64_t) shardStats.nUsage);
+        shard.pushKV("hits", (int64_t) shardStats.nHits);
+        shard.pushKV("misses", (int64_t) shardStats.nMisses);
+        shard.pushKV("contended", (int64_t) shardStats.nContended);
+        shards.push_back(shard);
+    }
+    ret.pushKV("shards", shards);
+
+    return ret;
+}
+
+static const std::string strCacheStatsHelp =
+    "{\n"
+    "  \"size\": xxxxx,               (numeric) Current count of cached entries\n"
+    "  \"usage\": xxxxx,              (numeric) Total memory usage for the cache\n"
+    "  \"maxusage\": xxxxx,           (numeric) Maximum memory usage for the cache\n"
+    "  \"hits\": xxxxx,               (numeric) Lookups of an already verified entry\n"
+    "  \"misses\": xxxxx,             (numeric) Lookups of an entry which had to be verified\n"
+    "  \"hitrate\": x.xxx,            (numeric) Share of the lookups which were hits\n"
+    "  \"contended\": xxxxx,          (numeric) Lookups and insertions which waited for another thread\n"
+    "  \"shards\": [                  (array) The same counters for each independently locked part of the cache\n"
+    "    {\n"
+    "      \"size\": xxxxx,\n"
+    "      \"usage\": xxxxx,\n"
+    "      \"hits\": xxxxx,\n"
+    "      \"misses\": xxxxx,\n"
+    "      \"contended\": xxxxx\n"
+    "    }, ...\n"
+    "  ]\n"
+    "}\n";
+
+UniValue getblsctcacheinfo(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() != 0)
+        throw runtime_error(
+                "getblsctcacheinfo\n"
+                "\nReturns details on the cache of verified BLSCT transactions.\n"
+                "\nResult:\n"
+                + strCacheStatsHelp +
+                "\nExamples:\n"
+                + HelpExampleCli("getblsctcacheinfo", "")
+                + HelpExampleRpc("getblsctcacheinfo", "")
+                );
+
+    return cacheStatsToJSON(GetBLSCTVerificationCacheStats());
+}
+
+UniValue getsigcacheinfo(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() != 0)
+        throw runtime_error(
+                "getsigcacheinfo\n"
+                "\nReturns details on the cache of verified script signatures.\n"
+                "\nResult:\n"
+                + strCacheStatsHelp +
+                "\nExamples:\n"
+                + HelpExampleCli("getsigcacheinfo", "")
+                + HelpExampleRpc("getsigcacheinfo", "")
+                );
+
+    return cacheStatsToJSON(GetSignatureCacheStats());
+}
+
 UniValue getstempoolinfo(const UniValue& params, bool fHelp)
 {
     if (fHelp || params.size() != 0)
@@ -1865,6 +1975,98 @@ UniValue getpaymentrequest(const UniValue& params, bool fHelp)
     return ret;
 }
 
+UniValue getdaostateproof(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() != 1)
+        throw runtime_error(
+                "getdaostateproof \"hash\"\n"
+                "\nReturns a proof that the given proposal, payment request, consultation or answer\n"
+                "is part of the DAO state committed to by getcfunddbstatehash.\n"
+                "\nArguments:\n"
+                "1. hash   (string, required) the hash of the entry\n"
+                "\nResult:\n"
+                "{\n"
+                "  \"type\": \"xxxx\",      (string) proposal, paymentrequest, consultation or answer\n"
+                "  \"id\": \"hex\",         (string) the hash of the type and the entry hash\n"
+                "  \"leaf\": \"hex\",       (string) the hash of the serialized entry\n"
+                "  \"root\": \"hex\",       (string) the root of the DAO state Merkle tree\n"
+                "  \"bucket\": [          (array) the entries sharing the tree leaf of this entry\n"
+                "    { \"id\": \"hex\", \"leaf\": \"hex\" }, ...\n"
+                "  ],\n"
+                "  \"branch\": [          (array) the hashes of the siblings up to the root\n"
+                "    \"hex\", ...\n"
+                "  ]\n"
+                "}\n"
+                "\nExamples\n"
+                + HelpExampleCli("getdaostateproof", "\"hash\"")
+                + HelpExampleRpc("getdaostateproof", "\"hash\"")
+                );
+
+    LOCK(cs_main);
+
+    uint256 hash = ParseHashV(params[0], "parameter 1");
+    CStateViewCache view(pcoinsTip);
+
+    std::string strType;
+    uint256 id, leaf;
+    CProposal proposal;
+    CPaymentRequest prequest;
+    CConsultation consultation;
+    CConsultationAnswer answer;
+
+    if (view.GetProposal(hash, proposal)) {
+        strType = "proposal";
+        id = GetDAOStateEntryId(DAO_ENTRY_PROPOSAL, hash);
+        leaf = GetDAOStateLeaf(proposal);
+    } else if (view.GetPaymentRequest(hash, prequest)) {
+        strType = "paymentrequest";
+        id = GetDAOStateEntryId(DAO_ENTRY_PAYMENT_REQUEST, hash);
+        leaf = GetDAOStateLeaf(prequest);
+    } else if (view.GetConsultation(hash, consultation)) {
+        strType = "consultation";
+        id = GetDAOStateEntryId(DAO_ENTRY_CONSULTATION, hash);
+        leaf = GetDAOStateLeaf(consultation);
+    } else if (view.GetConsultationAnswer(hash, answer)) {
+        strType = "answer";
+        id = GetDAOStateEntryId(DAO_ENTRY_ANSWER, hash);
+        leaf = GetDAOStateLeaf(answer);
+    } else {
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "DAO entry not found");
+    }
+
+    CDAOStateChanges changes;
+    const CDAOStateCommitment* pcommitment = view.GetDAOStateCommitment(changes);
+    if (!pcommitment)
+        throw JSONRPCError(RPC_DATABASE_ERROR, "Could not load the DAO state commitment");
+
+    std::vector<std::pair<uint256, uint256> > vEntries;
+    std::vector<uint256> vBranch;
+    pcommitment->GetProof(id, changes, vEntries, vBranch);
+
+    UniValue bucket(UniValue::VARR);
+    for (auto& it: vEntries)
+    {
+        UniValue entry(UniValue::VOBJ);
+        entry.pushKV("id", it.first.GetHex());
+        entry.pushKV("leaf", it.second.GetHex());
+        bucket.push_back(entry);
+    }
+
+    UniValue branch(UniValue::VARR);
+    for (auto& it: vBranch)
+        branch.push_back(it.GetHex());
+
+    UniValue ret(UniValue::VOBJ);
+    ret.pushKV("type", strType);
+    ret.pushKV("id", id.GetHex());
+    ret.pushKV("leaf", leaf.GetHex());
+    ret.pushKV("root", CDAOStateCommitment::GetProofRoot(id, vEntries, vBranch).GetHex());
+    ret.pushKV("bucket", bucket);
+    ret.pushKV("branch", branch);
+
+    return ret;
+}
+
 UniValue invalidateblock(const UniValue& params, bool fHelp)
 {
     if (fHelp || params.size() != 1)
@@ -1958,6 +2160,8 @@ static const CRPCCommand commands[] =
   { "blockchain",         "getmempooldescendants",  &getmempooldescendants,  true  },
   { "blockchain",         "getmempoolentry",        &getmempoolentry,        true  },
   { "blockchain",         "getmempoolinfo",         &getmempoolinfo,         true  },
+  { "blockchain",         "getblsctcacheinfo",      &getblsctcacheinfo,      true  },
+  { "blockchain",         "getsigcacheinfo",        &getsigcacheinfo,        true  },
   { "blockchain",         "getstempoolinfo",        &getstempoolinfo,        true  },
   { "communityfund",      "getproposal",            &getproposal,            true  },
   { "communityfund",      "getpaymentrequest",      &getpaymentrequest,      true  },
@@ -1969,6 +2173,7 @@ static const CRPCCommand commands[] =
   { "dao",                "getconsultation",        &getconsultation,        true  },
   { "dao",                "getconsultationanswer",  &getconsultationanswer,  true  },
   { "dao",                "getcfunddbstatehash",    &getcfunddbstatehash,    true  },
+  { "dao",                "getdaostateproof",       &getdaostateproof,       true  },
 
   /* Not shown in help */
   { "hidden",             "invalidateblock",        &invalidateblock,        true  },
@@ -6,6 +6,7 @@
 
 #include <chainparams.h>
 #include <clientversion.h>
+#include <kernel.h>
 #include <main.h>
 #include <miner.h>
 #include <net.h>
@@ -604,6 +605,7 @@ UniValue getstakinginfo(const UniValue& params, bool fHelp)
 
     obj.pushKV("difficulty", GetDifficulty(GetLastBlockIndex(pindexBestHeader, true)));
     obj.pushKV("search-interval", (int)nLastCoinStakeSearchInterval);
+    obj.pushKV("kernelspersecond", GetStakeKernelsPerSecond());
 
     obj.pushKV("weight", (uint64_t)nWeight);
     obj.pushKV("netstakeweight", (uint64_t)nNetworkWeight);
@@ -7,6 +7,7 @@
 #define NAVCOIN_SCRIPT_SIGCACHE_H
 
 #include <script/interpreter.h>
+#include <shardedcache.h>
 
 #include <vector>
 
@@ -27,4 +28,6 @@ public:
     bool VerifySignature(const std::vector<unsigned char>& vchSig, const CPubKey& vchPubKey, const uint256& sighash) const;
 };
 
+CacheStats GetSignatureCacheStats();
+
 #endif // NAVCOIN_SCRIPT_SIGCACHE_H
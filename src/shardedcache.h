@@ -0,0 +1,200 @@
+// Copyright (c) 2020 The Navcoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef NAVCOIN_SHARDEDCACHE_H
+#define NAVCOIN_SHARDEDCACHE_H
+
+#include <memusage.h>
+#include <random.h>
+#include <uint256.h>
+
+#include <atomic>
+#include <stdint.h>
+#include <vector>
+
+#include <boost/thread/locks.hpp>
+#include <boost/thread/shared_mutex.hpp>
+#include <boost/unordered_map.hpp>
+
+/** Number of independently locked parts of a CShardedCache */
+static const size_t CACHE_SHARDS = 16;
+
+struct CacheShardStats
+{
+    size_t nEntries;
+    size_t nUsage;
+    uint64_t nHits;
+    uint64_t nMisses;
+    //! Lookups and insertions which had to wait for the lock of the shard
+    uint64_t nContended;
+};
+
+struct CacheStats
+{
+    size_t nEntries;
+    size_t nUsage;
+    size_t nMaxUsage;
+    uint64_t nHits;
+    uint64_t nMisses;
+    uint64_t nContended;
+    std::vector<CacheShardStats> vShards;
+};
+
+/**
+ * The cache entries have a nonce hashed into them, so we don't need extra
+ * blinding in the map hash computation.
+ */
+class CSaltedEntryHasher
+{
+public:
+    size_t operator()(const uint256& key) const {
+        return key.GetCheapHash();
+    }
+};
+
+/** Memory used by a cached value besides the map node holding it */
+template <typename V>
+class CNoValueUsage
+{
+public:
+    size_t operator()(const V&) const {
+        return 0;
+    }
+};
+
+/**
+ * Cache of verification results keyed by salted hashes. It is split in shards,
+ * picked by the last byte of the entry, each of them with its own lock and an
+ * equal part of the memory limit, so the script check threads connecting a block
+ * rarely wait on each other. Random entries of a full shard are evicted.
+ */
+template <typename V, typename ValueUsage = CNoValueUsage<V> >
+class CShardedCache
+{
+private:
+    typedef boost::unordered_map<uint256, V, CSaltedEntryHasher> map_type;
+
+    struct CShard
+    {
+        boost::shared_mutex cs;
+        map_type map;
+        size_t nValueUsage;
+        std::atomic<uint64_t> nHits;
+        std::atomic<uint64_t> nMisses;
+        std::atomic<uint64_t> nContended;
+
+        CShard() : nValueUsage(0), nHits(0), nMisses(0), nContended(0) {}
+
+        size_t Usage() const { return memusage::DynamicUsage(map) + nValueUsage; }
+    };
+
+    CShard vShards[CACHE_SHARDS];
+    ValueUsage valueUsage;
+
+    CShard& GetShard(const uint256& entry)
+    {
+        return vShards[*(entry.end() - 1) % CACHE_SHARDS];
+    }
+
+    template <typename Lock>
+    static void Acquire(CShard& shard, Lock& lock)
+    {
+        if (!lock.try_lock()) {
+            shard.nContended++;
+            lock.lock();
+        }
+    }
+
+    void EraseFromShard(CShard& shard, typename map_type::iterator it)
+    {
+        shard.nValueUsage -= valueUsage(it->second);
+        shard.map.erase(it);
+    }
+
+public:
+    /** Looks up an entry, removing it on a hit when fErase is set */
+    bool Get(const uint256& entry, V& value, bool fErase)
+    {
+        CShard& shard = GetShard(entry);
+        bool fFound;
+
+        if (fErase) {
+            boost::unique_lock<boost::shared_mutex> lock(shard.cs, boost::defer_lock);
+            Acquire(shard, lock);
+            typename map_type::iterator it = shard.map.find(entry);
+            fFound = it != shard.map.end();
+            if (fFound) {
+                value = it->second;
+                EraseFromShard(shard, it);
+            }
+        } else {
+            boost::shared_lock<boost::shared_mutex> lock(shard.cs, boost::defer_lock);
+            Acquire(shard, lock);
+            typename map_type::const_iterator it = shard.map.find(entry);
+            fFound = it != shard.map.end();
+            if (fFound)
+                value = it->second;
+        }
+
+        if (fFound)
+            shard.nHits++;
+        else
+            shard.nMisses++;
+
+        return fFound;
+    }
+
+    /** Adds an entry, evicting others while the shard is over its part of nMaxUsage */
+    void Set(const uint256& entry, const V& value, size_t nMaxUsage)
+    {
+        size_t nMaxShardUsage = nMaxUsage / CACHE_SHARDS;
+        if (nMaxShardUsage <= 0) return;
+
+        CShard& shard = GetShard(entry);
+        boost::unique_lock<boost::shared_mutex> lock(shard.cs, boost::defer_lock);
+        Acquire(shard, lock);
+
+        while (!shard.map.empty() && shard.Usage() > nMaxShardUsage)
+        {
+            typename map_type::size_type s = GetRand(shard.map.bucket_count());
+            typename map_type::local_iterator it = shard.map.begin(s);
+            if (it != shard.map.end(s))
+                EraseFromShard(shard, shard.map.find(it->first));
+        }
+
+        std::pair<typename map_type::iterator, bool> ret = shard.map.insert(std::make_pair(entry, value));
+        if (ret.second)
+            shard.nValueUsage += valueUsage(ret.first->second);
+    }
+
+    void GetStats(CacheStats& stats, size_t nMaxUsage)
+    {
+        stats.nEntries = stats.nUsage = 0;
+        stats.nHits = stats.nMisses = stats.nContended = 0;
+        stats.nMaxUsage = nMaxUsage;
+        stats.vShards.resize(CACHE_SHARDS);
+
+        for (size_t i = 0; i < CACHE_SHARDS; i++)
+        {
+            CShard& shard = vShards[i];
+            CacheShardStats& shardStats = stats.vShards[i];
+            {
+                boost::shared_lock<boost::shared_mutex> lock(shard.cs);
+                shardStats.nEntries = shard.map.size();
+                shardStats.nUsage = shard.Usage();
+            }
+            shardStats.nHits = shard.nHits;
+            shardStats.nMisses = shard.nMisses;
+            shardStats.nContended = shard.nContended;
+
+            stats.nEntries += shardStats.nEntries;
+            stats.nUsage += shardStats.nUsage;
+            stats.nHits += shardStats.nHits;
+            stats.nMisses += shardStats.nMisses;
+            stats.nContended += shardStats.nContended;
+        }
+    }
+};
+
+#endif // NAVCOIN_SHARDEDCACHE_H
@@ -3,6 +3,7 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include <blsct/transaction.h>
+#include <blsct/verificationcache.h>
 #include <chainparams.h>
 #include <coins.h>
 #include <hash.h>
@@ -11,6 +12,8 @@
 #include <uint256.h>
 #include <wallet/test/wallet_test_fixture.h>
 #include <main.h>
+#include <miner.h>
+#include <txmempool.h>
 
 #include <vector>
 #include <map>
@@ -117,7 +120,7 @@ BOOST_AUTO_TEST_CASE(blsct)
     BOOST_CHECK(vData[0].amount == 10);
 
     Scalar diff = gammaIns-gammaOuts;
-    bls::PrivateKey balanceSigningKey = bls::PrivateKey::FromBN(diff.bn);
+    bls::PrivateKey balanceSigningKey = diff.GetPrivateKey();
 
     spendingTx.vchBalanceSig = bls::BasicSchemeMPL::Sign(balanceSigningKey, balanceMsg).Serialize();
 
@@ -138,7 +141,7 @@ BOOST_AUTO_TEST_CASE(blsct)
     BOOST_CHECK(!VerifyBLSCT(spendingTx, viewKey, vData, view, state));
 
     diff = gammaIns-gammaOuts;
-    balanceSigningKey = bls::PrivateKey::FromBN(diff.bn);
+    balanceSigningKey = diff.GetPrivateKey();
 
     spendingTx.vchBalanceSig = bls::BasicSchemeMPL::Sign(balanceSigningKey, balanceMsg).Serialize();
 
@@ -171,7 +174,7 @@ BOOST_AUTO_TEST_CASE(blsct)
     BOOST_CHECK(!VerifyBLSCT(spendingTx, viewKey, vData, view, state));
 
     diff = gammaIns-gammaOuts;
-    balanceSigningKey = bls::PrivateKey::FromBN(diff.bn);
+    balanceSigningKey = diff.GetPrivateKey();
     spendingTx.vchBalanceSig = bls::BasicSchemeMPL::Sign(balanceSigningKey, balanceMsg).Serialize();
 
     // Private to Private. Same amount. Balance signature correct. Tx signature empty.
@@ -219,7 +222,7 @@ BOOST_AUTO_TEST_CASE(blsct)
     BOOST_CHECK(state.GetRejectReason() == "could-not-read-balanceproof");
 
     diff = gammaIns-gammaOuts;
-    balanceSigningKey = bls::PrivateKey::FromBN(diff.bn);
+    balanceSigningKey = diff.GetPrivateKey();
     spendingTx.vchBalanceSig = bls::BasicSchemeMPL::Sign(balanceSigningKey, balanceMsg).Serialize();
 
     // Private to Private. Different amount. Balance signature complete but incorrect due different amount. Tx signature empty.
@@ -274,7 +277,7 @@ BOOST_AUTO_TEST_CASE(blsct)
     BOOST_CHECK(state.GetRejectReason() == "could-not-read-balanceproof");
 
     diff = gammaIns-gammaOuts;
-    balanceSigningKey = bls::PrivateKey::FromBN(diff.bn);
+    balanceSigningKey = diff.GetPrivateKey();
 
     spendingTx.vchBalanceSig = bls::BasicSchemeMPL::Sign(balanceSigningKey, balanceMsg).Serialize();
 
@@ -282,6 +285,46 @@ BOOST_AUTO_TEST_CASE(blsct)
     state = CValidationState();
 
     BOOST_CHECK(VerifyBLSCT(spendingTx, viewKey, vData, view, state));
+
+    CMutableTransaction invalidTx = spendingTx;
+    invalidTx.vout[0].nValue = 10;
+
+    std::vector<BLSCTVerificationData> vBatch(3);
+    uint256 hashFailed;
+
+    BOOST_CHECK(PrepareBLSCTVerification(spendingTx, viewKey, vData, view, state, vBatch[0]));
+    BOOST_CHECK(PrepareBLSCTVerification(spendingTx, viewKey, vData, view, state, vBatch[1]));
+    BOOST_CHECK(PrepareBLSCTVerification(invalidTx, viewKey, vData, view, state, vBatch[2]));
+
+    // Batch of valid transactions.
+    state = CValidationState();
+    BOOST_CHECK(VerifyBLSCTBatch(std::vector<BLSCTVerificationData>(vBatch.begin(), vBatch.begin() + 2), state, hashFailed));
+
+    // Batch including an invalid transaction. The failing transaction is found.
+    state = CValidationState();
+    BOOST_CHECK(!VerifyBLSCTBatch(vBatch, state, hashFailed));
+    BOOST_CHECK(hashFailed == CTransaction(invalidTx).GetHash());
+    BOOST_CHECK(state.GetRejectReason() == "invalid-balanceproof");
+
+    // A block of transactions split between the BLSCT check queue workers, as in ConnectBlock
+    std::vector<BLSCTVerificationData> vBlock(8);
+    std::vector<std::vector<RangeproofEncodedData>> vBlockData(vBlock.size());
+    for (size_t i = 0; i < vBlock.size(); i++)
+        BOOST_CHECK(PrepareBLSCTVerification(i == 5 ? invalidTx : spendingTx, viewKey, vBlockData[i], view, state, vBlock[i]));
+
+    CBLSCTBlockChecks blsctchecks;
+    state = CValidationState();
+    blsctchecks.Start(vBlock);
+    BOOST_CHECK(!blsctchecks.Wait(state, hashFailed));
+    BOOST_CHECK(hashFailed == CTransaction(invalidTx).GetHash());
+    BOOST_CHECK(state.GetRejectReason() == "invalid-balanceproof");
+
+    vBlock.erase(vBlock.begin() + 5);
+    state = CValidationState();
+    blsctchecks.Start(vBlock);
+    BOOST_CHECK(blsctchecks.Wait(state, hashFailed));
+    BOOST_CHECK(state.IsValid());
+
     spendingTx.vout[0].nValue = 10;
 
     BulletproofsRangeproof proofCheck = spendingTx.vout[0].GetBulletproof();
@@ -296,4 +339,135 @@ BOOST_AUTO_TEST_CASE(blsct)
     BOOST_CHECK(state.GetRejectReason() == "invalid-balanceproof");
 }
 
+BOOST_AUTO_TEST_CASE(blsct_combine_pool)
+{
+    CStateView dummy;
+    CStateViewCache view(&dummy);
+
+    bls::PrivateKey viewKey = Scalar::Rand().GetPrivateKey();
+    bls::PrivateKey spendKey = Scalar::Rand().GetPrivateKey();
+    blsctDoublePublicKey destKey(spendKey.GetG1Element() * viewKey, spendKey.GetG1Element());
+
+    // Private to private transactions, each spending its own output
+    std::vector<CTransaction> vTx;
+
+    for (int i = 0; i < 6; i++)
+    {
+        bls::PrivateKey bk = Scalar::Rand().GetPrivateKey();
+        bls::G1Element nonce;
+        std::string strFailReason;
+        std::vector<bls::G2Element> vBLSSignatures;
+
+        CMutableTransaction prevTx;
+        prevTx.nTime = i;
+        prevTx.vout.resize(1);
+
+        Scalar gammaIns = 0;
+        BOOST_CHECK(CreateBLSCTOutput(bk, nonce, prevTx.vout[0], destKey, 10*COIN, "", gammaIns, strFailReason, false, vBLSSignatures));
+
+        view.ModifyCoins(prevTx.GetHash())->FromTx(prevTx, 0);
+
+        CMutableTransaction spendingTx;
+        spendingTx.nVersion |= TX_BLS_CT_FLAG | TX_BLS_INPUT_FLAG;
+        spendingTx.nTime = i;
+        spendingTx.vin.resize(1);
+        spendingTx.vin[0].prevout = COutPoint(prevTx.GetHash(), 0);
+        spendingTx.vout.resize(1);
+
+        Scalar gammaOuts = 0;
+        BOOST_CHECK(CreateBLSCTOutput(bk, nonce, spendingTx.vout[0], destKey, 10*COIN, "test", gammaOuts, strFailReason, true, vBLSSignatures));
+
+        bls::G1Element t = bls::G1Element::FromByteVector(prevTx.vout[0].outputKey) * viewKey;
+        bls::PrivateKey sk = (Scalar(HashG1Element(t, 0)) + Scalar(spendKey)).GetPrivateKey();
+        SignBLSInput(sk, spendingTx.vin[0], vBLSSignatures);
+
+        spendingTx.vchTxSig = bls::BasicSchemeMPL::Aggregate(vBLSSignatures).Serialize();
+        spendingTx.vchBalanceSig = bls::BasicSchemeMPL::Sign((gammaIns - gammaOuts).GetPrivateKey(), balanceMsg).Serialize();
+
+        vTx.push_back(CTransaction(spendingTx));
+    }
+
+    // All but the last one are in the pool, the first two are left out of the block
+    CTxMemPool pool(CFeeRate(0));
+    TestMemPoolEntryHelper entry;
+
+    for (size_t i = 0; i < vTx.size() - 1; i++)
+        pool.addUnchecked(vTx[i].GetHash(), entry.FromTx(vTx[i]));
+
+    std::set<CTransaction> setToCombine(vTx.begin() + 2, vTx.end() - 1);
+    std::vector<uint256> vLeftOut = {vTx[0].GetHash(), vTx[1].GetHash()};
+
+    CTransaction combinedTx, expectedTx;
+    std::vector<RangeproofEncodedData> vData;
+    CValidationState state;
+
+    BOOST_CHECK(CombinePoolBLSCTTransactions(pool, setToCombine, vLeftOut, view, combinedTx, state));
+    BOOST_CHECK(VerifyBLSCT(combinedTx, viewKey, vData, view, state));
+
+    BOOST_CHECK(CombineBLSCTTransactions(setToCombine, expectedTx, view, state));
+    BOOST_CHECK(combinedTx.vchBalanceSig == expectedTx.vchBalanceSig);
+    BOOST_CHECK(combinedTx.vchTxSig == expectedTx.vchTxSig);
+    BOOST_CHECK(std::set<CTxIn>(combinedTx.vin.begin(), combinedTx.vin.end()) == std::set<CTxIn>(expectedTx.vin.begin(), expectedTx.vin.end()));
+
+    // The signatures of the entries left out must be taken out of the sums
+    state = CValidationState();
+    BOOST_CHECK(CombinePoolBLSCTTransactions(pool, setToCombine, std::vector<uint256>(1, vTx[0].GetHash()), view, combinedTx, state));
+    BOOST_CHECK(!VerifyBLSCT(combinedTx, viewKey, vData, view, state));
+
+    // A transaction missing from the pool is combined verifying the result
+    setToCombine.insert(vTx.back());
+    state = CValidationState();
+    BOOST_CHECK(CombinePoolBLSCTTransactions(pool, setToCombine, vLeftOut, view, combinedTx, state));
+    BOOST_CHECK(VerifyBLSCT(combinedTx, viewKey, vData, view, state));
+
+    BOOST_CHECK(CombineBLSCTTransactions(setToCombine, expectedTx, view, state));
+    BOOST_CHECK(combinedTx.vchBalanceSig == expectedTx.vchBalanceSig);
+    BOOST_CHECK(combinedTx.vchTxSig == expectedTx.vchTxSig);
+}
+
+BOOST_AUTO_TEST_CASE(blsct_verification_cache)
+{
+    uint256 txHash = GetRandHash();
+    std::vector<unsigned char> vchViewKey = {1, 2, 3};
+
+    uint256 entry = GetBLSCTCacheEntry(txHash, 0, vchViewKey);
+
+    // The entry depends on the mixing fee and the view key
+    BOOST_CHECK(entry == GetBLSCTCacheEntry(txHash, 0, vchViewKey));
+    BOOST_CHECK(entry != GetBLSCTCacheEntry(txHash, 1, vchViewKey));
+    BOOST_CHECK(entry != GetBLSCTCacheEntry(txHash, 0, std::vector<unsigned char>()));
+
+    RangeproofEncodedData data;
+    data.amount = 10;
+    data.message = "test";
+    data.index = 1;
+    data.valid = true;
+
+    std::vector<RangeproofEncodedData> vData;
+    BLSCTVerificationCacheStats stats = GetBLSCTVerificationCacheStats();
+
+    BOOST_CHECK(!GetCachedBLSCTVerification(entry, vData, false));
+    BOOST_CHECK(GetBLSCTVerificationCacheStats().nMisses == stats.nMisses + 1);
+
+    SetCachedBLSCTVerification(entry, std::vector<RangeproofEncodedData>(1, data));
+
+    // A lookup from the mempool keeps the entry, one from block connection removes it
+    BOOST_CHECK(GetCachedBLSCTVerification(entry, vData, false));
+    BOOST_CHECK(GetCachedBLSCTVerification(entry, vData, true));
+    BOOST_CHECK(!GetCachedBLSCTVerification(entry, vData, true));
+
+    BOOST_CHECK(vData.size() == 1);
+    BOOST_CHECK(vData[0].amount == 10);
+    BOOST_CHECK(vData[0].message == "test");
+    BOOST_CHECK(GetBLSCTVerificationCacheStats().nHits == stats.nHits + 2);
+
+    // The totals add up the counters of every shard
+    stats = GetBLSCTVerificationCacheStats();
+    BOOST_CHECK(stats.vShards.size() == CACHE_SHARDS);
+    uint64_t nShardHits = 0;
+    for (const CacheShardStats& shardStats: stats.vShards)
+        nShardHits += shardStats.nHits;
+    BOOST_CHECK(nShardHits == stats.nHits);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
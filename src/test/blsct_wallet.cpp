@@ -3,14 +3,19 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include <blsct/transaction.h>
+#include <chain.h>
 #include <chainparams.h>
+#include <clientversion.h>
 #include <coins.h>
 #include <hash.h>
 #include <key.h>
 #include <keystore.h>
 #include <random.h>
+#include <script/standard.h>
+#include <streams.h>
 #include <uint256.h>
 #include <wallet/test/wallet_test_fixture.h>
+#include <wallet/wallet.h>
 #include <main.h>
 
 #include <vector>
@@ -22,16 +27,9 @@ const uint32_t BIP32_HARDENED_KEY_LIMIT = 0x80000000;
 
 BOOST_FIXTURE_TEST_SUITE(blsct_wallet_tests, WalletTestingSetup)
 
-BOOST_AUTO_TEST_CASE(blsct_wallet)
+// Derives the BLSCT keys of the wallet from key
+static void SetBLSCTKeys(CWallet* pwallet, const CKey& key)
 {
-    LOCK(cs_main);
-
-    CStateViewCache view(pcoinsTip);
-    CBasicKeyStore keystore;
-
-    CKey key;
-    key.MakeNewKey(0);
-
     CHashWriter h(0, 0);
     std::vector<unsigned char> vKey(key.begin(), key.end());
 
@@ -48,17 +46,30 @@ BOOST_AUTO_TEST_CASE(blsct_wallet)
     bls::PrivateKey viewKey = blsctKey(transactionBLSKey).PrivateChild(BIP32_HARDENED_KEY_LIMIT);
     bls::PrivateKey spendKey = blsctKey(transactionBLSKey).PrivateChild(BIP32_HARDENED_KEY_LIMIT|1);
 
-    BOOST_CHECK(pwalletMain->SetBLSCTDoublePublicKey(blsctDoublePublicKey(viewKey.GetG1Element(), spendKey.GetG1Element())));
-    BOOST_CHECK(pwalletMain->SetBLSCTViewKey(blsctKey(viewKey)));
-    BOOST_CHECK(pwalletMain->SetBLSCTSpendKey(blsctKey(spendKey)));
-    BOOST_CHECK(pwalletMain->SetBLSCTBlindingMasterKey(blindingBLSKey));
+    BOOST_CHECK(pwallet->SetBLSCTDoublePublicKey(blsctDoublePublicKey(viewKey.GetG1Element(), spendKey.GetG1Element())));
+    BOOST_CHECK(pwallet->SetBLSCTViewKey(blsctKey(viewKey)));
+    BOOST_CHECK(pwallet->SetBLSCTSpendKey(blsctKey(spendKey)));
+    BOOST_CHECK(pwallet->SetBLSCTBlindingMasterKey(blindingBLSKey));
+
+    BOOST_CHECK(pwallet->NewBLSCTBlindingKeyPool());
+    BOOST_CHECK(pwallet->NewBLSCTSubAddressKeyPool(0));
+    BOOST_CHECK(!pwallet->IsLocked());
+
+    BOOST_CHECK(pwallet->TopUpBLSCTBlindingKeyPool());
+    BOOST_CHECK(pwallet->TopUpBLSCTSubAddressKeyPool(0));
+}
+
+BOOST_AUTO_TEST_CASE(blsct_wallet)
+{
+    LOCK(cs_main);
+
+    CStateViewCache view(pcoinsTip);
+    CBasicKeyStore keystore;
 
-    BOOST_CHECK(pwalletMain->NewBLSCTBlindingKeyPool());
-    BOOST_CHECK(pwalletMain->NewBLSCTSubAddressKeyPool(0));
-    BOOST_CHECK(!pwalletMain->IsLocked());
+    CKey key;
+    key.MakeNewKey(0);
 
-    BOOST_CHECK(pwalletMain->TopUpBLSCTBlindingKeyPool());
-    BOOST_CHECK(pwalletMain->TopUpBLSCTSubAddressKeyPool(0));
+    SetBLSCTKeys(pwalletMain, key);
 
     CKeyID keyID;
     BOOST_CHECK(pwalletMain->GetBLSCTSubAddressKeyFromPool(0, keyID));
@@ -82,4 +93,135 @@ BOOST_AUTO_TEST_CASE(blsct_wallet)
     BOOST_CHECK(pwalletMain->IsMine(txout));
 }
 
+BOOST_AUTO_TEST_CASE(blsct_wallet_rescan)
+{
+    // The same keys in a wallet rescanned through the pipeline and in one adding the blocks serially
+    CKey key;
+    key.MakeNewKey(0);
+    SetBLSCTKeys(pwalletMain, key);
+
+    bool fFirstRun, fBLSCTFirstRun;
+    CWallet walletSerial("wallet_test_serial.dat");
+    walletSerial.LoadWallet(fFirstRun, fBLSCTFirstRun);
+    SetBLSCTKeys(&walletSerial, key);
+
+    CKey keyP2PKH;
+    keyP2PKH.MakeNewKey(true);
+    BOOST_CHECK(pwalletMain->AddKey(keyP2PKH));
+    BOOST_CHECK(walletSerial.AddKey(keyP2PKH));
+    CScript scriptPubKey = GetScriptForDestination(keyP2PKH.GetPubKey().GetID());
+
+    CKeyID keyID;
+    BOOST_CHECK(pwalletMain->GetBLSCTSubAddressKeyFromPool(0, keyID));
+    blsctDoublePublicKey destKey;
+    BOOST_CHECK(pwalletMain->GetBLSCTSubAddressPublicKeys(keyID, destKey));
+    blsctPublicKey bpk;
+    BOOST_CHECK(pwalletMain->GetBLSCTBlindingKeyFromPool(bpk));
+    blsctKey b;
+    BOOST_CHECK(pwalletMain->GetBLSCTBlindingKey(bpk, b));
+
+    // More blocks than the pipeline reads ahead, paying to the wallet, to its BLSCT
+    // address, spending from it or unrelated
+    const int nBlocks = 200;
+    const CChainParams& chainparams = Params();
+    std::vector<CBlock> vBlocks(nBlocks);
+    std::vector<uint256> vHashes(nBlocks);
+    std::vector<CBlockIndex> vIndex(nBlocks);
+    COutPoint prevoutMine;
+    CDiskBlockPos pos(100, 0);
+
+    for (int i = 0; i < nBlocks; i++)
+    {
+        CMutableTransaction tx;
+        tx.nTime = GetTime();
+        tx.nLockTime = i;
+        tx.vin.push_back(CTxIn(COutPoint(GetRandHash(), 0)));
+
+        if (i % 4 == 1)
+        {
+            tx.vout.push_back(CTxOut(COIN, scriptPubKey));
+        }
+        else if (i % 4 == 2)
+        {
+            Scalar gamma;
+            std::string strFailReason;
+            std::vector<bls::G2Element> vBLSSignatures;
+            bls::G1Element nonce;
+            tx.vout.resize(1);
+            BOOST_CHECK(CreateBLSCTOutput(b.GetKey(), nonce, tx.vout[0], destKey, i * COIN, "rescan", gamma, strFailReason, false, vBLSSignatures));
+        }
+        else if (i % 4 == 3)
+        {
+            tx.vin[0].prevout = prevoutMine;
+            tx.vout.push_back(CTxOut(COIN, CScript() << OP_TRUE));
+        }
+        else
+        {
+            tx.vout.push_back(CTxOut(COIN, CScript() << OP_TRUE));
+        }
+
+        CBlock& block = vBlocks[i];
+        block.nTime = tx.nTime;
+        block.hashPrevBlock = i == 0 ? uint256() : vHashes[i - 1];
+        block.vtx.push_back(CTransaction(tx));
+        if (i % 4 == 1)
+            prevoutMine = COutPoint(block.vtx[0].GetHash(), 0);
+
+        BOOST_REQUIRE(WriteBlockToDisk(block, pos, chainparams.MessageStart()));
+        vHashes[i] = block.GetHash();
+        vIndex[i].phashBlock = &vHashes[i];
+        vIndex[i].pprev = i == 0 ? nullptr : &vIndex[i - 1];
+        vIndex[i].nHeight = i;
+        vIndex[i].nTime = block.nTime;
+        vIndex[i].nFile = pos.nFile;
+        vIndex[i].nDataPos = pos.nPos;
+        vIndex[i].nStatus = BLOCK_HAVE_DATA;
+
+        pos.nPos += ::GetSerializeSize(block, SER_DISK, CLIENT_VERSION);
+    }
+
+    {
+        LOCK(cs_main);
+        for (int i = 0; i < nBlocks; i++)
+            mapBlockIndex[vHashes[i]] = &vIndex[i];
+        chainActive.SetTip(&vIndex.back());
+    }
+
+    int nFound = pwalletMain->ScanForWalletTransactions(&vIndex[0], true);
+
+    {
+        LOCK2(cs_main, walletSerial.cs_wallet);
+        for (int i = 0; i < nBlocks; i++)
+            for (const CTransaction& tx: vBlocks[i].vtx)
+                walletSerial.AddToWalletIfInvolvingMe(tx, &vBlocks[i], true, nullptr);
+    }
+
+    {
+        LOCK2(cs_main, pwalletMain->cs_wallet);
+        LOCK(walletSerial.cs_wallet);
+
+        BOOST_CHECK_EQUAL(nFound, nBlocks / 4 * 3);
+        BOOST_CHECK_EQUAL(pwalletMain->mapWallet.size(), walletSerial.mapWallet.size());
+
+        int nBLSCT = 0;
+        for (const std::pair<const uint256, CWalletTx>& it: walletSerial.mapWallet)
+        {
+            std::map<uint256, CWalletTx>::const_iterator mi = pwalletMain->mapWallet.find(it.first);
+            BOOST_REQUIRE(mi != pwalletMain->mapWallet.end());
+            const CWalletTx& wtx = mi->second;
+            BOOST_CHECK(wtx.hashBlock == it.second.hashBlock);
+            BOOST_CHECK(wtx.vAmounts == it.second.vAmounts);
+            BOOST_CHECK(wtx.vMemos == it.second.vMemos);
+            BOOST_CHECK(wtx.vGammas == it.second.vGammas);
+            if (wtx.IsCTOutput() && wtx.vAmounts.size() == 1 && wtx.vAmounts[0] > 0 && wtx.vMemos[0] == "rescan")
+                nBLSCT++;
+        }
+        BOOST_CHECK_EQUAL(nBLSCT, nBlocks / 4);
+
+        chainActive.SetTip(NULL);
+        for (int i = 0; i < nBlocks; i++)
+            mapBlockIndex.erase(vHashes[i]);
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -4,10 +4,13 @@
 
 #include "blsct/bulletproofs.h"
 #include "test/test_navcoin.h"
+#include "utilstrencodings.h"
 
+#include <algorithm>
 #include <map>
 
 #include <boost/test/unit_test.hpp>
+#include <boost/thread.hpp>
 #include "boost/assign.hpp"
 
 BOOST_FIXTURE_TEST_SUITE(bulletproofsrangeproof, BasicTestingSetup)
@@ -135,7 +138,7 @@ BOOST_AUTO_TEST_CASE(RangeProofTest)
     for (Scalar v: vInRange)
     {
         std::vector<Scalar> values;
-        bn_print(v.bn);
+        BOOST_TEST_MESSAGE(HexStr(v.GetVch()));
         values.push_back(v);
         BOOST_CHECK(TestRange(values, nonce));
     }
@@ -153,4 +156,155 @@ BOOST_AUTO_TEST_CASE(RangeProofTest)
     BOOST_CHECK(!TestRange(vOutOfRange, nonce));
 }
 
+BOOST_AUTO_TEST_CASE(RangeProofUnreducedTest)
+{
+    bls::G1Element nonce = bls::G1Element::Infinity();
+
+    BulletproofsRangeproof bprp;
+    bprp.Prove({Scalar(1000)}, nonce, {1, 2, 3, 4});
+
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << bprp;
+    std::vector<uint8_t> vch(ss.begin(), ss.end());
+
+    // Write taux as taux plus the group order, which still fits in 32 bytes
+    std::vector<uint8_t> vchTaux = bprp.taux.GetVch();
+    std::vector<uint8_t> vchOrder = ParseHex("73eda753299d7d483339d80809a1d80553bda402fffe5bfeffffffff00000001");
+    std::vector<uint8_t> vchUnreduced(32);
+    int carry = 0;
+    for (size_t i = 32; i > 0; i--)
+    {
+        int sum = vchTaux[i-1] + vchOrder[i-1] + carry;
+        vchUnreduced[i-1] = sum & 0xFF;
+        carry = sum >> 8;
+    }
+    BOOST_REQUIRE(carry == 0);
+
+    auto it = std::search(vch.begin(), vch.end(), vchTaux.begin(), vchTaux.end());
+    BOOST_REQUIRE(it != vch.end());
+    std::copy(vchUnreduced.begin(), vchUnreduced.end(), it);
+
+    CDataStream ssUnreduced(vch, SER_NETWORK, PROTOCOL_VERSION);
+    BulletproofsRangeproof unreduced;
+    ssUnreduced >> unreduced;
+
+    // The transcript hashes the reduced value, as the copy of the relic big number did
+    BOOST_CHECK(unreduced.taux == bprp.taux);
+    BOOST_CHECK(unreduced.taux.GetVch() == vchTaux);
+
+    CHashWriter hasher(0,0), hasherUnreduced(0,0);
+    hasher << bprp.taux << bprp.mu << bprp.t;
+    hasherUnreduced << unreduced.taux << unreduced.mu << unreduced.t;
+    BOOST_CHECK(hasher.GetHash() == hasherUnreduced.GetHash());
+
+    std::vector<std::pair<int, BulletproofsRangeproof>> proofs;
+    proofs.push_back(std::make_pair(0, unreduced));
+    std::vector<RangeproofEncodedData> data;
+    BOOST_CHECK(VerifyBulletproof(proofs, data, {nonce}));
+    BOOST_CHECK(data.size() == 1 && data[0].amount == 1000);
+}
+
+BOOST_AUTO_TEST_CASE(RangeProofParallelTest)
+{
+    boost::thread_group threadGroup;
+
+    for (int i = 0; i < 3; i++)
+        threadGroup.create_thread(&ThreadBulletproofsProve);
+
+    bls::G1Element nonce = bls::G1Element::Infinity();
+    std::vector<Scalar> values;
+
+    for (unsigned int i = 0; i < maxM; i++)
+        values.push_back(Scalar(1000 * (i + 1)));
+
+    BOOST_CHECK(TestRange(values, nonce));
+    BOOST_CHECK(TestRangeBatch(values, nonce));
+
+    threadGroup.interrupt_all();
+    threadGroup.join_all();
+}
+
+BOOST_AUTO_TEST_CASE(MultiExpTest)
+{
+    BulletproofsRangeproof::Init();
+
+    // Cover both the mulVec and the Pippenger paths
+    for (size_t n: std::vector<size_t>{1, 2, 17, MULTIEXP_PIPPENGER_MIN_SIZE + 3})
+    {
+        std::vector<MultiexpData> data;
+
+        for (size_t i = 0; i < n; i++)
+            data.push_back({BulletproofsRangeproof::Gi[i] * Scalar::Rand(), Scalar::Rand()});
+
+        bls::G1Element expected = MultiExpLegacy(data);
+
+        BOOST_CHECK(MultiExp(data) == expected);
+        BOOST_CHECK(MultiExpMulVec(data) == expected);
+    }
+
+    // The precomputed generator table matches the plain generators
+    std::vector<MultiexpData> data;
+    std::vector<size_t> indexes;
+    std::vector<Fr> exps;
+
+    for (size_t i = 0; i < 8; i++)
+    {
+        Scalar s = Scalar::Rand();
+        std::vector<unsigned char> vch = s.GetVch();
+        Fr e;
+        e.deserialize(&vch[0], vch.size());
+
+        data.push_back({BulletproofsRangeproof::Gi[i], s});
+        indexes.push_back(BulletproofsRangeproof::GiIndex(i));
+        exps.push_back(e);
+    }
+
+    G1 result;
+    BulletproofsRangeproof::generators.MultiExp(result, indexes.data(), exps.data(), indexes.size());
+
+    std::vector<unsigned char> vch(48);
+    result.serialize(&vch[0], vch.size());
+
+    BOOST_CHECK(bls::G1Element::FromByteVector(vch) == MultiExpLegacy(data));
+}
+
+BOOST_AUTO_TEST_CASE(ScalarTest)
+{
+    Scalar a = Scalar::Rand();
+    Scalar b = Scalar::Rand();
+
+    // Serialization is 32 bytes big endian, as with relic
+    std::vector<uint8_t> vch = Scalar(0x0102).GetVch();
+    BOOST_CHECK(vch.size() == 32 && vch[30] == 0x01 && vch[31] == 0x02);
+    BOOST_CHECK(Scalar(a.GetVch()) == a);
+
+    // Encodings which are not reduced are read modulo the group order
+    std::vector<uint8_t> vchMax(32, 0xFF);
+    Scalar c(vchMax);
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << c;
+    Scalar d;
+    ss >> d;
+    BOOST_CHECK(c.GetVch() != vchMax && c.GetVch()[0] < 0x74);
+    BOOST_CHECK(d == c && d.GetVch() == c.GetVch());
+    BOOST_CHECK(c == (Scalar(1) << 256) - Scalar(1));
+
+    BOOST_CHECK((a + b) - b == a);
+    BOOST_CHECK(a + a.Negate() == 0);
+    BOOST_CHECK(a * a.Invert() == 1);
+    BOOST_CHECK(((a >> 128) << 64) >> 64 == a >> 128);
+    BOOST_CHECK((Scalar(0xF0F0) | Scalar(0x0F0F)) == 0xFFFF);
+    BOOST_CHECK((Scalar(0xF0F0) & Scalar(0xFF00)) == 0xF000);
+    BOOST_CHECK(~Scalar(0xF0F0) == 0x0F0F);
+    BOOST_CHECK(Scalar(0xFFFFFFFFFFFFFFFF).GetInt64() == -1);
+
+    std::vector<Scalar> values;
+    for (int i = 0; i < 33; i++)
+        values.push_back(Scalar::Rand());
+
+    std::vector<Scalar> inverses = VectorInvert(values);
+    for (size_t i = 0; i < values.size(); i++)
+        BOOST_CHECK(inverses[i] == values[i].Invert());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
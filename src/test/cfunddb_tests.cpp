@@ -4,14 +4,17 @@
 
 #include <chainparams.h>
 #include <consensus/dao.h>
+#include <consensus/daocommitment.h>
 #include <coins.h>
 #include <random.h>
 #include <uint256.h>
 #include <test/test_navcoin.h>
 #include <main.h>
 
+#include <algorithm>
 #include <vector>
 #include <map>
+#include <set>
 
 #include <boost/test/unit_test.hpp>
 
@@ -433,5 +436,293 @@ BOOST_AUTO_TEST_CASE(cfunddb_state)
     }
 }
 
+// Root of the state seen by view, committed to from scratch
+static uint256 GetFullDAOStateRoot(CStateViewCache& view)
+{
+    CProposalMap mapProposals;
+    BOOST_CHECK(view.GetAllProposals(mapProposals));
+
+    CDAOStateChanges entries;
+    AddDAOStateChanges(DAO_ENTRY_PROPOSAL, mapProposals, entries);
+
+    CDAOStateCommitment commitment;
+    commitment.Update(entries);
+    return commitment.GetRoot();
+}
+
+BOOST_AUTO_TEST_CASE(cfunddb_state_commitment)
+{
+    CStateViewDB *pcoinsdbview = new CStateViewDB(1<<23, true);
+    CStateViewCache base(pcoinsdbview);
+
+    std::string strDZeel = "{\"n\":5000000000,\"a\":\"NP3h1uzYuZX9k3xmT5sZsrEceRFW5kxo2N\",\"d\":604800,\"s\":\"test\",\"v\":2}";
+    CAmount nFee = GetConsensusParameter(Consensus::CONSENSUS_PARAM_PROPOSAL_MIN_FEE, base);
+    std::vector<uint256> vHashes;
+
+    for (unsigned int i = 0; i < 50; i++) {
+        CStateViewCache view(&base);
+
+        for (unsigned int j = 0; j < 4; j++) {
+            CProposal proposal;
+            BOOST_CHECK(TxToProposal(strDZeel, GetRandHash(), GetRandHash(), nFee, proposal));
+            BOOST_CHECK(view.AddProposal(proposal));
+            vHashes.push_back(proposal.hash);
+        }
+
+        // Drops the last proposal of the previous round
+        if (i % 3 == 1) {
+            BOOST_CHECK(view.RemoveProposal(vHashes[vHashes.size() - 5]));
+        }
+
+        // Changes in the caches are applied on top of what the database committed to
+        CDAOStateChanges changes;
+        const CDAOStateCommitment* pcommitment = view.GetDAOStateCommitment(changes);
+        BOOST_CHECK(pcommitment);
+        uint256 root = pcommitment->GetRoot(changes);
+        BOOST_CHECK(root == GetFullDAOStateRoot(view));
+
+        CProposal proposal;
+        if (view.GetProposal(vHashes.back(), proposal)) {
+            uint256 id = GetDAOStateEntryId(DAO_ENTRY_PROPOSAL, proposal.hash);
+            std::vector<std::pair<uint256, uint256> > vEntries;
+            std::vector<uint256> vBranch;
+            pcommitment->GetProof(id, changes, vEntries, vBranch);
+            BOOST_CHECK(std::find(vEntries.begin(), vEntries.end(), std::make_pair(id, GetDAOStateLeaf(proposal))) != vEntries.end());
+            BOOST_CHECK(CDAOStateCommitment::GetProofRoot(id, vEntries, vBranch) == root);
+        }
+
+        BOOST_CHECK(view.Flush());
+        if (i % 5 == 0)
+            BOOST_CHECK(base.Flush());
+
+        // The database only rehashes what was flushed to it
+        changes.clear();
+        BOOST_CHECK(base.GetDAOStateCommitment(changes)->GetRoot(changes) == root);
+    }
+
+    BOOST_CHECK(base.Flush());
+    CDAOStateChanges changes;
+    BOOST_CHECK(base.GetDAOStateCommitment(changes)->GetRoot() == GetFullDAOStateRoot(base));
+}
+
+BOOST_AUTO_TEST_CASE(cfunddb_payment_request_index)
+{
+    CStateViewDB *pcoinsdbview = new CStateViewDB(1<<23, true);
+    CStateViewCache base(pcoinsdbview);
+    CStateViewCache view(&base);
+
+    uint256 proposal = GetRandHash();
+    uint256 otherProposal = GetRandHash();
+    std::set<uint256> setExpected;
+    std::set<uint256> setHashes;
+
+    for (unsigned int i = 0; i < 10; i++) {
+        CPaymentRequest prequest;
+        prequest.hash = GetRandHash();
+        prequest.proposalhash = i % 2 ? proposal : otherProposal;
+        prequest.nAmount = 1 + i;
+        BOOST_CHECK(view.AddPaymentRequest(prequest));
+        if (i % 2)
+            setExpected.insert(prequest.hash);
+
+        // Flushed to the database in steps, so the hashes come from every layer
+        if (i % 3 == 0)
+            BOOST_CHECK(view.Flush());
+        if (i % 4 == 0)
+            BOOST_CHECK(base.Flush());
+
+        BOOST_CHECK(view.GetPaymentRequestsForProposal(proposal, setHashes));
+        BOOST_CHECK(setHashes == setExpected);
+    }
+
+    BOOST_CHECK(view.Flush());
+    BOOST_CHECK(base.Flush());
+    BOOST_CHECK(pcoinsdbview->GetPaymentRequestsForProposal(proposal, setHashes));
+    BOOST_CHECK(setHashes == setExpected);
+
+    // Removed entries are dropped from the index
+    uint256 removed = *setExpected.begin();
+    BOOST_CHECK(view.RemovePaymentRequest(removed));
+    setExpected.erase(removed);
+    BOOST_CHECK(view.GetPaymentRequestsForProposal(proposal, setHashes));
+    BOOST_CHECK(setHashes == setExpected);
+
+    BOOST_CHECK(view.Flush());
+    BOOST_CHECK(base.Flush());
+    BOOST_CHECK(pcoinsdbview->GetPaymentRequestsForProposal(proposal, setHashes));
+    BOOST_CHECK(setHashes == setExpected);
+
+    // Without blocks every entry is in the initial state
+    BOOST_CHECK(pcoinsdbview->GetPaymentRequestsByState(DAOFlags::NIL, setHashes));
+    BOOST_CHECK(setHashes.size() == 9);
+    BOOST_CHECK(pcoinsdbview->GetPaymentRequestsByState(DAOFlags::ACCEPTED, setHashes));
+    BOOST_CHECK(setHashes.empty());
+}
+
+BOOST_AUTO_TEST_CASE(cfunddb_consultation_state_index)
+{
+    CStateViewDB *pcoinsdbview = new CStateViewDB(1<<23, true);
+    CStateViewCache base(pcoinsdbview);
+    CStateViewCache view(&base);
+
+    std::set<uint256> setExpected;
+    std::set<uint256> setHashes;
+
+    for (unsigned int i = 0; i < 10; i++) {
+        CConsultation consultation;
+        consultation.hash = GetRandHash();
+        consultation.nVersion = CConsultation::BASE_VERSION;
+        BOOST_CHECK(view.AddConsultation(consultation));
+        setExpected.insert(consultation.hash);
+
+        // Flushed to the database in steps, so the hashes come from every layer
+        if (i % 3 == 0)
+            BOOST_CHECK(view.Flush());
+        if (i % 4 == 0)
+            BOOST_CHECK(base.Flush());
+
+        BOOST_CHECK(view.GetConsultationsByState(DAOFlags::NIL, setHashes));
+        BOOST_CHECK(std::includes(setHashes.begin(), setHashes.end(), setExpected.begin(), setExpected.end()));
+    }
+
+    BOOST_CHECK(view.Flush());
+    BOOST_CHECK(base.Flush());
+    BOOST_CHECK(pcoinsdbview->GetConsultationsByState(DAOFlags::NIL, setHashes));
+    BOOST_CHECK(setHashes == setExpected);
+    BOOST_CHECK(pcoinsdbview->GetConsultationsByState(DAOFlags::REFLECTION, setHashes));
+    BOOST_CHECK(setHashes.empty());
+
+    // Removed entries are dropped from the index
+    uint256 removed = *setExpected.begin();
+    BOOST_CHECK(view.RemoveConsultation(removed));
+    setExpected.erase(removed);
+
+    BOOST_CHECK(view.Flush());
+    BOOST_CHECK(base.Flush());
+    BOOST_CHECK(pcoinsdbview->GetConsultationsByState(DAOFlags::NIL, setHashes));
+    BOOST_CHECK(setHashes == setExpected);
+}
+
+static void SetTestVotes(CStateViewCache& view, CStateViewCache& base, const uint256& proposal)
+{
+    for (unsigned int i = 0; i < 12; i++) {
+        CVoteMapKey voter(1, (unsigned char)i);
+        {
+            CVoteModifier mVote = view.ModifyVote(voter, 100 + i % 4);
+            mVote->Set(100 + i % 4, proposal, i % 2);
+            mVote->Set(100 + (i + 1) % 4, proposal, 1 - i % 2);
+            if (i % 3 == 0)
+                mVote->Set(200, proposal, -1);
+        }
+
+        // Flushed to the database in steps, so the votes come from every layer
+        if (i % 2 == 0)
+            BOOST_CHECK(view.Flush());
+        if (i % 5 == 0)
+            BOOST_CHECK(base.Flush());
+    }
+}
+
+BOOST_AUTO_TEST_CASE(cfunddb_voter_height_index)
+{
+    CStateViewDB *pcoinsdbview = new CStateViewDB(1<<23, true);
+    CStateViewCache base(pcoinsdbview);
+    CStateViewCache view(&base);
+
+    CStateViewDB *pbaselinedbview = new CStateViewDB(1<<23, true);
+    CStateViewCache baselineBase(pbaselinedbview);
+    CStateViewCache baseline(&baselineBase);
+
+    uint256 proposal = GetRandHash();
+    SetTestVotes(view, base, proposal);
+    SetTestVotes(baseline, baselineBase, proposal);
+
+    uint256 hashBefore = GetDAOStateHash(view, 0, 0);
+    BOOST_CHECK(hashBefore == GetDAOStateHash(baseline, 0, 0));
+
+    // Disconnecting a height only clears the voters indexed at it, as DisconnectBlock does
+    const int nHeight = 101;
+    std::set<CVoteMapKey> setVoters;
+    BOOST_CHECK(view.GetVotersAtHeight(nHeight, setVoters));
+    BOOST_CHECK(setVoters.size() == 6);
+
+    for (auto& it: setVoters) {
+        CVoteModifier mVote = view.ModifyVote(it, nHeight);
+        mVote->Clear(nHeight);
+        mVote->fDirty = true;
+    }
+
+    // The baseline clears the height from every voter
+    CVoteMap mapBaseline;
+    BOOST_CHECK(baseline.GetAllVotes(mapBaseline));
+
+    for (auto& it: mapBaseline) {
+        CVoteModifier mVote = baseline.ModifyVote(it.first, nHeight);
+        mVote->Clear(nHeight);
+        mVote->fDirty = true;
+    }
+
+    CVoteMap mapVotes;
+    BOOST_CHECK(view.GetAllVotes(mapVotes));
+    BOOST_CHECK(baseline.GetAllVotes(mapBaseline));
+    BOOST_CHECK(mapVotes == mapBaseline);
+    BOOST_CHECK(view.GetVotersAtHeight(nHeight, setVoters));
+    BOOST_CHECK(setVoters.empty());
+
+    uint256 hashAfter = GetDAOStateHash(view, 0, 0);
+    BOOST_CHECK(hashAfter != hashBefore);
+    BOOST_CHECK(hashAfter == GetDAOStateHash(baseline, 0, 0));
+
+    // The same holds once both are written to the database
+    BOOST_CHECK(view.Flush());
+    BOOST_CHECK(base.Flush());
+    BOOST_CHECK(baseline.Flush());
+    BOOST_CHECK(baselineBase.Flush());
+
+    BOOST_CHECK(pcoinsdbview->GetAllVotes(mapVotes));
+    BOOST_CHECK(pbaselinedbview->GetAllVotes(mapBaseline));
+    BOOST_CHECK(mapVotes == mapBaseline);
+    BOOST_CHECK(pcoinsdbview->GetVotersAtHeight(nHeight, setVoters));
+    BOOST_CHECK(setVoters.empty());
+    BOOST_CHECK(pcoinsdbview->GetVotersAtHeight(200, setVoters));
+    BOOST_CHECK(setVoters.size() == 4);
+
+    BOOST_CHECK(GetDAOStateHash(base, 0, 0) == hashAfter);
+    BOOST_CHECK(GetDAOStateHash(baselineBase, 0, 0) == hashAfter);
+}
+
+BOOST_AUTO_TEST_CASE(cfunddb_vote_tally)
+{
+    uint256 proposal = GetRandHash();
+    uint256 consultation = GetRandHash();
+
+    CVoteTally block1;
+    block1.mapProposals[proposal] = make_pair(make_pair(1, 0), 0);
+    block1.mapSupport[consultation] = 1;
+    block1.hashBlock = GetRandHash();
+
+    CVoteTally block2;
+    block2.mapProposals[proposal] = make_pair(make_pair(0, 1), 0);
+    block2.mapConsultations[make_pair(consultation, 2)] = 1;
+    block2.nExclude = 1;
+    block2.hashBlock = GetRandHash();
+
+    CVoteTally tally;
+    BOOST_CHECK(tally.IsEmpty());
+    tally.Add(block1);
+    tally.Add(block2);
+
+    BOOST_CHECK(tally.mapProposals[proposal] == make_pair(make_pair(1, 1), 0));
+    BOOST_CHECK(tally.mapSupport[consultation] == 1);
+    BOOST_CHECK(tally.mapConsultations[make_pair(consultation, (int64_t)2)] == 1);
+    BOOST_CHECK(tally.nExclude == 1);
+
+    // Entries without votes are kept, as when counting the blocks one by one
+    CVoteTally block3;
+    block3.mapPaymentRequests[proposal] = make_pair(make_pair(0, 0), 0);
+    tally.Add(block3);
+    BOOST_CHECK(tally.mapPaymentRequests.count(proposal) == 1);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
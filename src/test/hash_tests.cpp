@@ -3,6 +3,8 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include <hash.h>
+#include <hashblock.h>
+#include <random.h>
 #include <utilstrencodings.h>
 #include <test/test_navcoin.h>
 
@@ -124,4 +126,20 @@ BOOST_AUTO_TEST_CASE(siphash)
     }
 }
 
+BOOST_AUTO_TEST_CASE(hash9_headers)
+{
+    // Batches not multiple of the four lanes also take the single header path
+    for (size_t nCount = 1; nCount <= 9; nCount++)
+    {
+        std::vector<unsigned char> vHeaders(80 * nCount);
+        GetRandBytes(vHeaders.data(), vHeaders.size());
+
+        std::vector<uint256> vHashes(nCount);
+        Hash9Headers(vHeaders.data(), nCount, vHashes.data());
+
+        for (size_t i = 0; i < nCount; i++)
+            BOOST_CHECK(vHashes[i] == Hash9(vHeaders.begin() + 80 * i, vHeaders.begin() + 80 * (i + 1)));
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -2,8 +2,15 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include <blockfilereader.h>
+#include <chain.h>
 #include <chainparams.h>
+#include <clientversion.h>
+#include <consensus/dao.h>
+#include <kernel.h>
 #include <main.h>
+#include <random.h>
+#include <streams.h>
 
 #include <test/test_navcoin.h>
 
@@ -72,4 +79,170 @@ BOOST_AUTO_TEST_CASE(test_combiner_all)
     Test.disconnect(&ReturnTrue);
     BOOST_CHECK(Test());
 }
+
+BOOST_AUTO_TEST_CASE(disk_block_index_hash)
+{
+    // A pre-v7 header, whose hash is the X13 proof of work hash
+    CBlockHeader header;
+    header.nVersion = 6;
+    header.hashPrevBlock = uint256S("0x01");
+    header.nTime = 1500000000;
+    header.nBits = 0x1d00ffff;
+    header.nNonce = 42;
+    uint256 hash = header.GetHash();
+    BOOST_CHECK(hash == header.GetPoWHash());
+
+    CBlockIndex prev;
+    prev.phashBlock = &header.hashPrevBlock;
+    CBlockIndex index(header);
+    index.phashBlock = &hash;
+    index.pprev = &prev;
+
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << CDiskBlockIndex(&index);
+
+    // The stored hash is used as is, and matches the header
+    CDiskBlockIndex diskindex;
+    ss >> diskindex;
+    BOOST_CHECK(diskindex.GetBlockHash() == hash);
+    BOOST_CHECK(diskindex.ComputeBlockHash() == hash);
+    BOOST_CHECK(diskindex.hashPrev == header.hashPrevBlock);
+}
+
+BOOST_AUTO_TEST_CASE(stake_kernel_check)
+{
+    // The precomputed kernel of the staker agrees with the consensus check
+    const unsigned int nStakeMinAge = Params().GetConsensus().nStakeMinAge;
+    const unsigned int vBits[] = {0x1b00ffff, 0x1f00ffff, 0x2000ffff, 0x207fffff};
+    int nPass = 0, nFail = 0;
+
+    for (int i = 0; i < 1000; i++) {
+        CBlockIndex indexPrev;
+        indexPrev.nStakeModifier = ((uint64_t)insecure_rand() << 32) | insecure_rand();
+
+        CBlockIndex indexFrom;
+        indexFrom.nTime = 1500000000 + insecure_rand() % 100000;
+
+        CMutableTransaction mtx;
+        mtx.nTime = indexFrom.nTime + insecure_rand() % 100;
+        mtx.vout.resize(1 + insecure_rand() % 3);
+        COutPoint prevout(GetRandHash(), insecure_rand() % mtx.vout.size());
+        mtx.vout[prevout.n].nValue = (i % 2) ? 1 + insecure_rand() % 65536 : GetRand(MAX_MONEY);
+        CTransaction txPrev(mtx);
+
+        unsigned int nBits = vBits[insecure_rand() % 4];
+        CStakeKernel kernel(indexPrev.nStakeModifier, nBits, indexFrom.nTime, txPrev.nTime, txPrev.vout[prevout.n].nValue, prevout);
+
+        for (int j = 0; j < 10; j++) {
+            // Around the time of the previous transaction and the min age
+            unsigned int nTimeTx = (j < 2 ? mtx.nTime : indexFrom.nTime + nStakeMinAge) - 50 + insecure_rand() % 100;
+            arith_uint256 hashProofOfStake, targetProofOfStake;
+            bool fCheck = CheckStakeKernelHash(&indexPrev, nBits, indexFrom, txPrev, prevout, nTimeTx, hashProofOfStake, targetProofOfStake);
+            BOOST_CHECK_EQUAL(kernel.Check(nTimeTx), fCheck);
+            if (nTimeTx >= txPrev.nTime && indexFrom.nTime + nStakeMinAge <= nTimeTx)
+                BOOST_CHECK(UintToArith256(GetStakeKernelHash(kernel.preimage, nTimeTx)) == hashProofOfStake);
+            fCheck ? nPass++ : nFail++;
+        }
+    }
+
+    BOOST_CHECK(nPass > 0 && nFail > 0);
+}
+
+BOOST_AUTO_TEST_CASE(dao_votes_lazy_load)
+{
+    LOCK(cs_main);
+
+    uint256 hash = uint256S("0x02");
+    uint256 proposal = uint256S("0x03");
+    CBlockIndex index;
+    index.phashBlock = &hash;
+    index.nStatus = BLOCK_OPT_DAO;
+    InsertProposalVotes(hash)->push_back(std::make_pair(proposal, (int)VoteFlags::VOTE_YES));
+    BOOST_CHECK(pblocktree->WriteBatchSync(std::vector<std::pair<int, const CBlockFileInfo*> >(), 0, std::vector<const CBlockIndex*>(1, &index)));
+
+    UnloadBlockIndex();
+    BOOST_CHECK(pblocktree->LoadBlockIndexGuts(InsertBlockIndex));
+    BOOST_CHECK(mapBlockIndex.count(hash) && mapBlockIndex[hash]->fDAOVotesOnDisk);
+
+    // Votes are only read from disk when the block is looked up
+    BOOST_CHECK(vProposalVotes.count(hash) == 0);
+    std::vector<std::pair<uint256, int>>* pVotes = GetProposalVotes(hash);
+    BOOST_REQUIRE(pVotes != nullptr);
+    BOOST_CHECK(pVotes->size() == 1 && (*pVotes)[0].first == proposal && (*pVotes)[0].second == VoteFlags::VOTE_YES);
+    BOOST_CHECK(!mapBlockIndex[hash]->fDAOVotesOnDisk);
+    BOOST_CHECK(GetPaymentRequestVotes(hash) == nullptr);
+}
+
+BOOST_AUTO_TEST_CASE(block_file_reader)
+{
+    const CChainParams& chainparams = Params();
+    CBlock block1 = chainparams.GenesisBlock();
+    CBlock block2 = block1;
+    block2.nTime++;
+
+    CDiskBlockPos pos1(100, 0);
+    BOOST_REQUIRE(WriteBlockToDisk(block1, pos1, chainparams.MessageStart()));
+
+    CBlock read;
+    BOOST_CHECK(ReadBlockFromDisk(read, pos1, chainparams.GetConsensus()));
+    BOOST_CHECK(read.GetHash() == block1.GetHash());
+
+    // Written after the first block was read ahead
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << block1;
+    CDiskBlockPos pos2(100, pos1.nPos + ss.size());
+    BOOST_REQUIRE(WriteBlockToDisk(block2, pos2, chainparams.MessageStart()));
+
+    BOOST_CHECK(ReadBlockFromDisk(read, pos2, chainparams.GetConsensus()));
+    BOOST_CHECK(read.GetHash() == block2.GetHash());
+
+    // The raw bytes are the block as serialized on disk
+    std::vector<char> vchBlock;
+    BOOST_CHECK(ReadRawBlockFromDisk(vchBlock, pos1));
+    BOOST_CHECK(vchBlock == std::vector<char>(ss.begin(), ss.end()));
+
+    BOOST_CHECK(!ReadRawBlockFromDisk(vchBlock, CDiskBlockPos(100, pos1.nPos + 1)));
+    BOOST_CHECK(!ReadRawBlockFromDisk(vchBlock, CDiskBlockPos(101, pos1.nPos)));
+
+    // The second block is still kept in memory, overwriting it drops it
+    CDiskBlockPos pos3(100, pos1.nPos + ss.size());
+    BOOST_REQUIRE(WriteBlockToDisk(block1, pos3, chainparams.MessageStart()));
+    BOOST_CHECK(pos3 == pos2);
+    BOOST_CHECK(ReadBlockFromDisk(read, pos3, chainparams.GetConsensus()));
+    BOOST_CHECK(read.GetHash() == block1.GetHash());
+
+    blockFileReader.Clear();
+}
+
+BOOST_AUTO_TEST_CASE(raw_block_cache)
+{
+    CRawBlockCache cache(30);
+    std::vector<std::shared_ptr<CRawBlock> > vBlocks;
+    for (int i = 0; i < 4; i++) {
+        vBlocks.push_back(std::make_shared<CRawBlock>());
+        vBlocks[i]->vchBlock.resize(10, i);
+    }
+
+    cache.Insert(uint256S("0x01"), vBlocks[0]);
+    cache.Insert(uint256S("0x02"), vBlocks[1]);
+    cache.Insert(uint256S("0x03"), vBlocks[2]);
+
+    // Using the first block makes the second the least recently used
+    BOOST_CHECK(cache.Get(uint256S("0x01")) == vBlocks[0]);
+    cache.Insert(uint256S("0x04"), vBlocks[3]);
+    BOOST_CHECK(!cache.Get(uint256S("0x02")));
+    BOOST_CHECK(cache.Get(uint256S("0x01")) == vBlocks[0]);
+    BOOST_CHECK(cache.Get(uint256S("0x03")) == vBlocks[2]);
+    BOOST_CHECK(cache.Get(uint256S("0x04")) == vBlocks[3]);
+
+    // Replacing a block doesn't evict others
+    cache.Insert(uint256S("0x03"), vBlocks[1]);
+    BOOST_CHECK(cache.Get(uint256S("0x03")) == vBlocks[1]);
+    BOOST_CHECK(cache.Get(uint256S("0x01")) == vBlocks[0]);
+    BOOST_CHECK(cache.Get(uint256S("0x04")) == vBlocks[3]);
+
+    cache.Clear();
+    BOOST_CHECK(!cache.Get(uint256S("0x01")));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
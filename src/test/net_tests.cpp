@@ -10,6 +10,10 @@
 #include <streams.h>
 #include <net.h>
 #include <chainparams.h>
+#include <scheduler.h>
+#include <utiltime.h>
+
+#include <boost/thread.hpp>
 
 using namespace std;
 
@@ -142,4 +146,77 @@ BOOST_AUTO_TEST_CASE(caddrdb_read_corrupted)
     BOOST_CHECK(addrman2.size() == 0);
 }
 
+BOOST_AUTO_TEST_CASE(dandelion_embargo_deadlines)
+{
+    uint256 tx = uint256S("0x01");
+    uint256 session = uint256S("0x02");
+    uint256 candidate = uint256S("0x03");
+
+    BOOST_CHECK(InsertDandelionEmbargo(tx, 300));
+    BOOST_CHECK(!InsertDandelionEmbargo(tx, 100));
+    BOOST_CHECK(InsertDandelionAggregationSessionEmbargo(session, 200));
+    BOOST_CHECK(InsertDandelionEncryptedCandidateEmbargo(candidate, 100));
+
+    // Only the expired embargoes are removed, earliest first
+    std::vector<std::pair<DandelionEmbargoType, uint256> > vExpired;
+    PopExpiredDandelionEmbargoes(99, vExpired);
+    BOOST_CHECK(vExpired.empty());
+    PopExpiredDandelionEmbargoes(200, vExpired);
+    BOOST_CHECK(vExpired.size() == 2);
+    BOOST_CHECK(vExpired[0] == std::make_pair(DANDELION_EMBARGO_ENCRYPTED_CANDIDATE, candidate));
+    BOOST_CHECK(vExpired[1] == std::make_pair(DANDELION_EMBARGO_AGGREGATION_SESSION, session));
+    BOOST_CHECK(!IsDandelionEncryptedCandidateEmbargoed(candidate));
+    BOOST_CHECK(!IsDandelionAggregationSessionEmbargoed(session));
+    BOOST_CHECK(IsTxDandelionEmbargoed(tx));
+
+    // A lifted embargo doesn't expire
+    BOOST_CHECK(RemoveDandelionEmbargo(tx));
+    BOOST_CHECK(!RemoveDandelionEmbargo(tx));
+    vExpired.clear();
+    PopExpiredDandelionEmbargoes(1000, vExpired);
+    BOOST_CHECK(vExpired.empty());
+}
+
+static std::vector<std::pair<DandelionEmbargoType, uint256> > vDandelionExpired;
+
+static void PopDandelionEmbargoes()
+{
+    PopExpiredDandelionEmbargoes(GetTimeMicros(), vDandelionExpired);
+}
+
+BOOST_AUTO_TEST_CASE(dandelion_embargo_scheduler)
+{
+    uint256 tx = uint256S("0x01");
+    uint256 session = uint256S("0x02");
+    uint256 candidate = uint256S("0x03");
+
+    // Set before the scheduler is known, as when the mempool is loaded
+    int64_t nNow = GetTimeMicros();
+    BOOST_CHECK(InsertDandelionEmbargo(tx, nNow + 60000));
+    BOOST_CHECK(InsertDandelionAggregationSessionEmbargo(session, nNow + 20000));
+
+    CScheduler scheduler;
+    SetDandelionEmbargoScheduler(&scheduler);
+    BOOST_CHECK(InsertDandelionEncryptedCandidateEmbargo(candidate, nNow + 40000));
+
+    // Only the earliest deadline wakes the scheduler, the others follow as it expires
+    boost::chrono::system_clock::time_point first, last;
+    BOOST_CHECK_EQUAL(scheduler.getQueueInfo(first, last), 1);
+    BOOST_CHECK(first == boost::chrono::system_clock::time_point(boost::chrono::microseconds(nNow + 20001)));
+
+    vDandelionExpired.clear();
+    GetNodeSignals().ExpireDandelionEmbargoes.connect(&PopDandelionEmbargoes);
+    boost::thread thread(boost::bind(&CScheduler::serviceQueue, &scheduler));
+    scheduler.stop(true);
+    thread.join();
+    GetNodeSignals().ExpireDandelionEmbargoes.disconnect(&PopDandelionEmbargoes);
+    SetDandelionEmbargoScheduler(nullptr);
+
+    BOOST_CHECK(vDandelionExpired.size() == 3);
+    BOOST_CHECK(vDandelionExpired[0] == std::make_pair(DANDELION_EMBARGO_AGGREGATION_SESSION, session));
+    BOOST_CHECK(vDandelionExpired[1] == std::make_pair(DANDELION_EMBARGO_ENCRYPTED_CANDIDATE, candidate));
+    BOOST_CHECK(vDandelionExpired[2] == std::make_pair(DANDELION_EMBARGO_TX, tx));
+    BOOST_CHECK(!IsTxDandelionEmbargoed(tx));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -6,6 +6,7 @@
 
 #include <test/test_navcoin.h>
 
+#include <blsct/scalar.h>
 #include <chainparams.h>
 #include <consensus/consensus.h>
 #include <consensus/validation.h>
@@ -32,6 +33,7 @@ extern void noui_connect();
 BasicTestingSetup::BasicTestingSetup(const std::string& chainName)
 {
         ECC_Start();
+        Scalar::Init();
         SetupEnvironment();
         SetupNetworking();
         fPrintToDebugLog = false; // don't want to write to debug.log file
@@ -62,7 +64,10 @@ TestingSetup::TestingSetup(const std::string& chainName) : BasicTestingSetup(cha
         InitBlockIndex(chainparams);
         nScriptCheckThreads = 3;
         for (int i=0; i < nScriptCheckThreads-1; i++)
+        {
             threadGroup.create_thread(&ThreadScriptCheck);
+            threadGroup.create_thread(&ThreadBLSCTCheck);
+        }
         RegisterNodeSignals(GetNodeSignals());
 }
 
@@ -13,6 +13,10 @@
 
 #include <stdint.h>
 
+#include <deque>
+#include <memory>
+
+#include <boost/bind.hpp>
 #include <boost/thread.hpp>
 
 using namespace std;
@@ -34,6 +38,15 @@ static const char DB_VOTEINDEX = 'C';
 static const char DB_CONSULTINDEX = 'K';
 static const char DB_ANSWERINDEX = 'A';
 static const char DB_CONSENSUSINDEX = 'p';
+static const char DB_PROP_STATE_INDEX = 'O';
+static const char DB_PREQ_STATE_INDEX = 'Q';
+static const char DB_PREQ_PROPOSAL_INDEX = 'P';
+static const char DB_VOTE_HEIGHT_INDEX = 'H';
+static const char DB_CONSULT_STATE_INDEX = 'S';
+static const char DB_DAO_INDEX_VERSION = 'I';
+
+//! Version of the secondary indexes over DAO entries, they are rebuilt when it changes
+static const int DAO_INDEX_VERSION = 3;
 
 static const char DB_BEST_BLOCK = 'B';
 static const char DB_FLAG = 'F';
@@ -245,6 +258,176 @@ bool CStateViewDB::GetAllConsultationAnswers(CConsultationAnswerMap &map) {
     return true;
 }
 
+// Reads the hashes indexed under key, which are stored after it in the index keys
+template <typename K, typename V>
+static bool ReadIndexedHashes(CDBWrapper& db, char chIndex, const K& key, std::set<V>& setHashes)
+{
+    setHashes.clear();
+
+    boost::scoped_ptr<CDBIterator> pcursor(db.NewIterator());
+
+    pcursor->Seek(make_pair(chIndex, make_pair(key, V())));
+
+    while (pcursor->Valid()) {
+        boost::this_thread::interruption_point();
+        std::pair<char, std::pair<K, V> > entry;
+        if (!pcursor->GetKey(entry) || entry.first != chIndex || entry.second.first != key)
+            break;
+        setHashes.insert(entry.second.second);
+        pcursor->Next();
+    }
+
+    return true;
+}
+
+bool CStateViewDB::GetPaymentRequestsForProposal(const uint256 &pid, std::set<uint256>& setHashes) {
+    return ReadIndexedHashes(db, DB_PREQ_PROPOSAL_INDEX, pid, setHashes);
+}
+
+bool CStateViewDB::GetProposalsByState(const flags &state, std::set<uint256>& setHashes) {
+    return ReadIndexedHashes(db, DB_PROP_STATE_INDEX, state, setHashes);
+}
+
+bool CStateViewDB::GetPaymentRequestsByState(const flags &state, std::set<uint256>& setHashes) {
+    return ReadIndexedHashes(db, DB_PREQ_STATE_INDEX, state, setHashes);
+}
+
+bool CStateViewDB::GetConsultationsByState(const flags &state, std::set<uint256>& setHashes) {
+    return ReadIndexedHashes(db, DB_CONSULT_STATE_INDEX, state, setHashes);
+}
+
+bool CStateViewDB::GetVotersAtHeight(const int &nHeight, std::set<CVoteMapKey>& setVoters) {
+    return ReadIndexedHashes(db, DB_VOTE_HEIGHT_INDEX, nHeight, setVoters);
+}
+
+static void IndexProposal(CDBBatch& batch, const uint256& hash, const CProposal& proposal, bool fErase)
+{
+    std::pair<char, std::pair<flags, uint256> > key = make_pair(DB_PROP_STATE_INDEX, make_pair(proposal.GetLastState(), hash));
+    if (fErase)
+        batch.Erase(key);
+    else
+        batch.Write(key, '1');
+}
+
+static void IndexConsultation(CDBBatch& batch, const uint256& hash, const CConsultation& consultation, bool fErase)
+{
+    std::pair<char, std::pair<flags, uint256> > key = make_pair(DB_CONSULT_STATE_INDEX, make_pair(consultation.GetLastState(), hash));
+    if (fErase)
+        batch.Erase(key);
+    else
+        batch.Write(key, '1');
+}
+
+static void IndexPaymentRequest(CDBBatch& batch, const uint256& hash, const CPaymentRequest& prequest, bool fErase)
+{
+    std::pair<char, std::pair<flags, uint256> > key = make_pair(DB_PREQ_STATE_INDEX, make_pair(prequest.GetLastState(), hash));
+    std::pair<char, std::pair<uint256, uint256> > keyProposal = make_pair(DB_PREQ_PROPOSAL_INDEX, make_pair(prequest.proposalhash, hash));
+    if (fErase) {
+        batch.Erase(key);
+        batch.Erase(keyProposal);
+    } else {
+        batch.Write(key, '1');
+        batch.Write(keyProposal, '1');
+    }
+}
+
+// Heights with an entry in the vote list, even an empty one, as those are the ones Clear(height) removes
+static void IndexVoter(CDBBatch& batch, const CVoteMapKey& voter, CVoteList& votes, bool fErase)
+{
+    std::map<int, std::map<uint256, int64_t>>* list = votes.GetFullList();
+    for (auto& it: *list)
+    {
+        std::pair<char, std::pair<int, CVoteMapKey> > key = make_pair(DB_VOTE_HEIGHT_INDEX, make_pair(it.first, voter));
+        if (fErase)
+            batch.Erase(key);
+        else
+            batch.Write(key, '1');
+    }
+}
+
+template <typename K, typename V = uint256>
+static void EraseIndex(CDBWrapper& db, CDBBatch& batch, char chIndex)
+{
+    boost::scoped_ptr<CDBIterator> pcursor(db.NewIterator());
+
+    pcursor->Seek(make_pair(chIndex, make_pair(K(), V())));
+
+    while (pcursor->Valid()) {
+        std::pair<char, std::pair<K, V> > key;
+        if (!pcursor->GetKey(key) || key.first != chIndex)
+            break;
+        batch.Erase(key);
+        pcursor->Next();
+    }
+}
+
+bool CStateViewDB::UpgradeDAOIndexes() {
+    int nVersion = 0;
+    if (db.Read(DB_DAO_INDEX_VERSION, nVersion) && nVersion == DAO_INDEX_VERSION)
+        return true;
+
+    CProposalMap mapProposals;
+    CPaymentRequestMap mapPaymentRequests;
+    CConsultationMap mapConsultations;
+    CVoteMap mapVotes;
+
+    if (!GetAllProposals(mapProposals) || !GetAllPaymentRequests(mapPaymentRequests) || !GetAllConsultations(mapConsultations) || !GetAllVotes(mapVotes))
+        return false;
+
+    LogPrintf("Indexing %u proposals, %u payment requests, %u consultations and %u voters...\n", mapProposals.size(), mapPaymentRequests.size(), mapConsultations.size(), mapVotes.size());
+
+    CDBBatch batch(db);
+
+    EraseIndex<flags>(db, batch, DB_PROP_STATE_INDEX);
+    EraseIndex<flags>(db, batch, DB_PREQ_STATE_INDEX);
+    EraseIndex<uint256>(db, batch, DB_PREQ_PROPOSAL_INDEX);
+    EraseIndex<flags>(db, batch, DB_CONSULT_STATE_INDEX);
+    EraseIndex<int, CVoteMapKey>(db, batch, DB_VOTE_HEIGHT_INDEX);
+
+    for (auto& it: mapProposals)
+        IndexProposal(batch, it.first, it.second, false);
+
+    for (auto& it: mapPaymentRequests)
+        IndexPaymentRequest(batch, it.first, it.second, false);
+
+    for (auto& it: mapConsultations)
+        IndexConsultation(batch, it.first, it.second, false);
+
+    for (auto& it: mapVotes)
+        IndexVoter(batch, it.first, it.second, false);
+
+    batch.Write(DB_DAO_INDEX_VERSION, DAO_INDEX_VERSION);
+
+    return db.WriteBatch(batch);
+}
+
+const CDAOStateCommitment* CStateViewDB::GetDAOStateCommitment(CDAOStateChanges& changes) {
+    if (!pdaoCommitment) {
+        CProposalMap mapProposals;
+        CPaymentRequestMap mapPaymentRequests;
+        CConsultationMap mapConsultations;
+        CConsultationAnswerMap mapAnswers;
+        CVoteMap mapVotes;
+
+        if (!GetAllProposals(mapProposals) || !GetAllPaymentRequests(mapPaymentRequests) ||
+                !GetAllConsultations(mapConsultations) || !GetAllConsultationAnswers(mapAnswers) ||
+                !GetAllVotes(mapVotes))
+            return NULL;
+
+        CDAOStateChanges entries;
+        AddDAOStateChanges(DAO_ENTRY_PROPOSAL, mapProposals, entries);
+        AddDAOStateChanges(DAO_ENTRY_PAYMENT_REQUEST, mapPaymentRequests, entries);
+        AddDAOStateChanges(DAO_ENTRY_CONSULTATION, mapConsultations, entries);
+        AddDAOStateChanges(DAO_ENTRY_ANSWER, mapAnswers, entries);
+        AddDAOStateChanges(DAO_ENTRY_VOTE, mapVotes, entries);
+
+        pdaoCommitment.reset(new CDAOStateCommitment());
+        pdaoCommitment->Update(entries);
+    }
+
+    return pdaoCommitment.get();
+}
+
 bool CStateViewDB::BatchWrite(CCoinsMap &mapCoins, CProposalMap &mapProposals,
                               CPaymentRequestMap &mapPaymentRequests, CVoteMap &mapVotes,
                               CConsultationMap &mapConsultations, CConsultationAnswerMap &mapAnswers,
@@ -254,6 +437,16 @@ bool CStateViewDB::BatchWrite(CCoinsMap &mapCoins, CProposalMap &mapProposals,
     CDBBatch batch(db);
     size_t count = 0;
     size_t changed = 0;
+
+    // Only the entries written are rehashed, before the maps are emptied below
+    CDAOStateChanges daoChanges;
+    if (pdaoCommitment) {
+        AddDAOStateChanges(DAO_ENTRY_PROPOSAL, mapProposals, daoChanges);
+        AddDAOStateChanges(DAO_ENTRY_PAYMENT_REQUEST, mapPaymentRequests, daoChanges);
+        AddDAOStateChanges(DAO_ENTRY_CONSULTATION, mapConsultations, daoChanges);
+        AddDAOStateChanges(DAO_ENTRY_ANSWER, mapAnswers, daoChanges);
+        AddDAOStateChanges(DAO_ENTRY_VOTE, mapVotes, daoChanges);
+    }
     for (CCoinsMap::iterator it = mapCoins.begin(); it != mapCoins.end();) {
         if (it->second.flags & CCoinsCacheEntry::DIRTY) {
             if (it->second.coins.IsPruned())
@@ -270,6 +463,12 @@ bool CStateViewDB::BatchWrite(CCoinsMap &mapCoins, CProposalMap &mapProposals,
     for (CProposalMap::iterator it = mapProposals.begin(); it != mapProposals.end();) {
         if (it->second.fDirty)
         {
+            CProposal old;
+            if (db.Read(make_pair(DB_PROPINDEX, it->first), old))
+                IndexProposal(batch, it->first, old, true);
+            if (!it->second.IsNull())
+                IndexProposal(batch, it->first, it->second, false);
+
             if (it->second.IsNull())
                 batch.Erase(make_pair(DB_PROPINDEX, it->first));
             else
@@ -294,6 +493,12 @@ bool CStateViewDB::BatchWrite(CCoinsMap &mapCoins, CProposalMap &mapProposals,
     for (CPaymentRequestMap::iterator it = mapPaymentRequests.begin(); it != mapPaymentRequests.end();) {
         if (it->second.fDirty)
         {
+            CPaymentRequest old;
+            if (db.Read(make_pair(DB_PREQINDEX, it->first), old))
+                IndexPaymentRequest(batch, it->first, old, true);
+            if (!it->second.IsNull())
+                IndexPaymentRequest(batch, it->first, it->second, false);
+
             if (it->second.IsNull())
                 batch.Erase(make_pair(DB_PREQINDEX, it->first));
             else
@@ -306,6 +511,12 @@ bool CStateViewDB::BatchWrite(CCoinsMap &mapCoins, CProposalMap &mapProposals,
     for (CConsultationMap::iterator it = mapConsultations.begin(); it != mapConsultations.end();) {
         if (it->second.fDirty)
         {
+            CConsultation old;
+            if (db.Read(make_pair(DB_CONSULTINDEX, it->first), old))
+                IndexConsultation(batch, it->first, old, true);
+            if (!it->second.IsNull())
+                IndexConsultation(batch, it->first, it->second, false);
+
             if (it->second.IsNull())
                 batch.Erase(make_pair(DB_CONSULTINDEX, it->first));
             else
@@ -330,6 +541,12 @@ bool CStateViewDB::BatchWrite(CCoinsMap &mapCoins, CProposalMap &mapProposals,
     for (CVoteMap::iterator it = mapVotes.begin(); it != mapVotes.end();) {
         if (it->second.fDirty)
         {
+            CVoteList old;
+            if (db.Read(make_pair(DB_VOTEINDEX, it->first), old))
+                IndexVoter(batch, it->first, old, true);
+            if (!it->second.IsNull())
+                IndexVoter(batch, it->first, it->second, false);
+
             if (it->second.IsNull())
                 batch.Erase(make_pair(DB_VOTEINDEX, it->first));
             else
@@ -346,7 +563,15 @@ bool CStateViewDB::BatchWrite(CCoinsMap &mapCoins, CProposalMap &mapProposals,
         batch.Write(DB_EXCLUDE_VOTES, nExcludeVotes);
 
     LogPrint("coindb", "Committing %u changed transactions (out of %u) to coin database...\n", (unsigned int)changed, (unsigned int)count);
-    return db.WriteBatch(batch);
+    if (!db.WriteBatch(batch)) {
+        pdaoCommitment.reset();
+        return false;
+    }
+
+    if (pdaoCommitment)
+        pdaoCommitment->Update(daoChanges);
+
+    return true;
 }
 
 CBlockTreeDB::CBlockTreeDB(size_t nCacheSize, bool fMemory, bool fWipe, bool compression, int maxOpenFiles) : CDBWrapper(GetDataDir() / "blocks" / "index", nCacheSize, fMemory, fWipe, false, compression, maxOpenFiles) {
@@ -803,31 +1028,148 @@ bool CBlockTreeDB::ReadFlag(const std::string &name, bool &fValue) {
     return true;
 }
 
-bool CBlockTreeDB::LoadBlockIndexGuts(boost::function<CBlockIndex*(const uint256&)> insertBlockIndex,
-                                      boost::function<std::vector<std::pair<uint256, int>>*(const uint256&)> insertProposalVotes,
-                                      boost::function<std::vector<std::pair<uint256, int>>*(const uint256&)> insertPaymentRequestVotes,
-                                      boost::function<std::map<uint256, bool>*(const uint256&)> insertSupport,
-                                      boost::function<std::map<uint256, uint64_t>*(const uint256&)> insertConsultationVotes)
+bool CBlockTreeDB::ReadBlockIndex(const uint256 &hash, CDiskBlockIndex &diskindex) {
+    return Read(make_pair(DB_BLOCK_INDEX, hash), diskindex);
+}
+
+/** Block index entries read from a range of the keyspace, with the hashes they are keyed by */
+typedef std::vector<std::pair<uint256, CDiskBlockIndex>> CBlockIndexBatch;
+
+/**
+ * Reading of the block index on startup. The keyspace is split in ranges of the
+ * first byte of the block hash, which are read and deserialized by their own
+ * thread, while the loading thread links the entries as they arrive.
+ */
+class CBlockIndexLoader
 {
-    boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
+public:
+    boost::mutex mutex;
+    boost::condition_variable cond;
+    std::deque<std::shared_ptr<CBlockIndexBatch>> queue;
+    size_t nMaxQueued;
+    //! Reader threads still running
+    int nRunning;
+    bool fStop;
+    std::string strError;
+
+    CBlockIndexLoader(size_t nMaxQueuedIn, int nRunningIn) : nMaxQueued(nMaxQueuedIn), nRunning(nRunningIn), fStop(false) {}
+
+    void Stop()
+    {
+        {
+            boost::unique_lock<boost::mutex> lock(mutex);
+            fStop = true;
+        }
+        cond.notify_all();
+    }
+};
+
+static const size_t BLOCK_INDEX_BATCH_SIZE = 1024;
 
-    pcursor->Seek(make_pair(DB_BLOCK_INDEX, uint256()));
+static void ThreadBlockIndexRead(CBlockTreeDB* pdb, CBlockIndexLoader* loader, int nBegin, int nEnd, bool fCheckHashes)
+{
+    RenameThread("navcoin-loadindex");
 
-    int nCount = 0;
+    boost::scoped_ptr<CDBIterator> pcursor(pdb->NewIterator());
 
-    // Load mapBlockIndex
-    while (pcursor->Valid()) {
-        if (++nCount % PROGRESS_INTERVAL == 0) {
-            // Update the progress
-            uiInterface.ShowProgress(_("Loading block guts..."), nCount);
-        }
-        boost::this_thread::interruption_point();
+    uint256 start;
+    *start.begin() = nBegin;
+    pcursor->Seek(make_pair(DB_BLOCK_INDEX, start));
+
+    std::shared_ptr<CBlockIndexBatch> batch(new CBlockIndexBatch());
+    std::string strError;
+    bool fStop = false;
+
+    while (!fStop && pcursor->Valid()) {
         std::pair<char, uint256> key;
-        if (pcursor->GetKey(key) && key.first == DB_BLOCK_INDEX) {
-            CDiskBlockIndex diskindex;
-            if (pcursor->GetValue(diskindex)) {
+        if (!pcursor->GetKey(key) || key.first != DB_BLOCK_INDEX || *key.second.begin() >= nEnd)
+            break;
+
+        batch->push_back(std::make_pair(key.second, CDiskBlockIndex()));
+        CDiskBlockIndex& diskindex = batch->back().second;
+        if (!pcursor->GetValue(diskindex)) {
+            strError = "failed to read value";
+            break;
+        }
+
+        // Entries are keyed by their block hash, so headers are only hashed again when asked to
+        if (fCheckHashes && diskindex.ComputeBlockHash() != key.second) {
+            strError = strprintf("block index entry %s does not match its header", key.second.ToString());
+            break;
+        }
+
+        // DAO votes stay on disk until they are needed
+        diskindex.fDAOVotesOnDisk = !diskindex.vProposalVotes.empty() || !diskindex.vPaymentRequestVotes.empty() ||
+                                    !diskindex.mapSupport.empty() || !diskindex.mapConsultationVotes.empty();
+        std::vector<std::pair<uint256, int>>().swap(diskindex.vProposalVotes);
+        std::vector<std::pair<uint256, int>>().swap(diskindex.vPaymentRequestVotes);
+        diskindex.mapSupport.clear();
+        diskindex.mapConsultationVotes.clear();
+
+        if (batch->size() == BLOCK_INDEX_BATCH_SIZE) {
+            boost::unique_lock<boost::mutex> lock(loader->mutex);
+            while (!loader->fStop && loader->queue.size() >= loader->nMaxQueued)
+                loader->cond.wait(lock);
+            fStop = loader->fStop;
+            loader->queue.push_back(batch);
+            batch.reset(new CBlockIndexBatch());
+            loader->cond.notify_all();
+        }
+
+        pcursor->Next();
+    }
+
+    {
+        boost::unique_lock<boost::mutex> lock(loader->mutex);
+        if (!batch->empty())
+            loader->queue.push_back(batch);
+        if (!strError.empty() && loader->strError.empty()) {
+            loader->strError = strError;
+            loader->fStop = true;
+        }
+        loader->nRunning--;
+    }
+    loader->cond.notify_all();
+}
+
+bool CBlockTreeDB::LoadBlockIndexGuts(boost::function<CBlockIndex*(const uint256&)> insertBlockIndex)
+{
+    int64_t nTimeStart = GetTimeMicros();
+
+    bool fCheckHashes = GetBoolArg("-checkblockhashes", DEFAULT_CHECKBLOCKHASHES);
+    int nThreads = std::max(1, std::min(GetNumCores(), MAX_BLOCK_INDEX_LOAD_THREADS));
+
+    CBlockIndexLoader loader(nThreads * 4, nThreads);
+    boost::thread_group threads;
+    for (int i = 0; i < nThreads; i++)
+        threads.create_thread(boost::bind(&ThreadBlockIndexRead, this, &loader, i * 256 / nThreads, (i + 1) * 256 / nThreads, fCheckHashes));
+
+    size_t nCount = 0;
+    int64_t nTimeLink = 0;
+
+    try {
+        // Load mapBlockIndex
+        while (true) {
+            std::shared_ptr<CBlockIndexBatch> batch;
+
+            {
+                boost::unique_lock<boost::mutex> lock(loader.mutex);
+                while (!loader.fStop && loader.queue.empty() && loader.nRunning > 0)
+                    loader.cond.wait(lock);
+                if (loader.fStop || loader.queue.empty())
+                    break;
+                batch = loader.queue.front();
+                loader.queue.pop_front();
+            }
+            loader.cond.notify_all();
+
+            int64_t nTimeLinkStart = GetTimeMicros();
+
+            for (const std::pair<uint256, CDiskBlockIndex>& entry: *batch) {
+                const CDiskBlockIndex& diskindex = entry.second;
+
                 // Construct block index object
-                CBlockIndex* pindexNew = insertBlockIndex(diskindex.GetBlockHash());
+                CBlockIndex* pindexNew = insertBlockIndex(entry.first);
                 pindexNew->pprev          = insertBlockIndex(diskindex.hashPrev);
                 pindexNew->nHeight        = diskindex.nHeight;
                 pindexNew->nFile          = diskindex.nFile;
@@ -843,7 +1185,6 @@ bool CBlockTreeDB::LoadBlockIndexGuts(boost::function<CBlockIndex*(const uint256
                 pindexNew->nMint          = diskindex.nMint;
                 pindexNew->nCFSupply      = diskindex.nCFSupply;
                 pindexNew->nCFLocked      = diskindex.nCFLocked;
-                pindexNew->strDZeel       = diskindex.strDZeel;
                 pindexNew->nFlags         = diskindex.nFlags;
                 pindexNew->nStakeModifier = diskindex.nStakeModifier;
                 pindexNew->hashProof      = diskindex.hashProof;
@@ -851,35 +1192,34 @@ bool CBlockTreeDB::LoadBlockIndexGuts(boost::function<CBlockIndex*(const uint256
                                           = diskindex.nPrivateMoneySupply;
                 pindexNew->nPublicMoneySupply
                                           = diskindex.nPublicMoneySupply;
-                if (diskindex.vProposalVotes.size() > 0)
-                {
-                    auto pVotes = insertProposalVotes(diskindex.GetBlockHash());
-                    *pVotes = diskindex.vProposalVotes;
-                }
-                if (diskindex.vPaymentRequestVotes.size() > 0)
-                {
-                    auto prVotes = insertPaymentRequestVotes(diskindex.GetBlockHash());
-                    *prVotes = diskindex.vPaymentRequestVotes;
-                }
-                if (diskindex.mapSupport.size() > 0)
-                {
-                    auto supp = insertSupport(diskindex.GetBlockHash());
-                    *supp = diskindex.mapSupport;
-                }
-                if (diskindex.mapConsultationVotes.size() > 0)
-                {
-                    auto cVotes = insertConsultationVotes(diskindex.GetBlockHash());
-                    *cVotes = diskindex.mapConsultationVotes;
-                }
+                pindexNew->fDAOVotesOnDisk = diskindex.fDAOVotesOnDisk;
+            }
 
-                pcursor->Next();
-            } else {
-                return error("LoadBlockIndex() : failed to read value");
+            nTimeLink += GetTimeMicros() - nTimeLinkStart;
+
+            if ((nCount + batch->size()) / PROGRESS_INTERVAL != nCount / PROGRESS_INTERVAL) {
+                // Update the progress
+                uiInterface.ShowProgress(_("Loading block guts..."), nCount + batch->size());
             }
-        } else {
-            break;
+            nCount += batch->size();
+
+            boost::this_thread::interruption_point();
         }
+    } catch (...) {
+        loader.Stop();
+        threads.join_all();
+        throw;
     }
 
+    loader.Stop();
+    threads.join_all();
+
+    if (!loader.strError.empty())
+        return error("%s: %s", __func__, loader.strError);
+
+    int64_t nTime = GetTimeMicros() - nTimeStart;
+    LogPrintf("%s: %u entries read on %d threads in %.2fs, %.2fs of it linking them\n", __func__,
+              nCount, nThreads, nTime * 0.000001, nTimeLink * 0.000001);
+
     return true;
 }
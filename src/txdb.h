@@ -16,6 +16,7 @@
 
 #include <functional>
 #include <map>
+#include <memory>
 #include <string>
 #include <utility>
 #include <vector>
@@ -23,6 +24,7 @@
 #include <boost/function.hpp>
 
 class CBlockIndex;
+class CDiskBlockIndex;
 class CStateViewDBCursor;
 class uint256;
 
@@ -46,6 +48,10 @@ static const int64_t nMaxBlockDBCache = 2;
 static const int64_t nMaxTxIndexCache = 1024;
 //! Max memory allocated to coin DB specific cache (MiB)
 static const int64_t nMaxCoinsDBCache = 8;
+//! -checkblockhashes default
+static const bool DEFAULT_CHECKBLOCKHASHES = false;
+//! Maximum number of threads reading the block index on startup
+static const int MAX_BLOCK_INDEX_LOAD_THREADS = 8;
 
 template<typename T, typename M, template<typename> class C = std::less>
 struct member_comparer : std::binary_function<T, T, bool>
@@ -97,6 +103,8 @@ class CStateViewDB : public CStateView
 {
 protected:
     CDBWrapper db;
+    //! Loaded from the DAO entries when first asked for, then updated by BatchWrite
+    std::unique_ptr<CDAOStateCommitment> pdaoCommitment;
 public:
     CStateViewDB(size_t nCacheSize, bool fMemory = false, bool fWipe = false);
 
@@ -126,7 +134,15 @@ public:
     bool GetAllVotes(CVoteMap &map);
     bool GetAllConsultations(CConsultationMap &map);
     bool GetAllConsultationAnswers(CConsultationAnswerMap &map);
+    bool GetPaymentRequestsForProposal(const uint256 &pid, std::set<uint256>& setHashes);
+    bool GetProposalsByState(const flags &state, std::set<uint256>& setHashes);
+    bool GetPaymentRequestsByState(const flags &state, std::set<uint256>& setHashes);
+    bool GetConsultationsByState(const flags &state, std::set<uint256>& setHashes);
+    bool GetVotersAtHeight(const int &nHeight, std::set<CVoteMapKey>& setVoters);
+    //! Builds the indexes of proposals, payment requests, consultations and voters if they are missing or outdated
+    bool UpgradeDAOIndexes();
     int GetExcludeVotes() const;
+    const CDAOStateCommitment* GetDAOStateCommitment(CDAOStateChanges& changes);
     CStateViewCursor *Cursor() const;
 };
 
@@ -189,11 +205,8 @@ public:
     bool ReadTimestampBlockIndex(const uint256 &hash, unsigned int &logicalTS);
     bool WriteFlag(const std::string &name, bool fValue);
     bool ReadFlag(const std::string &name, bool &fValue);
-    bool LoadBlockIndexGuts(boost::function<CBlockIndex*(const uint256&)> insertBlockIndex,
-                            boost::function<std::vector<std::pair<uint256, int>>*(const uint256&)> insertProposalVotes,
-                            boost::function<std::vector<std::pair<uint256, int>>*(const uint256&)> insertPaymentRequestVotes,
-                            boost::function<std::map<uint256, bool>*(const uint256&)> insertSupport,
-                            boost::function<std::map<uint256, uint64_t>*(const uint256&)> insertConsultationVotes);
+    bool ReadBlockIndex(const uint256 &hash, CDiskBlockIndex &diskindex);
+    bool LoadBlockIndexGuts(boost::function<CBlockIndex*(const uint256&)> insertBlockIndex);
     bool ReadProposalIndex(const uint256 &proposalid, CProposal &proposal);
     bool WriteProposalIndex(const std::vector<std::pair<uint256, CProposal> >&vect);
     bool GetProposalIndex(std::vector<CProposal>&vect);
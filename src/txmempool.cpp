@@ -475,6 +475,19 @@ bool CTxMemPool::addUnchecked(const uint256& hash, const CTxMemPoolEntry &entry,
         UpdateEntryForAncestors(newit, setAncestors);
     }
 
+    if (fBLSInput)
+    {
+        BLSCTCombineData data;
+        if (GetBLSCTCombineData(tx, data))
+        {
+            if (data.fBalanceSig)
+                blsctBalanceSigSum = blsctBalanceSigSum + data.balanceSig;
+            if (data.fTxSig)
+                blsctTxSigSum = blsctTxSigSum + data.txSig;
+            mapBLSCTCombine.insert(std::make_pair(hash, data));
+        }
+    }
+
     nTransactionsUpdated++;
     totalTxSize += entry.GetTxSize();
     minerPolicyEstimator->processTransaction(entry, fCurrentEstimate);
@@ -639,6 +652,16 @@ void CTxMemPool::removeUnchecked(txiter it)
     } else
         vTxHashes.clear();
 
+    std::map<uint256, BLSCTCombineData>::iterator itCombine = mapBLSCTCombine.find(hash);
+    if (itCombine != mapBLSCTCombine.end())
+    {
+        if (itCombine->second.fBalanceSig)
+            blsctBalanceSigSum = blsctBalanceSigSum + itCombine->second.balanceSig.Negate();
+        if (itCombine->second.fTxSig)
+            blsctTxSigSum = blsctTxSigSum + itCombine->second.txSig.Negate();
+        mapBLSCTCombine.erase(itCombine);
+    }
+
     totalTxSize -= it->GetTxSize();
     cachedInnerUsage -= it->DynamicMemoryUsage();
     cachedInnerUsage -= memusage::DynamicUsage(mapLinks[it].parents) + memusage::DynamicUsage(mapLinks[it].children);
@@ -807,6 +830,9 @@ void CTxMemPool::_clear()
     mapLinks.clear();
     mapTx.clear();
     mapNextTx.clear();
+    mapBLSCTCombine.clear();
+    blsctBalanceSigSum = bls::G2Element();
+    blsctTxSigSum = bls::G2Element();
     totalTxSize = 0;
     cachedInnerUsage = 0;
     lastRollingFeeUpdate = GetTime();
@@ -1257,6 +1283,39 @@ bool CStateViewMemPool::GetAllConsultations(CConsultationMap& mapConsultations)
     return true;
 }
 
+bool CStateViewMemPool::GetPaymentRequestsForProposal(const uint256 &pid, std::set<uint256>& setHashes) {
+    if (!base->GetPaymentRequestsForProposal(pid, setHashes))
+        return false;
+
+    for (auto& it: mempool.mapPaymentRequest)
+        if (it.second.proposalhash == pid)
+            setHashes.insert(it.first);
+
+    return true;
+}
+
+bool CStateViewMemPool::GetPaymentRequestsByState(const flags &state, std::set<uint256>& setHashes) {
+    if (!base->GetPaymentRequestsByState(state, setHashes))
+        return false;
+
+    for (auto& it: mempool.mapPaymentRequest)
+        if (it.second.GetLastState() == state)
+            setHashes.insert(it.first);
+
+    return true;
+}
+
+bool CStateViewMemPool::GetConsultationsByState(const flags &state, std::set<uint256>& setHashes) {
+    if (!base->GetConsultationsByState(state, setHashes))
+        return false;
+
+    for (auto& it: mempool.mapConsultation)
+        if (it.second.GetLastState() == state)
+            setHashes.insert(it.first);
+
+    return true;
+}
+
 bool CStateViewMemPool::HaveCoins(const uint256 &txid) const {
     return mempool.exists(txid) || base->HaveCoins(txid);
 }
@@ -1297,10 +1356,27 @@ bool CStateViewMemPool::AddConsultationAnswer(const CConsultationAnswer& answer)
     return const_cast<CTxMemPool&>(mempool).AddConsultationAnswer(answer);
 }
 
+bool CTxMemPool::GetBLSCTCombineData(const uint256& hash, BLSCTCombineData& data) const
+{
+    LOCK(cs);
+    std::map<uint256, BLSCTCombineData>::const_iterator it = mapBLSCTCombine.find(hash);
+    if (it == mapBLSCTCombine.end())
+        return false;
+    data = it->second;
+    return true;
+}
+
+void CTxMemPool::GetBLSCTSignatureSums(bls::G2Element& balanceSig, bls::G2Element& txSig) const
+{
+    LOCK(cs);
+    balanceSig = blsctBalanceSigSum;
+    txSig = blsctTxSigSum;
+}
+
 size_t CTxMemPool::DynamicMemoryUsage() const {
     LOCK(cs);
     // Estimate the overhead of mapTx to be 15 pointers + an allocation, as no exact formula for boost::multi_index_contained is implemented.
-    return memusage::MallocUsage(sizeof(CTxMemPoolEntry) + 15 * sizeof(void*)) * mapTx.size() + memusage::DynamicUsage(mapNextTx) + memusage::DynamicUsage(mapDeltas) + memusage::DynamicUsage(mapLinks) + memusage::DynamicUsage(vTxHashes) + cachedInnerUsage;
+    return memusage::MallocUsage(sizeof(CTxMemPoolEntry) + 15 * sizeof(void*)) * mapTx.size() + memusage::DynamicUsage(mapNextTx) + memusage::DynamicUsage(mapDeltas) + memusage::DynamicUsage(mapLinks) + memusage::DynamicUsage(vTxHashes) + memusage::DynamicUsage(mapBLSCTCombine) + cachedInnerUsage;
 }
 
 void CTxMemPool::RemoveStaged(setEntries &stage, bool updateDescendants) {
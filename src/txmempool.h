@@ -509,6 +509,11 @@ private:
     typedef std::map<uint256, std::vector<CSpentIndexKey> > mapSpentIndexInserted;
     mapSpentIndexInserted mapSpentInserted;
 
+    //! Signatures of the BLSCT transactions in the pool, parsed when they are accepted, and their sums
+    std::map<uint256, BLSCTCombineData> mapBLSCTCombine;
+    bls::G2Element blsctBalanceSigSum;
+    bls::G2Element blsctTxSigSum;
+
     void UpdateParent(txiter entry, txiter parent, bool add);
     void UpdateChild(txiter entry, txiter child, bool add);
 
@@ -556,6 +561,10 @@ public:
     bool getSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value);
     bool removeSpentIndex(const uint256 txhash);
 
+    bool GetBLSCTCombineData(const uint256& hash, BLSCTCombineData& data) const;
+    /** Sums of the balance and transaction signatures of every BLSCT transaction with combine data */
+    void GetBLSCTSignatureSums(bls::G2Element& balanceSig, bls::G2Element& txSig) const;
+
     void removeRecursive(const CTransaction &tx, std::list<CTransaction>& removed);
     void removeForReorg(const CStateViewCache *pcoins, unsigned int nMemPoolHeight, int flags);
     void removeConflicts(const CTransaction &tx, std::list<CTransaction>& removed);
@@ -803,6 +812,9 @@ public:
     bool GetAllPaymentRequests(CPaymentRequestMap& mapPaymentRequests);
     bool GetAllConsultationAnswers(CConsultationAnswerMap& mapConsultationAnswers);
     bool GetAllConsultations(CConsultationMap& mapConsultations);
+    bool GetPaymentRequestsForProposal(const uint256 &pid, std::set<uint256>& setHashes);
+    bool GetPaymentRequestsByState(const flags &state, std::set<uint256>& setHashes);
+    bool GetConsultationsByState(const flags &state, std::set<uint256>& setHashes);
     bool AddProposal(const CProposal& proposal) const;
     bool AddPaymentRequest(const CPaymentRequest& prequest) const;
     bool AddConsultation(const CConsultation& consultation) const;
@@ -375,8 +375,8 @@ bool CCryptoKeyStore::GetBLSCTSubAddressSpendingKeyForOutput(const std::pair<uin
         // Hs(a*R) + b + Hs("SubAddress\0" || a || acc || index)
         bls::G1Element t = bls::G1Element::FromByteVector(outputKey);
         Scalar s_ = privateBlsViewKey.GetScalar();
-        t = t * s_.bn;
-        k = blsctKey(bls::PrivateKey::FromBN((Scalar(HashG1Element(t, 0)) + s.GetScalar() + Scalar(string.GetHash())).bn));
+        t = t * s_;
+        k = blsctKey((Scalar(HashG1Element(t, 0)) + s.GetScalar() + Scalar(string.GetHash())).GetPrivateKey());
     }
     catch(...)
     {
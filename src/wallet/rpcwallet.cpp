@@ -4350,16 +4350,16 @@ UniValue proposalvotelist(const UniValue& params, bool fHelp)
     UniValue absvotes(UniValue::VARR);
     UniValue nullvotes(UniValue::VARR);
 
-    CProposalMap mapProposals;
+    std::set<uint256> setProposals;
     CStateViewCache view(pcoinsTip);
 
-    if(view.GetAllProposals(mapProposals))
+    if(view.GetProposalsByState(DAOFlags::NIL, setProposals))
     {
-        for (CProposalMap::iterator it_ = mapProposals.begin(); it_ != mapProposals.end(); it_++)
+        for (auto& it_: setProposals)
         {
             CProposal proposal;
 
-            if (!view.GetProposal(it_->first, proposal))
+            if (!view.GetProposal(it_, proposal))
                 continue;
 
             if (proposal.GetLastState() != DAOFlags::NIL)
@@ -4780,16 +4780,16 @@ UniValue paymentrequestvotelist(const UniValue& params, bool fHelp)
     UniValue absvotes(UniValue::VARR);
     UniValue nullvotes(UniValue::VARR);
 
-    CPaymentRequestMap mapPaymentRequests;
+    std::set<uint256> setPaymentRequests;
     CStateViewCache view(pcoinsTip);
 
-    if(view.GetAllPaymentRequests(mapPaymentRequests))
+    if(view.GetPaymentRequestsByState(DAOFlags::NIL, setPaymentRequests))
     {
-        for (CPaymentRequestMap::iterator it_ = mapPaymentRequests.begin(); it_ != mapPaymentRequests.end(); it_++)
+        for (auto& it_: setPaymentRequests)
         {
             CPaymentRequest prequest;
 
-            if (!view.GetPaymentRequest(it_->first, prequest))
+            if (!view.GetPaymentRequest(it_, prequest))
                 continue;
 
             if (prequest.GetLastState() != DAOFlags::NIL)
@@ -4935,15 +4935,44 @@ UniValue listproposals(const UniValue& params, bool fHelp)
         }
     }
 
-    CProposalMap mapProposals;
+    std::set<uint256> setProposals;
     CStateViewCache view(pcoinsTip);
+    bool fFound = true;
 
-    if(view.GetAllProposals(mapProposals))
+    // Ownership and expiration are not states, otherwise only the proposals in the states asked for are read
+    if (showAll || showMine || showExpired)
     {
-        for (CProposalMap::iterator it = mapProposals.begin(); it != mapProposals.end(); it++)
+        CProposalMap mapProposals;
+        fFound = view.GetAllProposals(mapProposals);
+        for (auto& it: mapProposals)
+            setProposals.insert(it.first);
+    }
+    else
+    {
+        std::set<flags> setStates;
+        if (showPending)
+            setStates.insert({DAOFlags::NIL, DAOFlags::PENDING_VOTING_PREQ, DAOFlags::PENDING_FUNDS});
+        if (showAccepted)
+            setStates.insert(DAOFlags::ACCEPTED);
+        if (showAcceptedExpired)
+            setStates.insert(DAOFlags::ACCEPTED_EXPIRED);
+        if (showRejected)
+            setStates.insert(DAOFlags::REJECTED);
+
+        for (auto& state: setStates)
+        {
+            std::set<uint256> setHashes;
+            fFound = fFound && view.GetProposalsByState(state, setHashes);
+            setProposals.insert(setHashes.begin(), setHashes.end());
+        }
+    }
+
+    if(fFound)
+    {
+        for (auto& hash: setProposals)
         {
             CProposal proposal;
-            if (!view.GetProposal(it->first, proposal))
+            if (!view.GetProposal(hash, proposal))
                 continue;
 
             flags fLastState = proposal.GetLastState();
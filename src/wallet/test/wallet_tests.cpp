@@ -4,6 +4,11 @@
 
 #include <wallet/wallet.h>
 
+#include <chain.h>
+#include <main.h>
+#include <wallet/walletdb.h>
+
+#include <limits>
 #include <set>
 #include <stdint.h>
 #include <utility>
@@ -350,4 +355,127 @@ BOOST_AUTO_TEST_CASE(ApproximateBestSubset)
     BOOST_CHECK_EQUAL(setCoinsRet.size(), 2U);
 }
 
+// Outputs AvailableCoinsForStaking() used to find scanning the whole wallet
+static set<COutPoint> ScanStakeableCoins()
+{
+    LOCK2(cs_main, pwalletMain->cs_wallet);
+    set<COutPoint> setCoins;
+    CAmount nMinimumInputValue = GetArg("-mininputvalue", 1 * COIN);
+    for (const pair<const uint256, CWalletTx>& it: pwalletMain->mapWallet)
+    {
+        const CWalletTx& wtx = it.second;
+        if (wtx.GetBlocksToMaturity() > 0 || wtx.isAbandoned() || wtx.GetDepthInMainChain() < 1)
+            continue;
+        for (unsigned int i = 0; i < wtx.vout.size(); i++)
+            if (!pwalletMain->IsSpent(it.first, i) && pwalletMain->IsMine(wtx.vout[i]) &&
+                    wtx.vout[i].nValue >= nMinimumInputValue && !wtx.vout[i].HasRangeProof())
+                setCoins.insert(COutPoint(it.first, i));
+    }
+    return setCoins;
+}
+
+static set<COutPoint> StakeableCoins()
+{
+    vector<COutput> vStakeable;
+    pwalletMain->AvailableCoinsForStaking(vStakeable, std::numeric_limits<unsigned int>::max());
+    set<COutPoint> setCoins;
+    for (const COutput& out: vStakeable)
+        setCoins.insert(COutPoint(out.tx->GetHash(), out.i));
+    BOOST_CHECK_EQUAL(setCoins.size(), vStakeable.size());
+    return setCoins;
+}
+
+static CWalletTx StakeableTestTx(const CScript& scriptPubKey, const vector<CAmount>& vValues, const COutPoint& prevout, const CBlockIndex* pindex)
+{
+    static unsigned int nextLockTime = 0;
+    CMutableTransaction tx;
+    tx.nTime = 1;
+    tx.nLockTime = nextLockTime++;
+    tx.vin.push_back(CTxIn(prevout));
+    for (const CAmount& nValue: vValues)
+        tx.vout.push_back(CTxOut(nValue, scriptPubKey));
+    CWalletTx wtx(pwalletMain, tx);
+    if (pindex)
+    {
+        wtx.hashBlock = pindex->GetBlockHash();
+        wtx.nIndex = 0;
+    }
+    return wtx;
+}
+
+BOOST_AUTO_TEST_CASE(stakeable_coins_index)
+{
+    CKey key;
+    key.MakeNewKey(true);
+    BOOST_REQUIRE(pwalletMain->AddKey(key));
+    CScript scriptPubKey = GetScriptForDestination(key.GetPubKey().GetID());
+    CWalletDB walletdb(pwalletMain->strWalletFile);
+
+    // Two chains forking after the genesis, 0-1-2 and 0-3-4
+    const int vHeight[] = {0, 1, 2, 1, 2};
+    const int vPrev[] = {-1, 0, 1, 0, 3};
+    vector<uint256> vHashes;
+    for (int i = 0; i < 5; i++)
+        vHashes.push_back(ArithToUint256(arith_uint256(i + 1)));
+    vector<CBlockIndex> vIndex(5);
+    {
+        LOCK(cs_main);
+        for (int i = 0; i < 5; i++)
+        {
+            vIndex[i].phashBlock = &vHashes[i];
+            vIndex[i].nHeight = vHeight[i];
+            vIndex[i].pprev = vPrev[i] < 0 ? nullptr : &vIndex[vPrev[i]];
+            mapBlockIndex[vHashes[i]] = &vIndex[i];
+        }
+        chainActive.SetTip(&vIndex[2]);
+    }
+    BOOST_CHECK(StakeableCoins() == ScanStakeableCoins());
+
+    // Confirmed outputs, one below the minimum input value
+    CWalletTx wtx1 = StakeableTestTx(scriptPubKey, {10 * COIN, COIN / 2, 2 * COIN}, COutPoint(), &vIndex[1]);
+    BOOST_CHECK(pwalletMain->AddToWallet(wtx1, false, &walletdb));
+    BOOST_CHECK(StakeableCoins() == ScanStakeableCoins());
+    BOOST_CHECK_EQUAL(StakeableCoins().size(), 2);
+
+    // Spent by an unconfirmed transaction, until it is abandoned
+    CWalletTx wtx2 = StakeableTestTx(scriptPubKey, {5 * COIN}, COutPoint(wtx1.GetHash(), 0), nullptr);
+    BOOST_CHECK(pwalletMain->AddToWallet(wtx2, false, &walletdb));
+    BOOST_CHECK(StakeableCoins() == ScanStakeableCoins());
+    BOOST_CHECK_EQUAL(StakeableCoins().size(), 1);
+
+    BOOST_CHECK(pwalletMain->AbandonTransaction(wtx2.GetHash()));
+    BOOST_CHECK(StakeableCoins() == ScanStakeableCoins());
+    BOOST_CHECK_EQUAL(StakeableCoins().size(), 2);
+
+    // Spent by a transaction conflicting with the tip
+    CWalletTx wtx3 = StakeableTestTx(scriptPubKey, {5 * COIN}, COutPoint(wtx1.GetHash(), 2), nullptr);
+    BOOST_CHECK(pwalletMain->AddToWallet(wtx3, false, &walletdb));
+    BOOST_CHECK(StakeableCoins() == ScanStakeableCoins());
+    BOOST_CHECK_EQUAL(StakeableCoins().size(), 1);
+
+    pwalletMain->MarkConflicted(vHashes[2], wtx3.GetHash());
+    BOOST_CHECK(StakeableCoins() == ScanStakeableCoins());
+    BOOST_CHECK_EQUAL(StakeableCoins().size(), 2);
+
+    // Confirmed in the other chain, which the tip then moves to
+    CWalletTx wtx4 = StakeableTestTx(scriptPubKey, {3 * COIN}, COutPoint(), &vIndex[4]);
+    BOOST_CHECK(pwalletMain->AddToWallet(wtx4, false, &walletdb));
+    BOOST_CHECK(StakeableCoins() == ScanStakeableCoins());
+    BOOST_CHECK_EQUAL(StakeableCoins().size(), 2);
+
+    {
+        LOCK(cs_main);
+        chainActive.SetTip(&vIndex[4]);
+    }
+    BOOST_CHECK(StakeableCoins() == ScanStakeableCoins());
+    BOOST_CHECK(StakeableCoins() == set<COutPoint>({COutPoint(wtx4.GetHash(), 0)}));
+
+    {
+        LOCK(cs_main);
+        chainActive.SetTip(NULL);
+        for (int i = 0; i < 5; i++)
+            mapBlockIndex.erase(vHashes[i]);
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
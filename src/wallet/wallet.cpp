@@ -32,6 +32,9 @@
 
 #include <assert.h>
 
+#include <deque>
+#include <memory>
+
 #include <boost/algorithm/string/replace.hpp>
 #include <boost/filesystem.hpp>
 #include <boost/thread.hpp>
@@ -313,6 +316,97 @@ uint64_t CWallet::GetStakeWeight() const
     return nWeight;
 }
 
+void CWallet::MarkStakeableDirty(const uint256& hash) const
+{
+    AssertLockHeld(cs_wallet);
+    setStakeableDirty.insert(hash);
+}
+
+void CWallet::UpdateStakeableCoins(const uint256& hash) const
+{
+    AssertLockHeld(cs_main);
+    AssertLockHeld(cs_wallet);
+
+    // Drop the outputs of the transaction from the index
+    std::map<uint256, int64_t>::iterator itTx = mapStakeableTxs.find(hash);
+    if (itTx != mapStakeableTxs.end())
+    {
+        std::map<int64_t, std::set<COutPoint> >::iterator itBucket = mapStakeableCoins.find(itTx->second);
+        if (itBucket != mapStakeableCoins.end())
+        {
+            std::set<COutPoint>& bucket = itBucket->second;
+            bucket.erase(bucket.lower_bound(COutPoint(hash, 0)), bucket.upper_bound(COutPoint(hash, (uint32_t) -1)));
+            if (bucket.empty())
+                mapStakeableCoins.erase(itBucket);
+        }
+        mapStakeableTxs.erase(itTx);
+    }
+    setStakeableImmature.erase(hash);
+
+    // And add back the ones which can currently stake
+    map<uint256, CWalletTx>::const_iterator it = mapWallet.find(hash);
+    if (it == mapWallet.end())
+        return;
+
+    const CWalletTx* pcoin = &(*it).second;
+
+    if (pcoin->isAbandoned())
+        return;
+
+    if (pcoin->GetDepthInMainChain() < 1)
+        return;
+
+    if (pcoin->GetBlocksToMaturity() > 0)
+    {
+        setStakeableImmature.insert(hash);
+        return;
+    }
+
+    int64_t nStakeableTime = pcoin->nTime + Params().GetConsensus().nStakeMinAge;
+
+    for (unsigned int i = 0; i < pcoin->vout.size(); i++)
+    {
+        if (!(IsSpent(hash,i)) && IsMine(pcoin->vout[i]) && pcoin->vout[i].nValue >= nStakeableMinInputValue && !pcoin->vout[i].HasRangeProof())
+        {
+            mapStakeableCoins[nStakeableTime].insert(COutPoint(hash, i));
+            mapStakeableTxs[hash] = nStakeableTime;
+        }
+    }
+}
+
+void CWallet::UpdateStakeableCoins() const
+{
+    AssertLockHeld(cs_main);
+    AssertLockHeld(cs_wallet);
+
+    const CBlockIndex* pindexTip = chainActive.Tip();
+
+    if (pindexStakeable == NULL || !chainActive.Contains(pindexStakeable) || nStakeableMinInputValue != nMinimumInputValue)
+    {
+        // First use, reorganization or new keys: check every transaction again
+        mapStakeableCoins.clear();
+        mapStakeableTxs.clear();
+        setStakeableImmature.clear();
+        setStakeableDirty.clear();
+        nStakeableMinInputValue = nMinimumInputValue;
+
+        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
+            setStakeableDirty.insert(it->first);
+    }
+    else if (pindexStakeable != pindexTip)
+    {
+        // Coinbases and coinstakes mature as blocks are connected
+        setStakeableDirty.insert(setStakeableImmature.begin(), setStakeableImmature.end());
+    }
+
+    pindexStakeable = pindexTip;
+
+    for (const uint256& hash: setStakeableDirty)
+        UpdateStakeableCoins(hash);
+
+    setStakeableDirty.clear();
+}
+
 void CWallet::AvailableCoinsForStaking(vector<COutput>& vCoins, unsigned int nSpendTime) const
 {
     vCoins.clear();
@@ -321,36 +415,29 @@ void CWallet::AvailableCoinsForStaking(vector<COutput>& vCoins, unsigned int nSp
 
     {
         LOCK2(cs_main, cs_wallet);
-        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
-        {
-            const CWalletTx* pcoin = &(*it).second;
-            const uint256& wtxid = it->first;
 
-            // Filtering by tx timestamp instead of block timestamp may give false positives but never false negatives
-            if (pcoin->nTime + Params().GetConsensus().nStakeMinAge > nSpendTime)
-                continue;
-
-            if (pcoin->GetBlocksToMaturity() > 0)
-                continue;
-
-            if (pcoin->isAbandoned())
-                continue;
+        UpdateStakeableCoins();
 
-            int nDepth = pcoin->GetDepthInMainChain();
-            if (nDepth < 1)
-                continue;
+        bool fColdStakingEnabled = IsColdStakingEnabled(chainActive.Tip(), Params().GetConsensus());
 
-            for (unsigned int i = 0; i < pcoin->vout.size(); i++)
+        // Filtering by tx timestamp instead of block timestamp may give false positives but never false negatives
+        for (std::map<int64_t, std::set<COutPoint> >::const_iterator itBucket = mapStakeableCoins.begin();
+             itBucket != mapStakeableCoins.end() && itBucket->first <= (int64_t)nSpendTime; ++itBucket)
+        {
+            for (const COutPoint& out: itBucket->second)
             {
-                auto ismine = IsMine(pcoin->vout[i]);
-                if (!(IsSpent(wtxid,i)) && ismine  && pcoin->vout[i].nValue >= nMinimumInputValue && !pcoin->vout[i].HasRangeProof()){
-                    vCoins.push_back(COutput(pcoin, i, nDepth, true,
-                                           ((ismine & (ISMINE_SPENDABLE)) != ISMINE_NO &&
-                                           !pcoin->vout[i].scriptPubKey.IsColdStaking() &&
-                                           !pcoin->vout[i].scriptPubKey.IsColdStakingv2()) ||
-                                           ((ismine & (ISMINE_STAKABLE)) != ISMINE_NO &&
-                                           IsColdStakingEnabled(chainActive.Tip(), Params().GetConsensus()))));
-                }
+                map<uint256, CWalletTx>::const_iterator it = mapWallet.find(out.hash);
+                if (it == mapWallet.end())
+                    continue;
+
+                const CWalletTx* pcoin = &(*it).second;
+                auto ismine = IsMine(pcoin->vout[out.n]);
+                vCoins.push_back(COutput(pcoin, out.n, pcoin->GetDepthInMainChain(), true,
+                                       ((ismine & (ISMINE_SPENDABLE)) != ISMINE_NO &&
+                                       !pcoin->vout[out.n].scriptPubKey.IsColdStaking() &&
+                                       !pcoin->vout[out.n].scriptPubKey.IsColdStakingv2()) ||
+                                       ((ismine & (ISMINE_STAKABLE)) != ISMINE_NO &&
+                                       fColdStakingEnabled)));
             }
         }
     }
@@ -400,6 +487,32 @@ bool CWallet::SelectCoinsForStaking(int64_t nTargetValue, unsigned int nSpendTim
     return true;
 }
 
+bool CWallet::FindStakeKernel(const CBlockIndex* pindexPrev, unsigned int nBits, unsigned int nTime) const
+{
+    int64_t nBalance = GetBalance() + GetColdStakingBalance();
+
+    if (nBalance <= nReserveBalance)
+        return false;
+
+    set<pair<const CWalletTx*,unsigned int> > setCoins;
+    int64_t nValueIn = 0;
+
+    if (!SelectCoinsForStaking(nBalance - nReserveBalance, nTime, setCoins, nValueIn) || setCoins.empty())
+        return false;
+
+    std::vector<COutPoint> vPrevouts;
+    for(PAIRTYPE(const CWalletTx*, unsigned int) pcoin: setCoins)
+        vPrevouts.push_back(COutPoint(pcoin.first->GetHash(), pcoin.second));
+
+    CStateViewCache view(pcoinsTip);
+
+    std::vector<CStakeKernel> vKernels;
+    PrepareStakeKernels(pindexPrev, nBits, vPrevouts, view, vKernels);
+
+    unsigned int nTimeKernel;
+    return SearchStakeKernels(vKernels, nTime, 1, nTimeKernel) >= 0;
+}
+
 bool CWallet::CreateCoinStake(const CKeyStore& keystore, unsigned int nBits, int64_t nSearchInterval, int64_t nFees, CMutableTransaction& txNew, CKey& key, CScript& kernelScriptPubKey)
 {
     CBlockIndex* pindexPrev = chainActive.Tip();
@@ -434,93 +547,102 @@ bool CWallet::CreateCoinStake(const CKeyStore& keystore, unsigned int nBits, int
 
     CStateViewCache view(pcoinsTip);
 
+    std::vector<COutPoint> vPrevouts;
+    for(PAIRTYPE(const CWalletTx*, unsigned int) pcoin: setCoins)
+        vPrevouts.push_back(COutPoint(pcoin.first->GetHash(), pcoin.second));
+
+    std::vector<CStakeKernel> vKernels;
+    PrepareStakeKernels(pindexPrev, nBits, vPrevouts, view, vKernels);
+
+    static int nMaxStakeSearchInterval = 60;
+    unsigned int nKernelSearchInterval = min(nSearchInterval,(int64_t)nMaxStakeSearchInterval);
+
     int64_t nCredit = 0;
     CScript scriptPubKeyKernel;
-    for(PAIRTYPE(const CWalletTx*, unsigned int) pcoin: setCoins)
-    {
-        static int nMaxStakeSearchInterval = 60;
-        bool fKernelFound = false;
-        for (unsigned int n=0; n<min(nSearchInterval,(int64_t)nMaxStakeSearchInterval) && !fKernelFound && pindexPrev == chainActive.Tip(); n++)
-        {
-            boost::this_thread::interruption_point();
-            // Search backward in time from the given txNew timestamp
-            // Search nSearchInterval seconds back up to nMaxStakeSearchInterval
-            COutPoint prevoutStake = COutPoint(pcoin.first->GetHash(), pcoin.second);
-            int64_t nBlockTime;
-            if (CheckKernel(pindexPrev, nBits, txNew.nTime - n, prevoutStake, view, &nBlockTime))
-            {
-                // Found a kernel
-                LogPrint("coinstake", "CreateCoinStake : kernel found\n");
-                vector<std::vector<unsigned char>> vSolutions;
-                txnouttype whichType;
-                CScript scriptPubKeyOut;
-                scriptPubKeyKernel = pcoin.first->vout[pcoin.second].scriptPubKey;
-                if (!Solver(scriptPubKeyKernel, whichType, vSolutions))
-                {
-                    LogPrint("coinstake", "CreateCoinStake : failed to parse kernel\n");
-                    break;
-                }
-                LogPrint("coinstake", "CreateCoinStake : parsed kernel type=%d\n", whichType);
-                if (whichType != TX_PUBKEY && whichType != TX_PUBKEYHASH && whichType != TX_COLDSTAKING && whichType != TX_COLDSTAKING_V2)
-                {
-                    LogPrint("coinstake", "CreateCoinStake : no support for kernel type=%d\n", whichType);
-                    break;  // only support pay to public key and pay to address
-                }
-                if (whichType == TX_COLDSTAKING || whichType == TX_COLDSTAKING_V2) // cold staking
-                {
-                    // try to find staking key
-                    if (!keystore.GetKey(uint160(vSolutions[0]), key))
-                    {
-                        LogPrint("coinstake", "CreateCoinStake : failed to get key for kernel type=%d\n", whichType);
-                        break;  // unable to find corresponding public key
-                    } else {
-                        // we keep the same script
-                        scriptPubKeyOut = scriptPubKeyKernel;
-                    }
-                }
-                if (whichType == TX_PUBKEYHASH) // pay to address type
-                {
-                    // convert to pay to public key type
-                    if (!keystore.GetKey(uint160(vSolutions[0]), key))
-                    {
-                        LogPrint("coinstake", "CreateCoinStake : failed to get key for kernel type=%d\n", whichType);
-                        break;  // unable to find corresponding public key
-                    }
-                    scriptPubKeyOut << ToByteVector(key.GetPubKey()) << OP_CHECKSIG;
-                }
-                if (whichType == TX_PUBKEY)
-                {
-                    std::vector<unsigned char>& vchPubKey = vSolutions[0];
-                    if (!keystore.GetKey(Hash160(vchPubKey), key))
-                    {
-                        LogPrint("coinstake", "CreateCoinStake : failed to get key for kernel type=%d\n", whichType);
-                        break;  // unable to find corresponding public key
-                    }
+    bool fKernelFound = false;
+    while (!fKernelFound && pindexPrev == chainActive.Tip())
+    {
+        boost::this_thread::interruption_point();
+        // Search backward in time from the given txNew timestamp
+        // Search nSearchInterval seconds back up to nMaxStakeSearchInterval
+        unsigned int nTimeKernel;
+        int nKernel = SearchStakeKernels(vKernels, txNew.nTime, nKernelSearchInterval, nTimeKernel);
+        if (nKernel < 0)
+            break;
 
-                    if (key.GetPubKey() != vchPubKey)
-                    {
-                        LogPrint("coinstake", "CreateCoinStake : invalid key for kernel type=%d\n", whichType);
-                        break; // keys mismatch
-                    }
+        // Found a kernel, it is not tried again if it can't be used
+        COutPoint prevoutStake = vKernels[nKernel].prevout;
+        vKernels.erase(vKernels.begin() + nKernel);
 
-                    scriptPubKeyOut = scriptPubKeyKernel;
-                }
+        const CWalletTx* pcoin = GetWalletTx(prevoutStake.hash);
+        if (!pcoin)
+            continue;
 
-                txNew.nTime -= n;
-                txNew.vin.push_back(CTxIn(pcoin.first->GetHash(), pcoin.second));
-                nCredit += pcoin.first->vout[pcoin.second].nValue;
-                vwtxPrev.insert(make_pair(pcoin.first,pcoin.second));
-                txNew.vout.push_back(CTxOut(0, scriptPubKeyOut));
-                kernelScriptPubKey = scriptPubKeyKernel;
+        LogPrint("coinstake", "CreateCoinStake : kernel found\n");
+        vector<std::vector<unsigned char>> vSolutions;
+        txnouttype whichType;
+        CScript scriptPubKeyOut;
+        scriptPubKeyKernel = pcoin->vout[prevoutStake.n].scriptPubKey;
+        if (!Solver(scriptPubKeyKernel, whichType, vSolutions))
+        {
+            LogPrint("coinstake", "CreateCoinStake : failed to parse kernel\n");
+            continue;
+        }
+        LogPrint("coinstake", "CreateCoinStake : parsed kernel type=%d\n", whichType);
+        if (whichType != TX_PUBKEY && whichType != TX_PUBKEYHASH && whichType != TX_COLDSTAKING && whichType != TX_COLDSTAKING_V2)
+        {
+            LogPrint("coinstake", "CreateCoinStake : no support for kernel type=%d\n", whichType);
+            continue;  // only support pay to public key and pay to address
+        }
+        if (whichType == TX_COLDSTAKING || whichType == TX_COLDSTAKING_V2) // cold staking
+        {
+            // try to find staking key
+            if (!keystore.GetKey(uint160(vSolutions[0]), key))
+            {
+                LogPrint("coinstake", "CreateCoinStake : failed to get key for kernel type=%d\n", whichType);
+                continue;  // unable to find corresponding public key
+            } else {
+                // we keep the same script
+                scriptPubKeyOut = scriptPubKeyKernel;
+            }
+        }
+        if (whichType == TX_PUBKEYHASH) // pay to address type
+        {
+            // convert to pay to public key type
+            if (!keystore.GetKey(uint160(vSolutions[0]), key))
+            {
+                LogPrint("coinstake", "CreateCoinStake : failed to get key for kernel type=%d\n", whichType);
+                continue;  // unable to find corresponding public key
+            }
+            scriptPubKeyOut << ToByteVector(key.GetPubKey()) << OP_CHECKSIG;
+        }
+        if (whichType == TX_PUBKEY)
+        {
+            std::vector<unsigned char>& vchPubKey = vSolutions[0];
+            if (!keystore.GetKey(Hash160(vchPubKey), key))
+            {
+                LogPrint("coinstake", "CreateCoinStake : failed to get key for kernel type=%d\n", whichType);
+                continue;  // unable to find corresponding public key
+            }
 
-                LogPrint("coinstake", "CreateCoinStake : added kernel type=%d\n", whichType);
-                fKernelFound = true;
-                break;
+            if (key.GetPubKey() != vchPubKey)
+            {
+                LogPrint("coinstake", "CreateCoinStake : invalid key for kernel type=%d\n", whichType);
+                continue; // keys mismatch
             }
+
+            scriptPubKeyOut = scriptPubKeyKernel;
         }
 
-        if (fKernelFound)
-            break; // if kernel is found stop searching
+        txNew.nTime = nTimeKernel;
+        txNew.vin.push_back(CTxIn(prevoutStake.hash, prevoutStake.n));
+        nCredit += pcoin->vout[prevoutStake.n].nValue;
+        vwtxPrev.insert(make_pair(pcoin,prevoutStake.n));
+        txNew.vout.push_back(CTxOut(0, scriptPubKeyOut));
+        kernelScriptPubKey = scriptPubKeyKernel;
+
+        LogPrint("coinstake", "CreateCoinStake : added kernel type=%d\n", whichType);
+        fKernelFound = true;
     }
 
     if (nCredit == 0 || nCredit > nBalance - nReserveBalance)
@@ -763,7 +885,7 @@ bool CWallet::CreateCoinStake(const CKeyStore& keystore, unsigned int nBits, int
         Scalar diff = gammaIns-gammaOuts;
         try
         {
-            bls::PrivateKey balanceSigningKey = bls::PrivateKey::FromBN(diff.bn);
+            bls::PrivateKey balanceSigningKey = diff.GetPrivateKey();
             txNew.vchBalanceSig = bls::BasicSchemeMPL::Sign(balanceSigningKey, balanceMsg).Serialize();
         }
         catch(...)
@@ -1472,6 +1594,9 @@ void CWallet::MarkDirty()
         LOCK(cs_wallet);
         for(PAIRTYPE(const uint256, CWalletTx)& item: mapWallet)
             item.second.MarkDirty();
+
+        // Ownership of outputs may have changed, rebuild the staking index
+        pindexStakeable = NULL;
     }
 }
 
@@ -1611,51 +1736,11 @@ bool CWallet::AddToWallet(const CWalletTx& wtxIn, bool fFromLoadWallet, CWalletD
 
             if (blsctData == nullptr)
             {
-                CValidationState state;
-                CStateView dummy;
-                CStateViewCache view(&dummy);
                 blsctKey k;
 
                 if (GetBLSCTViewKey(k))
                 {
-                    std::vector<bls::G1Element> nonces;
-                    std::vector<std::pair<int, BulletproofsRangeproof>> proofs;
-
-                    bls::PrivateKey vk = k.GetKey();
-
-                    for (unsigned int i = 0; i < wtx.vout.size(); i++)
-                    {
-                        CTxOut out = wtx.vout[i];
-
-                        if (out.outputKey.size() == 0 || out.outputKey.size() == 0 || out.spendingKey.size() == 0)
-                            continue;
-
-                        bls::G1Element n = bls::G1Element::FromByteVector(out.outputKey);
-                        n = n * vk;
-
-                        uint256 ekhash = SerializeHash(out.ephemeralKey);
-
-                        bool fHaveSubAddressKey = CBasicKeyStore::HaveBLSCTSubAddress(out.outputKey, out.spendingKey);
-
-                        if (mapNonces.count(ekhash) && mapNonces[ekhash].size() > 0 && !fHaveSubAddressKey)
-                        {
-                            try
-                            {
-                                n = bls::G1Element::FromByteVector(mapNonces[ekhash]);
-                            }
-                            catch(...)
-                            {
-                                proofs.push_back(std::make_pair(i, out.GetBulletproof()));
-                                nonces.push_back(n);
-                                continue;
-                            }
-
-                        }
-                        proofs.push_back(std::make_pair(i, out.GetBulletproof()));
-                        nonces.push_back(n);
-                    }
-
-                    if (!VerifyBulletproof(proofs, data, nonces, true))
+                    if (!RecoverBLSCTOutputs(wtx, k.GetKey(), mapNonces, data))
                     {
                         return error("%s: VerifyBulletproof returned false\n", __func__);
                     }
@@ -1697,6 +1782,11 @@ bool CWallet::AddToWallet(const CWalletTx& wtxIn, bool fFromLoadWallet, CWalletD
         // Break debit/credit balance caches:
         wtx.MarkDirty();
 
+        // Check the stakeable outputs of the transaction and of the ones it spends again
+        MarkStakeableDirty(hash);
+        for(const CTxIn& txin: wtx.vin)
+            MarkStakeableDirty(txin.prevout.hash);
+
         // Notify UI of new or updated transaction
         NotifyTransactionChanged(this, hash, fInsertedNew ? CT_NEW : CT_UPDATED);
 
@@ -1713,6 +1803,48 @@ bool CWallet::AddToWallet(const CWalletTx& wtxIn, bool fFromLoadWallet, CWalletD
     return true;
 }
 
+bool CWallet::RecoverBLSCTOutputs(const CTransaction& tx, const bls::PrivateKey& vk, const std::map<uint256, std::vector<unsigned char>>& mapNoncesIn, std::vector<RangeproofEncodedData>& data) const
+{
+    std::vector<bls::G1Element> nonces;
+    std::vector<std::pair<int, BulletproofsRangeproof>> proofs;
+
+    for (unsigned int i = 0; i < tx.vout.size(); i++)
+    {
+        CTxOut out = tx.vout[i];
+
+        if (out.outputKey.size() == 0 || out.outputKey.size() == 0 || out.spendingKey.size() == 0)
+            continue;
+
+        bls::G1Element n = bls::G1Element::FromByteVector(out.outputKey);
+        n = n * vk;
+
+        uint256 ekhash = SerializeHash(out.ephemeralKey);
+
+        bool fHaveSubAddressKey = CBasicKeyStore::HaveBLSCTSubAddress(out.outputKey, out.spendingKey);
+
+        std::map<uint256, std::vector<unsigned char>>::const_iterator it = mapNoncesIn.find(ekhash);
+
+        if (it != mapNoncesIn.end() && it->second.size() > 0 && !fHaveSubAddressKey)
+        {
+            try
+            {
+                n = bls::G1Element::FromByteVector(it->second);
+            }
+            catch(...)
+            {
+                proofs.push_back(std::make_pair(i, out.GetBulletproof()));
+                nonces.push_back(n);
+                continue;
+            }
+
+        }
+        proofs.push_back(std::make_pair(i, out.GetBulletproof()));
+        nonces.push_back(n);
+    }
+
+    return VerifyBulletproof(proofs, data, nonces, true);
+}
+
 /**
  * Add a transaction to the wallet, or update it.
  * pblock is optional, but should be provided if the transaction is known to be in a block.
@@ -1800,6 +1932,7 @@ bool CWallet::AbandonTransaction(const uint256& hashTx)
             wtx.nIndex = -1;
             wtx.setAbandoned();
             wtx.MarkDirty();
+            MarkStakeableDirty(now);
             walletdb.WriteTx(wtx);
             NotifyTransactionChanged(this, wtx.GetHash(), CT_UPDATED);
             // Iterate over all its outputs, and mark transactions in the wallet that spend them abandoned too
@@ -1815,7 +1948,10 @@ bool CWallet::AbandonTransaction(const uint256& hashTx)
             for(const CTxIn& txin: wtx.vin)
             {
                 if (mapWallet.count(txin.prevout.hash))
+                {
                     mapWallet[txin.prevout.hash].MarkDirty();
+                    MarkStakeableDirty(txin.prevout.hash);
+                }
             }
         }
     }
@@ -1862,6 +1998,7 @@ void CWallet::MarkConflicted(const uint256& hashBlock, const uint256& hashTx)
             wtx.nIndex = -1;
             wtx.hashBlock = hashBlock;
             wtx.MarkDirty();
+            MarkStakeableDirty(now);
             walletdb.WriteTx(wtx);
             // Iterate over all its outputs, and mark transactions in the wallet that spend them conflicted too
             TxSpends::const_iterator iter = mapTxSpends.lower_bound(COutPoint(now, 0));
@@ -1876,7 +2013,10 @@ void CWallet::MarkConflicted(const uint256& hashBlock, const uint256& hashTx)
             for(const CTxIn& txin: wtx.vin)
             {
                 if (mapWallet.count(txin.prevout.hash))
+                {
                     mapWallet[txin.prevout.hash].MarkDirty();
+                    MarkStakeableDirty(txin.prevout.hash);
+                }
             }
         }
     }
@@ -1895,7 +2035,10 @@ void CWallet::SyncTransaction(const CTransaction& tx, const CBlockIndex *pindex,
     for(const CTxIn& txin: tx.vin)
     {
         if (mapWallet.count(txin.prevout.hash))
+        {
             mapWallet[txin.prevout.hash].MarkDirty();
+            MarkStakeableDirty(txin.prevout.hash);
+        }
     }
 }
 
@@ -2312,6 +2455,165 @@ void CWalletTx::GetAccountAmounts(const string& strAccount, CAmount& nReceived,
     }
 }
 
+/** A block of a wallet rescan, read ahead and matched against the wallet outside of its locks */
+struct CRescanBlock
+{
+    CBlockIndex* pindex;
+    CBlock block;
+    //! Transactions paying to the wallet
+    std::vector<bool> vfMine;
+    //! BLSCT output data recovered with the view key, per transaction
+    std::vector<std::vector<RangeproofEncodedData>> vBLSCTData;
+    //! Transactions with vBLSCTData recovered, the others are recovered when added like a connected block
+    std::vector<bool> vfBLSCTData;
+    bool fDone;
+
+    CRescanBlock(CBlockIndex* pindexIn) : pindex(pindexIn), fDone(false) {}
+};
+
+/**
+ * Pipeline of a wallet rescan: a reader thread reads blocks ahead, worker threads
+ * match their outputs against the keystore and recover BLSCT outputs, and the
+ * rescanning thread adds them to the wallet in height order. Only the rescanning
+ * thread walks the chain, as its caller may already hold cs_main, and it checks
+ * the blocks are still in the active chain as it adds them.
+ */
+class CRescanPipeline
+{
+public:
+    boost::mutex mutex;
+    boost::condition_variable cond;
+    //! Blocks to be read, in height order
+    std::deque<CBlockIndex*> queueIndex;
+    //! Blocks read, in height order, from the next one to be added to the wallet
+    std::deque<std::shared_ptr<CRescanBlock>> queue;
+    //! Position in queue of the next block to be matched
+    size_t nNextWork;
+    size_t nMaxAhead;
+    bool fIndexDone;
+    bool fReadDone;
+    bool fStop;
+
+    CRescanPipeline(size_t nMaxAheadIn) : nNextWork(0), nMaxAhead(nMaxAheadIn), fIndexDone(false), fReadDone(false), fStop(false) {}
+
+    //! Stops the reader and worker threads, leaving the blocks they haven't finished
+    void Stop()
+    {
+        {
+            boost::unique_lock<boost::mutex> lock(mutex);
+            fStop = true;
+        }
+        cond.notify_all();
+    }
+
+    //! Queues the blocks following pindexNext in the active chain for reading
+    void QueueBlocks(CBlockIndex*& pindexNext)
+    {
+        AssertLockHeld(cs_main);
+
+        {
+            boost::unique_lock<boost::mutex> lock(mutex);
+            while (pindexNext && queueIndex.size() < nMaxAhead)
+            {
+                queueIndex.push_back(pindexNext);
+                pindexNext = chainActive.Next(pindexNext);
+            }
+            if (!pindexNext)
+                fIndexDone = true;
+        }
+        cond.notify_all();
+    }
+};
+
+static const int RESCAN_BLOCKS_PER_WORKER = 16;
+
+static void ThreadRescanRead(CRescanPipeline* pipeline)
+{
+    RenameThread("navcoin-rescanread");
+
+    const Consensus::Params& consensusParams = Params().GetConsensus();
+
+    while (true)
+    {
+        CBlockIndex* pindex;
+
+        {
+            boost::unique_lock<boost::mutex> lock(pipeline->mutex);
+            while (!pipeline->fStop && !(pipeline->fIndexDone && pipeline->queueIndex.empty()) &&
+                   (pipeline->queueIndex.empty() || pipeline->queue.size() >= pipeline->nMaxAhead))
+                pipeline->cond.wait(lock);
+            if (pipeline->fStop || pipeline->queueIndex.empty())
+                break;
+            pindex = pipeline->queueIndex.front();
+            pipeline->queueIndex.pop_front();
+        }
+
+        std::shared_ptr<CRescanBlock> item(new CRescanBlock(pindex));
+        ReadBlockFromDisk(item->block, pindex, consensusParams);
+
+        {
+            boost::unique_lock<boost::mutex> lock(pipeline->mutex);
+            pipeline->queue.push_back(item);
+        }
+        pipeline->cond.notify_all();
+    }
+
+    {
+        boost::unique_lock<boost::mutex> lock(pipeline->mutex);
+        pipeline->fReadDone = true;
+    }
+    pipeline->cond.notify_all();
+}
+
+static void ThreadRescanMatch(CRescanPipeline* pipeline, const CWallet* pwallet, const blsctKey* pViewKey,
+                              const std::map<uint256, std::vector<unsigned char>>* pmapNonces)
+{
+    RenameThread("navcoin-rescan");
+
+    while (true)
+    {
+        std::shared_ptr<CRescanBlock> item;
+
+        {
+            boost::unique_lock<boost::mutex> lock(pipeline->mutex);
+            while (!pipeline->fStop && pipeline->nNextWork >= pipeline->queue.size() && !pipeline->fReadDone)
+                pipeline->cond.wait(lock);
+            if (pipeline->fStop || pipeline->nNextWork >= pipeline->queue.size())
+                return;
+            item = pipeline->queue[pipeline->nNextWork++];
+        }
+
+        const std::vector<CTransaction>& vtx = item->block.vtx;
+        item->vfMine.resize(vtx.size());
+        item->vBLSCTData.resize(vtx.size());
+        item->vfBLSCTData.resize(vtx.size());
+
+        for (unsigned int i = 0; i < vtx.size(); i++)
+        {
+            item->vfMine[i] = pwallet->IsMine(vtx[i]);
+
+            if (item->vfMine[i] && pViewKey && vtx[i].IsCTOutput())
+            {
+                try
+                {
+                    item->vfBLSCTData[i] = pwallet->RecoverBLSCTOutputs(vtx[i], pViewKey->GetKey(), *pmapNonces, item->vBLSCTData[i]);
+                }
+                catch(...)
+                {
+                }
+                if (!item->vfBLSCTData[i])
+                    item->vBLSCTData[i].clear();
+            }
+        }
+
+        {
+            boost::unique_lock<boost::mutex> lock(pipeline->mutex);
+            item->fDone = true;
+        }
+        pipeline->cond.notify_all();
+    }
+}
+
 /**
  * Scan the block chain (starting in pindexStart) for transactions
  * from or to us. If fUpdate is true, found transactions that already
@@ -2321,42 +2623,153 @@ int CWallet::ScanForWalletTransactions(CBlockIndex* pindexStart, bool fUpdate)
 {
     int ret = 0;
     int64_t nNow = GetTime();
+    int64_t nTimeStart = GetTimeMillis();
     const CChainParams& chainParams = Params();
 
     CBlockIndex* pindex = pindexStart;
+    double dProgressStart, dProgressTip;
+
+    int nWorkers = std::max(1, nScriptCheckThreads);
+
     {
-        LOCK2(cs_main, cs_wallet);
+        LOCK(cs_main);
 
         // no need to read and scan block, if block was created before
         // our wallet birthday (as adjusted for block time variability)
         while (pindex && nTimeFirstKey && (pindex->GetBlockTime() < (nTimeFirstKey - 7200)))
             pindex = chainActive.Next(pindex);
 
-        ShowProgress(_("Rescanning..."), 0); // show rescan progress in GUI as dialog or on splashscreen, if -rescan on startup
-        double dProgressStart = Checkpoints::GuessVerificationProgress(chainParams.Checkpoints(), pindex, false);
-        double dProgressTip = Checkpoints::GuessVerificationProgress(chainParams.Checkpoints(), chainActive.Tip(), false);
-        while (pindex)
+        dProgressStart = Checkpoints::GuessVerificationProgress(chainParams.Checkpoints(), pindex, false);
+        dProgressTip = Checkpoints::GuessVerificationProgress(chainParams.Checkpoints(), chainActive.Tip(), false);
+    }
+
+    ShowProgress(_("Rescanning..."), 0); // show rescan progress in GUI as dialog or on splashscreen, if -rescan on startup
+
+    // Recovering BLSCT outputs needs the view key and the nonces of our mixing sessions
+    blsctKey k;
+    bool fHaveViewKey = GetBLSCTViewKey(k);
+    std::map<uint256, std::vector<unsigned char>> mapNoncesCopy;
+    {
+        LOCK(cs_wallet);
+        mapNoncesCopy = mapNonces;
+    }
+
+    int nBlocks = 0;
+    int nTx = 0;
+
+    // The pipeline is started again from the fork point when the chain is
+    // reorganized under the blocks it read ahead
+    while (pindex)
+    {
+        CRescanPipeline pipeline(nWorkers * RESCAN_BLOCKS_PER_WORKER);
+
         {
-            if (pindex->nHeight % 100 == 0 && dProgressTip - dProgressStart > 0.0)
-                ShowProgress(_("Rescanning..."), std::max(1, std::min(99, (int)((Checkpoints::GuessVerificationProgress(chainParams.Checkpoints(), pindex, false) - dProgressStart) / (dProgressTip - dProgressStart) * 100))));
+            LOCK(cs_main);
+            pipeline.QueueBlocks(pindex);
+        }
+
+        boost::thread_group threads;
+        threads.create_thread(boost::bind(&ThreadRescanRead, &pipeline));
+        for (int i = 0; i < nWorkers; i++)
+            threads.create_thread(boost::bind(&ThreadRescanMatch, &pipeline, this, fHaveViewKey ? &k : nullptr, &mapNoncesCopy));
 
-            CBlock block;
-            ReadBlockFromDisk(block, pindex, Params().GetConsensus());
-            for(CTransaction& tx: block.vtx)
+        try
+        {
+            while (true)
             {
-                std::vector<RangeproofEncodedData> blsctData;
+                std::shared_ptr<CRescanBlock> item;
 
-                if (AddToWalletIfInvolvingMe(tx, &block, fUpdate, &blsctData))
-                    ret++;
-            }
-            pindex = chainActive.Next(pindex);
-            if (GetTime() >= nNow + 60) {
-                nNow = GetTime();
-                LogPrintf("Still rescanning. At block %d. Progress=%f\n", pindex->nHeight, Checkpoints::GuessVerificationProgress(chainParams.Checkpoints(), pindex));
+                {
+                    boost::unique_lock<boost::mutex> lock(pipeline.mutex);
+                    while (!(pipeline.queue.size() > 0 && pipeline.queue.front()->fDone) && !(pipeline.fReadDone && pipeline.queue.empty()))
+                        pipeline.cond.wait(lock);
+                    if (pipeline.queue.empty())
+                        break;
+                    item = pipeline.queue.front();
+                    pipeline.queue.pop_front();
+                    pipeline.nNextWork--;
+                }
+                pipeline.cond.notify_all();
+
+                const CBlock& block = item->block;
+
+                if (item->pindex->nHeight % 100 == 0 && dProgressTip - dProgressStart > 0.0)
+                    ShowProgress(_("Rescanning..."), std::max(1, std::min(99, (int)((Checkpoints::GuessVerificationProgress(chainParams.Checkpoints(), item->pindex, false) - dProgressStart) / (dProgressTip - dProgressStart) * 100))));
+
+                {
+                    LOCK2(cs_main, cs_wallet);
+
+                    // Either this block or the next one to be queued left the active chain,
+                    // continue from this block or from where its chain forks
+                    if (!chainActive.Contains(item->pindex) || (pindex && !chainActive.Contains(pindex)))
+                    {
+                        const CBlockIndex* pindexFork = chainActive.FindFork(item->pindex);
+                        if (pindexFork == item->pindex)
+                            pindex = item->pindex;
+                        else
+                            pindex = pindexFork ? chainActive.Next(pindexFork) : chainActive.Genesis();
+                        LogPrintf("%s: chain reorganized while rescanning at block %d, rescanning again from block %d\n", __func__,
+                                  item->pindex->nHeight, pindex ? pindex->nHeight : -1);
+                        break;
+                    }
+
+                    pipeline.QueueBlocks(pindex);
+
+                    for (unsigned int i = 0; i < block.vtx.size(); i++)
+                    {
+                        const CTransaction& tx = block.vtx[i];
+
+                        // Transactions not paying to us only matter if they spend from or conflict with the wallet
+                        if (!item->vfMine[i] && !mapWallet.count(tx.GetHash()))
+                        {
+                            bool fSpendsWallet = false;
+                            for (const CTxIn& txin: tx.vin)
+                            {
+                                if (mapWallet.count(txin.prevout.hash) || mapTxSpends.count(txin.prevout))
+                                {
+                                    fSpendsWallet = true;
+                                    break;
+                                }
+                            }
+                            if (!fSpendsWallet)
+                                continue;
+                        }
+
+                        if (AddToWalletIfInvolvingMe(tx, &block, fUpdate, item->vfBLSCTData[i] ? &item->vBLSCTData[i] : nullptr))
+                            ret++;
+                    }
+                }
+
+                nBlocks++;
+                nTx += block.vtx.size();
+
+                if (GetTime() >= nNow + 60) {
+                    nNow = GetTime();
+                    int64_t nElapsed = GetTimeMillis() - nTimeStart;
+                    LogPrintf("Still rescanning. At block %d. Progress=%f, %.2f blocks/s, %.2f tx/s\n", item->pindex->nHeight,
+                              Checkpoints::GuessVerificationProgress(chainParams.Checkpoints(), item->pindex),
+                              nElapsed > 0 ? nBlocks * 1000.0 / nElapsed : 0.0, nElapsed > 0 ? nTx * 1000.0 / nElapsed : 0.0);
+                }
             }
         }
-        ShowProgress(_("Rescanning..."), 100); // hide progress dialog in GUI
+        catch (...)
+        {
+            // Don't leave the pipeline threads waiting on blocks which will never be added
+            pipeline.Stop();
+            threads.join_all();
+            throw;
+        }
+
+        // Stopped early when the chain was reorganized
+        pipeline.Stop();
+        threads.join_all();
     }
+
+    ShowProgress(_("Rescanning..."), 100); // hide progress dialog in GUI
+
+    LogPrintf("Rescanned %d blocks (%d transactions, %d found) with %d threads in %.2fs\n", nBlocks, nTx, ret, nWorkers,
+              (GetTimeMillis() - nTimeStart) * 0.001);
+
     return ret;
 }
 
@@ -3907,7 +4320,7 @@ bool CWallet::CreateTransaction(const vector<CRecipient>& vecSend, CWalletTx& wt
                     Scalar diff = gammaIns-gammaOuts;
                     try
                     {
-                        bls::PrivateKey balanceSigningKey = bls::PrivateKey::FromBN(diff.bn);
+                        bls::PrivateKey balanceSigningKey = diff.GetPrivateKey();
                         txNew.vchBalanceSig = bls::BasicSchemeMPL::Sign(balanceSigningKey, balanceMsg).Serialize();
                     }
                     catch(...)
@@ -4009,7 +4422,7 @@ bool CWallet::CreateTransaction(const vector<CRecipient>& vecSend, CWalletTx& wt
 
                     try
                     {
-                        if (!(coinsToMix && coinsToMix->tx.vin.size() > 0) && !VerifyBLSCT(txNew, bls::PrivateKey::FromBN(Scalar::Rand().bn), blsctData, inputs, state, true))
+                        if (!(coinsToMix && coinsToMix->tx.vin.size() > 0) && !VerifyBLSCT(txNew, Scalar::Rand().GetPrivateKey(), blsctData, inputs, state, true))
                         {
                             strFailReason = FormatStateMessage(state);
                             return false;
@@ -787,6 +787,24 @@ private:
 
     void SyncMetaData(std::pair<TxSpends::iterator, TxSpends::iterator>);
 
+    /**
+     * Outputs which may stake, bucketed by the time they reach the minimum stake
+     * age, so staking attempts don't need to scan the whole wallet. Transactions
+     * are checked again when marked dirty, immature coinstakes on every new tip.
+     */
+    mutable std::map<int64_t, std::set<COutPoint> > mapStakeableCoins;
+    //! Bucket of each transaction with outputs in mapStakeableCoins
+    mutable std::map<uint256, int64_t> mapStakeableTxs;
+    mutable std::set<uint256> setStakeableDirty;
+    mutable std::set<uint256> setStakeableImmature;
+    //! Tip the index was last updated at, NULL when it needs to be rebuilt
+    mutable const CBlockIndex* pindexStakeable;
+    mutable CAmount nStakeableMinInputValue;
+
+    void MarkStakeableDirty(const uint256& hash) const;
+    void UpdateStakeableCoins(const uint256& hash) const;
+    void UpdateStakeableCoins() const;
+
     /* the HD chain data model (external chain counters) */
     CHDChain hdChain;
 
@@ -853,6 +871,8 @@ public:
         aggSession = 0;
         fNeedsBLSCTGeneration = false;
         fBroadcastTransactions = false;
+        pindexStakeable = NULL;
+        nStakeableMinInputValue = 0;
     }
 
     bool IsHDEnabled() const;
@@ -909,6 +929,8 @@ public:
     void ListLockedCoins(std::vector<COutPoint>& vOutpts);
     uint64_t GetStakeWeight() const;
     bool CreateCoinStake(const CKeyStore& keystore, unsigned int nBits, int64_t nSearchInterval, int64_t nFees, CMutableTransaction& txNew, CKey& key, CScript& kernelScriptPubKey);
+    //! Whether any staking output has a kernel on top of pindexPrev at nTime, without building a coinstake
+    bool FindStakeKernel(const CBlockIndex* pindexPrev, unsigned int nBits, unsigned int nTime) const;
     int64_t GetStake() const;
     int64_t GetNewMint() const;
     bool GenerateBLSCT();
@@ -976,6 +998,8 @@ public:
 
     void MarkDirty();
     bool AddToWallet(const CWalletTx& wtxIn, bool fFromLoadWallet, CWalletDB* pwalletdb, const std::vector<RangeproofEncodedData> *blsctData = nullptr);
+    //! Recovers the data of the BLSCT outputs of tx with the view key vk and the nonces of our mixing sessions
+    bool RecoverBLSCTOutputs(const CTransaction& tx, const bls::PrivateKey& vk, const std::map<uint256, std::vector<unsigned char>>& mapNoncesIn, std::vector<RangeproofEncodedData>& data) const;
     void SyncTransaction(const CTransaction& tx, const CBlockIndex *pindex, const CBlock* pblock, const bool fConnect = true, const std::vector<RangeproofEncodedData> *blsctData = nullptr);
     bool AddToWalletIfInvolvingMe(const CTransaction& tx, const CBlock* pblock, bool fUpdate, const std::vector<RangeproofEncodedData> *blsctData = nullptr);
     int ScanForWalletTransactions(CBlockIndex* pindexStart, bool fUpdate = false);
@@ -122,6 +122,7 @@ testScripts = [
     'rawtransactions.py',
      'rest.py',
      'mempool_spendcoinbase.py',
+     'mempool_persist.py',
 #    'mempool_reorg.py',
 #    'mempool_limit.py',
      'httpbasics.py',
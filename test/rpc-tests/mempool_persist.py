@@ -0,0 +1,77 @@
+#!/usr/bin/env python3
+# Copyright (c) 2020 The Navcoin developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#
+# Test the mempool is dumped on shutdown and loaded on startup,
+# keeping the entry times and the fee deltas, unless -persistmempool=0.
+#
+
+import time
+
+from test_framework.test_framework import NavcoinTestFramework
+from test_framework.util import *
+
+
+class MempoolPersistTest(NavcoinTestFramework):
+
+    def __init__(self):
+        super().__init__()
+        self.setup_clean_chain = True
+        self.num_nodes = 2
+
+    def setup_network(self):
+        # Node 1 sends the transactions, straight to the mempool instead of the stempool.
+        # Node 0 is the one restarted, its wallet doesn't add them back to the mempool.
+        self.nodes = start_nodes(self.num_nodes, self.options.tmpdir, [[], ["-dandelion=0"]])
+        connect_nodes_bi(self.nodes, 0, 1)
+        self.is_network_split = False
+        self.sync_all()
+
+    def restart_node(self, extra_args=None):
+        self.nodes[0].stop()
+        navcoind_processes[0].wait()
+        self.nodes[0] = start_node(0, self.options.tmpdir, extra_args)
+
+    def wait_for_mempool_size(self, size):
+        # The mempool is loaded in the background once the chain is activated
+        for i in range(100):
+            if len(self.nodes[0].getrawmempool()) == size:
+                return
+            time.sleep(0.1)
+        assert_equal(len(self.nodes[0].getrawmempool()), size)
+
+    def run_test(self):
+        print("Mining blocks...")
+        slow_gen(self.nodes[1], 101)
+        self.sync_all()
+
+        txids = [self.nodes[1].sendtoaddress(self.nodes[1].getnewaddress(), 10) for i in range(5)]
+        self.sync_all()
+        self.nodes[0].prioritisetransaction(txids[0], 0, 1000)
+        entries = self.nodes[0].getrawmempool(True)
+        assert_equal(len(entries), 5)
+
+        print("Restarting the node, the mempool is loaded from disk...")
+        self.restart_node()
+        self.wait_for_mempool_size(5)
+
+        loaded = self.nodes[0].getrawmempool(True)
+        for txid in txids:
+            assert_equal(loaded[txid]['time'], entries[txid]['time'])
+            assert_equal(loaded[txid]['modifiedfee'], entries[txid]['modifiedfee'])
+        assert_equal(loaded[txids[0]]['modifiedfee'], loaded[txids[0]]['fee'] + Decimal('0.00001000'))
+
+        print("Restarting the node with -persistmempool=0, the mempool starts empty...")
+        self.restart_node(["-persistmempool=0"])
+        time.sleep(1)
+        assert_equal(len(self.nodes[0].getrawmempool()), 0)
+
+        print("Restarting the node, the dump was not overwritten by the empty mempool...")
+        self.restart_node()
+        self.wait_for_mempool_size(5)
+
+
+if __name__ == '__main__':
+    MempoolPersistTest().main()